@@ -171,12 +171,16 @@ bool VideoPlayerModel::OnVideoFrame(const AVFrameRef& frame)
 
 bool VideoPlayerModel::OnAudioFrame(const AVFrameRef& frame)
 {
-	AVFrameRef outFrame;
-	m_audioTransForPlayer->transformat(frame.data(), frame.sampleCount(), outFrame);
-	m_audioPlayer->playAudio(outFrame.data(0), outFrame.sampleCount());
+	m_audioTransForPlayer->transformat(frame.data(), frame.sampleCount(), m_audioOutFrame);
+	m_audioPlayer->playAudio(m_audioOutFrame.data(0), m_audioOutFrame.sampleCount());
 	return true;
 }
 
+int VideoPlayerModel::audioPendingTime()
+{
+	return m_audioPlayer->pendingTime();
+}
+
 void VideoPlayerModel::ToEndSignal()
 {
     std::weak_ptr<VideoPlayerModel> weakThis = shared_from_this();
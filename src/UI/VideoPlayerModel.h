@@ -48,6 +48,7 @@ protected:
 	virtual bool OnVideoFrame(const AVFrameRef& frame);
 	virtual bool OnAudioFrame(const AVFrameRef& frame);
 	virtual void ToEndSignal();
+	virtual int audioPendingTime();
 protected:
 	std::weak_ptr<VideoFrameNotify> m_videoNotify;
 
@@ -55,6 +56,7 @@ protected:
 	std::unique_ptr<QcMultiMediaPlayer> m_player;
 	std::unique_ptr<QcAudioPlayer> m_audioPlayer;
 	std::unique_ptr<QcAudioTransformat> m_audioTransForPlayer;
+	AVFrameRef m_audioOutFrame;     //reused by OnAudioFrame, only the audio thread touches it
 
 	std::vector<std::wstring> m_fileList;
 	std::wstring m_currentPlayFile;
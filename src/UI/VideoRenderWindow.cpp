@@ -5,6 +5,7 @@
 #include "win/MsgWnd.h"
 #include "libmedia/FFmpegVideoTransformat.h"
 #include "libmedia/FFmpegUtils.h"
+#include "libmedia/QsVideoConvert.h"
 #include "utils/LogTimeElapsed.h"
 #include <d3d11.h>
 
@@ -29,6 +30,8 @@ VideoRenderWindow::VideoRenderWindow()
 #endif
 
 	m_transFormat = std::make_unique<FFmpegVideoTransformat>();
+	//the software paths convert on the render thread, spread it over a few cores.
+	m_transFormat->setThreadCount(0);
 }
 
 VideoRenderWindow::~VideoRenderWindow()
@@ -94,8 +97,18 @@ void VideoRenderWindow::onRender()
 			frame = m_lastFrame;
 		}
 		frame = AVFrameRef::fromHWFrame(frame);
-		m_transFormat->transformat(frame.width(), frame.height(), frame.format(), frame.data(), frame.linesize()
-			, w, h, FFmpegUtils::fourccToFFmpegFormat(m_memorySurface->format()), m_memorySurface->datas(), m_memorySurface->lineSizes());
+		int iVideoFormat = FFmpegUtils::ffmpegFormatToFourcc(frame.format());
+		//same size yuv goes through the simd converter, swscale is left with scaling and the other formats.
+		if (frame.width() == w && frame.height() == h && video::CanConvertToRGB32(iVideoFormat, m_memorySurface->format()))
+		{
+			video::ConvertToRGB32(frame.data(), frame.linesize(), iVideoFormat, m_memorySurface->datas()[0], m_memorySurface->lineSizes()[0]
+				, m_memorySurface->format(), w, h, FFmpegUtils::colorMatrix(frame), FFmpegUtils::colorRange(frame));
+		}
+		else
+		{
+			m_transFormat->transformat(frame.width(), frame.height(), frame.format(), frame.data(), frame.linesize()
+				, w, h, FFmpegUtils::fourccToFFmpegFormat(m_memorySurface->format()), m_memorySurface->datas(), m_memorySurface->lineSizes());
+		}
 
 		HDC hDC = ::GetDC(m_hWnd);
 		::BitBlt(hDC, 0, 0, w, h, m_memorySurface->dcHandle(), 0, 0, SRCCOPY);
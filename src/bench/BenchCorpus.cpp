@@ -0,0 +1,188 @@
+#include "BenchCorpus.h"
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavdevice/avdevice.h>
+}
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+namespace
+{
+    bool fileExists(const std::string& file)
+    {
+        struct stat st;
+        return stat(file.c_str(), &st) == 0 && st.st_size > 0;
+    }
+
+    //sends frame (nullptr flushes) and writes every packet the encoder hands back.
+    bool encodeFrame(AVCodecContext* pEncoder, AVFrame* frame, AVFormatContext* pOut, AVStream* pStream)
+    {
+        if (avcodec_send_frame(pEncoder, frame) < 0)
+            return false;
+        AVPacket* pkt = av_packet_alloc();
+        bool bOk = true;
+        for (;;)
+        {
+            int ret = avcodec_receive_packet(pEncoder, pkt);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+                break;
+            if (ret < 0)
+            {
+                bOk = false;
+                break;
+            }
+            av_packet_rescale_ts(pkt, pEncoder->time_base, pStream->time_base);
+            pkt->stream_index = pStream->index;
+            if (av_interleaved_write_frame(pOut, pkt) < 0)
+            {
+                bOk = false;
+                break;
+            }
+        }
+        av_packet_free(&pkt);
+        return bOk;
+    }
+}
+
+bool BenchCorpus::addFile(const std::string& file)
+{
+    if (!fileExists(file))
+    {
+        fprintf(stderr, "%s: not found\n", file.c_str());
+        return false;
+    }
+    m_files.push_back(file);
+    return true;
+}
+
+bool BenchCorpus::addSynthetic(const std::string& spec, const std::string& codec)
+{
+    int w = 0, h = 0, fps = 0, seconds = 0;
+    if (sscanf(spec.c_str(), "%dx%d@%d:%d", &w, &h, &fps, &seconds) != 4 || w <= 0 || h <= 0 || fps <= 0 || seconds <= 0)
+    {
+        fprintf(stderr, "%s: expected WxH@fps:seconds\n", spec.c_str());
+        return false;
+    }
+
+    std::string encoder = codec;
+    if (encoder.empty())
+        encoder = avcodec_find_encoder_by_name("libx264") ? "libx264" : "mpeg4";
+    char name[128];
+    snprintf(name, sizeof(name), "/testsrc2_%dx%d_%d_%ds_%s.mp4", w, h, fps, seconds, encoder.c_str());
+    std::string path = cacheDir() + name;
+    if (!fileExists(path) && !generate(path, w, h, fps, seconds, encoder))
+    {
+        fprintf(stderr, "%s: generating %s failed\n", spec.c_str(), path.c_str());
+        remove(path.c_str());
+        return false;
+    }
+    m_files.push_back(path);
+    return true;
+}
+
+std::string BenchCorpus::cacheDir()
+{
+    const char* tmp = getenv("TEMP");
+    if (tmp == nullptr)
+        tmp = getenv("TMPDIR");
+#ifdef _WIN32
+    std::string dir = std::string(tmp ? tmp : ".") + "/libmedia_bench";
+    _mkdir(dir.c_str());
+#else
+    std::string dir = std::string(tmp ? tmp : "/tmp") + "/libmedia_bench";
+    mkdir(dir.c_str(), 0755);
+#endif
+    return dir;
+}
+
+bool BenchCorpus::generate(const std::string& path, int w, int h, int fps, int seconds, const std::string& codec)
+{
+    avdevice_register_all();
+    AVInputFormat* pLavfi = av_find_input_format("lavfi");
+    const AVCodec* pCodec = avcodec_find_encoder_by_name(codec.c_str());
+    if (pLavfi == nullptr || pCodec == nullptr)
+        return false;
+
+    char graph[256];
+    snprintf(graph, sizeof(graph), "testsrc2=size=%dx%d:rate=%d:duration=%d,format=yuv420p", w, h, fps, seconds);
+    AVFormatContext* pIn = nullptr;
+    AVFormatContext* pOut = nullptr;
+    AVCodecContext* pDecoder = nullptr;
+    AVCodecContext* pEncoder = nullptr;
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    bool bOk = false;
+    do
+    {
+        if (avformat_open_input(&pIn, graph, pLavfi, nullptr) < 0 || avformat_find_stream_info(pIn, nullptr) < 0)
+            break;
+        AVStream* pInStream = pIn->streams[0];
+        const AVCodec* pRaw = avcodec_find_decoder(pInStream->codecpar->codec_id);
+        pDecoder = avcodec_alloc_context3(pRaw);
+        if (pDecoder == nullptr || avcodec_parameters_to_context(pDecoder, pInStream->codecpar) < 0
+            || avcodec_open2(pDecoder, pRaw, nullptr) < 0)
+            break;
+
+        if (avformat_alloc_output_context2(&pOut, nullptr, nullptr, path.c_str()) < 0)
+            break;
+        pEncoder = avcodec_alloc_context3(pCodec);
+        pEncoder->width = w;
+        pEncoder->height = h;
+        pEncoder->pix_fmt = AV_PIX_FMT_YUV420P;
+        pEncoder->time_base = AVRational{ 1, fps };
+        pEncoder->framerate = AVRational{ fps, 1 };
+        //a keyframe every two seconds gives the seek runs something to land on.
+        pEncoder->gop_size = fps * 2;
+        pEncoder->max_b_frames = 2;
+        pEncoder->bit_rate = (int64_t)w * h * fps / 8;
+        if (pOut->oformat->flags & AVFMT_GLOBALHEADER)
+            pEncoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        if (avcodec_open2(pEncoder, pCodec, nullptr) < 0)
+            break;
+
+        AVStream* pStream = avformat_new_stream(pOut, nullptr);
+        if (pStream == nullptr || avcodec_parameters_from_context(pStream->codecpar, pEncoder) < 0)
+            break;
+        pStream->time_base = pEncoder->time_base;
+        if (avio_open(&pOut->pb, path.c_str(), AVIO_FLAG_WRITE) < 0)
+            break;
+        if (avformat_write_header(pOut, nullptr) < 0)
+            break;
+
+        bOk = true;
+        int64_t nFrame = 0;
+        while (bOk && av_read_frame(pIn, pkt) >= 0)
+        {
+            if (avcodec_send_packet(pDecoder, pkt) >= 0)
+            {
+                while (bOk && avcodec_receive_frame(pDecoder, frame) >= 0)
+                {
+                    frame->pts = nFrame++;
+                    frame->pict_type = AV_PICTURE_TYPE_NONE;
+                    bOk = encodeFrame(pEncoder, frame, pOut, pStream);
+                    av_frame_unref(frame);
+                }
+            }
+            av_packet_unref(pkt);
+        }
+        bOk = bOk && nFrame > 0 && encodeFrame(pEncoder, nullptr, pOut, pStream);
+        bOk = av_write_trailer(pOut) == 0 && bOk;
+    } while (0);
+
+    if (pOut)
+    {
+        avio_closep(&pOut->pb);
+        avformat_free_context(pOut);
+    }
+    avcodec_free_context(&pEncoder);
+    avcodec_free_context(&pDecoder);
+    avformat_close_input(&pIn);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    return bOk;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//The media a benchmark run goes over: files given on the command line and synthetic clips
+//rendered from lavfi's testsrc2. Synthetic clips are encoded once into the temp directory and
+//reused by later runs with the same parameters, so results stay comparable across releases.
+class BenchCorpus
+{
+public:
+    bool addFile(const std::string& file);
+    //spec is WxH@fps:seconds, e.g. 1920x1080@30:10. codec is an encoder name, empty picks
+    //libx264 when the ffmpeg build has it and mpeg4 otherwise.
+    bool addSynthetic(const std::string& spec, const std::string& codec);
+
+    const std::vector<std::string>& files() const { return m_files; }
+protected:
+    static std::string cacheDir();
+    static bool generate(const std::string& path, int w, int h, int fps, int seconds, const std::string& codec);
+protected:
+    std::vector<std::string> m_files;
+};
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "BenchReport.h"
+#include <stdio.h>
+
+namespace
+{
+    std::string quoted(const std::string& s)
+    {
+        std::string out = "\"";
+        for (unsigned char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (c < 0x20)
+            {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                out += buffer;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    std::string number(double v)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.3f", v);
+        return buffer;
+    }
+}
+
+BenchReport::BenchReport(const QsDecoderOptions& options)
+    : m_options(options)
+{
+
+}
+
+void BenchReport::add(const QsBenchResult& result)
+{
+    m_results.push_back(result);
+}
+
+bool BenchReport::allOk() const
+{
+    for (const QsBenchResult& result : m_results)
+    {
+        if (!result.ok)
+            return false;
+    }
+    return !m_results.empty();
+}
+
+std::string BenchReport::toJson() const
+{
+    std::string json = "{\n  \"version\": 1,\n";
+    json += "  \"options\": {\"threads\": " + std::to_string(m_options.threadCount)
+        + ", \"threadType\": " + std::to_string(m_options.threadType)
+        + ", \"lowDelay\": " + (m_options.lowDelay ? "true" : "false")
+        + ", \"lowres\": " + std::to_string(m_options.lowres) + "},\n";
+    json += "  \"results\": [";
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const QsBenchResult& r = m_results[i];
+        json += i ? ",\n    {" : "\n    {";
+        json += "\"file\": " + quoted(r.file);
+        json += ", \"mode\": " + quoted(r.mode);
+        json += ", \"ok\": " + std::string(r.ok ? "true" : "false");
+        json += ", \"width\": " + std::to_string(r.width);
+        json += ", \"height\": " + std::to_string(r.height);
+        json += ", \"frames\": " + std::to_string(r.frames);
+        json += ", \"wallMs\": " + number(r.wallMs);
+        json += ", \"fps\": " + number(r.fps);
+        json += ", \"cpuMs\": " + number(r.cpuMs);
+        json += ", \"peakRssKB\": " + std::to_string(r.peakRssKB);
+        json += ", \"frameMs\": {\"p50\": " + number(r.frameP50Ms) + ", \"p95\": " + number(r.frameP95Ms)
+            + ", \"p99\": " + number(r.frameP99Ms) + ", \"max\": " + number(r.frameMaxMs) + "}";
+        if (r.mode == "play")
+        {
+            json += ", \"droppedFrames\": " + std::to_string(r.droppedFrames);
+            json += ", \"lateFrames\": " + std::to_string(r.lateFrames);
+            json += ", \"avOffsetMs\": " + std::to_string(r.avOffsetMs);
+            json += ", \"seekLatencyMs\": [";
+            for (size_t j = 0; j < r.seekLatencyMs.size(); ++j)
+                json += (j ? ", " : "") + std::to_string(r.seekLatencyMs[j]);
+            json += "]";
+        }
+        else if (r.streams > 0)
+        {
+            json += ", \"streams\": " + std::to_string(r.streams);
+            json += ", \"droppedFrames\": " + std::to_string(r.droppedFrames);
+            json += ", \"lateFrames\": " + std::to_string(r.lateFrames);
+            json += ", \"contextSwitches\": " + std::to_string(r.contextSwitches);
+            json += ", \"executorRuns\": " + std::to_string(r.executorRuns);
+            json += ", \"executorSteals\": " + std::to_string(r.executorSteals);
+        }
+        else if (r.mode == "thumbnails")
+        {
+            json += ", \"workers\": " + std::to_string(r.workers);
+            json += ", \"thumbsPerCoreSec\": " + number(r.thumbsPerCoreSec);
+        }
+        json += "}";
+    }
+    json += m_results.empty() ? "]\n}\n" : "\n  ]\n}\n";
+    return json;
+}
+
+bool BenchReport::write(const std::string& path) const
+{
+    std::string json = toJson();
+    FILE* fp = path.empty() ? stdout : fopen(path.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+    bool bOk = fwrite(json.data(), 1, json.size(), fp) == json.size();
+    if (fp != stdout)
+        fclose(fp);
+    return bOk;
+}
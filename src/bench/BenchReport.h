@@ -0,0 +1,22 @@
+#pragma once
+
+#include "BenchRunner.h"
+#include <string>
+#include <vector>
+
+//Collects the results of one run and writes them as a single JSON document:
+//{ "version": 1, "options": {...}, "results": [ {...}, ... ] }
+class BenchReport
+{
+public:
+    BenchReport(const QsDecoderOptions& options);
+
+    void add(const QsBenchResult& result);
+    bool allOk() const;
+    std::string toJson() const;
+    //an empty path writes to stdout.
+    bool write(const std::string& path) const;
+protected:
+    QsDecoderOptions m_options;
+    std::vector<QsBenchResult> m_results;
+};
\ No newline at end of file
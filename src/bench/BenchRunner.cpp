@@ -0,0 +1,377 @@
+#include "BenchRunner.h"
+#include "libmedia/FFmpegDemuxer.h"
+#include "libmedia/FFmpegVideoDecoder.h"
+#include "libmedia/FFmpegVideoTransformat.h"
+#include "libmedia/FFmpegUtils.h"
+#include "libmedia/QcMultiMediaPlayer.h"
+#include "libmedia/QcTaskExecutor.h"
+#include "libmedia/QcThumbnailExtractor.h"
+#include "libmedia/AVFrameRef.h"
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    using namespace std::chrono;
+
+    double processCpuMs()
+    {
+#ifdef _WIN32
+        FILETIME create, exit, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user))
+            return 0;
+        auto toMs = [](const FILETIME& ft) {
+            return (((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 10000.0;
+        };
+        return toMs(kernel) + toMs(user);
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+        return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#endif
+    }
+
+    int64_t contextSwitches()
+    {
+#ifdef _WIN32
+        return -1;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return -1;
+        return (int64_t)usage.ru_nvcsw + usage.ru_nivcsw;
+#endif
+    }
+
+    int64_t peakRssKB()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return (int64_t)(counters.PeakWorkingSetSize / 1024);
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+        return usage.ru_maxrss;
+#endif
+    }
+
+    //fills the percentiles, times are sorted in place.
+    void setFrameTimes(QsBenchResult& result, std::vector<double>& times)
+    {
+        if (times.empty())
+            return;
+        std::sort(times.begin(), times.end());
+        auto at = [&](double fraction) {
+            return times[std::min(times.size() - 1, (size_t)(times.size() * fraction))];
+        };
+        result.frameP50Ms = at(0.5);
+        result.frameP95Ms = at(0.95);
+        result.frameP99Ms = at(0.99);
+        result.frameMaxMs = times.back();
+    }
+
+    class BenchNotify : public IMultiMediaNotify
+    {
+    public:
+        bool OnVideoFrame(const AVFrameRef&) override
+        {
+            auto now = steady_clock::now();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_bHasLast)
+                m_intervals.push_back(duration<double, std::milli>(now - m_last).count());
+            m_last = now;
+            m_bHasLast = true;
+            return true;
+        }
+        bool OnAudioFrame(const AVFrameRef&) override { return true; }
+        void ToEndSignal() override { m_bEnd = true; }
+
+        //the interval across a seek is not frame pacing, it restarts there.
+        void restart()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bHasLast = false;
+        }
+        std::vector<double> takeIntervals()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return std::move(m_intervals);
+        }
+        bool isEnd() const { return m_bEnd; }
+    protected:
+        std::mutex m_mutex;
+        std::vector<double> m_intervals;
+        steady_clock::time_point m_last;
+        bool m_bHasLast = false;
+        std::atomic<bool> m_bEnd{ false };
+    };
+
+    int waitSeekDone(QcMultiMediaPlayer& player, int timeoutMs)
+    {
+        auto end = steady_clock::now() + milliseconds(timeoutMs);
+        while (steady_clock::now() < end)
+        {
+            int latency = player.getLastSeekLatency();
+            if (latency >= 0)
+                return latency;
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        return -1;
+    }
+}
+
+BenchRunner::BenchRunner(const QsDecoderOptions& options, int playSeconds, int nSeeks)
+    : m_playSeconds(playSeconds)
+    , m_nSeeks(nSeeks)
+    , m_options(options)
+{
+
+}
+
+QsBenchResult BenchRunner::runDecode(const std::string& file, bool bConvert)
+{
+    QsBenchResult result;
+    result.file = file;
+    result.mode = bConvert ? "convert" : "decode";
+
+    FFmpegDemuxer demuxer;
+    if (!demuxer.open(file.c_str()) || demuxer.videoStream() == nullptr)
+        return result;
+    AVStream* pStream = demuxer.videoStream();
+    FFmpegVideoDecoder decoder;
+    decoder.setOptions(m_options);
+    if (!decoder.open(pStream->codecpar))
+        return result;
+    result.width = pStream->codecpar->width;
+    result.height = pStream->codecpar->height;
+
+    FFmpegVideoTransformat transformat;
+    AVFrameRef rgbFrame;
+    std::vector<double> frameTimes;
+    double cpuBegin = processCpuMs();
+    auto begin = steady_clock::now();
+    auto last = begin;
+    AVFrameRef frame;
+    auto drain = [&]() {
+        int ret;
+        while ((ret = decoder.recv(frame)) == FFmpegVideoDecoder::kOk)
+        {
+            if (bConvert)
+            {
+                if (rgbFrame.width() != frame.width() || rgbFrame.height() != frame.height())
+                    rgbFrame = AVFrameRef::allocFrame(frame.width(), frame.height(), AV_PIX_FMT_BGRA, 0);
+                transformat.transformat(frame.width(), frame.height(), frame.format(), frame.data(), frame.linesize(),
+                    rgbFrame.width(), rgbFrame.height(), AV_PIX_FMT_BGRA, rgbFrame.data(), rgbFrame.linesize());
+            }
+            auto now = steady_clock::now();
+            frameTimes.push_back(duration<double, std::milli>(now - last).count());
+            last = now;
+            ++result.frames;
+        }
+        return ret;
+    };
+
+    AVPacketPtr pkt = FFmpegUtils::allocAVPacket();
+    while (demuxer.readPacket(pkt) >= 0)
+    {
+        if (pkt->stream_index == pStream->index)
+        {
+            while (decoder.decode(pkt.get()) == AVERROR(EAGAIN))
+                drain();
+            drain();
+        }
+        av_packet_unref(pkt.get());
+    }
+    decoder.decode((const AVPacket*)nullptr);
+    while (drain() == FFmpegVideoDecoder::kAgain)
+        std::this_thread::yield();
+
+    result.wallMs = duration<double, std::milli>(steady_clock::now() - begin).count();
+    result.cpuMs = processCpuMs() - cpuBegin;
+    result.peakRssKB = peakRssKB();
+    result.fps = result.wallMs > 0 ? result.frames * 1000.0 / result.wallMs : 0;
+    setFrameTimes(result, frameTimes);
+    result.ok = result.frames > 0;
+    return result;
+}
+
+QsBenchResult BenchRunner::runPlay(const std::string& file)
+{
+    QsBenchResult result;
+    result.file = file;
+    result.mode = "play";
+
+    BenchNotify notify;
+    QcMultiMediaPlayer player(&notify);
+    if (!player.open(file.c_str(), m_options) || !player.hasVideo())
+        return result;
+    if (const QsMediaInfo* pInfo = player.getMediaInfo())
+    {
+        result.width = pInfo->videoWidth;
+        result.height = pInfo->videoHeight;
+    }
+    //no audio device here, video is paced by the external clock.
+    player.setClockMode(eExternalClock);
+
+    double cpuBegin = processCpuMs();
+    auto begin = steady_clock::now();
+    player.play();
+    auto end = begin + seconds(m_playSeconds);
+    while (steady_clock::now() < end && !notify.isEnd())
+        std::this_thread::sleep_for(milliseconds(10));
+    result.wallMs = duration<double, std::milli>(steady_clock::now() - begin).count();
+
+    QsPlayerStats stats = player.getStats();
+    result.frames = (int)stats.presentedVideoFrames;
+    result.droppedFrames = stats.droppedVideoFrames;
+    result.lateFrames = stats.lateVideoFrames;
+    result.avOffsetMs = stats.avOffsetMs;
+    result.fps = result.wallMs > 0 ? result.frames * 1000.0 / result.wallMs : 0;
+    std::vector<double> intervals = notify.takeIntervals();
+    setFrameTimes(result, intervals);
+
+    //seeks spread over the first 90% of the file, each one waited for before the next.
+    int total = player.getTotalTime();
+    for (int i = 0; i < m_nSeeks && total > 0; ++i)
+    {
+        notify.restart();
+        player.seek((int)((int64_t)total * 9 / 10 * (i * 7 % m_nSeeks + 1) / (m_nSeeks + 1)));
+        result.seekLatencyMs.push_back(waitSeekDone(player, 5000));
+    }
+    result.cpuMs = processCpuMs() - cpuBegin;
+    result.peakRssKB = peakRssKB();
+    player.close();
+    result.ok = result.frames > 0;
+    return result;
+}
+
+QsBenchResult BenchRunner::runStreams(const std::string& file, int nStreams, bool bExecutor)
+{
+    QsBenchResult result;
+    result.file = file;
+    result.mode = bExecutor ? "streams-executor" : "streams-threads";
+    result.streams = nStreams;
+
+    QcTaskExecutor* pExecutor = bExecutor ? &QcTaskExecutor::shared() : nullptr;
+    std::vector<std::unique_ptr<BenchNotify>> notifies;
+    std::vector<std::unique_ptr<QcMultiMediaPlayer>> players;
+    for (int i = 0; i < nStreams; ++i)
+    {
+        notifies.emplace_back(new BenchNotify);
+        players.emplace_back(new QcMultiMediaPlayer(notifies.back().get()));
+        QcMultiMediaPlayer& player = *players.back();
+        player.setExecutor(pExecutor);
+        if (!player.open(file.c_str(), m_options) || !player.hasVideo())
+            return result;
+        player.setClockMode(eExternalClock);
+    }
+    if (const QsMediaInfo* pInfo = players.front()->getMediaInfo())
+    {
+        result.width = pInfo->videoWidth;
+        result.height = pInfo->videoHeight;
+    }
+
+    QsExecutorStats executorBegin = pExecutor ? pExecutor->stats() : QsExecutorStats();
+    int64_t switchesBegin = contextSwitches();
+    double cpuBegin = processCpuMs();
+    auto begin = steady_clock::now();
+    for (auto& player : players)
+        player->play();
+    std::this_thread::sleep_for(seconds(m_playSeconds));
+    result.wallMs = duration<double, std::milli>(steady_clock::now() - begin).count();
+    result.cpuMs = processCpuMs() - cpuBegin;
+    int64_t switchesEnd = contextSwitches();
+    result.contextSwitches = switchesBegin < 0 || switchesEnd < 0 ? -1 : switchesEnd - switchesBegin;
+    if (pExecutor)
+    {
+        QsExecutorStats executorEnd = pExecutor->stats();
+        result.executorRuns = executorEnd.runs - executorBegin.runs;
+        result.executorSteals = executorEnd.steals - executorBegin.steals;
+    }
+
+    std::vector<double> intervals;
+    for (size_t i = 0; i < players.size(); ++i)
+    {
+        QsPlayerStats stats = players[i]->getStats();
+        result.frames += (int)stats.presentedVideoFrames;
+        result.droppedFrames += stats.droppedVideoFrames;
+        result.lateFrames += stats.lateVideoFrames;
+        std::vector<double> playerIntervals = notifies[i]->takeIntervals();
+        intervals.insert(intervals.end(), playerIntervals.begin(), playerIntervals.end());
+    }
+    result.fps = result.wallMs > 0 ? result.frames * 1000.0 / result.wallMs : 0;
+    setFrameTimes(result, intervals);
+    result.peakRssKB = peakRssKB();
+    for (auto& player : players)
+        player->close();
+    result.ok = result.frames > 0;
+    return result;
+}
+
+QsBenchResult BenchRunner::runThumbnails(const std::vector<std::string>& files, int nJobs, int nThumbs)
+{
+    QsBenchResult result;
+    result.file = files.size() == 1 ? files.front() : std::to_string(files.size()) + " files";
+    result.mode = "thumbnails";
+    if (files.empty())
+        return result;
+
+    QsThumbnailOptions options;
+    options.count = nThumbs;
+    QcTaskExecutor& executor = QcTaskExecutor::shared();
+    result.workers = executor.threadCount();
+    std::mutex mutex;
+    std::vector<double> jobTimes;
+    int failed = 0;
+
+    double cpuBegin = processCpuMs();
+    auto begin = steady_clock::now();
+    {
+        QcThumbnailPool pool(options, &executor);
+        for (int i = 0; i < nJobs; ++i)
+        {
+            pool.add(files[i % files.size()], [&](const std::string&, std::vector<QsThumbnail>& thumbnails) {
+                double ms = duration<double, std::milli>(steady_clock::now() - begin).count();
+                std::lock_guard<std::mutex> lock(mutex);
+                jobTimes.push_back(ms);
+                result.frames += (int)thumbnails.size();
+                if (thumbnails.empty())
+                    ++failed;
+                else if (result.width == 0)
+                {
+                    result.width = thumbnails.front().frame.width();
+                    result.height = thumbnails.front().frame.height();
+                }
+            });
+        }
+        pool.waitAll();
+    }
+    result.wallMs = duration<double, std::milli>(steady_clock::now() - begin).count();
+    result.cpuMs = processCpuMs() - cpuBegin;
+    result.peakRssKB = peakRssKB();
+    result.fps = result.wallMs > 0 ? result.frames * 1000.0 / result.wallMs : 0;
+    result.thumbsPerCoreSec = result.cpuMs > 0 ? result.frames * 1000.0 / result.cpuMs : 0;
+    //frameMs here is when each file finished, measured from the start.
+    setFrameTimes(result, jobTimes);
+    result.ok = result.frames > 0 && failed == 0;
+    return result;
+}
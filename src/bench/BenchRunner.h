@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "libmedia/QsMediaInfo.h"
+
+struct QsBenchResult
+{
+    std::string file;
+    std::string mode;
+    bool ok = false;
+    int width = 0;
+    int height = 0;
+    int frames = 0;
+    double wallMs = 0;
+    double fps = 0;
+    double cpuMs = 0;            //user + kernel time of the whole process during the run
+    int64_t peakRssKB = 0;       //process peak so far, runs earlier in the process count too
+    //decode modes: time per frame out of the decoder (plus conversion), play: time between presented frames.
+    double frameP50Ms = 0;
+    double frameP95Ms = 0;
+    double frameP99Ms = 0;
+    double frameMaxMs = 0;
+    //play only.
+    uint32_t droppedFrames = 0;
+    uint32_t lateFrames = 0;
+    int avOffsetMs = 0;
+    std::vector<int> seekLatencyMs;  //-1 for seeks that never presented a frame
+    //streams only, frames/droppedFrames/lateFrames above are summed over all players.
+    int streams = 0;
+    int64_t contextSwitches = -1;   //voluntary + involuntary of the whole process, -1 where the OS has no counter
+    uint64_t executorRuns = 0;
+    uint64_t executorSteals = 0;
+    //thumbnails only, frames counts thumbnails and fps is thumbnails per second.
+    int workers = 0;
+    double thumbsPerCoreSec = 0;    //thumbnails per second of cpu time, i.e. per fully busy core
+};
+
+//Runs one file through libmedia without any window or audio device.
+//decode: FFmpegDemuxer + FFmpegVideoDecoder as fast as possible.
+//convert: the same plus FFmpegVideoTransformat to BGRA, what a renderer without shaders would do.
+//play: QcMultiMediaPlayer paced in real time for playSeconds, then nSeeks seeks.
+//streams: nStreams players of the same file for playSeconds, on their own threads or the shared QcTaskExecutor.
+//thumbnails: nJobs QcThumbnailPool jobs cycling through files, nThumbs keyframe thumbnails of width 160 each.
+class BenchRunner
+{
+public:
+    BenchRunner(const QsDecoderOptions& options, int playSeconds, int nSeeks);
+
+    QsBenchResult runDecode(const std::string& file, bool bConvert);
+    QsBenchResult runPlay(const std::string& file);
+    QsBenchResult runStreams(const std::string& file, int nStreams, bool bExecutor);
+    QsBenchResult runThumbnails(const std::vector<std::string>& files, int nJobs, int nThumbs);
+protected:
+    int m_playSeconds;
+    int m_nSeeks;
+    QsDecoderOptions m_options;
+};
\ No newline at end of file
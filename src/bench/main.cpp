@@ -0,0 +1,134 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "BenchCorpus.h"
+#include "BenchRunner.h"
+#include "BenchReport.h"
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: bench [options] [file...]\n"
+        "  --mode decode|convert|play|all   default all\n"
+        "  --mode streams                   threads vs executor at each --streams count, not part of all\n"
+        "  --mode thumbnails                keyframe thumbnails of all files at once, not part of all\n"
+        "  --synthetic WxH@fps:seconds      lavfi testsrc2 clip, may be repeated\n"
+        "  --codec name                     encoder for synthetic clips, default libx264 or mpeg4\n"
+        "  --threads n                      decoder threads, 0 = one per core, default 1\n"
+        "  --play-seconds n                 real-time playback per file, default 10\n"
+        "  --seeks n                        seeks after playback, default 10\n"
+        "  --streams n,n,...                concurrent players per streams run, default 16,64,256\n"
+        "  --thumb-jobs n                   files handed to the thumbnail pool, cycling the list, default 64\n"
+        "  --thumbs n                       thumbnails per file, default 10\n"
+        "  --out file.json                  default stdout\n");
+}
+
+//the JSON goes to stdout or --out, progress and errors to stderr.
+int main(int argc, char* argv[])
+{
+    std::string mode = "all";
+    std::string codec;
+    std::string out;
+    std::vector<std::string> files;
+    std::vector<std::string> synthetic;
+    QsDecoderOptions options;
+    int playSeconds = 10;
+    int nSeeks = 10;
+    std::vector<int> streams;
+    int thumbJobs = 64;
+    int nThumbs = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool bHasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--mode") == 0 && bHasValue)
+            mode = argv[++i];
+        else if (strcmp(argv[i], "--synthetic") == 0 && bHasValue)
+            synthetic.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--codec") == 0 && bHasValue)
+            codec = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && bHasValue)
+            options.threadCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--play-seconds") == 0 && bHasValue)
+            playSeconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seeks") == 0 && bHasValue)
+            nSeeks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--streams") == 0 && bHasValue)
+        {
+            for (const char* p = argv[++i]; *p; ++p)
+            {
+                if (atoi(p) > 0)
+                    streams.push_back(atoi(p));
+                p = strchr(p, ',');
+                if (p == nullptr)
+                    break;
+            }
+        }
+        else if (strcmp(argv[i], "--thumb-jobs") == 0 && bHasValue)
+            thumbJobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--thumbs") == 0 && bHasValue)
+            nThumbs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && bHasValue)
+            out = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+
+    bool bDecode = mode == "all" || mode == "decode";
+    bool bConvert = mode == "all" || mode == "convert";
+    bool bPlay = mode == "all" || mode == "play";
+    bool bStreams = mode == "streams";
+    bool bThumbnails = mode == "thumbnails";
+    if (!(bDecode || bConvert || bPlay || bStreams || bThumbnails))
+    {
+        usage();
+        return 2;
+    }
+
+    BenchCorpus corpus;
+    for (const std::string& file : files)
+        corpus.addFile(file);
+    for (const std::string& spec : synthetic)
+        corpus.addSynthetic(spec, codec);
+    if (files.empty() && synthetic.empty())
+        corpus.addSynthetic("1280x720@30:10", codec);
+    if (streams.empty())
+        streams = { 16, 64, 256 };
+    if (corpus.files().empty())
+    {
+        usage();
+        return 2;
+    }
+
+    BenchRunner runner(options, playSeconds, nSeeks);
+    BenchReport report(options);
+    for (const std::string& file : corpus.files())
+    {
+        fprintf(stderr, "%s\n", file.c_str());
+        if (bDecode)
+            report.add(runner.runDecode(file, false));
+        if (bConvert)
+            report.add(runner.runDecode(file, true));
+        if (bPlay)
+            report.add(runner.runPlay(file));
+        for (int i = 0; bStreams && i < (int)streams.size(); ++i)
+        {
+            report.add(runner.runStreams(file, streams[i], false));
+            report.add(runner.runStreams(file, streams[i], true));
+        }
+    }
+    if (bThumbnails)
+        report.add(runner.runThumbnails(corpus.files(), thumbJobs, nThumbs));
+    if (!report.write(out))
+    {
+        fprintf(stderr, "%s: write failed\n", out.c_str());
+        return 1;
+    }
+    return report.allOk() ? 0 : 1;
+}
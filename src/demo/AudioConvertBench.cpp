@@ -0,0 +1,250 @@
+#include "AudioConvertBench.h"
+#include "libmedia/QsAudioConvert.h"
+#include "libmedia/QcAudioTransformat.h"
+#include "libmedia/AVFrameRef.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <random>
+#include <chrono>
+extern "C" {
+#include <libswresample/swresample.h>
+#include <libavutil/channel_layout.h>
+}
+
+namespace
+{
+    const char* kLevelNames[] = { "scalar", "sse4.1", "avx2" };
+    const int kSampleRate = 48000;
+    const int kPacket = 1024;
+
+    const QeSampleFormat kFormats[] = { eSampleFormatS16, eSampleFormatS16P, eSampleFormatFloat, eSampleFormatFloatP };
+
+    bool isPlanar(QeSampleFormat format, int nChannels)
+    {
+        return nChannels > 1 && (format == eSampleFormatS16P || format == eSampleFormatFloatP);
+    }
+
+    //nSamples of format in one buffer per plane, the pointers in data.
+    struct QsAudioBuffer
+    {
+        QsAudioBuffer(QeSampleFormat format, int nChannels, int nSamples)
+        {
+            int nPlanes = isPlanar(format, nChannels) ? nChannels : 1;
+            size_t bytes = (size_t)nSamples * getBytesPerSample(format) * (nPlanes == 1 ? nChannels : 1);
+            planes.resize(nPlanes);
+            for (int c = 0; c < nPlanes; ++c)
+            {
+                planes[c].resize(bytes);
+                data[c] = planes[c].data();
+            }
+        }
+        //noise with a few clipping and exactly half way samples, so rounding and clipping are covered.
+        void fill(QeSampleFormat format, std::mt19937& rng)
+        {
+            bool bFloat = format == eSampleFormatFloat || format == eSampleFormatFloatP;
+            for (auto& plane : planes)
+            {
+                if (!bFloat)
+                {
+                    for (size_t i = 0; i + 1 < plane.size(); i += 2)
+                        *(int16_t*)&plane[i] = (int16_t)rng();
+                    continue;
+                }
+                float* p = (float*)plane.data();
+                for (size_t i = 0; i < plane.size() / 4; ++i)
+                {
+                    int r = rng() % 16;
+                    if (r == 0)
+                        p[i] = (rng() % 2 ? 1.0f : -1.0f) * (1.0f + (rng() % 100) / 100.0f);
+                    else if (r == 1)
+                        p[i] = ((int)(rng() % 65536) - 32768 + 0.5f) / 32768.0f;
+                    else
+                        p[i] = (float)rng() / (float)rng.max() * 2.0f - 1.0f;
+                }
+            }
+        }
+        bool operator==(const QsAudioBuffer& other) const
+        {
+            return planes == other.planes;
+        }
+
+        std::vector<std::vector<uint8_t>> planes;
+        uint8_t* data[QmAudioPlanes] = {};
+    };
+
+    SwrContext* openSwr(QeSampleFormat srcFormat, int srcChannels, int srcRate, QeSampleFormat dstFormat, int dstChannels, int dstRate)
+    {
+        SwrContext* pSwr = swr_alloc_set_opts(NULL, av_get_default_channel_layout(dstChannels), (AVSampleFormat)dstFormat, dstRate,
+            av_get_default_channel_layout(srcChannels), (AVSampleFormat)srcFormat, srcRate, 0, NULL);
+        if (pSwr && swr_init(pSwr) < 0)
+            swr_free(&pSwr);
+        return pSwr;
+    }
+}
+
+AudioConvertBench::AudioConvertBench(int seconds)
+    : m_seconds(seconds > 0 ? seconds : 60)
+{
+
+}
+
+int AudioConvertBench::run()
+{
+    printf("simd level: %s\n", kLevelNames[DetectSimdLevel()]);
+    if (!verify())
+        return 1;
+
+    bool bOk = true;
+    printf("%-26s %-8s %10s %8s %s\n", "case", "path", "Msample/s", "speedup", "vs swr");
+    bOk &= runCase("fltp 2ch -> s16 2ch", eSampleFormatFloatP, 2, eSampleFormatS16, 2);
+    bOk &= runCase("s16 2ch -> flt 2ch", eSampleFormatS16, 2, eSampleFormatFloat, 2);
+    bOk &= runCase("s16 2ch -> fltp 2ch", eSampleFormatS16, 2, eSampleFormatFloatP, 2);
+    bOk &= runCase("flt 2ch -> s16 2ch", eSampleFormatFloat, 2, eSampleFormatS16, 2);
+    bOk &= runCase("s16p 2ch -> s16 2ch", eSampleFormatS16P, 2, eSampleFormatS16, 2);
+    bOk &= runCase("s16 2ch -> s16 1ch", eSampleFormatS16, 2, eSampleFormatS16, 1);
+    bOk &= runCase("fltp 2ch -> s16 1ch", eSampleFormatFloatP, 2, eSampleFormatS16, 1);
+    bOk &= runCase("s16 2ch -> flt 1ch", eSampleFormatS16, 2, eSampleFormatFloat, 1);
+    bOk &= runCase("flt 2ch -> flt 1ch", eSampleFormatFloat, 2, eSampleFormatFloat, 1);
+    bOk &= runCase("fltp 2ch -> flt 1ch", eSampleFormatFloatP, 2, eSampleFormatFloat, 1);
+    bOk &= runCase("s16 1ch -> s16 2ch", eSampleFormatS16, 1, eSampleFormatS16, 2);
+    bOk &= runCase("flt 1ch -> fltp 2ch", eSampleFormatFloat, 1, eSampleFormatFloatP, 2);
+    bOk &= runResample();
+    return bOk ? 0 : 1;
+}
+
+bool AudioConvertBench::verify()
+{
+    //lengths either side of the 4, 8 and 16 sample blocks and of the 256 frame staging chunks.
+    const int kLengths[] = { 0, 1, 3, 7, 8, 9, 15, 16, 17, 255, 256, 257, 1023, 3001 };
+    std::mt19937 rng(1);
+    int nCases = 0;
+    int nMismatch = 0;
+    for (QeSampleFormat srcFormat : kFormats)
+    {
+        for (QeSampleFormat dstFormat : kFormats)
+        {
+            for (int srcChannels = 1; srcChannels <= 6; ++srcChannels)
+            {
+                for (int dstChannels = 1; dstChannels <= 6; ++dstChannels)
+                {
+                    QsAudioPara src;
+                    src.sampleRate = kSampleRate;
+                    src.sampleFormat = srcFormat;
+                    src.nChannels = srcChannels;
+                    QsAudioPara dst = src;
+                    dst.sampleFormat = dstFormat;
+                    dst.nChannels = dstChannels;
+                    if (!audio::CanConvertDirect(src, dst))
+                        continue;
+                    for (int n : kLengths)
+                    {
+                        QsAudioBuffer in(srcFormat, srcChannels, n);
+                        in.fill(srcFormat, rng);
+                        QsAudioBuffer ref(dstFormat, dstChannels, n);
+                        audio::ConvertDirect(in.data, srcFormat, srcChannels, ref.data, dstFormat, dstChannels, n, eSimdNone);
+                        for (int level = eSimdSSE41; level <= DetectSimdLevel(); ++level)
+                        {
+                            QsAudioBuffer out(dstFormat, dstChannels, n);
+                            audio::ConvertDirect(in.data, srcFormat, srcChannels, out.data, dstFormat, dstChannels, n, (QeSimdLevel)level);
+                            ++nCases;
+                            if (!(out == ref))
+                            {
+                                ++nMismatch;
+                                printf("mismatch: format %d %dch -> %d %dch, %d samples, %s\n", srcFormat, srcChannels,
+                                    dstFormat, dstChannels, n, kLevelNames[level]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    printf("bit exact: %d/%d cases\n", nCases - nMismatch, nCases);
+    return nMismatch == 0;
+}
+
+bool AudioConvertBench::runCase(const char* name, QeSampleFormat srcFormat, int srcChannels, QeSampleFormat dstFormat, int dstChannels)
+{
+    using namespace std::chrono;
+    std::mt19937 rng(2);
+    QsAudioBuffer in(srcFormat, srcChannels, kPacket);
+    in.fill(srcFormat, rng);
+    QsAudioBuffer swrOut(dstFormat, dstChannels, kPacket);
+    int nPackets = m_seconds * kSampleRate / kPacket;
+    double samples = (double)nPackets * kPacket * (srcChannels > dstChannels ? srcChannels : dstChannels);
+
+    SwrContext* pSwr = openSwr(srcFormat, srcChannels, kSampleRate, dstFormat, dstChannels, kSampleRate);
+    if (pSwr == nullptr)
+    {
+        printf("%-26s swr_init failed\n", name);
+        return false;
+    }
+    auto begin = steady_clock::now();
+    for (int i = 0; i < nPackets; ++i)
+        swr_convert(pSwr, swrOut.data, kPacket, (const uint8_t**)in.data, kPacket);
+    double swrMs = duration<double, std::milli>(steady_clock::now() - begin).count();
+    swr_free(&pSwr);
+    printf("%-26s %-8s %10.1f %8.2f\n", name, "swr", swrMs > 0 ? samples / swrMs / 1000 : 0, 1.0);
+
+    bool bExact = true;
+    for (int level = eSimdNone; level <= DetectSimdLevel(); ++level)
+    {
+        QsAudioBuffer out(dstFormat, dstChannels, kPacket);
+        begin = steady_clock::now();
+        for (int i = 0; i < nPackets; ++i)
+            audio::ConvertDirect(in.data, srcFormat, srcChannels, out.data, dstFormat, dstChannels, kPacket, (QeSimdLevel)level);
+        double ms = duration<double, std::milli>(steady_clock::now() - begin).count();
+        bool bSame = out == swrOut;
+        bExact &= bSame;
+        printf("%-26s %-8s %10.1f %8.2f %s\n", name, kLevelNames[level], ms > 0 ? samples / ms / 1000 : 0,
+            ms > 0 ? swrMs / ms : 0, bSame ? "exact" : "differs");
+    }
+    return bExact;
+}
+
+bool AudioConvertBench::runResample()
+{
+    using namespace std::chrono;
+    const int kDstRate = 44100;
+    QsAudioPara src;
+    src.sampleRate = kSampleRate;
+    src.sampleFormat = eSampleFormatFloatP;
+    src.nChannels = 2;
+    QsAudioPara dst;
+    dst.sampleRate = kDstRate;
+    dst.sampleFormat = eSampleFormatS16;
+    dst.nChannels = 2;
+    QcAudioTransformat transformat;
+    if (!transformat.init(src, dst))
+    {
+        printf("resample init failed\n");
+        return false;
+    }
+
+    std::mt19937 rng(3);
+    QsAudioBuffer in(src.sampleFormat, src.nChannels, kPacket);
+    in.fill(src.sampleFormat, rng);
+    int nPackets = m_seconds * kSampleRate / kPacket;
+    int64_t nOut = 0;
+    AVFrameRef outFrame;
+    auto begin = steady_clock::now();
+    for (int i = 0; i < nPackets; ++i)
+    {
+        if (transformat.transformat(in.data, kPacket, outFrame))
+            nOut += outFrame.sampleCount();
+    }
+    int delay = transformat.getDelaySamples();
+    int nFlushed = transformat.flush(outFrame) ? outFrame.sampleCount() : 0;
+    double ms = duration<double, std::milli>(steady_clock::now() - begin).count();
+
+    //with the delay drained every input sample has come out, give or take the filter's rounding.
+    int64_t expected = (int64_t)nPackets * kPacket * kDstRate / kSampleRate;
+    nOut += nFlushed;
+    bool bOk = llabs(nOut - expected) <= 2;
+    printf("%-26s %-8s %10.1f %8s %lld of %lld samples, flush drained %d (delay %d)\n", "fltp 2ch 48k -> s16 44.1k", "swr",
+        ms > 0 ? (double)nPackets * kPacket * 2 / ms / 1000 : 0, "", (long long)nOut, (long long)expected, nFlushed, delay);
+    return bOk;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "QsAudiodef.h"
+
+//audio::ConvertDirect against libswresample on the same rate conversions QcAudioTransformat now
+//does itself, one 1024 sample packet at a time like a decoder hands them out. Every simd level is
+//first checked against the scalar path, and each case checks its output against swr's.
+//The last row resamples 48k -> 44.1k through QcAudioTransformat and drains it with flush().
+class AudioConvertBench
+{
+public:
+    AudioConvertBench(int seconds = 60);
+
+    int run();
+protected:
+    bool verify();
+    bool runCase(const char* name, QeSampleFormat srcFormat, int srcChannels, QeSampleFormat dstFormat, int dstChannels);
+    bool runResample();
+protected:
+    int m_seconds;
+};
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include "AudioMixerBench.h"
+#include "libmedia/QcAudioMixer.h"
+#include "libmedia/QsAudioMix.h"
+#include "QsAudiodef.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <chrono>
+
+namespace
+{
+    const char* kLevelNames[] = { "scalar", "sse4.1", "avx2" };
+    const int kRate = 48000;
+    //10ms, the usual wasapi period.
+    const int kPacket = 480;
+    const int64_t kPacketUs = 10000;
+    const int64_t kStartUs = 1000000;
+
+    bool pushPacket(QcAudioMixer& mixer, int id, const void* samples, int frames, int64_t timestamp,
+        int sampleRate = kRate, int nChannels = 2, QeSampleFormat format = eSampleFormatFloat)
+    {
+        QsAudioData data = {};
+        data.sampleRate = sampleRate;
+        data.sampleFormat = format;
+        data.nChannels = nChannels;
+        data.data[0] = (const uint8_t*)samples;
+        data.frames = (uint32_t)frames;
+        data.timestamp = (uint64_t)timestamp;
+        return mixer.pushAudio(id, &data);
+    }
+
+    int g_failures = 0;
+    void check(bool bOk, const char* what)
+    {
+        if (!bOk)
+        {
+            ++g_failures;
+            printf("FAILED: %s\n", what);
+        }
+    }
+}
+
+AudioMixerBench::AudioMixerBench(int seconds)
+    : m_seconds(seconds > 0 ? seconds : 10)
+{
+
+}
+
+int AudioMixerBench::run()
+{
+    printf("simd level: %s\n", kLevelNames[DetectSimdLevel()]);
+    if (!verifyKernels() || !verifyMixer())
+        return 1;
+
+    printf("%-7s %-8s %12s %12s %10s\n", "inputs", "path", "ns/frame", "us/10ms", "x realtime");
+    const int kInputs[] = { 2, 4, 8, 16, 32 };
+    for (int nInputs : kInputs)
+        runCase(nInputs);
+    return 0;
+}
+
+bool AudioMixerBench::verifyKernels()
+{
+    const int kLengths[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 960, 1001 };
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+    int nCases = 0;
+    int nMismatch = 0;
+    for (int n : kLengths)
+    {
+        std::vector<float> src(n), acc(n);
+        for (int i = 0; i < n; ++i)
+        {
+            src[i] = dist(rng);
+            acc[i] = dist(rng);
+        }
+        std::vector<float> refMix = acc;
+        audio::MixAdd(refMix.data(), src.data(), n, 0.7f, eSimdNone);
+        float refPeak = audio::PeakLevel(src.data(), n, eSimdNone);
+        std::vector<float> refLimit = src;
+        audio::SoftLimit(refLimit.data(), n, 1.0f, 0.6f, 0.89f, eSimdNone);
+        for (int level = eSimdSSE41; level <= DetectSimdLevel(); ++level)
+        {
+            std::vector<float> mix = acc;
+            audio::MixAdd(mix.data(), src.data(), n, 0.7f, (QeSimdLevel)level);
+            float peak = audio::PeakLevel(src.data(), n, (QeSimdLevel)level);
+            std::vector<float> limit = src;
+            audio::SoftLimit(limit.data(), n, 1.0f, 0.6f, 0.89f, (QeSimdLevel)level);
+            nCases += 3;
+            bool bMix = n == 0 || memcmp(mix.data(), refMix.data(), n * sizeof(float)) == 0;
+            bool bPeak = peak == refPeak;
+            bool bLimit = n == 0 || memcmp(limit.data(), refLimit.data(), n * sizeof(float)) == 0;
+            nMismatch += !bMix + !bPeak + !bLimit;
+            if (!bMix || !bPeak || !bLimit)
+                printf("mismatch: %d samples %s:%s%s%s\n", n, kLevelNames[level], bMix ? "" : " mix", bPeak ? "" : " peak", bLimit ? "" : " limit");
+        }
+        for (float v : refLimit)
+            check(fabsf(v) < 1.0f, "soft limit stays under full scale");
+    }
+    printf("bit exact: %d/%d cases\n", nCases - nMismatch, nCases);
+    return nMismatch == 0 && g_failures == 0;
+}
+
+bool AudioMixerBench::verifyMixer()
+{
+    g_failures = 0;
+    //a: 0.001 * (packet + 1) from the start, b: 0.25 from half a packet later. The output must be their
+    //exact sum frame by frame, with the limiter off.
+    {
+        QcAudioMixer mixer;
+        mixer.init(kRate, 2);
+        mixer.setLimiter(false);
+        int a = mixer.addInput();
+        int b = mixer.addInput();
+        std::vector<float> pa(kPacket * 2), pb(kPacket * 2, 0.25f);
+        std::mt19937 rng(2);
+        std::uniform_int_distribution<int> jitter(-2000, 2000);
+        const int kPackets = 50;
+        for (int k = 0; k < kPackets; ++k)
+        {
+            for (float& v : pa)
+                v = 0.001f * (k + 1);
+            //a's capture clock jitters by up to 2ms, it must still come out contiguous.
+            int64_t tsA = kStartUs + k * kPacketUs + (k ? jitter(rng) : 0);
+            pushPacket(mixer, a, pa.data(), kPacket, tsA);
+            pushPacket(mixer, b, pb.data(), kPacket, kStartUs + kPacketUs / 2 + k * kPacketUs);
+        }
+        std::vector<float> out(kPackets * kPacket * 2);
+        check(mixer.mix(out.data(), kPackets * kPacket), "mix after the first push");
+        bool bAligned = true;
+        for (int f = 0; f < kPackets * kPacket; ++f)
+        {
+            float expected = 0.001f * (f / kPacket + 1) + (f >= kPacket / 2 ? 0.25f : 0.0f);
+            bAligned &= fabsf(out[f * 2] - expected) < 1e-6f && out[f * 2 + 1] == out[f * 2];
+        }
+        check(bAligned, "inputs aligned by timestamp, jitter absorbed");
+        QsMixerInputStats sa = mixer.inputStats(a);
+        QsMixerInputStats sb = mixer.inputStats(b);
+        check(sa.mixedFrames == kPackets * kPacket && sa.silentFrames == 0 && sa.lateFrames == 0, "input a mixed whole");
+        check(sb.silentFrames == kPacket / 2 && sb.mixedFrames == kPackets * kPacket - kPacket / 2, "input b starts half a packet in");
+        check(mixer.timestamp() == kStartUs + kPackets * kPacketUs, "timestamp follows the mix");
+    }
+
+    //b stalls for 100ms while a keeps going: the mix goes on with silence for b, and b's packets for the
+    //stall arriving afterwards are dropped as late. b then resumes at its timestamps.
+    {
+        QcAudioMixer mixer;
+        mixer.init(kRate, 2);
+        mixer.setLimiter(false);
+        int a = mixer.addInput();
+        int b = mixer.addInput();
+        std::vector<float> pa(kPacket * 2, 0.125f), pb(kPacket * 2, 0.5f);
+        std::vector<float> out(kPacket * 2);
+        const int kLatencyMs = 20;
+        int64_t mixedFrames = 0;
+        bool bSilenceDuringStall = true;
+        bool bBothAfterStall = true;
+        for (int k = 0; k < 40; ++k)
+        {
+            int64_t ts = kStartUs + k * kPacketUs;
+            pushPacket(mixer, a, pa.data(), kPacket, ts);
+            if (k < 10 || k >= 20)
+                pushPacket(mixer, b, pb.data(), kPacket, ts);
+            if (k == 25)
+            {
+                //the stalled packets show up after all.
+                for (int j = 10; j < 20; ++j)
+                    pushPacket(mixer, b, pb.data(), kPacket, kStartUs + j * kPacketUs);
+            }
+            //the mix runs kLatencyMs behind the leading input, as a recorder would.
+            while (mixer.readyFrames(kLatencyMs) >= kPacket)
+            {
+                mixer.mix(out.data(), kPacket);
+                int packet = (int)(mixedFrames / kPacket);
+                float expected = 0.125f + (packet >= 10 && packet < 20 ? 0.0f : 0.5f);
+                for (float v : out)
+                {
+                    if (packet >= 10 && packet < 20)
+                        bSilenceDuringStall &= v == expected;
+                    else
+                        bBothAfterStall &= v == expected;
+                }
+                mixedFrames += kPacket;
+            }
+        }
+        QsMixerInputStats sb = mixer.inputStats(b);
+        check(mixedFrames == (40 - kLatencyMs / 10) * kPacket, "mix runs the latency behind the leading input");
+        check(bSilenceDuringStall, "stalled input mixed as silence without holding back the other");
+        check(bBothAfterStall, "stalled input realigned when it resumes");
+        check(sb.silentFrames == 10 * kPacket, "stall counted as silent frames");
+        check(sb.lateFrames == 10 * kPacket, "packets for the stall dropped as late");
+        check(mixer.inputStats(a).silentFrames == 0, "leading input never silent");
+    }
+
+    //a 44.1kHz float stereo input and a 48kHz s16 mono one are converted, a muted one is not heard and
+    //eight full scale inputs are held under 1.0 by the limiter.
+    {
+        QcAudioMixer mixer;
+        mixer.init(kRate, 2);
+        int resampled = mixer.addInput();
+        int mono = mixer.addInput();
+        int muted = mixer.addInput();
+        mixer.setMute(muted, true);
+        int loud[8];
+        for (int& id : loud)
+            id = mixer.addInput();
+        const int kSrcPacket = 441;
+        std::vector<float> p44(kSrcPacket * 2), loudPacket(kPacket * 2), mutedPacket(kPacket * 2, 1.0f);
+        std::vector<int16_t> pMono(kPacket);
+        std::vector<float> out(kPacket * 2);
+        float peak = 0;
+        const int kPackets = 100;
+        for (int k = 0; k < kPackets; ++k)
+        {
+            int64_t ts = kStartUs + k * kPacketUs;
+            for (int i = 0; i < kSrcPacket; ++i)
+                p44[i * 2] = p44[i * 2 + 1] = 0.3f * sinf(2 * 3.14159265f * 440 * (k * kSrcPacket + i) / 44100.0f);
+            for (int i = 0; i < kPacket; ++i)
+            {
+                float s = sinf(2 * 3.14159265f * 1000 * (k * kPacket + i) / kRate);
+                pMono[i] = (int16_t)(s * 8000);
+                loudPacket[i * 2] = loudPacket[i * 2 + 1] = s;
+            }
+            pushPacket(mixer, resampled, p44.data(), kSrcPacket, ts, 44100);
+            pushPacket(mixer, mono, pMono.data(), kPacket, ts, kRate, 1, eSampleFormatS16);
+            pushPacket(mixer, muted, mutedPacket.data(), kPacket, ts);
+            for (int id : loud)
+                pushPacket(mixer, id, loudPacket.data(), kPacket, ts);
+            if (k >= 2)
+            {
+                mixer.mix(out.data(), kPacket);
+                for (float v : out)
+                    peak = fabsf(v) > peak ? fabsf(v) : peak;
+            }
+        }
+        check(peak < 1.0f && peak > 0.85f, "limiter holds eight full scale inputs under 1.0");
+        check(mixer.inputStats(resampled).mixedFrames > (kPackets - 3) * kPacket, "44.1kHz input resampled and mixed");
+        check(mixer.inputStats(mono).mixedFrames == (kPackets - 2) * kPacket, "s16 mono input converted and mixed");
+        check(mixer.inputStats(muted).mixedFrames == (kPackets - 2) * kPacket, "muted input still consumed");
+        printf("limited peak of 8 full scale inputs: %.4f\n", peak);
+    }
+    printf("mixer checks: %s\n", g_failures ? "failed" : "ok");
+    return g_failures == 0;
+}
+
+void AudioMixerBench::runCase(int nInputs)
+{
+    using namespace std::chrono;
+    //the mix loop alone: nInputs packets accumulated into one, per simd level.
+    std::vector<std::vector<float>> packets(nInputs, std::vector<float>(kPacket * 2));
+    for (int i = 0; i < nInputs; ++i)
+    {
+        for (int f = 0; f < kPacket * 2; ++f)
+            packets[i][f] = 0.5f * sinf((float)(f * (i + 1)) * 0.01f);
+    }
+    std::vector<float> out(kPacket * 2);
+    int nBlocks = m_seconds * 100;
+    for (int level = eSimdNone; level <= DetectSimdLevel(); ++level)
+    {
+        auto begin = steady_clock::now();
+        for (int k = 0; k < nBlocks; ++k)
+        {
+            memset(out.data(), 0, out.size() * sizeof(float));
+            for (int i = 0; i < nInputs; ++i)
+                audio::MixAdd(out.data(), packets[i].data(), kPacket * 2, 0.5f, (QeSimdLevel)level);
+            audio::SoftLimit(out.data(), kPacket * 2, 1.0f, 1.0f, 0.89f, (QeSimdLevel)level);
+        }
+        double ns = duration<double, std::nano>(steady_clock::now() - begin).count() / nBlocks;
+        printf("%-7d %-8s %12.2f %12.2f %10.0f\n", nInputs, kLevelNames[level], ns / kPacket, ns / 1000, 1e7 / ns);
+    }
+
+    //the whole mixer: every input pushed its packet, then one 10ms block mixed.
+    QcAudioMixer mixer;
+    mixer.init(kRate, 2);
+    std::vector<int> ids(nInputs);
+    for (int& id : ids)
+        id = mixer.addInput();
+    auto begin = steady_clock::now();
+    for (int k = 0; k < nBlocks; ++k)
+    {
+        for (int i = 0; i < nInputs; ++i)
+            pushPacket(mixer, ids[i], packets[i].data(), kPacket, kStartUs + k * kPacketUs);
+        mixer.mix(out.data(), kPacket);
+    }
+    double ns = duration<double, std::nano>(steady_clock::now() - begin).count() / nBlocks;
+    printf("%-7d %-8s %12.2f %12.2f %10.0f\n", nInputs, "mixer", ns / kPacket, ns / 1000, 1e7 / ns);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+//QcAudioMixer. verify() checks the mix kernels bit for bit across simd levels, then feeds the mixer
+//synthetic sources with known timestamps: packet alignment, capture jitter, a stalled input that is
+//filled with silence and whose late packets are dropped, resampled and mono inputs, mute, and the
+//limiter holding full scale inputs under 1.0. run() then times 2-32 stereo inputs at 48kHz.
+class AudioMixerBench
+{
+public:
+    AudioMixerBench(int seconds = 10);
+
+    int run();
+protected:
+    bool verifyKernels();
+    bool verifyMixer();
+    void runCase(int nInputs);
+protected:
+    int m_seconds;
+};
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "ColorConvertBench.h"
+#include "libmedia/QsVideoConvert.h"
+#include "libmedia/FFmpegVideoTransformat.h"
+#include "libmedia/FFmpegUtils.h"
+#include "libmedia/AVFrameRef.h"
+#include <stdint.h>
+#include <string.h>
+#include "QsVideodef.h"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <stdio.h>
+
+namespace
+{
+    const char* kLevelNames[] = { "scalar", "sse4.1", "avx2" };
+
+    const int kFormats[] = { FOURCC_I420, FOURCC_YV12, FOURCC_NV12, FOURCC_NV21 };
+}
+
+ColorConvertBench::ColorConvertBench(int nFrames)
+    : m_nFrames(nFrames)
+{
+
+}
+
+int ColorConvertBench::run()
+{
+    printf("simd level: %s\n", kLevelNames[DetectSimdLevel()]);
+    if (!verify())
+        return 1;
+
+    printf("%-18s %-8s %10s %8s\n", "case", "path", "ms/frame", "speedup");
+    runCase("i420->bgra 1080p", 1920, 1080, FOURCC_I420);
+    runCase("nv12->bgra 1080p", 1920, 1080, FOURCC_NV12);
+    runCase("i420->bgra 4k", 3840, 2160, FOURCC_I420);
+    runCase("nv12->bgra 4k", 3840, 2160, FOURCC_NV12);
+    return 0;
+}
+
+bool ColorConvertBench::verify()
+{
+    //odd sizes and widths either side of the 8 and 16 pixel blocks, so the scalar tails are covered.
+    const int kSizes[][2] = { { 1, 1 }, { 2, 2 }, { 7, 3 }, { 15, 5 }, { 16, 2 }, { 17, 9 }, { 33, 17 }, { 1279, 719 }, { 1920, 1080 } };
+    std::mt19937 rng(1);
+    int nCases = 0;
+    int nMismatch = 0;
+    for (auto& size : kSizes)
+    {
+        int w = size[0];
+        int h = size[1];
+        int cw = (w + 1) / 2;
+        int ch = (h + 1) / 2;
+        std::vector<uint8_t> y(w * h), u(cw * ch * 2), v(cw * ch);
+        for (auto* plane : { &y, &u, &v })
+        {
+            for (uint8_t& b : *plane)
+                b = (uint8_t)rng();
+        }
+        std::vector<uint8_t> ref(w * h * 4), out(w * h * 4);
+        for (int format : kFormats)
+        {
+            bool bNV = format == FOURCC_NV12 || format == FOURCC_NV21;
+            const uint8_t* const data[] = { y.data(), u.data(), v.data() };
+            const int linesize[] = { w, bNV ? cw * 2 : cw, cw };
+            for (int dstFormat : { FOURCC_BGRA, FOURCC_RGBA })
+            {
+                for (int matrix = video::eMatrixBT601; matrix <= video::eMatrixBT709; ++matrix)
+                {
+                    for (int range = video::eRangeLimited; range <= video::eRangeFull; ++range)
+                    {
+                        video::ConvertToRGB32(data, linesize, format, ref.data(), w * 4, dstFormat, w, h
+                            , (video::QeColorMatrix)matrix, (video::QeColorRange)range, eSimdNone);
+                        for (int level = eSimdSSE41; level <= DetectSimdLevel(); ++level)
+                        {
+                            memset(out.data(), 0, out.size());
+                            video::ConvertToRGB32(data, linesize, format, out.data(), w * 4, dstFormat, w, h
+                                , (video::QeColorMatrix)matrix, (video::QeColorRange)range, (QeSimdLevel)level);
+                            ++nCases;
+                            if (memcmp(ref.data(), out.data(), out.size()) != 0)
+                            {
+                                ++nMismatch;
+                                printf("mismatch: %dx%d format %.4s -> %.4s matrix %d range %d %s\n", w, h, (const char*)&format
+                                    , (const char*)&dstFormat, matrix, range, kLevelNames[level]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    printf("bit exact: %d/%d cases\n", nCases - nMismatch, nCases);
+    return nMismatch == 0;
+}
+
+void ColorConvertBench::runCase(const char* name, int width, int height, int srcFormat)
+{
+    using namespace std::chrono;
+    int avSrcFormat = FFmpegUtils::fourccToFFmpegFormat(srcFormat);
+    int avDstFormat = FFmpegUtils::fourccToFFmpegFormat(FOURCC_BGRA);
+    AVFrameRef src = AVFrameRef::allocFrame(width, height, avSrcFormat);
+    AVFrameRef dst = AVFrameRef::allocFrame(width, height, avDstFormat);
+    for (int p = 0; p < 3 && src.data(p); ++p)
+    {
+        int rows = p == 0 ? height : (height + 1) / 2;
+        for (int y = 0; y < rows; ++y)
+        {
+            uint8_t* pRow = src.data(p) + (ptrdiff_t)y * src.linesize(p);
+            for (int x = 0; x < src.linesize(p); ++x)
+                pRow[x] = (uint8_t)(x + y * 3 + p * 64);
+        }
+    }
+
+    FFmpegVideoTransformat transformat;
+    transformat.setQuality(eScaleFast);
+    transformat.setThreadCount(1);
+    transformat.transformat(width, height, avSrcFormat, src.data(), src.linesize(), width, height, avDstFormat, dst.data(), dst.linesize());
+    auto begin = steady_clock::now();
+    for (int i = 0; i < m_nFrames; ++i)
+        transformat.transformat(width, height, avSrcFormat, src.data(), src.linesize(), width, height, avDstFormat, dst.data(), dst.linesize());
+    double swsMs = duration<double, std::milli>(steady_clock::now() - begin).count() / m_nFrames;
+    printf("%-18s %-8s %10.3f %8.2f\n", name, "sws", swsMs, 1.0);
+
+    for (int level = eSimdNone; level <= DetectSimdLevel(); ++level)
+    {
+        begin = steady_clock::now();
+        for (int i = 0; i < m_nFrames; ++i)
+        {
+            video::ConvertToRGB32(src.data(), src.linesize(), srcFormat, dst.data(0), dst.linesize(0), FOURCC_BGRA, width, height
+                , video::eMatrixBT601, video::eRangeLimited, (QeSimdLevel)level);
+        }
+        double ms = duration<double, std::milli>(steady_clock::now() - begin).count() / m_nFrames;
+        printf("%-18s %-8s %10.3f %8.2f\n", name, kLevelNames[level], ms, ms > 0 ? swsMs / ms : 0);
+    }
+}
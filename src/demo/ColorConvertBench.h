@@ -0,0 +1,17 @@
+#pragma once
+
+//video::ConvertToRGB32 against FFmpegVideoTransformat (one thread, fast bilinear) on the same frames.
+//Every simd level is first checked bit for bit against the scalar reference over odd sizes, all
+//formats, matrices and ranges; a mismatch fails the run before anything is timed.
+class ColorConvertBench
+{
+public:
+    ColorConvertBench(int nFrames = 100);
+
+    int run();
+protected:
+    bool verify();
+    void runCase(const char* name, int width, int height, int srcFormat);
+protected:
+    int m_nFrames;
+};
\ No newline at end of file
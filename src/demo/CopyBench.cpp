@@ -0,0 +1,93 @@
+#include "CopyBench.h"
+#include <stdint.h>
+#include <string.h>
+#include "QsVideodef.h"
+#include "QsVideoCopy.h"
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+
+namespace
+{
+    struct QsSize
+    {
+        const char* name;
+        int width;
+        int height;
+    };
+
+    const QsSize kSizes[] = {
+        { "720p", 1280, 720 },
+        { "1080p", 1920, 1080 },
+        { "4k", 3840, 2160 },
+        { "8k", 7680, 4320 },
+    };
+}
+
+CopyBench::CopyBench(int nFrames)
+    : m_nFrames(nFrames)
+{
+
+}
+
+int CopyBench::run()
+{
+    printf("%-12s %-10s %10s %8s %8s\n", "case", "path", "ms/frame", "GB/s", "speedup");
+    for (const QsSize& size : kSizes)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "nv12 %s", size.name);
+        runCase(name, size.width, size.height, FOURCC_NV12);
+        snprintf(name, sizeof(name), "p010 %s", size.name);
+        runCase(name, size.width, size.height, FOURCC_P010);
+        snprintf(name, sizeof(name), "bgra %s", size.name);
+        runCase(name, size.width, size.height, FOURCC_BGRA);
+    }
+    return 0;
+}
+
+void CopyBench::runCase(const char* name, int width, int height, int format)
+{
+    using namespace std::chrono;
+    //separate allocations with padded strides, like a decoder frame going to an upload buffer.
+    uint32_t bufferSize = video::CalBufNeedSize(width + 32, height, format);
+    std::vector<uint8_t> src(bufferSize, 0x5a), dst(bufferSize);
+    uint8_t* srcData[QMaxSlice] = {};
+    uint8_t* dstData[QMaxSlice] = {};
+    uint32_t srcLinesize[QMaxSlice] = {};
+    uint32_t dstLinesize[QMaxSlice] = {};
+    video::FillVideoFrameInfo(src.data(), width + 32, height, format, srcData, srcLinesize);
+    video::FillVideoFrameInfo(dst.data(), width + 32, height, format, dstData, dstLinesize);
+
+    int rowBytes[QMaxSlice];
+    int rows[QMaxSlice];
+    int nPlanes = video::PlaneLayout(format, width, height, rowBytes, rows);
+    double bytes = 0;
+    for (int p = 0; p < nPlanes; ++p)
+        bytes += (double)rowBytes[p] * rows[p];
+
+    double base = 0;
+    auto measure = [&](const char* path, const std::function<void()>& copy) {
+        copy();
+        auto begin = steady_clock::now();
+        for (int i = 0; i < m_nFrames; ++i)
+            copy();
+        double ms = duration<double, std::milli>(steady_clock::now() - begin).count() / m_nFrames;
+        if (base == 0)
+            base = ms;
+        printf("%-12s %-10s %10.3f %8.2f %8.2f\n", name, path, ms, bytes / ms / 1e6, ms > 0 ? base / ms : 0);
+    };
+    measure("memcpy", [&] {
+        video::CopyVideoFrame(dstData, dstLinesize, srcData, srcLinesize, format, width, height);
+    });
+    measure("cached", [&] {
+        video::CopyVideoFrameFast(dstData, dstLinesize, srcData, srcLinesize, format, width, height, video::eCopyCached, 1);
+    });
+    measure("stream", [&] {
+        video::CopyVideoFrameFast(dstData, dstLinesize, srcData, srcLinesize, format, width, height, video::eCopyWriteOnly, 1);
+    });
+    measure("stream mt", [&] {
+        video::CopyVideoFrameFast(dstData, dstLinesize, srcData, srcLinesize, format, width, height, video::eCopyWriteOnly, video::kCopyMaxThreads);
+    });
+}
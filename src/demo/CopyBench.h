@@ -0,0 +1,15 @@
+#pragma once
+
+//video::CopyVideoFrame against CopyVideoFrameFast from 720p to 8K: plain stores on one thread,
+//streaming stores on one thread, and streaming stores with the rows split over kCopyMaxThreads.
+class CopyBench
+{
+public:
+    CopyBench(int nFrames = 50);
+
+    int run();
+protected:
+    void runCase(const char* name, int width, int height, int format);
+protected:
+    int m_nFrames;
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "DecodeBench.h"
+#include "libmedia/FFmpegDemuxer.h"
+#include "libmedia/FFmpegVideoDecoder.h"
+#include "libmedia/FFmpegUtils.h"
+#include "libmedia/AVFrameRef.h"
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+
+DecodeBench::DecodeBench(int maxPackets)
+    : m_maxPackets(maxPackets)
+{
+
+}
+
+int DecodeBench::run(const std::string& file, int maxThreads)
+{
+    if (file.empty())
+    {
+        printf("usage: demo decode <file> [maxThreads]\n");
+        return 1;
+    }
+
+    FFmpegDemuxer demuxer;
+    if (!demuxer.open(file.c_str()) || demuxer.videoStream() == nullptr)
+    {
+        printf("%s: no video stream\n", file.c_str());
+        return 1;
+    }
+    int videoIndex = demuxer.videoStream()->index;
+    m_pCodecPar = demuxer.videoStream()->codecpar;
+    while ((int)m_packets.size() < m_maxPackets)
+    {
+        AVPacketPtr pkt = FFmpegUtils::allocAVPacket();
+        if (demuxer.readPacket(pkt) < 0)
+            break;
+        if (pkt->stream_index == videoIndex)
+            m_packets.push_back(pkt);
+    }
+    if (m_packets.empty())
+    {
+        printf("%s: no video packets\n", file.c_str());
+        return 1;
+    }
+
+    if (maxThreads <= 0)
+        maxThreads = (int)std::thread::hardware_concurrency();
+    printf("%s, %dx%d, %d packets\n", avcodec_get_name(m_pCodecPar->codec_id),
+        m_pCodecPar->width, m_pCodecPar->height, (int)m_packets.size());
+    printf("%-6s %8s %8s %10s %8s\n", "type", "threads", "frames", "fps", "delay");
+
+    bool bOk = true;
+    const int types[] = { eFrameThread, eSliceThread };
+    for (int type : types)
+    {
+        for (int nThreads = 1; ; nThreads = nThreads * 2 > maxThreads ? maxThreads : nThreads * 2)
+        {
+            QsDecoderOptions options;
+            options.threadCount = nThreads;
+            options.threadType = type;
+            bOk &= runCase(options);
+            if (nThreads >= maxThreads)
+                break;
+        }
+    }
+    return bOk ? 0 : 1;
+}
+
+bool DecodeBench::runCase(const QsDecoderOptions& options)
+{
+    using namespace std::chrono;
+    FFmpegVideoDecoder decoder;
+    decoder.setOptions(options);
+    if (!decoder.open(m_pCodecPar))
+    {
+        printf("open decoder failed\n");
+        return false;
+    }
+
+    int nFrames = 0;
+    int delay = -1;
+    AVFrameRef frame;
+    auto drain = [&](int nSent) {
+        int ret;
+        while ((ret = decoder.recv(frame)) == FFmpegVideoDecoder::kOk)
+        {
+            if (delay < 0)
+                delay = nSent;
+            ++nFrames;
+        }
+        return ret;
+    };
+
+    auto begin = steady_clock::now();
+    int nSent = 0;
+    for (const AVPacketPtr& pkt : m_packets)
+    {
+        ++nSent;
+        while (decoder.decode(pkt.get()) == AVERROR(EAGAIN))
+            drain(nSent);
+        drain(nSent);
+    }
+    decoder.decode((const AVPacket*)nullptr);
+    while (drain(nSent) == FFmpegVideoDecoder::kAgain)
+        std::this_thread::yield();
+    double seconds = duration<double>(steady_clock::now() - begin).count();
+
+    printf("%-6s %8d %8d %10.1f %8d\n", options.threadType == eFrameThread ? "frame" : "slice",
+        decoder.threadCount(), nFrames, nFrames / seconds, delay);
+    return nFrames > 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "libmedia/QsMediaInfo.h"
+
+struct AVCodecParameters;
+
+//Software video decode throughput of FFmpegVideoDecoder over a sweep of thread counts, for frame
+//and slice threading. The packets are demuxed up front so only decoding is timed; "delay" is the
+//number of packets sent before the first frame came out.
+class DecodeBench
+{
+public:
+    DecodeBench(int maxPackets = 600);
+
+    int run(const std::string& file, int maxThreads);
+protected:
+    bool runCase(const QsDecoderOptions& options);
+protected:
+    int m_maxPackets;
+    std::vector<AVPacketPtr> m_packets;
+    const AVCodecParameters* m_pCodecPar = nullptr;
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "FrameQueueBench.h"
+#include "libmedia/FrameQueue.h"
+#include "libmedia/AVFrameRef.h"
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+
+FrameQueueBench::FrameQueueBench(int nFrames)
+    : m_nFrames(nFrames)
+{
+
+}
+
+int FrameQueueBench::run()
+{
+    printf("%-10s %8s %12s %12s\n", "backend", "capacity", "ns/frame", "Mframes/s");
+    const int capacities[] = { 3, 16, 256 };
+    for (int capacity : capacities)
+    {
+        runCase(FrameQueue::kMutexQueue, capacity);
+        runCase(FrameQueue::kLockFreeRing, capacity);
+    }
+    return 0;
+}
+
+void FrameQueueBench::runCase(int backend, int capacity)
+{
+    using namespace std::chrono;
+    FrameQueue queue(capacity, backend);
+    //the payload is irrelevant here, only the AVFrameRef handoff is measured.
+    AVFrameRef frame = AVFrameRef::allocFrame();
+
+    auto begin = steady_clock::now();
+    std::thread producer([&] {
+        for (int i = 0; i < m_nFrames; ++i)
+        {
+            frame.setPtsMsTime(i);
+            queue.push(frame);
+        }
+    });
+
+    int expected = 0;
+    bool bOrdered = true;
+    while (expected < m_nFrames)
+    {
+        const AVFrameRef* pFrame = queue.peek();
+        if (pFrame == nullptr)
+        {
+            AVFrameRef waitFrame;
+            if (queue.pop(waitFrame, -1))
+            {
+                bOrdered &= waitFrame.ptsMsTime() == expected;
+                ++expected;
+            }
+            continue;
+        }
+        bOrdered &= pFrame->ptsMsTime() == expected;
+        queue.pop();
+        ++expected;
+    }
+    producer.join();
+    double ns = (double)duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+
+    printf("%-10s %8d %12.1f %12.2f%s\n", backend == FrameQueue::kLockFreeRing ? "spsc" : "mutex",
+        capacity, ns / m_nFrames, m_nFrames * 1000.0 / ns, bOrdered ? "" : "  ORDER ERROR");
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+//Decode->present handoff microbenchmark: one producer pushes frames, one consumer peeks and pops them,
+//the same way videoDecodeThread drains its queue. Compares the FrameQueue backends.
+class FrameQueueBench
+{
+public:
+    FrameQueueBench(int nFrames = 1000000);
+
+    int run();
+protected:
+    void runCase(int backend, int capacity);
+protected:
+    int m_nFrames;
+};
\ No newline at end of file
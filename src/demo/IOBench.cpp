@@ -0,0 +1,156 @@
+#include "IOBench.h"
+#include "libmedia/FFmpegReadAheadIO.h"
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavformat/avio.h>
+}
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+
+namespace
+{
+    //wraps a file context, every read is delayed to the configured bandwidth and latency.
+    struct QsThrottledSource
+    {
+        AVIOContext* file = nullptr;
+        AVIOContext* context = nullptr;
+        int kbps = 0;
+        int latencyMs = 0;
+        uint64_t blockedUs = 0;
+
+        static int read(void* opaque, uint8_t* buf, int size)
+        {
+            using namespace std::chrono;
+            QsThrottledSource* pThis = (QsThrottledSource*)opaque;
+            auto begin = steady_clock::now();
+            int n = avio_read(pThis->file, buf, size);
+            if (n <= 0)
+                return n == 0 ? AVERROR_EOF : n;
+            auto due = begin + milliseconds(pThis->latencyMs) + microseconds((int64_t)n * 1000 / pThis->kbps);
+            std::this_thread::sleep_until(due);
+            pThis->blockedUs += duration_cast<microseconds>(steady_clock::now() - begin).count();
+            return n;
+        }
+
+        static int64_t seek(void* opaque, int64_t offset, int whence)
+        {
+            QsThrottledSource* pThis = (QsThrottledSource*)opaque;
+            if (whence & AVSEEK_SIZE)
+                return avio_size(pThis->file);
+            return avio_seek(pThis->file, offset, whence & ~AVSEEK_FORCE);
+        }
+
+        bool open(const std::string& path, int bufferSize)
+        {
+            if (avio_open(&file, path.c_str(), AVIO_FLAG_READ) < 0)
+                return false;
+            uint8_t* buffer = (uint8_t*)av_malloc(bufferSize);
+            context = avio_alloc_context(buffer, bufferSize, 0, this, &QsThrottledSource::read, nullptr, &QsThrottledSource::seek);
+            return context != nullptr;
+        }
+
+        void close()
+        {
+            if (context)
+            {
+                av_freep(&context->buffer);
+                avio_context_free(&context);
+            }
+            avio_closep(&file);
+        }
+    };
+
+    void busyWork(int us)
+    {
+        using namespace std::chrono;
+        auto end = steady_clock::now() + microseconds(us);
+        while (steady_clock::now() < end)
+        {
+        }
+    }
+}
+
+IOBench::IOBench(int kbps, int latencyMs, int workUs)
+    : m_kbps(kbps)
+    , m_latencyMs(latencyMs)
+    , m_workUs(workUs)
+{
+
+}
+
+int IOBench::run(const std::string& file)
+{
+    if (file.empty())
+    {
+        printf("usage: demo io <file>\n");
+        return 1;
+    }
+
+    printf("source %d KB/s, %d ms per read, %d us work per packet\n", m_kbps, m_latencyMs, m_workUs);
+    printf("%-10s %8s %10s %10s %10s %8s\n", "io", "packets", "MB/s", "wall ms", "stall ms", "hit");
+    bool bOk = runCase(file, false);
+    bOk &= runCase(file, true);
+    return bOk ? 0 : 1;
+}
+
+bool IOBench::runCase(const std::string& file, bool bReadAhead)
+{
+    using namespace std::chrono;
+    QsThrottledSource source;
+    source.kbps = m_kbps;
+    source.latencyMs = m_latencyMs;
+    //the default path reads through avio's usual 32 KB buffer.
+    if (!source.open(file, 32 * 1024))
+    {
+        source.close();
+        printf("%s: open failed\n", file.c_str());
+        return false;
+    }
+
+    FFmpegReadAheadIO readAhead;
+    AVFormatContext* pContext = avformat_alloc_context();
+    if (bReadAhead)
+    {
+        readAhead.open(source.context, false);
+        pContext->pb = readAhead.context();
+    }
+    else
+    {
+        pContext->pb = source.context;
+    }
+
+    auto begin = steady_clock::now();
+    int nPackets = 0;
+    int64_t bytes = 0;
+    if (avformat_open_input(&pContext, file.c_str(), NULL, NULL) == 0)
+    {
+        AVPacket* pkt = av_packet_alloc();
+        while (av_read_frame(pContext, pkt) >= 0)
+        {
+            ++nPackets;
+            bytes += pkt->size;
+            av_packet_unref(pkt);
+            busyWork(m_workUs);
+        }
+        av_packet_free(&pkt);
+    }
+    double wallMs = duration<double, std::milli>(steady_clock::now() - begin).count();
+    avformat_close_input(&pContext);
+
+    //without read-ahead every throttled read blocks the demuxing thread.
+    double stallMs = source.blockedUs / 1000.0;
+    float hitRate = 0;
+    if (bReadAhead)
+    {
+        QsIOStats stats = readAhead.stats();
+        stallMs = stats.stallUs / 1000.0;
+        hitRate = stats.hitRate;
+    }
+    readAhead.close();
+    source.close();
+
+    printf("%-10s %8d %10.2f %10.1f %10.1f %7.1f%%\n", bReadAhead ? "readahead" : "default",
+        nPackets, bytes / 1048576.0 / (wallMs / 1000.0), wallMs, stallMs, hitRate * 100);
+    return nPackets > 0;
+}
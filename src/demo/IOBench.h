@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+//Demuxing throughput over a throttled source: the default avio path against FFmpegReadAheadIO.
+//The source is limited to kbps KB/s with a fixed latency per read, and every packet costs the
+//demuxing thread workUs of simulated decode time so read-ahead has something to overlap with.
+class IOBench
+{
+public:
+    IOBench(int kbps = 20 * 1024, int latencyMs = 2, int workUs = 300);
+
+    int run(const std::string& file);
+protected:
+    bool runCase(const std::string& file, bool bReadAhead);
+protected:
+    int m_kbps;
+    int m_latencyMs;
+    int m_workUs;
+};
\ No newline at end of file
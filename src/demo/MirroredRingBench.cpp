@@ -0,0 +1,126 @@
+#include "MirroredRingBench.h"
+#include "QcRingBuffer.h"
+#include "QcMirroredRingBuffer.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+namespace
+{
+    const size_t kRingBytes = 1 << 20;
+    //audio held back between calls, like the time-stretch search window.
+    const size_t kWindowBytes = 64 << 10;
+
+    //stands in for the encoder reading the block.
+    uint64_t consume(const char* data, size_t bytes)
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < bytes; i += 64)
+            sum += (uint8_t)data[i];
+        return sum;
+    }
+}
+
+MirroredRingBench::MirroredRingBench(int megabytes)
+    : m_megabytes(megabytes)
+{
+
+}
+
+int MirroredRingBench::run()
+{
+    printf("%-8s %-7s %-10s %10s %8s\n", "case", "block", "ring", "GB/s", "speedup");
+    //a 10ms stereo s16 packet at 48kHz, an AAC frame of float stereo, a video bitstream packet.
+    const int blocks[] = { 1920, 8192, 100000 };
+    for (int block : blocks)
+        runCase(block);
+    return 0;
+}
+
+void MirroredRingBench::runCase(int blockBytes)
+{
+    using namespace std::chrono;
+    std::vector<char> src(blockBytes, 0x21);
+    std::vector<char> dst(blockBytes);
+    std::vector<char> scratch(blockBytes);
+    size_t nBlocks = ((size_t)m_megabytes << 20) / blockBytes;
+    uint64_t checksum = 0;
+
+    double base = 0;
+    auto measure = [&](const char* name, const char* ring, const std::function<void()>& transfer) {
+        transfer();
+        auto begin = steady_clock::now();
+        for (size_t i = 0; i < nBlocks; ++i)
+            transfer();
+        double ns = (double)duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+        if (base == 0)
+            base = ns;
+        printf("%-8s %-7d %-10s %10.2f %8.2f\n", name, blockBytes, ring, (double)nBlocks * blockBytes / ns, base / ns);
+    };
+
+    QcRingBuffer ring((int)kRingBytes);
+    QcRingBuffer spsc((int)kRingBytes, QcRingBuffer::eSpsc);
+    QcMirroredRingBuffer mirror(kRingBytes);
+    if (!mirror.isValid())
+    {
+        printf("mirror could not be mapped\n");
+        return;
+    }
+
+    base = 0;
+    measure("copy", "default", [&] {
+        ring.write(src.data(), blockBytes);
+        ring.read(dst.data(), blockBytes);
+    });
+    measure("copy", "spsc", [&] {
+        spsc.write(src.data(), blockBytes);
+        spsc.read(dst.data(), blockBytes);
+    });
+    measure("copy", "mirrored", [&] {
+        mirror.write(src.data(), blockBytes);
+        mirror.read(dst.data(), blockBytes);
+    });
+
+    base = 0;
+    measure("window", "spsc", [&] {
+        spsc.write(src.data(), blockBytes);
+        QcRingBuffer::QsReadSpan span = spsc.acquireRead(blockBytes);
+        const char* data = span.data1;
+        if (span.size2)
+        {
+            memcpy(scratch.data(), span.data1, span.size1);
+            memcpy(scratch.data() + span.size1, span.data2, span.size2);
+            data = scratch.data();
+        }
+        checksum += consume(data, span.size());
+        spsc.commitRead(span.size());
+    });
+    measure("window", "mirrored", [&] {
+        mirror.write(src.data(), blockBytes);
+        size_t available = 0;
+        const char* data = mirror.acquireRead(available);
+        checksum += consume(data, available);
+        mirror.commitRead(available);
+    });
+    base = 0;
+    std::vector<char> stage(kWindowBytes, 0x21);
+    measure("slide", "vector", [&] {
+        stage.insert(stage.end(), src.begin(), src.end());
+        checksum += consume(stage.data(), stage.size());
+        stage.erase(stage.begin(), stage.begin() + blockBytes);
+    });
+    mirror.clear();
+    mirror.write(stage.data(), kWindowBytes);
+    measure("slide", "mirrored", [&] {
+        mirror.write(src.data(), blockBytes);
+        size_t available = 0;
+        const char* data = mirror.acquireRead(available);
+        checksum += consume(data, available);
+        mirror.commitRead(blockBytes);
+    });
+    if (checksum == 0)
+        printf("unexpected checksum\n");
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+//QcMirroredRingBuffer against QcRingBuffer on one thread, so only the data path is measured.
+//"copy" writes and reads back blocks of a size that does not divide the capacity, so transfers wrap;
+//"window" is an encoder that needs each block as one pointer: QcRingBuffer stitches wrapped blocks
+//into a scratch buffer, the mirror hands out the pointer as is. "slide" keeps a window of audio
+//resident, appends a block and drops one from the front, the way QcAudioTimeStretch stages its input.
+class MirroredRingBench
+{
+public:
+    MirroredRingBench(int megabytes = 512);
+
+    int run();
+protected:
+    void runCase(int blockBytes);
+protected:
+    int m_megabytes;
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "PacketPoolBench.h"
+#include "libmedia/FFmpegUtils.h"
+#include "libmedia/FFmpegDemuxer.h"
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+#include <deque>
+#include <chrono>
+#include <stdio.h>
+
+PacketPoolBench::PacketPoolBench(int nPackets, int queueDepth)
+    : m_nPackets(nPackets)
+    , m_queueDepth(queueDepth)
+{
+
+}
+
+int PacketPoolBench::run(const std::string& file)
+{
+    printf("%-10s %-5s %10s %10s %10s %10s\n", "case", "pool", "packets", "ns/packet", "hits", "misses");
+    runSynthetic(false);
+    runSynthetic(true);
+    if (file.empty())
+        return 0;
+
+    bool bOk = runDemux(file, false);
+    bOk &= runDemux(file, true);
+    return bOk ? 0 : 1;
+}
+
+void PacketPoolBench::runSynthetic(bool bPool)
+{
+    using namespace std::chrono;
+    FFmpegUtils::setPacketPoolEnabled(bPool);
+    QsPoolStats before = FFmpegUtils::packetPoolStats();
+
+    std::deque<AVPacketPtr> queue;
+    auto begin = steady_clock::now();
+    for (int i = 0; i < m_nPackets; ++i)
+    {
+        queue.push_back(FFmpegUtils::allocAVPacket());
+        if ((int)queue.size() > m_queueDepth)
+            queue.pop_front();
+    }
+    queue.clear();
+    double ms = duration<double, std::milli>(steady_clock::now() - begin).count();
+
+    QsPoolStats after = FFmpegUtils::packetPoolStats();
+    printf("%-10s %-5s %10d %10.1f %10llu %10llu\n", "synthetic", bPool ? "on" : "off", m_nPackets,
+        ms * 1e6 / m_nPackets, (unsigned long long)(after.hits - before.hits), (unsigned long long)(after.misses - before.misses));
+}
+
+bool PacketPoolBench::runDemux(const std::string& file, bool bPool)
+{
+    using namespace std::chrono;
+    FFmpegDemuxer demuxer;
+    if (!demuxer.open(file.c_str()))
+    {
+        printf("%s: open failed\n", file.c_str());
+        return false;
+    }
+
+    FFmpegUtils::setPacketPoolEnabled(bPool);
+    QsPoolStats before = FFmpegUtils::packetPoolStats();
+
+    //the file is demuxed over and over until enough packets went through.
+    std::deque<AVPacketPtr> queue;
+    int nPackets = 0;
+    auto begin = steady_clock::now();
+    while (nPackets < m_nPackets)
+    {
+        AVPacketPtr pkt = FFmpegUtils::allocAVPacket();
+        if (demuxer.readPacket(pkt) != 0)
+        {
+            if (!demuxer.isFileEnd() || nPackets == 0)
+                break;
+            demuxer.seek(0);
+            continue;
+        }
+        queue.push_back(pkt);
+        if ((int)queue.size() > m_queueDepth)
+            queue.pop_front();
+        ++nPackets;
+    }
+    queue.clear();
+    double ms = duration<double, std::milli>(steady_clock::now() - begin).count();
+    demuxer.close();
+
+    QsPoolStats after = FFmpegUtils::packetPoolStats();
+    printf("%-10s %-5s %10d %10.1f %10llu %10llu\n", "demux", bPool ? "on" : "off", nPackets,
+        nPackets ? ms * 1e6 / nPackets : 0.0, (unsigned long long)(after.hits - before.hits), (unsigned long long)(after.misses - before.misses));
+    return nPackets > 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+//AVPacket turnover with and without FFmpegPacketPool: a synthetic alloc/release loop and, when a
+//file is given, demuxing it with a window of queued packets like the player's PacketQueue.
+class PacketPoolBench
+{
+public:
+    PacketPoolBench(int nPackets = 1000000, int queueDepth = 64);
+
+    int run(const std::string& file);
+protected:
+    void runSynthetic(bool bPool);
+    bool runDemux(const std::string& file, bool bPool);
+protected:
+    int m_nPackets;
+    int m_queueDepth;
+};
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "RingBufferBench.h"
+#include "QcRingBuffer.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+    //48kHz stereo s16.
+    const int kBlockAlign = 4;
+    const int kBytesPerMs = 48 * kBlockAlign;
+    const int kPacketBytes = 10 * kBytesPerMs;
+}
+
+RingBufferBench::RingBufferBench(int durationMs)
+    : m_durationMs(durationMs)
+{
+
+}
+
+int RingBufferBench::run()
+{
+    printf("%-6s %6s %10s %10s %9s %9s %9s %10s %9s\n", "mode", "ringMs", "writes/s", "reads/s",
+        "p50 ns", "p99 ns", "max ns", "overflowKB", "underflow");
+    const int ringSizes[] = { 50, 250 };
+    for (int ringMs : ringSizes)
+    {
+        runCase(false, ringMs);
+        runCase(true, ringMs);
+    }
+    return 0;
+}
+
+void RingBufferBench::runCase(bool bSpsc, int ringMs)
+{
+    using namespace std::chrono;
+    QcRingBuffer ring(ringMs * kBytesPerMs, bSpsc ? QcRingBuffer::eSpsc : QcRingBuffer::eDefault);
+    std::mutex mutex;
+    std::atomic<bool> bStop(false);
+    uint64_t overflowBytes = 0;
+    uint64_t underflows = 0;
+
+    int64_t writes = 0;
+    std::thread producer([&] {
+        std::vector<char> block(kPacketBytes, 0x11);
+        while (!bStop.load(std::memory_order_relaxed))
+        {
+            if (bSpsc)
+            {
+                if (ring.writeSpsc(block.data(), block.size(), kBlockAlign) == 0)
+                    std::this_thread::yield();
+            }
+            else
+            {
+                //the old playAudio: make room by dropping the oldest bytes, all under the lock.
+                std::unique_lock<std::mutex> lock(mutex);
+                size_t usableSize = ring.usableSize();
+                if (block.size() > usableSize)
+                {
+                    overflowBytes += block.size() - usableSize;
+                    ring.read(nullptr, block.size() - usableSize);
+                }
+                ring.write(block.data(), block.size());
+            }
+            ++writes;
+        }
+    });
+
+    std::vector<char> endpoint(kPacketBytes);
+    int64_t reads = 0;
+    std::vector<int64_t> cost;
+    cost.reserve(1 << 20);
+    auto begin = steady_clock::now();
+    auto end = begin + milliseconds(m_durationMs);
+    for (;;)
+    {
+        auto t0 = steady_clock::now();
+        if (t0 >= end)
+            break;
+        if (bSpsc)
+        {
+            QcRingBuffer::QsReadSpan span = ring.acquireRead(kPacketBytes);
+            if (span.size() == (size_t)kPacketBytes)
+            {
+                memcpy(endpoint.data(), span.data1, span.size1);
+                memcpy(endpoint.data() + span.size1, span.data2, span.size2);
+                ring.commitRead(span.size());
+                ++reads;
+            }
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (ring.size() >= (size_t)kPacketBytes)
+            {
+                ring.read(endpoint.data(), kPacketBytes);
+                ++reads;
+            }
+            else
+                ++underflows;
+        }
+        if (cost.size() < cost.capacity())
+            cost.push_back(duration_cast<nanoseconds>(steady_clock::now() - t0).count());
+    }
+    bStop = true;
+    producer.join();
+    double seconds = duration<double>(steady_clock::now() - begin).count();
+
+    if (bSpsc)
+    {
+        overflowBytes = ring.overflowBytes();
+        underflows = ring.underflowCount();
+    }
+    std::sort(cost.begin(), cost.end());
+    int64_t p50 = cost.empty() ? 0 : cost[cost.size() / 2];
+    int64_t p99 = cost.empty() ? 0 : cost[cost.size() * 99 / 100];
+    int64_t worst = cost.empty() ? 0 : cost.back();
+    printf("%-6s %6d %10.0f %10.0f %9lld %9lld %9lld %10llu %9llu\n", bSpsc ? "spsc" : "mutex", ringMs,
+        writes / seconds, reads / seconds, (long long)p50, (long long)p99, (long long)worst,
+        (unsigned long long)(overflowBytes / 1024), (unsigned long long)underflows);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+//WASAPIPlayer's pcm handoff under contention: a decode thread writes 10ms blocks as fast as it can
+//while a render thread takes 10ms packets. Compares QcRingBuffer behind a mutex, the way playAudio
+//and fillPcmData used to share it, with the eSpsc mode; the render side's per packet time is what
+//an audio device callback would wait.
+class RingBufferBench
+{
+public:
+    RingBufferBench(int durationMs = 2000);
+
+    int run();
+protected:
+    void runCase(bool bSpsc, int ringMs);
+protected:
+    int m_durationMs;
+};
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "ScaleBench.h"
+#include "libmedia/FFmpegVideoTransformat.h"
+#include "libmedia/AVFrameRef.h"
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+}
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+
+namespace
+{
+    struct QsScaleCase
+    {
+        const char* name;
+        int srcW;
+        int srcH;
+        AVPixelFormat srcFormat;
+        int dstW;
+        int dstH;
+        AVPixelFormat dstFormat;
+    };
+
+    const QsScaleCase kCases[] = {
+        { "nv12->bgra 1080p", 1920, 1080, AV_PIX_FMT_NV12, 1920, 1080, AV_PIX_FMT_BGRA },
+        { "i420->bgra 1080p", 1920, 1080, AV_PIX_FMT_YUV420P, 1920, 1080, AV_PIX_FMT_BGRA },
+        { "nv12 4k->bgra 1080p", 3840, 2160, AV_PIX_FMT_NV12, 1920, 1080, AV_PIX_FMT_BGRA },
+        { "i420 4k->i420 1080p", 3840, 2160, AV_PIX_FMT_YUV420P, 1920, 1080, AV_PIX_FMT_YUV420P },
+        { "i420 1080p->bgra 720p", 1920, 1080, AV_PIX_FMT_YUV420P, 1280, 720, AV_PIX_FMT_BGRA },
+    };
+
+    const char* kQualityNames[] = { "fast", "bilinear", "area", "bicubic", "best" };
+}
+
+ScaleBench::ScaleBench(int nFrames)
+    : m_nFrames(nFrames)
+{
+
+}
+
+int ScaleBench::run(int maxThreads)
+{
+    if (maxThreads <= 0)
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("%-22s %-9s %7s %10s %8s\n", "case", "quality", "threads", "ms/frame", "speedup");
+    for (const QsScaleCase& c : kCases)
+    {
+        for (int quality : { eScaleFast, eScaleArea, eScaleBest })
+        {
+            double base = 0;
+            for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2)
+            {
+                double ms = runCase(c.srcW, c.srcH, c.srcFormat, c.dstW, c.dstH, c.dstFormat, quality, nThreads);
+                if (nThreads == 1)
+                    base = ms;
+                printf("%-22s %-9s %7d %10.3f %8.2f\n", c.name, kQualityNames[quality], nThreads, ms,
+                    ms > 0 ? base / ms : 0);
+            }
+        }
+    }
+    return 0;
+}
+
+double ScaleBench::runCase(int srcW, int srcH, int srcFormat, int dstW, int dstH, int dstFormat, int quality, int nThreads)
+{
+    using namespace std::chrono;
+    AVFrameRef src = AVFrameRef::allocFrame(srcW, srcH, srcFormat);
+    AVFrameRef dst = AVFrameRef::allocFrame(dstW, dstH, dstFormat);
+    //a gradient, so the filters do real work and nothing collapses to a constant.
+    for (int p = 0; p < 4 && src.data(p); ++p)
+    {
+        int rows = p == 0 ? srcH : srcH >> av_pix_fmt_desc_get((AVPixelFormat)srcFormat)->log2_chroma_h;
+        for (int y = 0; y < rows; ++y)
+        {
+            uint8_t* pRow = src.data(p) + (ptrdiff_t)y * src.linesize(p);
+            for (int x = 0; x < src.linesize(p); ++x)
+                pRow[x] = (uint8_t)(x + y * 3 + p * 64);
+        }
+    }
+
+    FFmpegVideoTransformat transformat;
+    transformat.setQuality(quality);
+    transformat.setThreadCount(nThreads);
+    //the first call builds the contexts and starts the workers.
+    transformat.transformat(srcW, srcH, srcFormat, src.data(), src.linesize(), dstW, dstH, dstFormat, dst.data(), dst.linesize());
+
+    auto begin = steady_clock::now();
+    for (int i = 0; i < m_nFrames; ++i)
+        transformat.transformat(srcW, srcH, srcFormat, src.data(), src.linesize(), dstW, dstH, dstFormat, dst.data(), dst.linesize());
+    return duration<double, std::milli>(steady_clock::now() - begin).count() / m_nFrames;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+//FFmpegVideoTransformat over the conversions a software renderer hits, for each quality tier and
+//band thread count. Frames are synthetic, so no file is needed; "speedup" is against one thread.
+class ScaleBench
+{
+public:
+    ScaleBench(int nFrames = 100);
+
+    int run(int maxThreads);
+protected:
+    double runCase(int srcW, int srcH, int srcFormat, int dstW, int dstH, int dstFormat, int quality, int nThreads);
+protected:
+    int m_nFrames;
+};
\ No newline at end of file
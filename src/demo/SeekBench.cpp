@@ -0,0 +1,149 @@
+#include "SeekBench.h"
+#include "libmedia/QcMultiMediaPlayer.h"
+#include "libmedia/AVFrameRef.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+#include <stdint.h>
+
+namespace
+{
+    class NullNotify : public IMultiMediaNotify
+    {
+    public:
+        bool OnVideoFrame(const AVFrameRef&) override { return true; }
+        bool OnAudioFrame(const AVFrameRef&) override { return true; }
+        void ToEndSignal() override {}
+    };
+
+    struct QsSeekStats
+    {
+        std::vector<double> callUs;
+        std::vector<int> latencyMs;
+        int timeouts = 0;
+    };
+
+    //polls until the seek issued last has presented a frame, -1 on timeout.
+    int waitSeekDone(QcMultiMediaPlayer& player, int timeoutMs)
+    {
+        using namespace std::chrono;
+        auto end = steady_clock::now() + milliseconds(timeoutMs);
+        while (steady_clock::now() < end)
+        {
+            int latency = player.getLastSeekLatency();
+            if (latency >= 0)
+                return latency;
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        return -1;
+    }
+
+    void printStats(const char* name, QsSeekStats& stats)
+    {
+        std::vector<int>& lat = stats.latencyMs;
+        if (lat.empty())
+        {
+            printf("  %-8s no completed seeks, %d timeouts\n", name, stats.timeouts);
+            return;
+        }
+        std::sort(lat.begin(), lat.end());
+        double sum = 0;
+        for (int v : lat)
+            sum += v;
+        double callSum = 0;
+        double callMax = 0;
+        for (double v : stats.callUs)
+        {
+            callSum += v;
+            callMax = (std::max)(callMax, v);
+        }
+        size_t p95 = (lat.size() * 95 + 99) / 100 - 1;
+        printf("  %-8s latency ms min=%d avg=%.1f p95=%d max=%d | seek() us avg=%.1f max=%.1f | timeouts=%d\n",
+            name, lat.front(), sum / lat.size(), lat[p95], lat.back(),
+            callSum / stats.callUs.size(), callMax, stats.timeouts);
+    }
+}
+
+SeekBench::SeekBench(int nSeeks, int nBurst)
+    : m_nSeeks(nSeeks)
+    , m_nBurst(nBurst)
+{
+
+}
+
+int SeekBench::run(const std::vector<std::string>& files)
+{
+    if (files.empty())
+    {
+        printf("usage: demo seek <file> [file...]\n");
+        return 1;
+    }
+
+    int nFailed = 0;
+    for (const std::string& file : files)
+    {
+        if (!runFile(file))
+            ++nFailed;
+    }
+    return nFailed;
+}
+
+bool SeekBench::runFile(const std::string& file)
+{
+    using namespace std::chrono;
+    NullNotify notify;
+    QcMultiMediaPlayer player(&notify);
+    if (!player.open(file.c_str()) || (!player.hasVideo() && !player.hasAudio()))
+    {
+        printf("%s: open failed\n", file.c_str());
+        return false;
+    }
+
+    int totalTime = player.getTotalTime();
+    if (totalTime <= 0)
+    {
+        printf("%s: not seekable\n", file.c_str());
+        return false;
+    }
+
+    player.play();
+    printf("%s (%d ms)\n", file.c_str(), totalTime);
+
+    //fixed seed so runs over the same files seek to the same positions.
+    uint32_t seed = 12345;
+    auto nextTarget = [&] {
+        seed = seed * 1664525 + 1013904223;
+        return (int)((seed >> 8) % (uint32_t)std::max<int>(1, totalTime * 9 / 10));
+    };
+
+    QsSeekStats single;
+    QsSeekStats burst;
+    for (int i = 0; i < m_nSeeks; ++i)
+    {
+        auto begin = steady_clock::now();
+        player.seek(nextTarget());
+        single.callUs.push_back(duration<double, std::micro>(steady_clock::now() - begin).count());
+        int latency = waitSeekDone(player, 5000);
+        if (latency < 0)
+            ++single.timeouts;
+        else
+            single.latencyMs.push_back(latency);
+
+        //scrubbing: the requests coalesce, the latency is that of the last target.
+        begin = steady_clock::now();
+        for (int j = 0; j < m_nBurst; ++j)
+            player.seek(nextTarget());
+        burst.callUs.push_back(duration<double, std::micro>(steady_clock::now() - begin).count() / m_nBurst);
+        latency = waitSeekDone(player, 5000);
+        if (latency < 0)
+            ++burst.timeouts;
+        else
+            burst.latencyMs.push_back(latency);
+    }
+    player.close();
+
+    printStats("single", single);
+    printStats("burst", burst);
+    return true;
+}
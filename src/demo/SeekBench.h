@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+//Seek latency over a set of files: every seek is timed from the seek() call to the first frame
+//presented at the new position, single seeks and bursts of scrubbing seeks where only the last one counts.
+class SeekBench
+{
+public:
+    SeekBench(int nSeeks = 20, int nBurst = 8);
+
+    int run(const std::vector<std::string>& files);
+protected:
+    bool runFile(const std::string& file);
+protected:
+    int m_nSeeks;
+    int m_nBurst;
+};
\ No newline at end of file
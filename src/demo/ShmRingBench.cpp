@@ -0,0 +1,207 @@
+#include "ShmRingBench.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "QsVideodef.h"
+#include "utils/QcVideoSharedMemory.h"
+
+namespace
+{
+    struct QsSize
+    {
+        const char* name;
+        int width;
+        int height;
+    };
+
+    const QsSize kSizes[] = {
+        { "1080p", 1920, 1080 },
+        { "4k", 3840, 2160 },
+    };
+
+    std::wstring toWide(const char* text)
+    {
+        return std::wstring(text, text + strlen(text));
+    }
+}
+
+ShmRingBench::ShmRingBench(int nFrames, int nSlots)
+    : m_nFrames(nFrames)
+    , m_nSlots(nSlots)
+{
+
+}
+
+int ShmRingBench::run()
+{
+    printf("%-6s %-6s %8s %8s %8s %8s %10s %10s\n", "mode", "size", "written", "read", "dropped", "GB/s", "lat p50us", "lat p99us");
+    for (const QsSize& size : kSizes)
+    {
+        runCase("burst", size.width, size.height, false);
+        runCase("paced", size.width, size.height, true);
+    }
+    return 0;
+}
+
+void ShmRingBench::runCase(const char* mode, int width, int height, bool bPaced)
+{
+    using namespace std::chrono;
+    char key[64];
+    snprintf(key, sizeof(key), "ShmRingBench_%d_%s_%d", (int)(QcVideoSharedMemory::now() % 100000), mode, height);
+
+    QcVideoSharedMemory ring(toWide(key).c_str());
+    if (!ring.create(m_nSlots, width, height, FOURCC_NV12))
+    {
+        printf("%-6s %dx%d: create failed\n", mode, width, height);
+        return;
+    }
+    if (!startReader(key))
+    {
+        printf("%-6s %dx%d: reader did not start\n", mode, width, height);
+        return;
+    }
+    for (int i = 0; i < 500 && ring.readerCount() == 0; ++i)
+        std::this_thread::sleep_for(milliseconds(10));
+
+    //a decoder frame in private memory, copied into the ring once per frame.
+    std::vector<uint8_t> src(video::CalBufNeedSize(width, height, FOURCC_NV12), 0x80);
+    uint8_t* srcData[QMaxSlice] = {};
+    uint32_t srcLinesize[QMaxSlice] = {};
+    video::FillVideoFrameInfo(src.data(), width, height, FOURCC_NV12, srcData, srcLinesize);
+
+    int written = 0;
+    for (int i = 0; i < m_nFrames; ++i)
+    {
+        //the first byte carries the frame number so the reader can check it got the right pixels.
+        srcData[0][0] = (uint8_t)i;
+        if (ring.writeFrame(srcData, srcLinesize, width, height, FOURCC_NV12, i))
+            ++written;
+        if (bPaced)
+            std::this_thread::sleep_for(milliseconds(2));
+    }
+    if (waitReader() != 0 || written != m_nFrames)
+        printf("%-6s %dx%d: reader failed or %d frames found every slot held\n", mode, width, height, m_nFrames - written);
+}
+
+int ShmRingBench::runReader(const char* key, int nFrames)
+{
+    using namespace std::chrono;
+    QcVideoSharedMemory ring(toWide(key).c_str());
+    if (!ring.attach())
+    {
+        printf("reader: attach %s failed\n", key);
+        return 1;
+    }
+
+    std::vector<int64_t> latency;
+    latency.reserve(nFrames);
+    double bytes = 0;
+    int read = 0;
+    int bad = 0;
+    uint64_t checksum = 0;
+    QsSharedFrame frame;
+    auto begin = steady_clock::now();
+    //ends with the last frame or when the writer has gone quiet.
+    while (ring.lockReadBuffer(frame, 1000))
+    {
+        latency.push_back(QcVideoSharedMemory::now() - frame.timestamp);
+        if (frame.data[0][0] != (uint8_t)frame.pts)
+            ++bad;
+        //touches every cache line, the way an analytics pass would.
+        int chromaHeight = (frame.height + 1) / 2;
+        for (int y = 0; y < frame.height; ++y)
+        {
+            const uint8_t* row = frame.data[0] + (size_t)y * frame.linesize[0];
+            for (int x = 0; x < frame.width; x += 64)
+                checksum += row[x];
+        }
+        for (int y = 0; y < chromaHeight; ++y)
+        {
+            const uint8_t* row = frame.data[1] + (size_t)y * frame.linesize[1];
+            for (int x = 0; x < frame.width; x += 64)
+                checksum += row[x];
+        }
+        bytes += (double)frame.linesize[0] * frame.height + (double)frame.linesize[1] * chromaHeight;
+        ++read;
+        bool bLast = frame.pts == nFrames - 1;
+        ring.unLockReadBuffer();
+        if (bLast)
+            break;
+    }
+    double ms = duration<double, std::milli>(steady_clock::now() - begin).count();
+
+    std::sort(latency.begin(), latency.end());
+    int64_t p50 = latency.empty() ? 0 : latency[latency.size() / 2];
+    int64_t p99 = latency.empty() ? 0 : latency[std::min(latency.size() - 1, latency.size() * 99 / 100)];
+    const char* mode = strstr(key, "paced") ? "paced" : "burst";
+    const char* size = frame.height > 1080 ? "4k" : "1080p";
+    printf("%-6s %-6s %8d %8d %8lld %8.2f %10lld %10lld%s\n", mode, size, ring.writtenFrames(), read, (long long)ring.droppedFrames(),
+        ms > 0 ? bytes / ms / 1e6 : 0, (long long)p50, (long long)p99, bad ? "  pixel mismatch" : "");
+    (void)checksum;
+    return bad ? 1 : 0;
+}
+
+#ifdef _WIN32
+bool ShmRingBench::startReader(const char* key)
+{
+    char path[MAX_PATH];
+    GetModuleFileNameA(NULL, path, MAX_PATH);
+    std::string cmd = std::string("\"") + path + "\" shmring-reader " + key + " " + std::to_string(m_nFrames);
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi = {};
+    if (!CreateProcessA(NULL, &cmd[0], NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi))
+        return false;
+    CloseHandle(pi.hThread);
+    m_hProcess = pi.hProcess;
+    return true;
+}
+
+int ShmRingBench::waitReader()
+{
+    DWORD code = 1;
+    if (m_hProcess)
+    {
+        WaitForSingleObject(m_hProcess, INFINITE);
+        GetExitCodeProcess(m_hProcess, &code);
+        CloseHandle(m_hProcess);
+        m_hProcess = nullptr;
+    }
+    return (int)code;
+}
+#else
+bool ShmRingBench::startReader(const char* key)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int code = runReader(key, m_nFrames);
+        fflush(stdout);
+        _exit(code);
+    }
+    m_hProcess = (void*)(intptr_t)pid;
+    return pid > 0;
+}
+
+int ShmRingBench::waitReader()
+{
+    int status = 1;
+    if (m_hProcess)
+    {
+        waitpid((pid_t)(intptr_t)m_hProcess, &status, 0);
+        m_hProcess = nullptr;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+//QcVideoSharedMemory between two processes: this one writes nv12 frames into the ring and a child
+//process reads them. "burst" writes flat out (throughput, overwrite drops), "paced" writes every 2ms
+//so the latency is the writer's publish to the reader's wakeup.
+class ShmRingBench
+{
+public:
+    ShmRingBench(int nFrames = 600, int nSlots = 4);
+
+    int run();
+    //body of the child process.
+    static int runReader(const char* key, int nFrames);
+protected:
+    void runCase(const char* mode, int width, int height, bool bPaced);
+    bool startReader(const char* key);
+    int waitReader();
+protected:
+    int m_nFrames;
+    int m_nSlots;
+    void* m_hProcess = nullptr;
+};
\ No newline at end of file
@@ -1,6 +1,52 @@
 #include <windows.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "FrameQueueBench.h"
+#include "SeekBench.h"
+#include "IOBench.h"
+#include "PacketPoolBench.h"
+#include "DecodeBench.h"
+#include "ScaleBench.h"
+#include "ColorConvertBench.h"
+#include "CopyBench.h"
+#include "ShmRingBench.h"
+#include "RingBufferBench.h"
+#include "MirroredRingBench.h"
+#include "AudioConvertBench.h"
+#include "AudioMixerBench.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "framequeue") == 0)
+        return FrameQueueBench().run();
+    if (argc > 1 && strcmp(argv[1], "seek") == 0)
+        return SeekBench().run(std::vector<std::string>(argv + 2, argv + argc));
+    if (argc > 1 && strcmp(argv[1], "io") == 0)
+        return IOBench().run(argc > 2 ? argv[2] : "");
+    if (argc > 1 && strcmp(argv[1], "packetpool") == 0)
+        return PacketPoolBench().run(argc > 2 ? argv[2] : "");
+    if (argc > 1 && strcmp(argv[1], "decode") == 0)
+        return DecodeBench().run(argc > 2 ? argv[2] : "", argc > 3 ? atoi(argv[3]) : 0);
+    if (argc > 1 && strcmp(argv[1], "scale") == 0)
+        return ScaleBench().run(argc > 2 ? atoi(argv[2]) : 0);
+    if (argc > 1 && strcmp(argv[1], "yuv2rgb") == 0)
+        return ColorConvertBench(argc > 2 ? atoi(argv[2]) : 100).run();
+    if (argc > 1 && strcmp(argv[1], "copy") == 0)
+        return CopyBench(argc > 2 ? atoi(argv[2]) : 50).run();
+    if (argc > 1 && strcmp(argv[1], "shmring") == 0)
+        return ShmRingBench(argc > 2 ? atoi(argv[2]) : 600, argc > 3 ? atoi(argv[3]) : 4).run();
+    if (argc > 3 && strcmp(argv[1], "shmring-reader") == 0)
+        return ShmRingBench::runReader(argv[2], atoi(argv[3]));
+    if (argc > 1 && strcmp(argv[1], "ringbuffer") == 0)
+        return RingBufferBench(argc > 2 ? atoi(argv[2]) : 2000).run();
+    if (argc > 1 && strcmp(argv[1], "mirror") == 0)
+        return MirroredRingBench(argc > 2 ? atoi(argv[2]) : 512).run();
+    if (argc > 1 && strcmp(argv[1], "audioconv") == 0)
+        return AudioConvertBench(argc > 2 ? atoi(argv[2]) : 60).run();
+    if (argc > 1 && strcmp(argv[1], "mixer") == 0)
+        return AudioMixerBench(argc > 2 ? atoi(argv[2]) : 10).run();
+
+    printf("usage: demo framequeue | seek <file> [file...] | io <file> | packetpool [file] | decode <file> [maxThreads] | scale [maxThreads] | yuv2rgb [frames] | copy [frames] | shmring [frames] [slots] | ringbuffer [ms] | mirror [MB] | audioconv [seconds] | mixer [seconds]\n");
     return 0;
 }
\ No newline at end of file
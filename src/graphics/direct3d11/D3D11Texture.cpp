@@ -2,6 +2,7 @@
 #include <d3d11.h>
 #include <string>
 #include "QsVideodef.h"
+#include "QsVideoCopy.h"
 #include "utils/libtime.h"
 #include <utils/LogTimeElapsed.h>
 
@@ -226,9 +227,9 @@ bool D3D11Texture::updateYUV(const uint8_t* const datas[], const int dataSlice[]
 			}	
 		}
 
-		video::CopyPlane((uint8_t*)res[0].pData, (int)res[0].RowPitch, datas[0], dataSlice[0], w, h);
-		video::CopyPlane((uint8_t*)res[1].pData, (int)res[1].RowPitch, datas[1], dataSlice[1], w/2, h/2);
-		video::CopyPlane((uint8_t*)res[2].pData, (int)res[2].RowPitch, datas[2], dataSlice[2], w/2, h/2);
+		video::CopyPlaneFast((uint8_t*)res[0].pData, (int)res[0].RowPitch, datas[0], dataSlice[0], w, h);
+		video::CopyPlaneFast((uint8_t*)res[1].pData, (int)res[1].RowPitch, datas[1], dataSlice[1], w/2, h/2);
+		video::CopyPlaneFast((uint8_t*)res[2].pData, (int)res[2].RowPitch, datas[2], dataSlice[2], w/2, h/2);
 
 		for (int i = 0; i < 3; ++i)
 		{
@@ -292,14 +293,14 @@ bool D3D11Texture::updateNV12(const uint8_t* const datas[], const int dataSlice[
 			HRESULT hr = m_d3d11DeviceContext->Map(m_texturePlanes[0], 0, D3D11_MAP_WRITE_DISCARD, 0, &res);
 			if (FAILED(hr))
 				return false;
-			video::CopyPlane((uint8_t*)res.pData, (int)res.RowPitch, datas[0], dataSlice[0], w, h);
+			video::CopyPlaneFast((uint8_t*)res.pData, (int)res.RowPitch, datas[0], dataSlice[0], w, h);
 			m_d3d11DeviceContext->Unmap(m_texturePlanes[0], 0);
 
 
 			hr = m_d3d11DeviceContext->Map(m_texturePlanes[1], 0, D3D11_MAP_WRITE_DISCARD, 0, &res);
 			if (FAILED(hr))
 				return false;
-			video::CopyPlane((uint8_t*)res.pData, (int)res.RowPitch, datas[1], dataSlice[1], w/2, h/2);
+			video::CopyPlaneFast((uint8_t*)res.pData, (int)res.RowPitch, datas[1], dataSlice[1], w/2, h/2);
 			m_d3d11DeviceContext->Unmap(m_texturePlanes[1], 0);
 	}
 	else
@@ -309,8 +310,8 @@ bool D3D11Texture::updateNV12(const uint8_t* const datas[], const int dataSlice[
 		if (FAILED(hr))
 			return false;
 
-		video::CopyPlane((uint8_t*)res.pData, (int)res.RowPitch, datas[0], dataSlice[0], w, h);
-		video::CopyPlane(((uint8_t*)res.pData) + h * res.RowPitch, (int)res.RowPitch, datas[1], dataSlice[1], w, h/2);
+		video::CopyPlaneFast((uint8_t*)res.pData, (int)res.RowPitch, datas[0], dataSlice[0], w, h);
+		video::CopyPlaneFast(((uint8_t*)res.pData) + h * res.RowPitch, (int)res.RowPitch, datas[1], dataSlice[1], w, h/2);
 
 		m_d3d11DeviceContext->Unmap(m_texturePlanes[0], 0);
 	}
@@ -341,7 +342,7 @@ void D3D11Texture::createRGBTexture(int width, int height, int dxgiFormat)
 bool D3D11Texture::updateRGB32(const uint8_t* srcData, int srcSlice, int w, int h, int dxgiFormat)
 {
 	return lockRGB32(w, h, dxgiFormat, [&](uint8_t* dstData, int dstSlice){
-		video::CopyPlane(dstData, dstSlice, srcData, srcSlice, w, h);
+		video::CopyPlaneFast(dstData, dstSlice, srcData, srcSlice, w * 4, h);
 	});
 }
 
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+//Spin-then-park policy in the manner of glibc's adaptive mutex: spin() polls a condition for up to
+//twice the learned budget before the caller parks, and the budget follows the spins the recent
+//waits took. Short critical sections stay in user space, long ones settle on a bounded spin.
+class QcAdaptiveSpin
+{
+public:
+	enum { kMaxSpins = 200 };
+
+	template<class Fn>
+	bool spin(Fn&& ready)
+	{
+		int budget = m_budget.load(std::memory_order_relaxed);
+		int limit = budget * 2 + 10 < kMaxSpins ? budget * 2 + 10 : kMaxSpins;
+		int spins = 0;
+		bool bReady = false;
+		while (!(bReady = ready()) && ++spins < limit)
+			pause();
+		m_budget.store(budget + (spins - budget) / 8, std::memory_order_relaxed);
+		return bReady;
+	}
+
+	int budget() const { return m_budget.load(std::memory_order_relaxed); }
+
+	static void pause()
+	{
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#else
+		std::this_thread::yield();
+#endif
+	}
+private:
+	std::atomic<int> m_budget{ 0 };
+};
@@ -1,41 +1,48 @@
 #pragma once
 
+#include <atomic>
+#include <thread>
+
+//Lazily created singleton pointer, meant for objects with static storage: the zero-initialized
+//state is valid before any constructor ran. lock: 0 empty, 1 creating, 2 created, 3 released.
 template <class T>
 struct QcAtomicPointer
 {
-	T * p;
-	volatile long lock;
+	std::atomic<T*> p;
+	std::atomic<long> lock;
 	~QcAtomicPointer()
 	{
 		release();
 	}
 	void release()
 	{
-		while (lock == 1){}// busy locking while init
-		if (::InterlockedCompareExchange(&lock, 3, 2) == 2)
+		while (lock.load(std::memory_order_acquire) == 1){}// busy locking while init
+		long created = 2;
+		if (lock.compare_exchange_strong(created, 3))
 		{
 			//QmLogFinal << "Begin: " << __FUNCTION__;
-			delete p;
-			p = NULL;
+			delete p.exchange(nullptr);
 
 			//QmLogFinal << "End: " << __FUNCTION__;
 		}
 	}
 	inline T * get()
 	{
-		if (lock == 2 || lock == 3) // short path
-			return p;
+		long state = lock.load(std::memory_order_acquire);
+		if (state == 2 || state == 3) // short path
+			return p.load(std::memory_order_relaxed);
 
-		if (::InterlockedCompareExchange(&lock, 1, 0) == 0)
+		long empty = 0;
+		if (lock.compare_exchange_strong(empty, 1))
 		{
-			p = new T;
-			::InterlockedExchange(&lock, 2);
+			p.store(new T, std::memory_order_relaxed);
+			lock.store(2, std::memory_order_release);
 		}
 		else
 		{
-			while (lock == 1) Sleep(0); // busy locking while init
+			while (lock.load(std::memory_order_acquire) == 1) std::this_thread::yield(); // busy locking while init
 		}
-		return p;
+		return p.load(std::memory_order_relaxed);
 	}
 	inline operator T *() { return get(); }
 	inline T *operator->() { return get(); }
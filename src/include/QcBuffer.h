@@ -80,6 +80,8 @@ public:
 	{
 		return (m_pData == NULL || m_uDataSize == 0);
 	}
+	//set by attachExternelBuffer(), the memory still belongs to whoever attached it.
+	bool isExternalBuffer() const { return m_bExternalBuffer; }
 
 	void swap(QcBuffer& buffer)
 	{
@@ -1,12 +1,23 @@
 #pragma once
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <atomic>
+#include <thread>
+#include "QcFutex.h"
+#include "QcAdaptiveSpin.h"
+#endif
 
+//Recursive lock. Windows keeps the CRITICAL_SECTION, which spins before it parks in the kernel;
+//elsewhere a futex word (0 free, 1 locked, 2 locked with waiters) behind an adaptive spin.
 class QcCriticalLock 
 {
 public:
+#ifdef _WIN32
+	enum { kSpinCount = 4000 };
 	QcCriticalLock()
 	{	
-		InitializeCriticalSection(&m_csLock);
+		InitializeCriticalSectionAndSpinCount(&m_csLock, kSpinCount);
 	}
 	~QcCriticalLock()
 	{
@@ -34,6 +45,64 @@ public:
 	}
 private:
 	CRITICAL_SECTION	m_csLock;
+#else
+	void lock()
+	{
+		if (isOwner())
+		{
+			++m_recursion;
+			return;
+		}
+		if (!m_spin.spin([this] { return tryAcquire(); }))
+		{
+			//from here on the word says there may be waiters, so unlock() wakes one.
+			while (m_state.exchange(2, std::memory_order_acquire) != 0)
+				QcFutex::wait(m_state, 2);
+		}
+		setOwner();
+	}
+	void unlock()
+	{
+		if (--m_recursion > 0)
+			return;
+		m_owner.store(std::thread::id(), std::memory_order_relaxed);
+		if (m_state.exchange(0, std::memory_order_release) == 2)
+			QcFutex::wakeOne(m_state);
+	}
+	bool tryLock()
+	{
+		if (isOwner())
+		{
+			++m_recursion;
+			return true;
+		}
+		if (!tryAcquire())
+			return false;
+		setOwner();
+		return true;
+	}
+private:
+	bool tryAcquire()
+	{
+		int expected = 0;
+		return m_state.load(std::memory_order_relaxed) == 0
+			&& m_state.compare_exchange_strong(expected, 1, std::memory_order_acquire);
+	}
+	bool isOwner() const
+	{
+		return m_owner.load(std::memory_order_relaxed) == std::this_thread::get_id();
+	}
+	void setOwner()
+	{
+		m_owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+		m_recursion = 1;
+	}
+private:
+	std::atomic<int> m_state{ 0 };
+	std::atomic<std::thread::id> m_owner{ std::thread::id() };
+	int m_recursion = 0;
+	QcAdaptiveSpin m_spin;
+#endif
 };
 
 class QcAutoCriticalLock
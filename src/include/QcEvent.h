@@ -1,11 +1,28 @@
 #pragma once
 
-#include <Windows.h>
 #include <string>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "QcAdaptiveSpin.h"
+#endif
 
+//Auto or manual reset event. On Windows it wraps a kernel event, so it can be handed to APIs
+//that signal a HANDLE (WASAPI) and named events are shared between processes. Elsewhere it is a
+//condition variable, a name is ignored, and wait() spins briefly before it parks.
+//waitAny() is the portable replacement for WaitForMultipleObjects over events.
 class QcEvent
 {
 public:
+	enum { kTimeout = -1 };
+
+#ifdef _WIN32
 	QcEvent()
 		: m_hEvent(0)
 	{}
@@ -19,7 +36,7 @@ public:
 		}
 	}
 
-	void init(BOOL bManualReset = FALSE, BOOL bInitialState = FALSE, const wchar_t* key = NULL, bool bChangeName = false)
+	void init(bool bManualReset = false, bool bInitialState = false, const wchar_t* key = NULL, bool bChangeName = false)
 	{
 		std::wstring sKey = key != NULL ? key : L"";
 		if (sKey.size() && bChangeName)
@@ -41,6 +58,24 @@ public:
 		if (m_hEvent)
 			ResetEvent(m_hEvent);
 	}
+	//timeoutMs < 0 waits forever, returns false on timeout.
+	bool wait(int timeoutMs = -1) const
+	{
+		return m_hEvent && WaitForSingleObject(m_hEvent, timeoutMs < 0 ? INFINITE : timeoutMs) == WAIT_OBJECT_0;
+	}
+	//index of the event that ended the wait, kTimeout when none did.
+	static int waitAny(const QcEvent* const events[], int count, int timeoutMs = -1)
+	{
+		HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+		if (count <= 0 || count > MAXIMUM_WAIT_OBJECTS)
+			return kTimeout;
+		for (int i = 0; i < count; ++i)
+			handles[i] = events[i]->m_hEvent;
+		DWORD result = WaitForMultipleObjects(count, handles, FALSE, timeoutMs < 0 ? INFINITE : timeoutMs);
+		if (result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + (DWORD)count)
+			return (int)(result - WAIT_OBJECT_0);
+		return kTimeout;
+	}
 
 	operator HANDLE() const
 	{
@@ -52,4 +87,133 @@ public:
 	}
 private:
 	HANDLE m_hEvent;
+#else
+	void init(bool bManualReset = false, bool bInitialState = false, const wchar_t* key = NULL, bool bChangeName = false)
+	{
+		(void)key;
+		(void)bChangeName;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_bInit)
+		{
+			m_bManualReset = bManualReset;
+			m_bSignaled = bInitialState;
+			m_bInit = true;
+		}
+	}
+	void setEvent() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_bInit)
+			return;
+		m_bSignaled = true;
+		if (m_bManualReset)
+			m_cond.notify_all();
+		else
+			m_cond.notify_one();
+		for (QsWaiter* pWaiter : m_waiters)
+			pWaiter->notify();
+	}
+	void resetEvent() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bSignaled = false;
+	}
+	bool wait(int timeoutMs = -1) const
+	{
+		if (!m_bInit)
+			return false;
+		m_spin.spin([this] { return m_bSignaled.load(std::memory_order_acquire); });
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto signaled = [this] { return m_bSignaled.load(std::memory_order_relaxed); };
+		if (timeoutMs < 0)
+			m_cond.wait(lock, signaled);
+		else if (!m_cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), signaled))
+			return false;
+		if (!m_bManualReset)
+			m_bSignaled = false;
+		return true;
+	}
+	static int waitAny(const QcEvent* const events[], int count, int timeoutMs = -1)
+	{
+		if (count <= 0)
+			return kTimeout;
+		//registered first, so a setEvent between the check and the wait still wakes it.
+		QsWaiter waiter;
+		for (int i = 0; i < count; ++i)
+			events[i]->addWaiter(&waiter);
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs < 0 ? 0 : timeoutMs);
+		int index = kTimeout;
+		for (;;)
+		{
+			for (int i = 0; i < count && index == kTimeout; ++i)
+			{
+				if (events[i]->tryConsume())
+					index = i;
+			}
+			if (index != kTimeout || !waiter.wait(timeoutMs < 0, deadline))
+				break;
+		}
+		for (int i = 0; i < count; ++i)
+			events[i]->removeWaiter(&waiter);
+		return index;
+	}
+
+	operator bool() const
+	{
+		return m_bInit;
+	}
+private:
+	struct QsWaiter
+	{
+		std::mutex mutex;
+		std::condition_variable cond;
+		bool bNotified = false;
+
+		void notify()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bNotified = true;
+			cond.notify_one();
+		}
+		//false once the deadline passed without a notify.
+		bool wait(bool bForever, std::chrono::steady_clock::time_point deadline)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (bForever)
+				cond.wait(lock, [this] { return bNotified; });
+			else if (!cond.wait_until(lock, deadline, [this] { return bNotified; }))
+				return false;
+			bNotified = false;
+			return true;
+		}
+	};
+
+	bool tryConsume() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_bSignaled)
+			return false;
+		if (!m_bManualReset)
+			m_bSignaled = false;
+		return true;
+	}
+	void addWaiter(QsWaiter* pWaiter) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_waiters.push_back(pWaiter);
+	}
+	void removeWaiter(QsWaiter* pWaiter) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_waiters.erase(std::remove(m_waiters.begin(), m_waiters.end(), pWaiter), m_waiters.end());
+	}
+private:
+	mutable std::mutex m_mutex;
+	mutable std::condition_variable m_cond;
+	mutable std::vector<QsWaiter*> m_waiters;
+	mutable std::atomic<bool> m_bSignaled{ false };
+	mutable QcAdaptiveSpin m_spin;
+	bool m_bManualReset = false;
+	std::atomic<bool> m_bInit{ false };
+#endif
 };
\ No newline at end of file
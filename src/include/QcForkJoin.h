@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fork-join pool for splitting one piece of work into bands: job 0 runs on the caller, job i on
+//worker i - 1, and run() returns once every job has. One run at a time; tryRun() lets callers that
+//share a pool fall back to doing the work themselves instead of queueing behind another run.
+class QcForkJoin
+{
+public:
+	explicit QcForkJoin(int nThreads)
+	{
+		for (int i = 1; i < nThreads; ++i)
+			m_threads.emplace_back([this, i] { _loop(i); });
+	}
+	~QcForkJoin()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStop = true;
+		}
+		m_cond.notify_all();
+		for (std::thread& thread : m_threads)
+			thread.join();
+	}
+	int size() const { return (int)m_threads.size() + 1; }
+
+	void run(int n, const std::function<void(int)>& job)
+	{
+		std::lock_guard<std::mutex> runLock(m_runMutex);
+		_run(n, job);
+	}
+
+	bool tryRun(int n, const std::function<void(int)>& job)
+	{
+		std::unique_lock<std::mutex> runLock(m_runMutex, std::try_to_lock);
+		if (!runLock.owns_lock())
+			return false;
+		_run(n, job);
+		return true;
+	}
+private:
+	void _run(int n, const std::function<void(int)>& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pJob = &job;
+			m_nJobs = n;
+			m_pending = n - 1;
+			++m_generation;
+		}
+		m_cond.notify_all();
+		job(0);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCond.wait(lock, [this] { return m_pending == 0; });
+		m_pJob = nullptr;
+	}
+
+	void _loop(int index)
+	{
+		uint32_t seen = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			m_cond.wait(lock, [&] { return m_bStop || m_generation != seen; });
+			if (m_bStop)
+				return;
+			seen = m_generation;
+			//_run() waits for every job it handed out, so m_pJob stays valid until m_pending drops.
+			if (index >= m_nJobs)
+				continue;
+			const std::function<void(int)>* pCurrent = m_pJob;
+			lock.unlock();
+			(*pCurrent)(index);
+			lock.lock();
+			if (--m_pending == 0)
+				m_doneCond.notify_one();
+		}
+	}
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_runMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::condition_variable m_doneCond;
+	const std::function<void(int)>* m_pJob = nullptr;
+	int m_nJobs = 0;
+	int m_pending = 0;
+	uint32_t m_generation = 0;
+	bool m_bStop = false;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stdint.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+//Parks threads on the address of a 32-bit atomic until another thread wakes that address.
+//Linux uses the futex syscall, everything else a small hashed table of condition variables.
+//wait() returns at once when the word no longer holds expected; false means the timeout ran out,
+//true a wakeup, which may be spurious: callers always re-check their condition.
+//waitShared()/wakeAllShared() are for words in memory shared between processes. Linux parks on a
+//shared futex; elsewhere off Windows they poll every millisecond, and Windows has named events instead.
+namespace QcFutex
+{
+#if defined(__linux__)
+	inline bool wait(std::atomic<int>& word, int expected, int timeoutMs = -1)
+	{
+		struct timespec ts;
+		struct timespec* pTimeout = nullptr;
+		if (timeoutMs >= 0)
+		{
+			ts.tv_sec = timeoutMs / 1000;
+			ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+			pTimeout = &ts;
+		}
+		long ret = syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT_PRIVATE, expected, pTimeout, nullptr, 0);
+		return !(ret == -1 && errno == ETIMEDOUT);
+	}
+
+	inline void wakeOne(std::atomic<int>& word)
+	{
+		syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+	}
+
+	inline void wakeAll(std::atomic<int>& word)
+	{
+		syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+	}
+
+	inline bool waitShared(std::atomic<int>& word, int expected, int timeoutMs = -1)
+	{
+		struct timespec ts;
+		struct timespec* pTimeout = nullptr;
+		if (timeoutMs >= 0)
+		{
+			ts.tv_sec = timeoutMs / 1000;
+			ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+			pTimeout = &ts;
+		}
+		long ret = syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT, expected, pTimeout, nullptr, 0);
+		return !(ret == -1 && errno == ETIMEDOUT);
+	}
+
+	inline void wakeAllShared(std::atomic<int>& word)
+	{
+		syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+	}
+#else
+	struct QsParkBucket
+	{
+		std::mutex mutex;
+		std::condition_variable cond;
+	};
+
+	//words hashing to the same bucket share it, so every wake is a notify_all.
+	inline QsParkBucket& bucketOf(const void* address)
+	{
+		static QsParkBucket s_buckets[64];
+		return s_buckets[((uintptr_t)address >> 4) % 64];
+	}
+
+	inline bool wait(std::atomic<int>& word, int expected, int timeoutMs = -1)
+	{
+		QsParkBucket& bucket = bucketOf(&word);
+		std::unique_lock<std::mutex> lock(bucket.mutex);
+		if (word.load() != expected)
+			return true;
+		if (timeoutMs < 0)
+		{
+			bucket.cond.wait(lock);
+			return true;
+		}
+		return bucket.cond.wait_for(lock, std::chrono::milliseconds(timeoutMs)) == std::cv_status::no_timeout;
+	}
+
+	inline void wakeAll(std::atomic<int>& word)
+	{
+		//taking the lock orders the wake after a waiter's check of the word.
+		QsParkBucket& bucket = bucketOf(&word);
+		std::lock_guard<std::mutex> lock(bucket.mutex);
+		bucket.cond.notify_all();
+	}
+
+	inline void wakeOne(std::atomic<int>& word)
+	{
+		wakeAll(word);
+	}
+
+#ifndef _WIN32
+	inline bool waitShared(std::atomic<int>& word, int expected, int timeoutMs = -1)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+		while (word.load() == expected)
+		{
+			if (timeoutMs >= 0 && std::chrono::steady_clock::now() >= deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	inline void wakeAllShared(std::atomic<int>&)
+	{
+	}
+#endif
+#endif
+}
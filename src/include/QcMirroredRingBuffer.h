@@ -0,0 +1,225 @@
+#pragma once
+#include <atomic>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+//Byte ring whose pages are mapped twice back to back, so the bytes at capacity()..2*capacity() are
+//the bytes at 0..capacity() again. Every readable and every writable region is therefore one
+//contiguous pointer, and no transfer is ever split at the wrap.
+//One producer thread (acquireWrite/commitWrite/write) and one consumer thread (acquireRead/
+//commitRead/read/clear) may use it at once without locks; ensureCapacity() needs both sides idle.
+//Capacity is a power of two of at least the allocation granularity (64KB on Windows, a page elsewhere).
+class QcMirroredRingBuffer
+{
+public:
+	explicit QcMirroredRingBuffer(size_t capacity = 0)
+	{
+		if (capacity)
+			ensureCapacity(capacity);
+	}
+	~QcMirroredRingBuffer()
+	{
+		_unmap(m_data, m_capacity);
+	}
+
+	//false when the mirror could not be mapped, nothing can be written then.
+	bool isValid() const { return m_data != NULL; }
+	size_t capacity() const { return m_capacity; }
+	size_t size() const
+	{
+		size_t readPos = m_readPos.load(std::memory_order_acquire);
+		return m_writePos.load(std::memory_order_acquire) - readPos;
+	}
+	size_t usableSize() const { return m_capacity - size(); }
+	uint64_t overflowBytes() const { return m_overflowBytes.load(std::memory_order_relaxed); }
+	uint64_t underflowCount() const { return m_underflowCount.load(std::memory_order_relaxed); }
+
+	//producer: all free space as one region, usable bytes long.
+	char* acquireWrite(size_t& usable)
+	{
+		size_t writePos = m_writePos.load(std::memory_order_relaxed);
+		usable = m_capacity - (writePos - m_readPos.load(std::memory_order_acquire));
+		return m_data + (writePos & (m_capacity - 1));
+	}
+	void commitWrite(size_t bytes)
+	{
+		m_writePos.store(m_writePos.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+	}
+	//writes the largest multiple of unit bytes that fits, the rest counts in overflowBytes().
+	size_t write(const char* data, size_t bytes, size_t unit = 1)
+	{
+		size_t usable = 0;
+		char* dst = acquireWrite(usable);
+		size_t bytes_to_write = bytes < usable ? bytes : usable;
+		bytes_to_write -= bytes_to_write % unit;
+		if (bytes_to_write)
+		{
+			memcpy(dst, data, bytes_to_write);
+			commitWrite(bytes_to_write);
+		}
+		if (bytes_to_write < bytes)
+			m_overflowBytes.fetch_add(bytes - bytes_to_write, std::memory_order_relaxed);
+		return bytes_to_write;
+	}
+
+	//consumer: every readable byte as one region, valid until commitRead() releases it.
+	const char* acquireRead(size_t& available) const
+	{
+		size_t readPos = m_readPos.load(std::memory_order_relaxed);
+		available = m_writePos.load(std::memory_order_acquire) - readPos;
+		return m_data + (readPos & (m_capacity - 1));
+	}
+	void commitRead(size_t bytes)
+	{
+		m_readPos.store(m_readPos.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+	}
+	//a read that finds less than bytes takes what there is and counts in underflowCount().
+	size_t read(char* data, size_t bytes)
+	{
+		size_t available = 0;
+		const char* src = acquireRead(available);
+		size_t bytes_to_read = bytes < available ? bytes : available;
+		if (bytes_to_read < bytes)
+			m_underflowCount.fetch_add(1, std::memory_order_relaxed);
+		if (data)
+			memcpy(data, src, bytes_to_read);
+		commitRead(bytes_to_read);
+		return bytes_to_read;
+	}
+	void clear()
+	{
+		m_readPos.store(m_writePos.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	//maps a larger mirror and moves the readable bytes over in one copy; false keeps the old one.
+	bool ensureCapacity(size_t capacity)
+	{
+		if (capacity <= m_capacity)
+			return true;
+		size_t size = _granularity();
+		while (size < capacity)
+			size <<= 1;
+		char* data = _map(size);
+		if (data == NULL)
+			return false;
+
+		size_t available = 0;
+		const char* src = acquireRead(available);
+		if (available)
+			memcpy(data, src, available);
+		_unmap(m_data, m_capacity);
+		m_data = data;
+		m_capacity = size;
+		m_readPos.store(0, std::memory_order_relaxed);
+		m_writePos.store(available, std::memory_order_release);
+		return true;
+	}
+private:
+	QcMirroredRingBuffer(const QcMirroredRingBuffer&);
+	QcMirroredRingBuffer& operator=(const QcMirroredRingBuffer&);
+
+#ifdef _WIN32
+	static size_t _granularity()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+	}
+	//reserves twice the size to find a free range, releases it and maps both views there; another
+	//thread can take the range in between, so it retries a few times.
+	static char* _map(size_t size)
+	{
+		HANDLE hMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+			(DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+		if (hMapping == NULL)
+			return NULL;
+		char* data = NULL;
+		for (int i = 0; i < 16 && data == NULL; ++i)
+		{
+			char* address = (char*)VirtualAlloc(NULL, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+			if (address == NULL)
+				break;
+			VirtualFree(address, 0, MEM_RELEASE);
+			void* first = MapViewOfFileEx(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size, address);
+			void* second = first ? MapViewOfFileEx(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size, address + size) : NULL;
+			if (first && second)
+				data = address;
+			else if (first)
+				UnmapViewOfFile(first);
+		}
+		//the views keep the section alive.
+		CloseHandle(hMapping);
+		return data;
+	}
+	static void _unmap(char* data, size_t size)
+	{
+		if (data == NULL)
+			return;
+		UnmapViewOfFile(data);
+		UnmapViewOfFile(data + size);
+	}
+#else
+	static size_t _granularity()
+	{
+		return (size_t)sysconf(_SC_PAGESIZE);
+	}
+	//an anonymous file mapped twice into one reserved range, so no other mapping can slip in between.
+	static char* _map(size_t size)
+	{
+#if defined(__linux__)
+		int fd = (int)syscall(SYS_memfd_create, "QcMirroredRingBuffer", 1u /*MFD_CLOEXEC*/);
+#else
+		char name[64];
+		snprintf(name, sizeof(name), "/QcMirroredRingBuffer_%d_%p", (int)getpid(), (void*)&name);
+		int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0)
+			shm_unlink(name);
+#endif
+		if (fd < 0)
+			return NULL;
+		char* data = NULL;
+		if (ftruncate(fd, (off_t)size) == 0)
+		{
+			void* address = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (address != MAP_FAILED)
+			{
+				data = (char*)address;
+				if (mmap(data, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+					|| mmap(data + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+				{
+					munmap(address, size * 2);
+					data = NULL;
+				}
+			}
+		}
+		close(fd);
+		return data;
+	}
+	static void _unmap(char* data, size_t size)
+	{
+		if (data)
+			munmap(data, size * 2);
+	}
+#endif
+private:
+	char* m_data = NULL;
+	size_t m_capacity = 0;
+	std::atomic<uint64_t> m_overflowBytes{ 0 };
+	std::atomic<uint64_t> m_underflowCount{ 0 };
+	//free running, masked by the capacity on access.
+	alignas(64) std::atomic<size_t> m_readPos{ 0 };
+	alignas(64) std::atomic<size_t> m_writePos{ 0 };
+};
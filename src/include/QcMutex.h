@@ -1,10 +1,24 @@
 #pragma once
 
+#include <string>
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+#include <thread>
+#include <atomic>
+#endif
 
+//Named mutex shared between processes, without a name init() creates nothing and lock() is a no-op.
+//Windows uses a kernel mutex, elsewhere a POSIX named semaphore with a count of one: it is not
+//recursive and is not released when the owning process dies.
 class QcMutex
 {
 public:
+#ifdef _WIN32
 	QcMutex()
 		: m_hMutex(0)
 	{}
@@ -51,6 +65,74 @@ public:
 	}
 private:
 	HANDLE m_hMutex;
+#else
+	~QcMutex()
+	{
+		if (m_sem != SEM_FAILED)
+			sem_close(m_sem);
+	}
+
+	void init(const wchar_t* key = NULL, bool bChangeName = false)
+	{
+		std::wstring sKey = key != NULL ? key : L"";
+		if (sKey.size() && bChangeName)
+		{
+			sKey += L"_Mutex";
+		}
+		if (m_sem == SEM_FAILED && sKey.size())
+		{
+			//semaphore names are "/name" without further slashes, Windows names are ASCII in practice.
+			std::string name = "/";
+			for (wchar_t c : sKey)
+				name += (c == L'/' || c == L'\\' || c > 0x7f) ? '_' : (char)c;
+			m_sem = sem_open(name.c_str(), O_CREAT, 0666, 1);
+		}
+	}
+	void lock(int timeout = -1) const
+	{
+		if (m_sem == SEM_FAILED)
+			return;
+		int ret;
+		if (timeout < 0)
+		{
+			while ((ret = sem_wait(m_sem)) != 0 && errno == EINTR)
+			{
+			}
+			if (ret == 0)
+				m_owner = std::this_thread::get_id();
+			return;
+		}
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeout / 1000;
+		deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec += 1;
+			deadline.tv_nsec -= 1000000000;
+		}
+		while ((ret = sem_timedwait(m_sem, &deadline)) != 0 && errno == EINTR)
+		{
+		}
+		if (ret == 0)
+			m_owner = std::this_thread::get_id();
+	}
+	//like ReleaseMutex, releasing without owning (e.g. after a timed out lock) does nothing.
+	void unLock() const
+	{
+		std::thread::id self = std::this_thread::get_id();
+		if (m_sem != SEM_FAILED && m_owner.compare_exchange_strong(self, std::thread::id()))
+			sem_post(m_sem);
+	}
+
+	operator bool() const
+	{
+		return m_sem != SEM_FAILED;
+	}
+private:
+	sem_t* m_sem = SEM_FAILED;
+	mutable std::atomic<std::thread::id> m_owner{ std::thread::id() };
+#endif
 };
 
 class QcAutoMutexLock
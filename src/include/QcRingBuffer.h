@@ -1,18 +1,48 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
 #include <malloc.h>
+#include <string.h>
+#include <stdint.h>
 
+//Byte ring. The default mode grows on demand and callers bring their own lock.
+//eSpsc is for one producer thread calling write() and one consumer thread calling read(),
+//acquireRead()/commitRead() and clear(): capacity is a fixed power of two, both sides use atomic
+//positions and neither ever locks or waits. A write that does not fit keeps what fits and counts
+//the rest in overflowBytes(); a read that finds less than it asked for counts in underflowCount().
 class QcRingBuffer
 {
 public:
-	QcRingBuffer(int capacity)
+	enum QeMode { eDefault, eSpsc };
+
+	//consumer view of readable bytes, the second part is non empty when they wrap around the end.
+	struct QsReadSpan
+	{
+		const char* data1;
+		size_t size1;
+		const char* data2;
+		size_t size2;
+
+		size_t size() const { return size1 + size2; }
+	};
+
+	QcRingBuffer(int capacity, QeMode mode = eDefault)
 		: m_read_index(0)
 		, m_write_index(0)
 		, m_size(0)
 		, m_capacity(0)
 		, m_data(NULL)
+		, m_bSpsc(mode == eSpsc)
 	{
-		if (capacity)
+		if (m_bSpsc)
+		{
+			size_t size = 64;
+			while (size < (size_t)capacity)
+				size <<= 1;
+			m_data = (char*)malloc(size);
+			m_capacity = size;
+		}
+		else if (capacity)
 		{
 			ensureCapacity(capacity);
 		}
@@ -23,13 +53,36 @@ public:
 			free(m_data);
 	}
 
-	void clear() { m_size = 0; m_read_index = 0;  m_write_index = 0; }
-	size_t size() const { return m_size; }
+	void clear()
+	{
+		if (m_bSpsc)
+		{
+			m_readPos.store(m_writePos.load(std::memory_order_acquire), std::memory_order_release);
+			return;
+		}
+		m_size = 0; m_read_index = 0;  m_write_index = 0;
+	}
+	size_t size() const
+	{
+		if (m_bSpsc)
+		{
+			//read first: the write position only grows, so the difference never goes negative.
+			size_t readPos = m_readPos.load(std::memory_order_acquire);
+			return m_writePos.load(std::memory_order_acquire) - readPos;
+		}
+		return m_size;
+	}
 	size_t capacity() const { return m_capacity; }
-    size_t usableSize() const { return m_capacity - m_size;}
+    size_t usableSize() const { return m_capacity - size();}
+	bool isSpsc() const { return m_bSpsc; }
+	uint64_t overflowBytes() const { return m_overflowBytes.load(std::memory_order_relaxed); }
+	uint64_t underflowCount() const { return m_underflowCount.load(std::memory_order_relaxed); }
+
 	// Return number of bytes written.
 	size_t write(const char *data, size_t bytes, bool bAutoExpand = false)
 	{
+		if (m_bSpsc)
+			return writeSpsc(data, bytes, 1);
 		if (bAutoExpand)
 		{
 			ensureCapacity(m_size + bytes);
@@ -37,7 +90,7 @@ public:
 		if (bytes == 0) return 0;
 
 		size_t capacity = m_capacity;
-		size_t bytes_to_write = min(bytes, capacity - m_size);
+		size_t bytes_to_write = std::min<size_t>(bytes, capacity - m_size);
 
 		// Write in a single step
 		if (bytes_to_write <= capacity - m_write_index)
@@ -62,10 +115,21 @@ public:
 	// Return number of bytes read.
 	size_t read(char *data, size_t bytes)
 	{
+		if (m_bSpsc)
+		{
+			QsReadSpan span = acquireRead(bytes);
+			if (data)
+			{
+				memcpy(data, span.data1, span.size1);
+				memcpy(data + span.size1, span.data2, span.size2);
+			}
+			commitRead(span.size());
+			return span.size();
+		}
 		if (bytes == 0) return 0;
 
 		size_t capacity = m_capacity;
-		size_t bytes_to_read = min(bytes, m_size);
+		size_t bytes_to_read = std::min<size_t>(bytes, m_size);
 
 		// Read in a single step
 		if (bytes_to_read <= capacity - m_read_index)
@@ -92,6 +156,55 @@ public:
 		return bytes_to_read;
 	}
 
+	//producer side of eSpsc: writes the largest multiple of unit bytes that fits, so a partial write
+	//never splits an audio frame. Return number of bytes written.
+	size_t writeSpsc(const char *data, size_t bytes, size_t unit)
+	{
+		size_t writePos = m_writePos.load(std::memory_order_relaxed);
+		size_t usable = m_capacity - (writePos - m_readPosCache);
+		if (usable < bytes)
+		{
+			m_readPosCache = m_readPos.load(std::memory_order_acquire);
+			usable = m_capacity - (writePos - m_readPosCache);
+		}
+		size_t bytes_to_write = std::min<size_t>(bytes, usable);
+		bytes_to_write -= bytes_to_write % unit;
+
+		size_t index = writePos & (m_capacity - 1);
+		size_t size_1 = std::min<size_t>(bytes_to_write, m_capacity - index);
+		memcpy(m_data + index, data, size_1);
+		memcpy(m_data, data + size_1, bytes_to_write - size_1);
+		m_writePos.store(writePos + bytes_to_write, std::memory_order_release);
+
+		if (bytes_to_write < bytes)
+			m_overflowBytes.fetch_add(bytes - bytes_to_write, std::memory_order_relaxed);
+		return bytes_to_write;
+	}
+
+	//consumer side of eSpsc: up to bytes readable bytes in place. They stay valid and unchanged
+	//until commitRead() hands them, or a prefix of them, back to the producer.
+	QsReadSpan acquireRead(size_t bytes)
+	{
+		size_t readPos = m_readPos.load(std::memory_order_relaxed);
+		size_t available = m_writePosCache - readPos;
+		if (available < bytes)
+		{
+			m_writePosCache = m_writePos.load(std::memory_order_acquire);
+			available = m_writePosCache - readPos;
+			if (available < bytes)
+				m_underflowCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		size_t bytes_to_read = std::min<size_t>(bytes, available);
+		size_t index = readPos & (m_capacity - 1);
+		size_t size_1 = std::min<size_t>(bytes_to_read, m_capacity - index);
+		QsReadSpan span = { m_data + index, size_1, m_data, bytes_to_read - size_1 };
+		return span;
+	}
+	void commitRead(size_t bytes)
+	{
+		m_readPos.store(m_readPos.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+	}
+
 	template<typename T> size_t write(T data)
 	{
 		int iRet = write((const char*)&data, sizeof(data), true);
@@ -105,7 +218,7 @@ public:
 
 	void ensureCapacity(int capacity)
 	{
-		if (capacity > (int)m_capacity)
+		if (!m_bSpsc && capacity > (int)m_capacity)
 		{
 			capacity = ((capacity) / 4 + 1) * 4;
 
@@ -120,6 +233,7 @@ public:
 			m_capacity = capacity;
 		}
 	}
+	//default mode only, an eSpsc ring stays with the two threads that use it.
 	void swap(QcRingBuffer& other)
 	{
 		std::swap(m_read_index, other.m_read_index);
@@ -134,12 +248,21 @@ private:
 	size_t m_size;
 	size_t m_capacity;
 	char *m_data;
+
+	//eSpsc positions run freely and are masked by the capacity on access.
+	bool m_bSpsc;
+	std::atomic<uint64_t> m_overflowBytes{ 0 };
+	std::atomic<uint64_t> m_underflowCount{ 0 };
+	//consumer side
+	alignas(64) std::atomic<size_t> m_readPos{ 0 };
+	size_t m_writePosCache = 0;
+	//producer side
+	alignas(64) std::atomic<size_t> m_writePos{ 0 };
+	size_t m_readPosCache = 0;
 };
-namespace std
+//found by argument dependent lookup; std::swap itself needs a movable type, and the atomics are not.
+inline void swap(QcRingBuffer& one, QcRingBuffer& two)
 {
-	template<> inline void swap(QcRingBuffer& one, QcRingBuffer& two)
-	{
-		one.swap(two);
-	}
+	one.swap(two);
 }
 
@@ -1,6 +1,15 @@
 ﻿#pragma once
+#ifdef _WIN32
 #include <Windows.h>
 #include <MMSystem.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#include <stdint.h>
 #include <string>
 #include "QcMutex.h"
 
@@ -15,6 +24,11 @@
 //   } \
 //   void (0)
 
+//Named shared memory. Windows maps a pagefile backed file mapping that lives until its last handle
+//closes. Elsewhere it is a POSIX shm object: the creator unlinks the name when it detaches and
+//mappings already made stay valid. On both, create() on a name that exists opens that segment without
+//resizing it and isCreator() is false; a POSIX segment whose creator crashed outlives it, the caller
+//decides that from the contents and replaces it with replace().
 class QcSharedMemory
 {
 public:
@@ -27,15 +41,13 @@ public:
 	QcSharedMemory()
 		: m_size(0)
 		, m_memory(NULL)
-		, m_hand(NULL)
 	{
 	}
 
 	QcSharedMemory(const std::wstring &key, bool bChangeName = true)
-		: m_size(0)
+		: m_key(key)
+		, m_size(0)
 		, m_memory(NULL)
-		, m_hand(NULL)
-		, m_key(key)
 	{
 		setKey(key, bChangeName);
 	}
@@ -74,6 +86,7 @@ public:
 
 		return attach(mode);
 	}
+#ifdef _WIN32
 	bool attach(AccessMode mode)
 	{
 		HANDLE hHandle = _handle(0);
@@ -120,6 +133,56 @@ public:
 		return _cleanHandle();
 	}
 
+#else
+	bool attach(AccessMode mode)
+	{
+		if (_handle(0) < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(m_hand, &st) != 0 || st.st_size <= 0)
+		{
+			_cleanHandle();
+			return false;
+		}
+		int prot = mode == QcSharedMemory::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+		void* memory = mmap(NULL, (size_t)st.st_size, prot, MAP_SHARED, m_hand, 0);
+		if (memory == MAP_FAILED)
+		{
+			_cleanHandle();
+			return false;
+		}
+		m_memory = memory;
+		m_size = (uint32_t)st.st_size;
+		return true;
+	}
+
+	bool isAttached() const
+	{
+		return (0 != m_memory);
+	}
+	bool detach()
+	{
+		if (m_memory)
+		{
+			munmap(m_memory, m_size);
+			m_memory = NULL;
+		}
+		return _cleanHandle();
+	}
+
+	//unlinks the name and creates a new segment under it. Only for a segment left by a dead creator:
+	//whoever still maps the old one keeps its pages and never sees the new one.
+	bool replace(int size, AccessMode mode = QcSharedMemory::ReadWrite)
+	{
+		detach();
+		if (m_key.empty())
+			return false;
+		shm_unlink(_posixName(m_bChangeName ? m_key + L"_SharedMemory" : m_key).c_str());
+		return create(size, mode);
+	}
+
+#endif
 	int size() const { return m_size; }
 	void* data(){ return m_memory; }
 	const void* data() const{ return m_memory; }
@@ -134,14 +197,22 @@ public:
 		m_mutex.unLock();
 		return true;
 	}
+#ifdef _WIN32
 	HANDLE handle() const
 	{
 		return m_hand;
 	}
+#else
+	int handle() const
+	{
+		return m_hand;
+	}
+#endif
     bool isCreator() const {
         return m_bCreator;
     }
 protected:
+#ifdef _WIN32
 	bool _create(size_t size)
 	{
 		return _handle(size) != NULL;
@@ -186,6 +257,61 @@ protected:
 		m_hand = 0;
 		return true;
 	}
+#else
+	bool _create(size_t size)
+	{
+		return _handle(size) >= 0;
+	}
+	int _handle(size_t size)
+	{
+		if (m_hand < 0)
+		{
+			if (m_key.empty())
+				return -1;
+
+			std::wstring key = m_key;
+			if (m_bChangeName)
+				key += L"_SharedMemory";
+			m_name = _posixName(key);
+
+			if (size == 0)
+				m_hand = shm_open(m_name.c_str(), O_RDWR, 0);
+			else
+			{
+				m_hand = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+				m_bCreator = m_hand >= 0;
+				//like CreateFileMapping on an existing name: the segment is shared, not resized.
+				if (m_hand < 0 && errno == EEXIST)
+					m_hand = shm_open(m_name.c_str(), O_RDWR, 0);
+				else if (m_hand >= 0 && ftruncate(m_hand, (off_t)size) != 0)
+					_cleanHandle();
+			}
+		}
+		return m_hand;
+	}
+
+	bool _cleanHandle()
+	{
+		if (m_hand >= 0)
+		{
+			close(m_hand);
+			m_hand = -1;
+			if (m_bCreator)
+				shm_unlink(m_name.c_str());
+			m_bCreator = false;
+		}
+		return true;
+	}
+
+	//shm names are "/name" without further slashes, like the QcMutex semaphores.
+	static std::string _posixName(const std::wstring& key)
+	{
+		std::string name = "/";
+		for (wchar_t c : key)
+			name += (c == L'/' || c == L'\\' || c > 0x7f) ? '_' : (char)c;
+		return name;
+	}
+#endif
 private:
 	QcSharedMemory(const QcSharedMemory &);
 	QcSharedMemory &operator=(const QcSharedMemory &);
@@ -193,8 +319,14 @@ private:
 	std::wstring m_key;
 	bool		m_bChangeName;
     bool        m_bCreator = false;
-	HANDLE       m_hand;
+#ifdef _WIN32
+	HANDLE       m_hand = NULL;
 	DWORD        m_size;
+#else
+	int          m_hand = -1;
+	std::string  m_name;
+	uint32_t     m_size;
+#endif
 	void*        m_memory;
 	QcMutex		 m_mutex;
 };
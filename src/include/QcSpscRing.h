@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+//Fixed capacity single-producer/single-consumer ring.
+//push() belongs to one thread, front()/pop()/clear() to one other thread; neither side ever takes a lock.
+//Slots are default constructed T, pop() resets the slot so held references are released right away.
+template <class T>
+class QcSpscRing
+{
+public:
+	explicit QcSpscRing(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+		m_slots.resize(size);
+		m_mask = size - 1;
+	}
+
+	size_t capacity() const { return m_slots.size(); }
+	size_t size() const
+	{
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+	bool empty() const { return size() == 0; }
+
+	template <class U>
+	bool push(U&& value)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_headCache == m_slots.size())
+		{
+			m_headCache = m_head.load(std::memory_order_acquire);
+			if (tail - m_headCache == m_slots.size())
+				return false;
+		}
+		m_slots[tail & m_mask] = std::forward<U>(value);
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//peek the oldest element without copying it, nullptr when empty.
+	T* front()
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tailCache)
+		{
+			m_tailCache = m_tail.load(std::memory_order_acquire);
+			if (head == m_tailCache)
+				return nullptr;
+		}
+		return &m_slots[head & m_mask];
+	}
+
+	bool pop(T& value)
+	{
+		T* pFront = front();
+		if (pFront == nullptr)
+			return false;
+		value = std::move(*pFront);
+		return pop();
+	}
+	bool pop()
+	{
+		T* pFront = front();
+		if (pFront == nullptr)
+			return false;
+		*pFront = T();
+		m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		return true;
+	}
+	void clear()
+	{
+		while (pop());
+	}
+private:
+	QcSpscRing(const QcSpscRing&);
+	QcSpscRing& operator=(const QcSpscRing&);
+
+	std::vector<T> m_slots;
+	size_t m_mask = 0;
+	//consumer side
+	alignas(64) std::atomic<size_t> m_head{ 0 };
+	size_t m_tailCache = 0;
+	//producer side
+	alignas(64) std::atomic<size_t> m_tail{ 0 };
+	size_t m_headCache = 0;
+};
\ No newline at end of file
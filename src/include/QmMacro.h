@@ -52,10 +52,18 @@ private: \
 
 //Run Once
 #define LibC_PTHREAD_ONCE_INIT 0
+#ifdef _WIN32
+#define QmCompareExchange(p, v, cmp) InterlockedCompareExchange(p, v, cmp)
+#define QmYieldThread() Sleep(0)
+#else
+#include <sched.h>
+#define QmCompareExchange(p, v, cmp) __sync_val_compare_and_swap(p, cmp, v)
+#define QmYieldThread() sched_yield()
+#endif
 #define QmRunOnce(ponce_control, init_routine, ...) \
 	do \
 			{	\
-		if (InterlockedCompareExchange(ponce_control, LibC_PTHREAD_ONCE_INIT + 1, LibC_PTHREAD_ONCE_INIT) == LibC_PTHREAD_ONCE_INIT) \
+		if (QmCompareExchange(ponce_control, LibC_PTHREAD_ONCE_INIT + 1, LibC_PTHREAD_ONCE_INIT) == LibC_PTHREAD_ONCE_INIT) \
 						{	\
 			init_routine(__VA_ARGS__);	\
 			*ponce_control = LibC_PTHREAD_ONCE_INIT + 2;	\
@@ -63,12 +71,18 @@ private: \
 								else \
 								{ \
 															while (*ponce_control != LibC_PTHREAD_ONCE_INIT + 2)	\
-				Sleep(0);											\
+				QmYieldThread();									\
 								}															\
 				} while (0)
 
 
-#define QmAssert(c) if(!(c)) {__asm int 3}
+#ifdef _MSC_VER
+#define QmTrap() __debugbreak()
+#else
+#define QmTrap() __builtin_trap()
+#endif
+
+#define QmAssert(c) if(!(c)) {QmTrap();}
 #define QmSafeDelete(p) do {if (p){ delete p; p=NULL;} } while(0,0)
 #define QmSafeDeleteArray(p) do {if (p){ delete [] p; p=NULL;} } while(0,0)
 #define QmSafeRelease(p) do {if (p){ p->Release(); p=NULL;} } while(0,0)
@@ -78,7 +92,7 @@ private: \
 #define QmAlignSize2(size, align) (((size + align - 1) & (~(align - 1))))
 
 #ifndef QmDebugBreak
-#define QmDebugBreak() {{__asm int 3}; }
+#define QmDebugBreak() {QmTrap(); }
 #endif
 
 #define QmBitTest(bit, ptr) ( ((unsigned char*)ptr)[bit/8] & (1<<(bit%8)))
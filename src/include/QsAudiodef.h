@@ -45,6 +45,7 @@ struct QsAudioData
     const uint8_t* data[QmAudioPlanes];
     uint32_t frames;
 
+    //microseconds of the first frame, captures use the QueryPerformanceCounter clock.
     uint64_t timestamp;
 };
 inline int getBytesPerSample(QeSampleFormat format)
@@ -0,0 +1,64 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define QmSimdX86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define QmTargetSSE41
+#define QmTargetAVX2
+#else
+//gcc and clang only emit the instructions inside functions marked for them, msvc always can.
+#define QmTargetSSE41 __attribute__((target("sse4.1")))
+#define QmTargetAVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define QmSimdX86 0
+#endif
+
+//instruction sets the runtime dispatched paths may use, each level includes the ones before it.
+enum QeSimdLevel
+{
+	eSimdNone,
+	eSimdSSE41,
+	eSimdAVX2,
+	eSimdAuto = 0xff,
+};
+
+//highest level both the cpu and the os support, detected once per module.
+inline QeSimdLevel DetectSimdLevel()
+{
+	static const QeSimdLevel level = []() {
+#if QmSimdX86
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		int nIds = info[0];
+		__cpuid(info, 1);
+		bool bSSE41 = (info[2] & (1 << 19)) != 0;
+		//avx also needs the os to save the ymm registers.
+		bool bAVX = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		bool bAVX2 = false;
+		if (bAVX && nIds >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			bAVX2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		bool bSSE41 = __builtin_cpu_supports("sse4.1") != 0;
+		bool bAVX2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+		return bAVX2 ? eSimdAVX2 : (bSSE41 ? eSimdSSE41 : eSimdNone);
+#else
+		return eSimdNone;
+#endif
+	}();
+	return level;
+}
+
+//level capped at what DetectSimdLevel() found, eSimdAuto is the detected level.
+inline QeSimdLevel ClampSimdLevel(QeSimdLevel level)
+{
+	return level < DetectSimdLevel() ? level : DetectSimdLevel();
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include "QsVideodef.h"
+#include "QsSimd.h"
+#include "QcForkJoin.h"
+
+//Frame copies for 4K/8K sizes, next to CopyPlane/CopyVideoFrame in QsVideodef.h. Header only, so the
+//graphics upload paths can use it without linking media.
+namespace video {
+	enum QeCopyHint
+	{
+		eCopyCached,        //the destination is read again soon, plain stores keep it in the cache
+		eCopyWriteOnly,     //shared memory, upload buffers and mapped textures: streaming stores bypass the cache
+	};
+
+	//smaller copies stay on the calling thread, about a 1080p i420 frame is below it.
+	const size_t kCopyThreadBytes = 4 << 20;
+	//a copy is bound by memory bandwidth, which a few cores already saturate.
+	const int kCopyMaxThreads = 4;
+
+	namespace copy_detail {
+		struct QsPlaneCopy
+		{
+			uint8_t* dst;
+			int dstStride;
+			const uint8_t* src;
+			int srcStride;
+			int rowBytes;
+			int rows;
+		};
+
+#if QmSimdX86
+		//unaligned loads, aligned non temporal stores: the head up to dst alignment and the tail go through memcpy.
+		QmTargetSSE41 inline void streamRowSSE41(uint8_t* dst, const uint8_t* src, size_t n)
+		{
+			size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+			head = head < n ? head : n;
+			memcpy(dst, src, head);
+			dst += head;
+			src += head;
+			n -= head;
+			for (; n >= 64; n -= 64, dst += 64, src += 64)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)src);
+				__m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+				__m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+				__m128i d = _mm_loadu_si128((const __m128i*)(src + 48));
+				_mm_stream_si128((__m128i*)dst, a);
+				_mm_stream_si128((__m128i*)(dst + 16), b);
+				_mm_stream_si128((__m128i*)(dst + 32), c);
+				_mm_stream_si128((__m128i*)(dst + 48), d);
+			}
+			for (; n >= 16; n -= 16, dst += 16, src += 16)
+				_mm_stream_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+			memcpy(dst, src, n);
+		}
+
+		QmTargetAVX2 inline void streamRowAVX2(uint8_t* dst, const uint8_t* src, size_t n)
+		{
+			size_t head = (32 - ((uintptr_t)dst & 31)) & 31;
+			head = head < n ? head : n;
+			memcpy(dst, src, head);
+			dst += head;
+			src += head;
+			n -= head;
+			for (; n >= 128; n -= 128, dst += 128, src += 128)
+			{
+				__m256i a = _mm256_loadu_si256((const __m256i*)src);
+				__m256i b = _mm256_loadu_si256((const __m256i*)(src + 32));
+				__m256i c = _mm256_loadu_si256((const __m256i*)(src + 64));
+				__m256i d = _mm256_loadu_si256((const __m256i*)(src + 96));
+				_mm256_stream_si256((__m256i*)dst, a);
+				_mm256_stream_si256((__m256i*)(dst + 32), b);
+				_mm256_stream_si256((__m256i*)(dst + 64), c);
+				_mm256_stream_si256((__m256i*)(dst + 96), d);
+			}
+			for (; n >= 32; n -= 32, dst += 32, src += 32)
+				_mm256_stream_si256((__m256i*)dst, _mm256_loadu_si256((const __m256i*)src));
+			memcpy(dst, src, n);
+		}
+#endif
+
+		inline void copyRows(const QsPlaneCopy& plane, int begin, int end, bool bStream)
+		{
+			uint8_t* dst = plane.dst + (ptrdiff_t)begin * plane.dstStride;
+			const uint8_t* src = plane.src + (ptrdiff_t)begin * plane.srcStride;
+			size_t rowBytes = (size_t)plane.rowBytes;
+			int rows = end - begin;
+			if (rows <= 0 || rowBytes == 0)
+				return;
+			if ((int)rowBytes == plane.srcStride && (int)rowBytes == plane.dstStride)
+			{
+				rowBytes *= rows;
+				rows = 1;
+			}
+
+			void (*streamRow)(uint8_t*, const uint8_t*, size_t) = nullptr;
+#if QmSimdX86
+			//rows this short are mostly head and tail.
+			if (bStream && rowBytes >= 256)
+			{
+				QeSimdLevel level = DetectSimdLevel();
+				if (level >= eSimdAVX2)
+					streamRow = streamRowAVX2;
+				else if (level >= eSimdSSE41)
+					streamRow = streamRowSSE41;
+			}
+#endif
+			for (int i = 0; i < rows; ++i)
+			{
+				if (streamRow)
+					streamRow(dst, src, rowBytes);
+				else
+					memcpy(dst, src, rowBytes);
+				dst += plane.dstStride;
+				src += plane.srcStride;
+			}
+#if QmSimdX86
+			//streaming stores are weakly ordered, make them visible before whoever waits on this copy reads.
+			if (streamRow)
+				_mm_sfence();
+#endif
+		}
+
+		//leaked on purpose: joining threads from a dll's static destructors deadlocks under the loader lock.
+		inline QcForkJoin& copyWorkers()
+		{
+			static QcForkJoin* pWorkers = new QcForkJoin(std::max(1, std::min((int)std::thread::hardware_concurrency(), kCopyMaxThreads)));
+			return *pWorkers;
+		}
+
+		inline void copyPlanes(const QsPlaneCopy* planes, int nPlanes, QeCopyHint hint, int nThreads)
+		{
+			bool bStream = hint == eCopyWriteOnly;
+			auto band = [&](int i, int n) {
+				for (int p = 0; p < nPlanes; ++p)
+				{
+					int rows = planes[p].rows;
+					copyRows(planes[p], (int)((int64_t)rows * i / n), (int)((int64_t)rows * (i + 1) / n), bStream);
+				}
+			};
+
+			if (nThreads <= 0)
+			{
+				size_t total = 0;
+				for (int p = 0; p < nPlanes; ++p)
+					total += (size_t)planes[p].rowBytes * planes[p].rows;
+				nThreads = total >= kCopyThreadBytes ? kCopyMaxThreads : 1;
+			}
+			if (nThreads > 1)
+			{
+				//one pool per module shared by every copy; a copy that finds it busy runs on its own thread.
+				QcForkJoin& workers = copyWorkers();
+				int n = std::min(nThreads, workers.size());
+				if (n > 1 && workers.tryRun(n, [&](int i) { band(i, n); }))
+					return;
+			}
+			band(0, 1);
+		}
+	}
+
+	//CopyPlane with streaming stores for eCopyWriteOnly and, from kCopyThreadBytes up, the rows split
+	//across a shared pool. nThreads 0 picks by size, 1 keeps the copy on the calling thread.
+	inline void CopyPlaneFast(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+		int widthBytes, int height, QeCopyHint hint = eCopyWriteOnly, int nThreads = 0)
+	{
+		copy_detail::QsPlaneCopy plane = { dst, dst_stride, src, src_stride, widthBytes, height };
+		copy_detail::copyPlanes(&plane, 1, hint, nThreads);
+	}
+
+	//CopyVideoFrame the same way, every plane of a band goes to the same thread.
+	inline void CopyVideoFrameFast(uint8_t* dstData[QMaxSlice], uint32_t dst_linesize[QMaxSlice],
+		const uint8_t* const srcData[QMaxSlice], uint32_t const src_linesize[QMaxSlice],
+		int format, uint32_t width, uint32_t height, QeCopyHint hint = eCopyWriteOnly, int nThreads = 0)
+	{
+		int rowBytes[QMaxSlice];
+		int rows[QMaxSlice];
+		int nPlanes = PlaneLayout(format, (int)width, (int)height, rowBytes, rows);
+		copy_detail::QsPlaneCopy planes[QMaxSlice];
+		for (int p = 0; p < nPlanes; ++p)
+			planes[p] = { dstData[p], (int)dst_linesize[p], srcData[p], (int)src_linesize[p], rowBytes[p], rows[p] };
+		copy_detail::copyPlanes(planes, nPlanes, hint, nThreads);
+	}
+}
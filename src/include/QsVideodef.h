@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <algorithm>
+#include <string.h>
 
 #define QMaxSlice 4
 #define ALIGNMENT 32
@@ -30,6 +31,10 @@ namespace
 		FOURCC_NV12 = MAKE_FOURCC('N', 'V', '1', '2'),
 		FOURCC_NV21 = MAKE_FOURCC('N', 'V', '2', '1'),  // 
 
+		// 10 bit in 16 bit little endian samples
+		FOURCC_I010 = MAKE_FOURCC('Y', '3', 11, 10),    //i420 layout, ffmpeg yuv420p10le
+		FOURCC_P010 = MAKE_FOURCC('P', '0', '1', '0'),  //nv12 layout, value in the high 10 bits
+
 		// 4:4:4 planar
 		FOURCC_I444 = MAKE_FOURCC('I', '4', '4', '4'),
 		// 4:0:0
@@ -70,6 +75,14 @@ namespace video {
 			len1 = ALIGN_SIZE(width * height, ALIGNMENT);
 			len2 = ALIGN_SIZE(halfwidth * 2 * halfheight, ALIGNMENT);
 			return len1 + len2;
+		case FOURCC_I010:
+			len1 = ALIGN_SIZE(width * 2 * height, ALIGNMENT);
+			len2 = ALIGN_SIZE(halfwidth * 2 * halfheight, ALIGNMENT);
+			return len1 + len2 * 2;
+		case FOURCC_P010:
+			len1 = ALIGN_SIZE(width * 2 * height, ALIGNMENT);
+			len2 = ALIGN_SIZE(halfwidth * 4 * halfheight, ALIGNMENT);
+			return len1 + len2;
 		case FOURCC_Y800:
 			len1 = ALIGN_SIZE(width * height, ALIGNMENT);
 			return len1;
@@ -120,6 +133,25 @@ namespace video {
 			linesize[0] = width;
 			linesize[1] = halfwidth * 2;
 			break;
+		case FOURCC_I010:
+			len1 = ALIGN_SIZE(width * 2 * height, ALIGNMENT);
+			len2 = ALIGN_SIZE(halfwidth * 2 * halfheight, ALIGNMENT);
+
+			data[0] = buffer;
+			data[1] = data[0] + len1;
+			data[2] = data[1] + len2;
+			linesize[0] = width * 2;
+			linesize[1] = halfwidth * 2;
+			linesize[2] = halfwidth * 2;
+			break;
+		case FOURCC_P010:
+			len1 = ALIGN_SIZE(width * 2 * height, ALIGNMENT);
+
+			data[0] = buffer;
+			data[1] = data[0] + len1;
+			linesize[0] = width * 2;
+			linesize[1] = halfwidth * 4;
+			break;
 		case FOURCC_Y800:
 			len1 = ALIGN_SIZE(width * height, ALIGNMENT);
 			data[0] = buffer;
@@ -143,6 +175,52 @@ namespace video {
 		}
 	}
 
+	//bytes per row and rows of each plane, returns the plane count.
+	inline int PlaneLayout(int format, int width, int height, int rowBytes[QMaxSlice], int rows[QMaxSlice])
+	{
+		int halfwidth = (width + 1) >> 1;
+		int halfheight = (height + 1) >> 1;
+		int nPlanes = 0;
+		auto add = [&](int bytes, int n) { rowBytes[nPlanes] = bytes; rows[nPlanes] = n; ++nPlanes; };
+
+		switch (format) {
+		case FOURCC_I420:
+		case FOURCC_YU12:
+		case FOURCC_YV12:
+			add(width, height);
+			add(halfwidth, halfheight);
+			add(halfwidth, halfheight);
+			break;
+		case FOURCC_NV12:
+		case FOURCC_NV21:
+			add(width, height);
+			add(halfwidth * 2, halfheight);
+			break;
+		case FOURCC_I010:
+			add(width * 2, height);
+			add(halfwidth * 2, halfheight);
+			add(halfwidth * 2, halfheight);
+			break;
+		case FOURCC_P010:
+			add(width * 2, height);
+			add(halfwidth * 4, halfheight);
+			break;
+		case FOURCC_Y800:
+			add(width, height);
+			break;
+		case FOURCC_RGBA:
+		case FOURCC_BGRA:
+			add(width * 4, height);
+			break;
+		case FOURCC_I444:
+			add(width, height);
+			add(width, height);
+			add(width, height);
+			break;
+		}
+		return nPlanes;
+	}
+
 	inline void CopyPlane(uint8_t* dst, int dst_stride,
 		const uint8_t* src, int src_stride,
 		int width, int height)
@@ -182,7 +260,18 @@ namespace video {
 		case FOURCC_NV12:
 		case FOURCC_NV21:
 			CopyPlane(dstData[0], dst_linesize[0], srcData[0], src_linesize[0], width, height);
-			CopyPlane(dstData[1], dst_linesize[1], srcData[1], src_linesize[1], width, halfheight);
+			CopyPlane(dstData[1], dst_linesize[1], srcData[1], src_linesize[1], halfwidth * 2, halfheight);
+			break;
+
+		case FOURCC_I010:
+			CopyPlane(dstData[0], dst_linesize[0], srcData[0], src_linesize[0], width * 2, height);
+			CopyPlane(dstData[1], dst_linesize[1], srcData[1], src_linesize[1], halfwidth * 2, halfheight);
+			CopyPlane(dstData[2], dst_linesize[2], srcData[2], src_linesize[2], halfwidth * 2, halfheight);
+			break;
+
+		case FOURCC_P010:
+			CopyPlane(dstData[0], dst_linesize[0], srcData[0], src_linesize[0], width * 2, height);
+			CopyPlane(dstData[1], dst_linesize[1], srcData[1], src_linesize[1], halfwidth * 4, halfheight);
 			break;
 
 		case FOURCC_Y800:
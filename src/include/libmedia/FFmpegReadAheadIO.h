@@ -0,0 +1 @@
+#include "../../media/FFmpegReadAheadIO.h"
\ No newline at end of file
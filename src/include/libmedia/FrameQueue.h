@@ -0,0 +1 @@
+#include "../../media/FrameQueue.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../media/QcAudioMixer.h"
\ No newline at end of file
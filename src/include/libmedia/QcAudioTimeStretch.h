@@ -0,0 +1 @@
+#include "../../media/QcAudioTimeStretch.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../media/QcTaskExecutor.h"
\ No newline at end of file
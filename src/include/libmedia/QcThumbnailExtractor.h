@@ -0,0 +1 @@
+#include "../../media/QcThumbnailExtractor.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../media/QsAudioConvert.h"
\ No newline at end of file
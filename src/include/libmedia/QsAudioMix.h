@@ -0,0 +1 @@
+#include "../../media/QsAudioMix.h"
\ No newline at end of file
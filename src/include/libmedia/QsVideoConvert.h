@@ -0,0 +1 @@
+#include "../../media/QsVideoConvert.h"
\ No newline at end of file
@@ -11,7 +11,84 @@ extern "C" {
 };
 #endif
 #include "AVFrameRef.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
 
+struct QsFrameNode
+{
+	AVFrame* frame = nullptr;
+	std::atomic<int> refCount{ 0 };
+};
+
+namespace
+{
+	//frames waiting in the pool, beyond that released frames are freed.
+	const size_t kMaxPooledFrames = 256;
+
+	class QcFramePool
+	{
+	public:
+		static QcFramePool& instance()
+		{
+			//never destroyed: frames may still be released during static destruction.
+			static QcFramePool* s_pool = new QcFramePool();
+			return *s_pool;
+		}
+
+		QsFrameNode* acquire()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_nodes.empty())
+				{
+					QsFrameNode* pNode = m_nodes.back();
+					m_nodes.pop_back();
+					++m_stats.hits;
+					return pNode;
+				}
+				++m_stats.misses;
+			}
+			QsFrameNode* pNode = new QsFrameNode();
+			pNode->frame = av_frame_alloc();
+			return pNode;
+		}
+
+		void release(QsFrameNode* pNode)
+		{
+			av_frame_unref(pNode->frame);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_nodes.size() < kMaxPooledFrames)
+				{
+					m_nodes.push_back(pNode);
+					++m_stats.recycled;
+					return;
+				}
+				++m_stats.freed;
+			}
+			av_frame_free(&pNode->frame);
+			delete pNode;
+		}
+
+		QsPoolStats stats()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			QsPoolStats stats = m_stats;
+			stats.pooled = (uint32_t)m_nodes.size();
+			return stats;
+		}
+	private:
+		QcFramePool()
+		{
+			m_nodes.reserve(kMaxPooledFrames);
+		}
+	private:
+		std::mutex m_mutex;
+		std::vector<QsFrameNode*> m_nodes;
+		QsPoolStats m_stats;
+	};
+}
 
 AVFrameRef::AVFrameRef()
 {
@@ -19,15 +96,82 @@ AVFrameRef::AVFrameRef()
 
 AVFrameRef::~AVFrameRef()
 {
+	release();
+}
+
+AVFrameRef::AVFrameRef(const AVFrameRef& other)
+	: m_pNode(other.m_pNode)
+	, m_pAVFrame(other.m_pAVFrame)
+	, m_ptsSystemTime(other.m_ptsSystemTime)
+	, m_msPts(other.m_msPts)
+	, m_serial(other.m_serial)
+{
+	if (m_pNode)
+		m_pNode->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+AVFrameRef::AVFrameRef(AVFrameRef&& other) noexcept
+	: m_pNode(other.m_pNode)
+	, m_pAVFrame(other.m_pAVFrame)
+	, m_ptsSystemTime(other.m_ptsSystemTime)
+	, m_msPts(other.m_msPts)
+	, m_serial(other.m_serial)
+{
+	other.m_pNode = nullptr;
+	other.m_pAVFrame = nullptr;
+}
+
+AVFrameRef& AVFrameRef::operator=(const AVFrameRef& other)
+{
+	if (this != &other)
+	{
+		if (other.m_pNode)
+			other.m_pNode->refCount.fetch_add(1, std::memory_order_relaxed);
+		release();
+		m_pNode = other.m_pNode;
+		m_pAVFrame = other.m_pAVFrame;
+		m_ptsSystemTime = other.m_ptsSystemTime;
+		m_msPts = other.m_msPts;
+		m_serial = other.m_serial;
+	}
+	return *this;
+}
+
+AVFrameRef& AVFrameRef::operator=(AVFrameRef&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+		m_pNode = other.m_pNode;
+		m_pAVFrame = other.m_pAVFrame;
+		m_ptsSystemTime = other.m_ptsSystemTime;
+		m_msPts = other.m_msPts;
+		m_serial = other.m_serial;
+		other.m_pNode = nullptr;
+		other.m_pAVFrame = nullptr;
+	}
+	return *this;
+}
+
+int AVFrameRef::useCount() const
+{
+	return m_pNode ? m_pNode->refCount.load(std::memory_order_acquire) : 0;
+}
 
+void AVFrameRef::release()
+{
+	if (m_pNode && m_pNode->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		QcFramePool::instance().release(m_pNode);
+	m_pNode = nullptr;
+	m_pAVFrame = nullptr;
 }
 
 AVFrameRef AVFrameRef::allocFrame()
 {
 	AVFrameRef ret;
-	ret.m_pAVFrame.reset(av_frame_alloc(), [](AVFrame* frame) {
-		av_frame_free(&frame);
-	});
+	ret.m_pNode = QcFramePool::instance().acquire();
+	ret.m_pNode->refCount = 1;
+	ret.m_pAVFrame = ret.m_pNode->frame;
 	return ret;
 }
 
@@ -131,3 +275,18 @@ void AVFrameRef::setPtsMsTime(int msTime)
 	m_msPts = msTime;
 }
 
+int AVFrameRef::serial() const
+{
+	return m_serial;
+}
+
+void AVFrameRef::setSerial(int serial)
+{
+	m_serial = serial;
+}
+
+QsPoolStats AVFrameRef::poolStats()
+{
+	return QcFramePool::instance().stats();
+}
+
@@ -1,14 +1,22 @@
 #pragma once
 
 #include "media_global.h"
+#include "QsMediaInfo.h"
 #include <memory>
 
 struct AVFrame;
+struct QsFrameNode;
+//Reference to a pooled AVFrame. The reference count lives in the pooled node, so copies and
+//moves never allocate, and the frame goes back to the pool unreferenced with its last reference.
 class MEDIA_API AVFrameRef
 {
 public:
     AVFrameRef();
     ~AVFrameRef();
+    AVFrameRef(const AVFrameRef& other);
+    AVFrameRef(AVFrameRef&& other) noexcept;
+    AVFrameRef& operator=(const AVFrameRef& other);
+    AVFrameRef& operator=(AVFrameRef&& other) noexcept;
 
 	static AVFrameRef allocFrame();
 	static AVFrameRef allocFrame(int w, int h, int format, int pts = 0);
@@ -16,13 +24,13 @@ public:
 	static AVFrameRef fromHWFrame(const AVFrameRef& hwFrame);
 
     operator AVFrame* () {
-        return m_pAVFrame.get();
+        return m_pAVFrame;
     }
 	operator const AVFrame* () const {
-		return m_pAVFrame.get();
+		return m_pAVFrame;
 	}
     AVFrame* operator->() {
-        return m_pAVFrame.get();
+        return m_pAVFrame;
     }
 
 	uint8_t** data() const;
@@ -41,8 +49,20 @@ public:
 
 	int ptsMsTime() const;
 	void setPtsMsTime(int msTime);
+	//seek generation the frame was decoded in, see PacketQueue::serial().
+	int serial() const;
+	void setSerial(int serial);
+	//AVFrameRefs sharing this frame, 0 for an empty one. 1 means nobody else can see the samples.
+	int useCount() const;
+
+	//hits are frames reused from the pool, misses the ones av_frame_alloc'ed.
+	static QsPoolStats poolStats();
+private:
+	void release();
 private:
-    std::shared_ptr<AVFrame> m_pAVFrame = nullptr;
+	QsFrameNode* m_pNode = nullptr;
+    AVFrame* m_pAVFrame = nullptr;
 	int m_ptsSystemTime = 0;
 	int m_msPts = 0;
+	int m_serial = 0;
 };
\ No newline at end of file
@@ -23,7 +23,7 @@ void FFmpegAudioDecoder::flush()
 		avcodec_flush_buffers(m_pCodecCtx);
 }
 
-void FFmpegAudioDecoder::open(const AVCodecParameters *par)
+bool FFmpegAudioDecoder::open(const AVCodecParameters *par)
 {
     do
     {
@@ -33,6 +33,7 @@ void FFmpegAudioDecoder::open(const AVCodecParameters *par)
         if (pCodec)
             OpenCodec(par, pCodec);
     } while (0);
+    return m_pCodecCtx != nullptr;
 }
 
 void FFmpegAudioDecoder::OpenCodec(const AVCodecParameters *par, AVCodec* pCodec)
@@ -21,7 +21,7 @@ public:
 	FFmpegAudioDecoder();
 	~FFmpegAudioDecoder();
 
-	void open(const AVCodecParameters *par);
+	bool open(const AVCodecParameters *par);
 	void close();
 
 	int decode(const AVPacket* pkt);
@@ -11,6 +11,8 @@ extern "C" {
 };
 #endif
 #include "FFmpegUtils.h"
+#include "FFmpegKeyframeIndex.h"
+#include "FFmpegReadAheadIO.h"
 
 static AVRational gContextBaseTime = { 1, AV_TIME_BASE };
 
@@ -24,14 +26,36 @@ FFmpegDemuxer::~FFmpegDemuxer()
 
 }
 
+void FFmpegDemuxer::setReadAhead(int bufferBytes, int readAheadBytes)
+{
+    m_readAheadBufferBytes = bufferBytes;
+    m_readAheadBytes = readAheadBytes;
+}
+
 bool FFmpegDemuxer::open(const char* pFile)
 {
     close();
 
+    if (m_readAheadBufferBytes > 0)
+    {
+        m_pIO = std::make_unique<FFmpegReadAheadIO>(m_readAheadBufferBytes, m_readAheadBytes);
+        if (m_pIO->open(pFile))
+        {
+            m_pFormatContext = avformat_alloc_context();
+            m_pFormatContext->pb = m_pIO->context();
+        }
+        else
+        {
+            //not a plain readable url, let avformat open it the usual way.
+            m_pIO = nullptr;
+        }
+    }
+
     if (avformat_open_input(&m_pFormatContext, pFile, NULL, NULL) != 0)
     {
         avformat_close_input(&m_pFormatContext);
         m_pFormatContext = NULL;
+        m_pIO = nullptr;
         return false;
     }
     if (avformat_find_stream_info(m_pFormatContext, NULL) < 0)
@@ -55,16 +79,27 @@ bool FFmpegDemuxer::open(const char* pFile)
 		m_mediaInfo.iFileTotalTime = QmBaseTimeToMSTime(m_pFormatContext->duration, gContextBaseTime);
     }
 
+    //without an index every av_seek_frame bisects the file (raw ts, matroska without cues).
+    if (m_pVideoStream && m_pVideoStream->nb_index_entries < 2)
+    {
+        m_pKeyframeIndex = std::make_unique<FFmpegKeyframeIndex>();
+        m_pKeyframeIndex->open(pFile, m_pVideoStream->index);
+    }
+
 	return true;
 }
 
 void FFmpegDemuxer::close()
 {
+    m_pKeyframeIndex = nullptr;
+    m_bIndexRegistered = false;
     if (m_pFormatContext)
     {
         avformat_close_input(&m_pFormatContext);
         m_pFormatContext = NULL;
     }
+    //a custom pb outlives the format context that used it.
+    m_pIO = nullptr;
 	m_pVideoStream = nullptr;
 	m_pAudioStream = nullptr;
 }
@@ -109,6 +144,11 @@ int FFmpegDemuxer::readPacket(AVPacketPtr& pkt)
 	return iRet;
 }
 
+QsIOStats FFmpegDemuxer::ioStats() const
+{
+	return m_pIO ? m_pIO->stats() : QsIOStats();
+}
+
 bool FFmpegDemuxer::isFileEnd()
 {
 	return m_fileEnd;
@@ -116,6 +156,13 @@ bool FFmpegDemuxer::isFileEnd()
 
 int FFmpegDemuxer::seek(int msTime)
 {
+	if (m_pKeyframeIndex && m_pKeyframeIndex->isReady())
+	{
+		int iRet = seekByIndex(msTime);
+		if (iRet >= 0)
+			return iRet;
+	}
+
 	int64_t seek_target = QmMSTimeToBaseTime(msTime, gContextBaseTime);
 	int iRet = av_seek_frame(m_pFormatContext, -1, seek_target, AVSEEK_FLAG_BACKWARD);
 	if (iRet < 0)
@@ -125,6 +172,25 @@ int FFmpegDemuxer::seek(int msTime)
 	return iRet;
 }
 
+int FFmpegDemuxer::seekByIndex(int msTime)
+{
+	int64_t pts = QmMSTimeToBaseTime(msTime, m_pVideoStream->time_base);
+	if (m_pKeyframeIndex->mode() == FFmpegKeyframeIndex::kFormatIndex)
+	{
+		//hand the entries to the container once, its own read_seek then jumps straight to them.
+		if (!m_bIndexRegistered)
+		{
+			for (const QsKeyframeEntry& e : m_pKeyframeIndex->entries())
+				av_add_index_entry(m_pVideoStream, e.pos, e.dts, 0, 0, AVINDEX_KEYFRAME);
+			m_bIndexRegistered = true;
+		}
+		return av_seek_frame(m_pFormatContext, m_pVideoStream->index, pts, AVSEEK_FLAG_BACKWARD);
+	}
 
+	QsKeyframeEntry entry;
+	if (!m_pKeyframeIndex->find(pts, entry))
+		return -1;
+	return av_seek_frame(m_pFormatContext, m_pVideoStream->index, entry.pos, AVSEEK_FLAG_BYTE);
+}
 
 
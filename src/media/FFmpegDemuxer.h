@@ -3,15 +3,20 @@
 #include "media_global.h"
 
 #include "QsMediaInfo.h"
+#include <memory>
 
 struct AVFormatContext;
 struct AVStream;
+class FFmpegKeyframeIndex;
+class FFmpegReadAheadIO;
 class MEDIA_API FFmpegDemuxer
 {
 public:
     FFmpegDemuxer();
     ~FFmpegDemuxer();
 
+    //bufferBytes > 0 reads the file through FFmpegReadAheadIO, takes effect on the next open().
+    void setReadAhead(int bufferBytes, int readAheadBytes);
     bool open(const char* file);
     void close();
     
@@ -19,12 +24,14 @@ public:
 	bool isFileEnd();
 	int seek(int msTime);
 	const QsMediaInfo& getMediaInfo() { return m_mediaInfo; }
+	QsIOStats ioStats() const;
 
     AVStream* videoStream() { return m_pVideoStream;}
 	AVStream* audioStream() { return m_pAudioStream;}
 protected:
     void openVideoStream(int i);
     void openAudioStream(int i);
+    int seekByIndex(int msTime);
 protected:
     AVFormatContext* m_pFormatContext = nullptr;
     AVStream* m_pVideoStream = nullptr;
@@ -32,5 +39,11 @@ protected:
 
     QsMediaInfo m_mediaInfo;
 	bool m_fileEnd = false;
+	//only built for video streams the container does not index itself.
+	std::unique_ptr<FFmpegKeyframeIndex> m_pKeyframeIndex;
+	bool m_bIndexRegistered = false;
+	std::unique_ptr<FFmpegReadAheadIO> m_pIO;
+	int m_readAheadBufferBytes = 0;
+	int m_readAheadBytes = 0;
 };
 
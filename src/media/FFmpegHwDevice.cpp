@@ -11,7 +11,12 @@ extern "C" {
 #ifdef __cplusplus
 };
 #endif
+#ifdef _WIN32
 #include <libavutil/hwcontext_d3d11va.h>
+static const AVHWDeviceType kDefaultHwDeviceType = AV_HWDEVICE_TYPE_D3D11VA;
+#else
+static const AVHWDeviceType kDefaultHwDeviceType = AV_HWDEVICE_TYPE_VAAPI;
+#endif
 
 
 FFmpegHwDevice::FFmpegHwDevice()
@@ -26,6 +31,7 @@ FFmpegHwDevice::~FFmpegHwDevice()
 
 void FFmpegHwDevice::attach(ID3D11Device* pDevcie)
 {
+#ifdef _WIN32
 	if (pDevcie)
 	{
 		m_hwDevice = allocHwDeviceBuffer(AV_HWDEVICE_TYPE_D3D11VA);
@@ -37,9 +43,13 @@ void FFmpegHwDevice::attach(ID3D11Device* pDevcie)
 		av_hwdevice_ctx_init(m_hwDevice.get());
 	}
 	else
+#else
+	//an external device can only be shared on d3d11; use the default device instead.
+	(void)pDevcie;
+#endif
 	{
 		AVBufferRef* bufRef = NULL;
-		av_hwdevice_ctx_create(&bufRef, AV_HWDEVICE_TYPE_D3D11VA, "", NULL, 0);
+		av_hwdevice_ctx_create(&bufRef, kDefaultHwDeviceType, "", NULL, 0);
 
 		m_hwDevice.reset(bufRef, [](AVBufferRef* ref) {
 			av_buffer_unref(&ref);
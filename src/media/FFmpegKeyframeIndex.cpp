@@ -0,0 +1,368 @@
+#include "FFmpegKeyframeIndex.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#ifdef __cplusplus
+};
+#endif
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#endif
+
+static const char kCacheMagic[4] = { 'Q', 'K', 'F', 'I' };
+static const uint32_t kCacheVersion = 1;
+
+std::mutex FFmpegKeyframeIndex::s_cacheDirMutex;
+std::string FFmpegKeyframeIndex::s_cacheDir;
+
+namespace
+{
+	uint64_t fnv1a(const std::string& str)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+		for (unsigned char c : str)
+		{
+			hash ^= c;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	//entries are stored as zigzag varint deltas, a keyframe every few seconds costs a handful of bytes.
+	void putVarint(std::string& buffer, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((char)(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((char)value);
+	}
+
+	void putDelta(std::string& buffer, int64_t value)
+	{
+		putVarint(buffer, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+	}
+
+	void putU32(std::string& buffer, uint32_t value)
+	{
+		buffer.append((const char*)&value, sizeof(value));
+	}
+
+	bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; p < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *p++;
+			value |= (uint64_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	bool getDelta(const uint8_t*& p, const uint8_t* end, int64_t& value)
+	{
+		uint64_t zigzag = 0;
+		if (!getVarint(p, end, zigzag))
+			return false;
+		value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+		return true;
+	}
+
+	bool getU32(const uint8_t*& p, const uint8_t* end, uint32_t& value)
+	{
+		if (end - p < (int)sizeof(value))
+			return false;
+		memcpy(&value, p, sizeof(value));
+		p += sizeof(value);
+		return true;
+	}
+
+	bool readFile(const std::string& path, std::string& data)
+	{
+		FILE* fp = fopen(path.c_str(), "rb");
+		if (fp == nullptr)
+			return false;
+		char buffer[64 * 1024];
+		size_t n = 0;
+		while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+			data.append(buffer, n);
+		fclose(fp);
+		return true;
+	}
+}
+
+FFmpegKeyframeIndex::FFmpegKeyframeIndex()
+{
+
+}
+
+FFmpegKeyframeIndex::~FFmpegKeyframeIndex()
+{
+	close();
+}
+
+void FFmpegKeyframeIndex::open(const char* file, int streamIndex)
+{
+	close();
+
+	m_cacheKey.clear();
+	m_cachePath.clear();
+	if (makeCacheKey(file, m_cacheKey))
+	{
+		m_cacheKey += "|" + std::to_string(streamIndex);
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.kfi", (unsigned long long)fnv1a(m_cacheKey));
+		m_cachePath = cacheDir() + "/" + name;
+		if (load())
+		{
+			m_bReady = true;
+			return;
+		}
+	}
+
+	m_bStop = false;
+	m_scanThread = std::thread(&FFmpegKeyframeIndex::scanThread, this, std::string(file), streamIndex);
+}
+
+void FFmpegKeyframeIndex::close()
+{
+	m_bStop = true;
+	if (m_scanThread.joinable())
+		m_scanThread.join();
+	m_bReady = false;
+	m_entries.clear();
+	m_mode = kNone;
+}
+
+bool FFmpegKeyframeIndex::find(int64_t pts, QsKeyframeEntry& entry) const
+{
+	if (!m_bReady || m_entries.empty())
+		return false;
+
+	auto iter = std::upper_bound(m_entries.begin(), m_entries.end(), pts,
+		[](int64_t value, const QsKeyframeEntry& e) { return value < e.pts; });
+	//a target before the first keyframe starts from the first one.
+	entry = iter == m_entries.begin() ? *iter : *(iter - 1);
+	return true;
+}
+
+void FFmpegKeyframeIndex::setCacheDir(const char* dir)
+{
+	std::lock_guard<std::mutex> lock(s_cacheDirMutex);
+	s_cacheDir = dir ? dir : "";
+}
+
+std::string FFmpegKeyframeIndex::cacheDir()
+{
+	std::lock_guard<std::mutex> lock(s_cacheDirMutex);
+	if (s_cacheDir.empty())
+	{
+		const char* tmp = getenv("TEMP");
+		if (tmp == nullptr)
+			tmp = getenv("TMPDIR");
+#ifdef _WIN32
+		s_cacheDir = std::string(tmp ? tmp : ".") + "/libmedia_kfi";
+		_mkdir(s_cacheDir.c_str());
+#else
+		s_cacheDir = std::string(tmp ? tmp : "/tmp") + "/libmedia_kfi";
+		mkdir(s_cacheDir.c_str(), 0755);
+#endif
+	}
+	return s_cacheDir;
+}
+
+bool FFmpegKeyframeIndex::makeCacheKey(const char* file, std::string& key)
+{
+	int64_t size = 0;
+	int64_t mtime = 0;
+#ifdef _WIN32
+	//the path is utf-8 like everything handed to ffmpeg.
+	wchar_t wfile[MAX_PATH * 2];
+	if (MultiByteToWideChar(CP_UTF8, 0, file, -1, wfile, sizeof(wfile) / sizeof(wchar_t)) == 0)
+		return false;
+	struct _stat64 st;
+	if (_wstat64(wfile, &st) != 0)
+		return false;
+#else
+	struct stat st;
+	if (stat(file, &st) != 0)
+		return false;
+#endif
+	size = st.st_size;
+	mtime = st.st_mtime;
+	key = std::string(file) + "|" + std::to_string(size) + "|" + std::to_string(mtime);
+	return true;
+}
+
+bool FFmpegKeyframeIndex::load()
+{
+	std::string data;
+	if (!readFile(m_cachePath, data) || data.size() < sizeof(kCacheMagic))
+		return false;
+
+	const uint8_t* p = (const uint8_t*)data.data();
+	const uint8_t* end = p + data.size();
+	if (memcmp(p, kCacheMagic, sizeof(kCacheMagic)) != 0)
+		return false;
+	p += sizeof(kCacheMagic);
+
+	uint32_t version = 0;
+	uint32_t mode = 0;
+	uint32_t keyLen = 0;
+	if (!getU32(p, end, version) || version != kCacheVersion
+		|| !getU32(p, end, mode) || (mode != kBytePosition && mode != kFormatIndex)
+		|| !getU32(p, end, keyLen) || end - p < (int64_t)keyLen)
+		return false;
+	//the name is only a hash, the full key rules out collisions and stale files.
+	if (std::string((const char*)p, keyLen) != m_cacheKey)
+		return false;
+	p += keyLen;
+
+	uint32_t count = 0;
+	if (!getU32(p, end, count))
+		return false;
+	std::vector<QsKeyframeEntry> entries(count);
+	QsKeyframeEntry last = { 0, 0, 0 };
+	for (QsKeyframeEntry& e : entries)
+	{
+		int64_t pts, dts, pos;
+		if (!getDelta(p, end, pts) || !getDelta(p, end, dts) || !getDelta(p, end, pos))
+			return false;
+		e.pts = last.pts + pts;
+		e.dts = last.dts + dts;
+		e.pos = last.pos + pos;
+		last = e;
+	}
+	m_entries.swap(entries);
+	m_mode = mode;
+	return !m_entries.empty();
+}
+
+bool FFmpegKeyframeIndex::save() const
+{
+	if (m_cachePath.empty())
+		return false;
+
+	std::string data(kCacheMagic, sizeof(kCacheMagic));
+	putU32(data, kCacheVersion);
+	putU32(data, m_mode);
+	putU32(data, (uint32_t)m_cacheKey.size());
+	data += m_cacheKey;
+	putU32(data, (uint32_t)m_entries.size());
+	QsKeyframeEntry last = { 0, 0, 0 };
+	for (const QsKeyframeEntry& e : m_entries)
+	{
+		putDelta(data, e.pts - last.pts);
+		putDelta(data, e.dts - last.dts);
+		putDelta(data, e.pos - last.pos);
+		last = e;
+	}
+
+	//written aside and renamed, a player opening the same file never reads half an index.
+	std::string tmpPath = m_cachePath + ".tmp";
+	FILE* fp = fopen(tmpPath.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+	bool bOk = fwrite(data.data(), 1, data.size(), fp) == data.size();
+	fclose(fp);
+	remove(m_cachePath.c_str());
+	if (!bOk || rename(tmpPath.c_str(), m_cachePath.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+void FFmpegKeyframeIndex::scanThread(std::string file, int streamIndex)
+{
+	AVFormatContext* pContext = avformat_alloc_context();
+	if (pContext == nullptr)
+		return;
+	pContext->interrupt_callback.callback = [](void* opaque) -> int {
+		return ((FFmpegKeyframeIndex*)opaque)->m_bStop ? 1 : 0;
+	};
+	pContext->interrupt_callback.opaque = this;
+	if (avformat_open_input(&pContext, file.c_str(), NULL, NULL) != 0)
+		return;
+	if (avformat_find_stream_info(pContext, NULL) < 0 || streamIndex >= (int)pContext->nb_streams)
+	{
+		avformat_close_input(&pContext);
+		return;
+	}
+
+	//packets only, nothing is decoded; other streams are still read but dropped by the demuxer.
+	for (int i = 0; i < (int)pContext->nb_streams; ++i)
+	{
+		if (i != streamIndex)
+			pContext->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	AVStream* pStream = pContext->streams[streamIndex];
+	std::vector<QsKeyframeEntry> entries;
+	AVPacket* pkt = av_packet_alloc();
+	int iRet = 0;
+	while (!m_bStop && (iRet = av_read_frame(pContext, pkt)) >= 0)
+	{
+		if (pkt->stream_index == streamIndex && (pkt->flags & AV_PKT_FLAG_KEY) && pkt->pos >= 0)
+		{
+			QsKeyframeEntry e;
+			e.dts = pkt->dts;
+			e.pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+			e.pos = pkt->pos;
+			if (e.pts != AV_NOPTS_VALUE)
+				entries.push_back(e);
+		}
+		av_packet_unref(pkt);
+	}
+	av_packet_free(&pkt);
+
+	int mode = kNone;
+	if (iRet == AVERROR_EOF && !m_bStop)
+	{
+		if (pStream->nb_index_entries > 0 && !(pContext->iformat->flags & AVFMT_GENERIC_INDEX))
+		{
+			//the container indexed itself while being read (matroska without cues records its clusters),
+			//its positions are the ones its read_seek understands, packet offsets inside a cluster are not.
+			entries.clear();
+			for (int i = 0; i < pStream->nb_index_entries; ++i)
+			{
+				const AVIndexEntry& ie = pStream->index_entries[i];
+				if (ie.flags & AVINDEX_KEYFRAME)
+				{
+					QsKeyframeEntry e = { ie.timestamp, ie.timestamp, ie.pos };
+					entries.push_back(e);
+				}
+			}
+			mode = kFormatIndex;
+		}
+		else if (!(pContext->iformat->flags & AVFMT_NO_BYTE_SEEK))
+		{
+			mode = kBytePosition;
+		}
+	}
+	avformat_close_input(&pContext);
+
+	if (mode == kNone || entries.empty())
+		return;
+
+	std::stable_sort(entries.begin(), entries.end(), [](const QsKeyframeEntry& a, const QsKeyframeEntry& b) {
+		return a.pts < b.pts;
+	});
+	m_entries.swap(entries);
+	m_mode = mode;
+	save();
+	m_bReady = true;
+}
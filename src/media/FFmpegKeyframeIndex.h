@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+struct QsKeyframeEntry
+{
+	int64_t pts;    //stream time base, dts when the packet had no pts
+	int64_t dts;
+	int64_t pos;    //byte offset of the keyframe packet, or the format's own index position
+};
+
+//Keyframe index of one video stream, for files whose container has no usable index.
+//It is loaded from a cache file keyed by path+size+mtime, or built by a packet-only scan of the
+//file on a background thread and cached once complete. Entries are in the stream time base.
+class FFmpegKeyframeIndex
+{
+public:
+	enum
+	{
+		kNone = 0,
+		kBytePosition,  //pos is the keyframe packet offset, seek with AVSEEK_FLAG_BYTE
+		kFormatIndex,   //entries come from the container's own index (e.g. matroska clusters), register them with av_add_index_entry
+	};
+
+	FFmpegKeyframeIndex();
+	~FFmpegKeyframeIndex();
+
+	void open(const char* file, int streamIndex);
+	void close();
+
+	bool isReady() const { return m_bReady; }
+	int mode() const { return m_mode; }
+	//the last keyframe at or before pts, false until the index is ready.
+	bool find(int64_t pts, QsKeyframeEntry& entry) const;
+	const std::vector<QsKeyframeEntry>& entries() const { return m_entries; }
+
+	//directory of the cache files, %TEMP%/libmedia_kfi by default.
+	static void setCacheDir(const char* dir);
+protected:
+	void scanThread(std::string file, int streamIndex);
+	bool load();
+	bool save() const;
+	static bool makeCacheKey(const char* file, std::string& key);
+	static std::string cacheDir();
+protected:
+	std::string m_cacheKey;
+	std::string m_cachePath;
+	std::thread m_scanThread;
+	std::atomic<bool> m_bStop{ false };
+	std::atomic<bool> m_bReady{ false };
+	//written by the scan thread before m_bReady is set, read only afterwards.
+	std::vector<QsKeyframeEntry> m_entries;
+	int m_mode = kNone;
+
+	static std::mutex s_cacheDirMutex;
+	static std::string s_cacheDir;
+};
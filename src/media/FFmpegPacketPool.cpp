@@ -0,0 +1,141 @@
+#include "FFmpegPacketPool.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavcodec/avcodec.h>
+#ifdef __cplusplus
+};
+#endif
+
+//hands the shared_ptr control block of a pooled packet out of the pool as well.
+template<class T>
+struct QsPoolAllocator
+{
+	typedef T value_type;
+
+	QsPoolAllocator() {}
+	template<class U> QsPoolAllocator(const QsPoolAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		return (T*)FFmpegPacketPool::instance().allocBlock(n * sizeof(T));
+	}
+	void deallocate(T* p, size_t n)
+	{
+		FFmpegPacketPool::instance().freeBlock(p, n * sizeof(T));
+	}
+	template<class U> bool operator==(const QsPoolAllocator<U>&) const { return true; }
+	template<class U> bool operator!=(const QsPoolAllocator<U>&) const { return false; }
+};
+
+FFmpegPacketPool& FFmpegPacketPool::instance()
+{
+	//never destroyed: packets may still be released during static destruction.
+	static FFmpegPacketPool* s_pool = new FFmpegPacketPool();
+	return *s_pool;
+}
+
+FFmpegPacketPool::FFmpegPacketPool()
+{
+	m_packets.reserve(kMaxPooled);
+	m_blocks.reserve(kMaxPooled);
+}
+
+AVPacketPtr FFmpegPacketPool::alloc()
+{
+	AVPacket* pkt = nullptr;
+	bool bPooled = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		bPooled = m_bEnabled;
+		if (bPooled && !m_packets.empty())
+		{
+			pkt = m_packets.back();
+			m_packets.pop_back();
+			++m_stats.hits;
+		}
+		else if (bPooled)
+		{
+			++m_stats.misses;
+		}
+	}
+	if (!bPooled)
+	{
+		return AVPacketPtr(av_packet_alloc(), [](AVPacket* pPkt) {
+			av_packet_free(&pPkt);
+		});
+	}
+	if (pkt == nullptr)
+		pkt = av_packet_alloc();
+
+	return AVPacketPtr(pkt, [](AVPacket* pPkt) {
+		FFmpegPacketPool::instance().recycle(pPkt);
+	}, QsPoolAllocator<AVPacket>());
+}
+
+void FFmpegPacketPool::recycle(AVPacket* pkt)
+{
+	av_packet_unref(pkt);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_bEnabled && m_packets.size() < kMaxPooled)
+		{
+			m_packets.push_back(pkt);
+			++m_stats.recycled;
+			return;
+		}
+		++m_stats.freed;
+	}
+	av_packet_free(&pkt);
+}
+
+void* FFmpegPacketPool::allocBlock(size_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		//every AVPacketPtr of the pool has the same control block type, so one block size.
+		if (m_blockSize == 0)
+			m_blockSize = size;
+		if (size == m_blockSize && !m_blocks.empty())
+		{
+			void* p = m_blocks.back();
+			m_blocks.pop_back();
+			return p;
+		}
+	}
+	return ::operator new(size);
+}
+
+void FFmpegPacketPool::freeBlock(void* p, size_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (size == m_blockSize && m_blocks.size() < kMaxPooled)
+		{
+			m_blocks.push_back(p);
+			return;
+		}
+	}
+	::operator delete(p);
+}
+
+void FFmpegPacketPool::setEnabled(bool bEnabled)
+{
+	std::vector<AVPacket*> packets;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bEnabled = bEnabled;
+		if (!bEnabled)
+			packets.swap(m_packets);
+	}
+	for (AVPacket* pkt : packets)
+		av_packet_free(&pkt);
+}
+
+QsPoolStats FFmpegPacketPool::stats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	QsPoolStats stats = m_stats;
+	stats.pooled = (uint32_t)m_packets.size();
+	return stats;
+}
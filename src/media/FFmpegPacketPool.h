@@ -0,0 +1,37 @@
+#pragma once
+
+#include "QsMediaInfo.h"
+#include <vector>
+#include <mutex>
+
+template<class T> struct QsPoolAllocator;
+
+//Recycles AVPacket shells and the shared_ptr control blocks of AVPacketPtr.
+//A packet goes back to the pool, unreferenced, when its last AVPacketPtr is released.
+//The payload still belongs to whatever the demuxer allocated and is freed with the reference.
+class FFmpegPacketPool
+{
+public:
+	static FFmpegPacketPool& instance();
+
+	AVPacketPtr alloc();
+	//disabled, alloc() falls back to av_packet_alloc and a plain shared_ptr.
+	void setEnabled(bool bEnabled);
+	QsPoolStats stats() const;
+protected:
+	FFmpegPacketPool();
+	void recycle(AVPacket* pkt);
+	void* allocBlock(size_t size);
+	void freeBlock(void* p, size_t size);
+
+	template<class T> friend struct QsPoolAllocator;
+protected:
+	enum { kMaxPooled = 1024 };
+
+	mutable std::mutex m_mutex;
+	std::vector<AVPacket*> m_packets;
+	std::vector<void*> m_blocks;
+	size_t m_blockSize = 0;
+	bool m_bEnabled = true;
+	QsPoolStats m_stats;
+};
@@ -0,0 +1,244 @@
+#include "FFmpegReadAheadIO.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavformat/avformat.h>
+#include <libavformat/avio.h>
+#ifdef __cplusplus
+};
+#endif
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+//what the demuxer reads through per call, the large buffer is the cache ring.
+static const int kIOBufferSize = 64 * 1024;
+//the read-ahead thread reads the source in chunks of this size.
+static const int kFetchChunkSize = 256 * 1024;
+
+FFmpegReadAheadIO::FFmpegReadAheadIO(int bufferBytes, int readAheadBytes)
+	: m_cache((std::max)(bufferBytes, 2 * kFetchChunkSize))
+	, m_readAheadBytes((std::min)(readAheadBytes, (int)m_cache.size() - kFetchChunkSize))
+{
+
+}
+
+FFmpegReadAheadIO::~FFmpegReadAheadIO()
+{
+	close();
+}
+
+bool FFmpegReadAheadIO::open(const char* url)
+{
+	AVIOContext* source = nullptr;
+	if (avio_open(&source, url, AVIO_FLAG_READ) < 0)
+		return false;
+	return open(source, true);
+}
+
+bool FFmpegReadAheadIO::open(AVIOContext* source, bool bOwnSource)
+{
+	close();
+
+	m_pSource = source;
+	m_bOwnSource = bOwnSource;
+	m_sourceSize = avio_size(source);
+
+	uint8_t* buffer = (uint8_t*)av_malloc(kIOBufferSize);
+	m_pContext = avio_alloc_context(buffer, kIOBufferSize, 0, this, &FFmpegReadAheadIO::readPacket, nullptr, &FFmpegReadAheadIO::seekPacket);
+	if (m_pContext == nullptr)
+	{
+		av_free(buffer);
+		close();
+		return false;
+	}
+	m_pContext->seekable = source->seekable;
+
+	m_cacheStart = m_cacheEnd = m_readPos = avio_tell(source);
+	m_bEof = false;
+	m_bStop = false;
+	m_stats = QsIOStats();
+	m_fetchThread = std::thread([this] { fetchThread(); });
+	return true;
+}
+
+void FFmpegReadAheadIO::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+		m_fetchCond.notify_all();
+		m_dataCond.notify_all();
+	}
+	if (m_fetchThread.joinable())
+		m_fetchThread.join();
+
+	if (m_pContext)
+	{
+		//avio may have replaced the buffer it was given.
+		av_freep(&m_pContext->buffer);
+		avio_context_free(&m_pContext);
+	}
+	if (m_pSource && m_bOwnSource)
+		avio_closep(&m_pSource);
+	m_pSource = nullptr;
+}
+
+QsIOStats FFmpegReadAheadIO::stats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	QsIOStats stats = m_stats;
+	uint32_t reads = stats.hits + stats.misses;
+	stats.hitRate = reads ? (float)stats.hits / reads : 0;
+	return stats;
+}
+
+int FFmpegReadAheadIO::readPacket(void* opaque, uint8_t* buf, int size)
+{
+	return ((FFmpegReadAheadIO*)opaque)->read(buf, size);
+}
+
+int64_t FFmpegReadAheadIO::seekPacket(void* opaque, int64_t offset, int whence)
+{
+	return ((FFmpegReadAheadIO*)opaque)->seek(offset, whence);
+}
+
+int FFmpegReadAheadIO::read(uint8_t* buf, int size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_readPos < m_cacheEnd)
+	{
+		++m_stats.hits;
+	}
+	else
+	{
+		++m_stats.misses;
+		auto begin = std::chrono::steady_clock::now();
+		m_fetchCond.notify_all();
+		m_dataCond.wait(lock, [this] { return m_readPos < m_cacheEnd || m_bEof || m_bStop; });
+		m_stats.stallUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+		if (m_readPos >= m_cacheEnd)
+			return AVERROR_EOF;
+	}
+
+	int n = (int)(std::min)((int64_t)size, m_cacheEnd - m_readPos);
+	copyFromCache(buf, m_readPos, n);
+	m_readPos += n;
+	m_stats.bytesRead += n;
+	//reading freed room behind the read position.
+	m_fetchCond.notify_all();
+	return n;
+}
+
+int64_t FFmpegReadAheadIO::seek(int64_t offset, int whence)
+{
+	if (whence & AVSEEK_SIZE)
+		return m_sourceSize >= 0 ? m_sourceSize : AVERROR(ENOSYS);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int64_t target = offset;
+	switch (whence & ~AVSEEK_FORCE)
+	{
+	case SEEK_SET:
+		break;
+	case SEEK_CUR:
+		target = m_readPos + offset;
+		break;
+	case SEEK_END:
+		if (m_sourceSize < 0)
+			return AVERROR(ENOSYS);
+		target = m_sourceSize + offset;
+		break;
+	default:
+		return AVERROR(EINVAL);
+	}
+	if (target < 0)
+		return AVERROR(EINVAL);
+
+	if (target < m_cacheStart || target > m_cacheEnd)
+	{
+		//outside the window: whatever the read-ahead thread is fetching belongs to the old position.
+		++m_generation;
+		++m_stats.invalidations;
+		m_cacheStart = m_cacheEnd = target;
+		m_bEof = false;
+	}
+	m_readPos = target;
+	m_fetchCond.notify_all();
+	return target;
+}
+
+void FFmpegReadAheadIO::fetchThread()
+{
+	std::vector<uint8_t> chunk(kFetchChunkSize);
+	int64_t sourcePos = avio_tell(m_pSource);
+	const int64_t capacity = (int64_t)m_cache.size();
+	//room kept for data behind the read position, demuxers often step back a little.
+	const int64_t keepBehind = capacity - m_readAheadBytes - kFetchChunkSize;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_bStop)
+	{
+		if (m_bEof || m_cacheEnd - m_readPos >= m_readAheadBytes)
+		{
+			m_fetchCond.wait(lock);
+			continue;
+		}
+
+		int64_t evictTo = m_readPos - keepBehind;
+		if (evictTo > m_cacheStart)
+			m_cacheStart = evictTo;
+		int toRead = (int)(std::min)((int64_t)kFetchChunkSize, capacity - (m_cacheEnd - m_cacheStart));
+
+		uint32_t generation = m_generation;
+		int64_t pos = m_cacheEnd;
+		lock.unlock();
+
+		int n = 0;
+		if (pos != sourcePos)
+		{
+			int64_t ret = avio_seek(m_pSource, pos, SEEK_SET);
+			sourcePos = ret < 0 ? -1 : ret;
+		}
+		if (sourcePos == pos)
+		{
+			n = avio_read(m_pSource, chunk.data(), toRead);
+			if (n > 0)
+				sourcePos += n;
+		}
+
+		lock.lock();
+		if (generation != m_generation)
+			continue;
+		if (n <= 0)
+		{
+			//end of file or a read error, either way the demuxer gets what is cached and then EOF.
+			m_bEof = true;
+		}
+		else
+		{
+			copyToCache(chunk.data(), pos, n);
+			m_cacheEnd += n;
+			m_stats.bytesFetched += n;
+		}
+		m_dataCond.notify_all();
+	}
+}
+
+void FFmpegReadAheadIO::copyFromCache(uint8_t* dst, int64_t pos, int size) const
+{
+	int64_t capacity = (int64_t)m_cache.size();
+	int offset = (int)(pos % capacity);
+	int first = (int)(std::min)((int64_t)size, capacity - offset);
+	memcpy(dst, m_cache.data() + offset, first);
+	memcpy(dst + first, m_cache.data(), size - first);
+}
+
+void FFmpegReadAheadIO::copyToCache(const uint8_t* src, int64_t pos, int size)
+{
+	int64_t capacity = (int64_t)m_cache.size();
+	int offset = (int)(pos % capacity);
+	int first = (int)(std::min)((int64_t)size, capacity - offset);
+	memcpy(m_cache.data() + offset, src, first);
+	memcpy(m_cache.data(), src + first, size - first);
+}
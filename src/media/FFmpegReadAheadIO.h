@@ -0,0 +1,59 @@
+#pragma once
+
+#include "media_global.h"
+#include "QsMediaInfo.h"
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct AVIOContext;
+
+//Buffered AVIOContext for FFmpegDemuxer: a background thread keeps readAheadBytes of the source
+//cached ahead of the demuxer's read position in a bufferBytes ring. Seeks inside the cached window
+//only move the read position, seeks outside it drop the window and restart the read-ahead there.
+class MEDIA_API FFmpegReadAheadIO
+{
+public:
+	FFmpegReadAheadIO(int bufferBytes = 32 * 1024 * 1024, int readAheadBytes = 16 * 1024 * 1024);
+	~FFmpegReadAheadIO();
+
+	bool open(const char* url);
+	//wraps an already opened source, which is closed with this object when bOwnSource is set.
+	bool open(AVIOContext* source, bool bOwnSource);
+	void close();
+
+	//to be set as AVFormatContext::pb before avformat_open_input.
+	AVIOContext* context() const { return m_pContext; }
+	QsIOStats stats() const;
+protected:
+	static int readPacket(void* opaque, uint8_t* buf, int size);
+	static int64_t seekPacket(void* opaque, int64_t offset, int whence);
+	int read(uint8_t* buf, int size);
+	int64_t seek(int64_t offset, int whence);
+	void fetchThread();
+	void copyFromCache(uint8_t* dst, int64_t pos, int size) const;
+	void copyToCache(const uint8_t* src, int64_t pos, int size);
+protected:
+	AVIOContext* m_pSource = nullptr;
+	AVIOContext* m_pContext = nullptr;
+	bool m_bOwnSource = false;
+	int64_t m_sourceSize = -1;
+
+	std::vector<uint8_t> m_cache;
+	int m_readAheadBytes;
+	//[m_cacheStart, m_cacheEnd) is cached, at m_cache[pos % size].
+	int64_t m_cacheStart = 0;
+	int64_t m_cacheEnd = 0;
+	int64_t m_readPos = 0;
+	uint32_t m_generation = 0;
+	bool m_bEof = false;
+	bool m_bStop = false;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_dataCond;
+	std::condition_variable m_fetchCond;
+	std::thread m_fetchThread;
+	QsIOStats m_stats;
+};
@@ -1,6 +1,7 @@
 ﻿#include "FFmpegUtils.h"
 #include <chrono>
 #include "QmMacro.h"
+#include "FFmpegPacketPool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,9 +53,17 @@ QeSampleFormat FFmpegUtils::FromFFmpegAudioFormat(int iFFmpegFormat)
 
 AVPacketPtr FFmpegUtils::allocAVPacket()
 {
-	return AVPacketPtr(av_packet_alloc(), [](AVPacket* pPkt) {
-		av_packet_free(&pPkt);
-	});
+	return FFmpegPacketPool::instance().alloc();
+}
+
+void FFmpegUtils::setPacketPoolEnabled(bool bEnabled)
+{
+	FFmpegPacketPool::instance().setEnabled(bEnabled);
+}
+
+QsPoolStats FFmpegUtils::packetPoolStats()
+{
+	return FFmpegPacketPool::instance().stats();
 }
 
 int FFmpegUtils::currentMilliSecsSinceEpoch()
@@ -65,3 +74,17 @@ int FFmpegUtils::currentMilliSecsSinceEpoch()
 	milliseconds ms = duration_cast<milliseconds>(cur);
 	return (int)ms.count();
 }
+
+video::QeColorMatrix FFmpegUtils::colorMatrix(const AVFrame* frame)
+{
+	if (frame->colorspace == AVCOL_SPC_BT709 || (frame->colorspace == AVCOL_SPC_UNSPECIFIED && frame->height > 576))
+		return video::eMatrixBT709;
+	return video::eMatrixBT601;
+}
+
+video::QeColorRange FFmpegUtils::colorRange(const AVFrame* frame)
+{
+	if (frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P)
+		return video::eRangeFull;
+	return video::eRangeLimited;
+}
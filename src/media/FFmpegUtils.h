@@ -3,6 +3,7 @@
 #include "media_global.h"
 #include "QsMediaInfo.h"
 #include "QsAudiodef.h"
+#include "QsVideoConvert.h"
 
 #define QmBaseTimeToSecondTime(value, base) (value * double(base.num) )/(base.den)
 #define QmSecondTimeToBaseTime(value, base) (int64_t)((value * double(base.den) )/(base.num))
@@ -10,6 +11,7 @@
 #define QmMSTimeToBaseTime(value, base) (int64_t)((value * double(base.den) )/(base.num * 1000))
 
 struct AVRational;
+struct AVFrame;
 
 class MEDIA_API FFmpegUtils
 {
@@ -21,7 +23,14 @@ public:
     static int ToFFmpegAudioFormat(QeSampleFormat iFormat);
     static QeSampleFormat FromFFmpegAudioFormat(int iFFmpegFormat);
 
+	//packets come from FFmpegPacketPool and go back to it with their last reference.
 	static AVPacketPtr allocAVPacket();
+	static void setPacketPoolEnabled(bool bEnabled);
+	static QsPoolStats packetPoolStats();
 	static int currentMilliSecsSinceEpoch();
+
+	//for video::ConvertToRGB32, an unspecified colorspace is bt709 above sd sizes and bt601 up to them.
+	static video::QeColorMatrix colorMatrix(const AVFrame* frame);
+	static video::QeColorRange colorRange(const AVFrame* frame);
 };
  
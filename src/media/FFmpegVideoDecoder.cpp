@@ -8,7 +8,10 @@ extern "C"{
 #include <libavutil/hwcontext.h>
 #include <libavutil/error.h>
 }
+#ifdef _WIN32
 #include <libavutil/hwcontext_d3d11va.h>
+#endif
+#include <algorithm>
 
 FFmpegVideoDecoder::FFmpegVideoDecoder()
 {
@@ -29,6 +32,63 @@ void FFmpegVideoDecoder::setHwDevice(AVBufferRef* device_ctx)
 		m_hw_device_ctx = av_buffer_ref(device_ctx);
 }
 
+void FFmpegVideoDecoder::setOptions(const QsDecoderOptions& options)
+{
+	m_options = options;
+}
+
+int FFmpegVideoDecoder::threadCount() const
+{
+	return m_pCodecCtx ? m_pCodecCtx->thread_count : 0;
+}
+
+static AVDiscard toDiscard(int discard)
+{
+	static const AVDiscard kDiscard[] = { AVDISCARD_DEFAULT, AVDISCARD_NONREF, AVDISCARD_BIDIR,
+		AVDISCARD_NONINTRA, AVDISCARD_NONKEY, AVDISCARD_ALL };
+	return discard > eDiscardNone && discard <= eDiscardAll ? kDiscard[discard] : AVDISCARD_DEFAULT;
+}
+
+void FFmpegVideoDecoder::setSkipFrame(int discard)
+{
+	if (m_pCodecCtx)
+		m_pCodecCtx->skip_frame = toDiscard(std::max(discard, m_options.skipFrame));
+}
+
+void FFmpegVideoDecoder::applyOptions(AVCodecContext* pCodecCtx, const AVCodec* pCodec)
+{
+	//the context defaults to a single thread and is left that way unless the caller asks for more,
+	//0 lets libavcodec size it to the cores.
+	if (m_options.threadCount != 1)
+	{
+		pCodecCtx->thread_count = std::max<int>(m_options.threadCount, 0);
+		switch (m_options.threadType)
+		{
+		case eFrameThread:
+			pCodecCtx->thread_type = FF_THREAD_FRAME;
+			break;
+		case eSliceThread:
+			pCodecCtx->thread_type = FF_THREAD_SLICE;
+			break;
+		default:
+			pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+			break;
+		}
+	}
+	if (m_options.lowDelay)
+	{
+		//frame threads hold back one frame each, which is what low delay asks to avoid.
+		pCodecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+		pCodecCtx->thread_type &= ~FF_THREAD_FRAME;
+		if (pCodecCtx->thread_type == 0)
+			pCodecCtx->thread_type = FF_THREAD_SLICE;
+	}
+	pCodecCtx->skip_loop_filter = toDiscard(m_options.skipLoopFilter);
+	pCodecCtx->skip_frame = toDiscard(m_options.skipFrame);
+	if (m_options.lowres > 0 && pCodec)
+		pCodecCtx->lowres = FFMIN(m_options.lowres, (int)pCodec->max_lowres);
+}
+
 void FFmpegVideoDecoder::openCodec(const AVCodecParameters *par, int srcW, int srcH, int srcFormat, int codecID)
 {
     AVCodecContext* pCodecCtx = nullptr;
@@ -51,6 +111,7 @@ void FFmpegVideoDecoder::openCodec(const AVCodecParameters *par, int srcW, int s
             pCodecCtx->coded_height = srcH;
             pCodecCtx->pix_fmt = (AVPixelFormat)srcFormat;
         }
+        applyOptions(pCodecCtx, pCodec);
 
 		bool bDone = false;
 		int err = 0;
@@ -61,7 +122,7 @@ void FFmpegVideoDecoder::openCodec(const AVCodecParameters *par, int srcW, int s
 				auto old_get_format = pCodecCtx->get_format;
 				pCodecCtx->hw_device_ctx = av_buffer_ref(m_hw_device_ctx);
 
-#if 1
+#ifdef _WIN32
 				pCodecCtx->get_format = [](AVCodecContext *ctx, const enum AVPixelFormat *pix_fmts) {
 					const enum AVPixelFormat *p;
 					AVBufferRef* new_frames_ctx = nullptr;
@@ -2,6 +2,7 @@
 #define QC_FFMPEG_DECODER_H
 
 #include "media_global.h"
+#include "QsMediaInfo.h"
 
 struct AVCodecContext;
 struct AVBufferRef;
@@ -24,6 +25,13 @@ public:
 	~FFmpegVideoDecoder();
 
 	void setHwDevice(AVBufferRef* device_ctx);
+	//takes effect on the next open().
+	void setOptions(const QsDecoderOptions& options);
+	const QsDecoderOptions& options() const { return m_options; }
+	//threads the opened codec actually runs, 0 before open().
+	int threadCount() const;
+	//QeDecodeDiscard applied to the open codec from the next packet on, never less than options().skipFrame.
+	void setSkipFrame(int discard);
 	bool open(const AVCodecParameters *par);
 	bool open(int srcW, int srcH, int srcFormat, int codecID);
 	void close();
@@ -34,9 +42,11 @@ public:
 	void flush();
 protected:
     void openCodec(const AVCodecParameters *par, int srcW, int srcH, int srcFormat, int codecID);
+    void applyOptions(AVCodecContext* pCodecCtx, const AVCodec* pCodec);
 protected:
 	AVCodecContext* m_pCodecCtx = nullptr;
 	AVCodec* m_pCodec = nullptr;
 	AVBufferRef * m_hw_device_ctx = nullptr;
+	QsDecoderOptions m_options;
 };
 #endif
@@ -5,8 +5,52 @@ extern "C"{
 #include <libavdevice/avdevice.h>
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 }
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include "QcForkJoin.h"
 
+namespace
+{
+    const int kMaxAutoThreads = 4;
+    const int kMaxThreads = 16;
+    //below this a band costs more in wakeups than it saves.
+    const int kMinBandRows = 64;
+    //rows past a band edge its filter taps may reach, in output rows and per unit of downscale in source rows;
+    //covers lanczos' three lobes.
+    const int kMarginRows = 4;
+
+    const int kScaleFlags[] = { SWS_FAST_BILINEAR, SWS_BILINEAR, SWS_AREA, SWS_BICUBIC,
+        SWS_LANCZOS | SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT };
+
+    int gcd(int a, int b)
+    {
+        while (b)
+        {
+            int t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    //first row of plane p at frame row y, y is a whole chroma row.
+    int planeRow(const AVPixFmtDescriptor* pDesc, int plane, int y)
+    {
+        return plane == 1 || plane == 2 ? y >> pDesc->log2_chroma_h : y;
+    }
+
+    int planeRows(const AVPixFmtDescriptor* pDesc, int plane, int y, int h)
+    {
+        if (plane != 1 && plane != 2)
+            return h;
+        int shift = pDesc->log2_chroma_h;
+        return (-((-(y + h)) >> shift)) - (y >> shift);
+    }
+}
 
 FFmpegVideoTransformat::FFmpegVideoTransformat()
 {
@@ -18,13 +62,41 @@ FFmpegVideoTransformat::~FFmpegVideoTransformat()
     CloseSwsContext();
 }
 
+void FFmpegVideoTransformat::setQuality(int quality)
+{
+    quality = std::min(std::max(quality, (int)eScaleFast), (int)eScaleBest);
+    if (quality == m_quality)
+        return;
+    m_quality = quality;
+    CloseSwsContext();
+}
+
+void FFmpegVideoTransformat::setThreadCount(int nThreads)
+{
+    nThreads = std::min(std::max(nThreads, 0), kMaxThreads);
+    if (nThreads == m_nThreads)
+        return;
+    m_nThreads = nThreads;
+    CloseSwsContext();
+    m_pWorkers = nullptr;
+}
+
 bool FFmpegVideoTransformat::transformat(int srcW, int srcH, int srcFormat, const uint8_t *const srcSlice[], const int srcStride[],
     int dstW, int dstH, int destFormat, uint8_t *const dstSlice[], const int dstStride[])
 {
     if (!OpenSwsContext(srcW, srcH, srcFormat, dstW, dstH, destFormat))
         return false;
 
-    int iRet = sws_scale(m_pSwsCtx, (const uint8_t* const*)srcSlice, srcStride, 0, srcH, dstSlice, dstStride);
+    if (m_bands.size() == 1)
+    {
+        _scaleBand(m_bands[0], srcSlice, srcStride, dstSlice, dstStride);
+        return true;
+    }
+    if (!m_pWorkers || m_pWorkers->size() < (int)m_bands.size())
+        m_pWorkers = std::make_unique<QcForkJoin>((int)m_bands.size());
+    m_pWorkers->run((int)m_bands.size(), [&](int i) {
+        _scaleBand(m_bands[i], srcSlice, srcStride, dstSlice, dstStride);
+    });
     return true;
 }
 
@@ -32,7 +104,7 @@ bool FFmpegVideoTransformat::OpenSwsContext(int srcW, int srcH, int srcFormat, i
 {
     if (m_srcW == srcW && m_srcH == srcH && m_srcFormat == srcFormat
         && m_dstW == dstW && m_dstH == dstH && m_dstFormat == destFormat)
-        return m_pSwsCtx != nullptr;
+        return !m_bands.empty();
 
     CloseSwsContext();
     m_srcW = srcW;
@@ -43,17 +115,130 @@ bool FFmpegVideoTransformat::OpenSwsContext(int srcW, int srcH, int srcFormat, i
     m_dstH = dstH;
     m_dstFormat = destFormat;
 
-    m_pSwsCtx = sws_getContext(m_srcW, m_srcH, (AVPixelFormat)m_srcFormat, m_dstW, m_dstH, (AVPixelFormat)m_dstFormat, SWS_AREA, NULL, NULL, NULL);
-
-    return m_pSwsCtx != nullptr;
+    int nBands = _bandLimit();
+    if (_openBands(nBands))
+        return true;
+    //a banded layout that sws refused still gets the plain whole frame context.
+    CloseSwsContext();
+    if (nBands > 1 && _openBands(1))
+        return true;
+    CloseSwsContext();
+    return false;
 }
 
 void FFmpegVideoTransformat::CloseSwsContext()
 {
-    if (m_pSwsCtx)
+    for (QsBand& band : m_bands)
     {
-        sws_freeContext(m_pSwsCtx);
-        m_pSwsCtx = NULL;
+        if (band.pSwsCtx)
+            sws_freeContext(band.pSwsCtx);
+        av_freep(&band.scratch[0]);
     }
+    m_bands.clear();
 }
 
+//how many bands the current sizes allow: band edges have to fall on whole chroma rows in both images and
+//map to each other exactly, otherwise a band would scale with a slightly different phase than the frame.
+int FFmpegVideoTransformat::_bandLimit() const
+{
+    int nThreads = m_nThreads > 0 ? m_nThreads : std::min((int)std::thread::hardware_concurrency(), kMaxAutoThreads);
+    const AVPixFmtDescriptor* pSrcDesc = av_pix_fmt_desc_get((AVPixelFormat)m_srcFormat);
+    const AVPixFmtDescriptor* pDstDesc = av_pix_fmt_desc_get((AVPixelFormat)m_dstFormat);
+    const uint64_t kUnbandable = AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM;
+    if (nThreads <= 1 || !pSrcDesc || !pDstDesc || ((pSrcDesc->flags | pDstDesc->flags) & kUnbandable)
+        || m_srcH <= 0 || m_dstH <= 0)
+        return 1;
+    return std::min(nThreads, m_dstH / kMinBandRows);
+}
+
+bool FFmpegVideoTransformat::_openBands(int nBands)
+{
+    const AVPixFmtDescriptor* pSrcDesc = av_pix_fmt_desc_get((AVPixelFormat)m_srcFormat);
+    const AVPixFmtDescriptor* pDstDesc = av_pix_fmt_desc_get((AVPixelFormat)m_dstFormat);
+    int g = gcd(m_srcH, m_dstH);
+    int unitSrc = m_srcH / g;
+    int unitDst = m_dstH / g;
+    int units = g;
+    if (nBands > 1)
+    {
+        int srcAlign = 1 << pSrcDesc->log2_chroma_h;
+        int dstAlign = 1 << pDstDesc->log2_chroma_h;
+        int step = 1;
+        while ((step * unitSrc) % srcAlign || (step * unitDst) % dstAlign)
+            ++step;
+        if (units % step != 0)
+            nBands = 1;
+        unitSrc *= step;
+        unitDst *= step;
+        units /= step;
+    }
+    nBands = std::min(nBands, units);
+    if (nBands <= 1)
+    {
+        unitSrc = m_srcH;
+        unitDst = m_dstH;
+        units = 1;
+        nBands = 1;
+    }
+    int downscale = std::max(1, (m_srcH + m_dstH - 1) / m_dstH);
+    int margin = std::max((kMarginRows * downscale + unitSrc - 1) / unitSrc, (kMarginRows + unitDst - 1) / unitDst);
+
+    m_bands.resize(nBands);
+    for (int i = 0; i < nBands; ++i)
+    {
+        QsBand& band = m_bands[i];
+        int u0 = units * i / nBands;
+        int u1 = units * (i + 1) / nBands;
+        int c0 = nBands > 1 ? std::max(0, u0 - margin) : u0;
+        int c1 = nBands > 1 ? std::min(units, u1 + margin) : u1;
+        band.srcY = c0 * unitSrc;
+        band.srcH = (c1 - c0) * unitSrc;
+        band.dstY = c0 * unitDst;
+        band.dstH = (c1 - c0) * unitDst;
+        band.outY = u0 * unitDst;
+        band.outH = (u1 - u0) * unitDst;
+        band.pSwsCtx = sws_getContext(m_srcW, band.srcH, (AVPixelFormat)m_srcFormat, m_dstW, band.dstH,
+            (AVPixelFormat)m_dstFormat, kScaleFlags[m_quality], NULL, NULL, NULL);
+        if (band.pSwsCtx == nullptr)
+            return false;
+        if (band.dstH != band.outH
+            && av_image_alloc(band.scratch, band.scratchStride, m_dstW, band.dstH, (AVPixelFormat)m_dstFormat, 32) < 0)
+            return false;
+    }
+    return true;
+}
+
+void FFmpegVideoTransformat::_scaleBand(QsBand& band, const uint8_t* const srcSlice[], const int srcStride[],
+    uint8_t* const dstSlice[], const int dstStride[])
+{
+    //the callers' arrays only hold the planes of their format, sws_scale reads four.
+    const AVPixFmtDescriptor* pSrcDesc = av_pix_fmt_desc_get((AVPixelFormat)m_srcFormat);
+    const AVPixFmtDescriptor* pDstDesc = av_pix_fmt_desc_get((AVPixelFormat)m_dstFormat);
+    const uint8_t* src[4] = {};
+    int srcLines[4] = {};
+    for (int p = 0; p < av_pix_fmt_count_planes((AVPixelFormat)m_srcFormat); ++p)
+    {
+        src[p] = srcSlice[p] + (ptrdiff_t)planeRow(pSrcDesc, p, band.srcY) * srcStride[p];
+        srcLines[p] = srcStride[p];
+    }
+
+    int nDstPlanes = av_pix_fmt_count_planes((AVPixelFormat)m_dstFormat);
+    uint8_t* dst[4] = {};
+    int dstLines[4] = {};
+    for (int p = 0; p < nDstPlanes; ++p)
+    {
+        dst[p] = band.scratch[0] ? band.scratch[p] : dstSlice[p] + (ptrdiff_t)planeRow(pDstDesc, p, band.dstY) * dstStride[p];
+        dstLines[p] = band.scratch[0] ? band.scratchStride[p] : dstStride[p];
+    }
+    sws_scale(band.pSwsCtx, src, srcLines, 0, band.srcH, dst, dstLines);
+
+    if (band.scratch[0] == nullptr)
+        return;
+    for (int p = 0; p < nDstPlanes; ++p)
+    {
+        int skip = planeRow(pDstDesc, p, band.outY) - planeRow(pDstDesc, p, band.dstY);
+        av_image_copy_plane(dstSlice[p] + (ptrdiff_t)planeRow(pDstDesc, p, band.outY) * dstStride[p], dstStride[p],
+            band.scratch[p] + (ptrdiff_t)skip * band.scratchStride[p], band.scratchStride[p],
+            av_image_get_linesize((AVPixelFormat)m_dstFormat, m_dstW, p), planeRows(pDstDesc, p, band.outY, band.outH));
+    }
+}
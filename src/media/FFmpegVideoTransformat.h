@@ -2,20 +2,62 @@
 
 #include "media_global.h"
 #include <stdint.h>
+#include <memory>
+#include <vector>
+
+//the sws algorithm behind each quality tier.
+enum QeScaleQuality
+{
+    eScaleFast = 0,     //SWS_FAST_BILINEAR
+    eScaleBilinear,     //SWS_BILINEAR
+    eScaleArea,         //SWS_AREA, the default, best suited to downscaling
+    eScaleBicubic,      //SWS_BICUBIC
+    eScaleBest,         //SWS_LANCZOS with accurate rounding and full chroma interpolation
+};
 
 struct SwsContext;
+class QcForkJoin;
 class MEDIA_API FFmpegVideoTransformat
 {
 public:
     FFmpegVideoTransformat();
     ~FFmpegVideoTransformat();
 
+    //QeScaleQuality, eScaleArea by default.
+    void setQuality(int quality);
+    int quality() const { return m_quality; }
+    //splits the output into up to nThreads horizontal bands scaled at once, the calling thread takes one.
+    //1 (the default) is a single sws_scale, 0 picks one per core up to kMaxAutoThreads.
+    void setThreadCount(int nThreads);
+    int threadCount() const { return m_nThreads; }
+    //bands the contexts were built with, fewer than the threads for small frames or awkward ratios.
+    int bandCount() const { return (int)m_bands.size(); }
+
     bool transformat(int srcW, int srcH, int srcFormat, const uint8_t* const srcSlice[], const int srcStride[],
         int dstW, int dstH, int destFormat, uint8_t *const dstSlice[], const int dstStride[]);
 
 protected:
+    //A band context scales its output rows plus a margin on each side, so the filter taps at the band
+    //edges see the same source rows as a whole frame scale would. The margin rows are written to
+    //scratch and dropped, only outY..outY+outH reach the destination.
+    struct QsBand
+    {
+        SwsContext* pSwsCtx = nullptr;
+        int srcY = 0;
+        int srcH = 0;
+        int dstY = 0;
+        int dstH = 0;
+        int outY = 0;
+        int outH = 0;
+        uint8_t* scratch[4] = {};
+        int scratchStride[4] = {};
+    };
     bool OpenSwsContext(int srcW, int srcH, int srcFormat, int dstW, int dstH, int destFormat);
     void CloseSwsContext();
+    int _bandLimit() const;
+    bool _openBands(int nBands);
+    void _scaleBand(QsBand& band, const uint8_t* const srcSlice[], const int srcStride[],
+        uint8_t* const dstSlice[], const int dstStride[]);
 protected:
     int m_srcW = 0;
     int m_srcH = 0;
@@ -24,5 +66,9 @@ protected:
     int m_dstW = 0;
     int m_dstH = 0;
     int m_dstFormat = 0;
-    SwsContext* m_pSwsCtx = nullptr;
+
+    int m_quality = eScaleArea;
+    int m_nThreads = 1;
+    std::vector<QsBand> m_bands;
+    std::unique_ptr<QcForkJoin> m_pWorkers;
 };
@@ -1,43 +1,216 @@
 #include "FrameQueue.h"
 
-FrameQueue::FrameQueue()
+FrameQueue::FrameQueue(int capacity, int backend)
+	: m_capacity(capacity)
 {
+	if (backend == kLockFreeRing)
+		m_pRing = new QcSpscRing<AVFrameRef>(capacity);
+}
+
+FrameQueue::~FrameQueue()
+{
+	delete m_pRing;
+}
+
+//With the ring the caller comes in unlocked. A waiter registers itself under the mutex before it
+//checks its predicate, and _notify only signals when someone is registered, so the hot path stays lock free.
+void FrameQueue::_wait(std::unique_lock<std::mutex>& lock, int timeoutMs, const std::function<bool()>& ready)
+{
+	if (m_pRing == nullptr)
+	{
+		waitCondition(m_cond, lock, timeoutMs, ready);
+		return;
+	}
+	if (timeoutMs == 0 || ready())
+		return;
 
+	lock.lock();
+	++m_waiters;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	waitCondition(m_cond, lock, timeoutMs, ready);
+	--m_waiters;
+	lock.unlock();
 }
 
-bool FrameQueue::push(const AVFrameRef& frame)
+void FrameQueue::_notify()
 {
-	m_queue.push(frame);
+	if (m_wakeCb)
+		m_wakeCb();
+	if (m_pRing == nullptr)
+	{
+		m_cond.notify_all();
+		return;
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_waiters > 0)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_cond.notify_all();
+	}
+}
+
+bool FrameQueue::push(const AVFrameRef& frame, int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+	if (m_pRing == nullptr)
+		lock.lock();
+
+	uint32_t flushCount = m_flushCount;
+	_wait(lock, timeoutMs, [&] {
+		return _size() < m_capacity || flushCount != m_flushCount || isInterrupted();
+	});
+	if (_size() >= m_capacity || flushCount != m_flushCount || m_bAbort)
+		return false;
+
+	if (m_pRing)
+		m_pRing->push(frame);
+	else
+		m_queue.push(frame);
+	_notify();
 	return true;
 }
 
-bool FrameQueue::pop(AVFrameRef& frame)
+bool FrameQueue::pop(AVFrameRef& frame, int timeoutMs)
 {
-	if (m_queue.size())
+	std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+	if (m_pRing == nullptr)
+		lock.lock();
+
+	uint32_t flushCount = m_flushCount;
+	_wait(lock, timeoutMs, [&] {
+		return _size() > 0 || flushCount != m_flushCount || isInterrupted();
+	});
+	if (m_bAbort)
+		return false;
+
+	if (m_pRing)
+	{
+		if (!m_pRing->pop(frame))
+			return false;
+	}
+	else
 	{
+		if (m_queue.empty())
+			return false;
 		frame = m_queue.front();
 		m_queue.pop();
-		return true;
 	}
-	return false;
+	_notify();
+	return true;
+}
+
+bool FrameQueue::pop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+	if (m_pRing)
+	{
+		if (!m_pRing->pop())
+			return false;
+	}
+	else
+	{
+		lock.lock();
+		if (m_queue.empty())
+			return false;
+		m_queue.pop();
+	}
+	_notify();
+	return true;
 }
 
 bool FrameQueue::front(AVFrameRef& frame)
 {
-	if (m_queue.size())
+	const AVFrameRef* pFrame = peek();
+	if (pFrame)
 	{
-		frame = m_queue.front();
+		frame = *pFrame;
 		return true;
 	}
 	return false;
 }
 
+const AVFrameRef* FrameQueue::peek()
+{
+	if (m_pRing)
+		return m_pRing->front();
+
+	//std::queue keeps element addresses stable on push, and only the consumer pops.
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queue.empty() ? nullptr : &m_queue.front();
+}
+
+bool FrameQueue::waitForSpace(int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+	if (m_pRing == nullptr)
+		lock.lock();
+
+	uint32_t flushCount = m_flushCount;
+	_wait(lock, timeoutMs, [&] {
+		return _size() < m_capacity || flushCount != m_flushCount || isInterrupted();
+	});
+	return _size() < m_capacity;
+}
+
+//with the ring, clear() drains from the consumer side; the producer must not push concurrently with another thread clearing.
 void FrameQueue::clear()
 {
-	m_queue.swap(std::queue<AVFrameRef>());
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_pRing)
+	{
+		m_pRing->clear();
+	}
+	else
+	{
+		std::queue<AVFrameRef> empty;
+		m_queue.swap(empty);
+	}
+	++m_flushCount;
+	m_cond.notify_all();
+	if (m_wakeCb)
+		m_wakeCb();
 }
 
-int FrameQueue::size()
+void FrameQueue::abort()
 {
-	return m_queue.size();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bAbort = true;
+	m_cond.notify_all();
+	if (m_wakeCb)
+		m_wakeCb();
+}
+
+void FrameQueue::start()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bAbort = false;
+}
+
+void FrameQueue::wakeup()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_cond.notify_all();
+	if (m_wakeCb)
+		m_wakeCb();
+}
+
+void FrameQueue::setWakeCallback(std::function<void()>&& cb)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_wakeCb = std::move(cb);
+}
+
+void FrameQueue::setInterruptCallback(std::function<bool()>&& cb)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_interruptCb = std::move(cb);
+}
+
+int FrameQueue::size() const
+{
+	if (m_pRing)
+		return _size();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return _size();
 }
@@ -3,22 +3,59 @@
 #include "media_global.h"
 #include "QsMediaInfo.h"
 #include "AVFrameRef.h"
+#include "QcSpscRing.h"
 #include <queue>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 
-class FrameQueue
+//Bounded blocking queue of decoded frames.
+//push() blocks while the queue holds capacity frames, pop() waits up to timeoutMs for a frame.
+//kLockFreeRing keeps the frames in a QcSpscRing: push/peek/pop never lock, the mutex is only
+//taken by a side that has to wait. It requires one producer and one consumer thread.
+class MEDIA_API FrameQueue
 {
 public:
-	FrameQueue();
+	enum
+	{
+		kMutexQueue = 0,
+		kLockFreeRing,
+	};
+	FrameQueue(int capacity = 3, int backend = kMutexQueue);
+	~FrameQueue();
 
-	bool push(const AVFrameRef& packet);
-	bool pop(AVFrameRef& packet);
-	bool front(AVFrameRef& packet);
+	bool push(const AVFrameRef& frame, int timeoutMs = -1);
+	bool pop(AVFrameRef& frame, int timeoutMs = 0);
+	bool pop();
+	bool front(AVFrameRef& frame);
+	//the oldest frame without a copy, valid until the consumer pops it.
+	const AVFrameRef* peek();
+	bool waitForSpace(int timeoutMs);
 	void clear();
-	int size();
-
-	std::mutex& mutex() { return m_mutex; }
+	void abort();
+	void start();
+	void wakeup();
+	void setInterruptCallback(std::function<bool()>&& cb);
+	//called after every push, pop and wakeup, see PacketQueue::setWakeCallback(). Set it before the queue is used.
+	void setWakeCallback(std::function<void()>&& cb);
+	int size() const;
+	int capacity() const { return m_capacity; }
+	int backend() const { return m_pRing ? kLockFreeRing : kMutexQueue; }
+protected:
+	bool isInterrupted() const { return m_bAbort || (m_interruptCb && m_interruptCb()); }
+	int _size() const { return m_pRing ? (int)m_pRing->size() : (int)m_queue.size(); }
+	void _wait(std::unique_lock<std::mutex>& lock, int timeoutMs, const std::function<bool()>& ready);
+	void _notify();
 protected:
 	std::queue<AVFrameRef> m_queue;
-	std::mutex m_mutex;
+	QcSpscRing<AVFrameRef>* m_pRing = nullptr;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::function<bool()> m_interruptCb;
+	std::function<void()> m_wakeCb;
+	int m_capacity = 0;
+	std::atomic<int> m_waiters{ 0 };
+	std::atomic<uint32_t> m_flushCount{ 0 };
+	std::atomic<bool> m_bAbort{ false };
 };
\ No newline at end of file
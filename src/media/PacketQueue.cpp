@@ -12,35 +12,203 @@ extern "C" {
 #endif
 
 
-PacketQueue::PacketQueue()
+PacketQueue::PacketQueue(uint32_t maxBytes)
+    : m_lastDts(AV_NOPTS_VALUE)
 {
-
+    m_marks.maxBytes = maxBytes;
 }
 
-bool PacketQueue::push(const AVPacketPtr& packet)
+bool PacketQueue::push(const AVPacketPtr& packet, int serial, int timeoutMs)
 {
-    m_queue.push(packet);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitCondition(m_cond, lock, timeoutMs, [&] {
+        return _hasSpace() || serial != m_serial || isInterrupted();
+    });
+    //an interrupt only cuts the wait short, a flush drops the packet that belonged to the old position.
+    if (!_hasSpace() || serial != m_serial || m_bAbort)
+        return false;
+
+    int64_t duration = packet->duration;
+    if (duration <= 0 && packet->dts != AV_NOPTS_VALUE && m_lastDts != AV_NOPTS_VALUE && packet->dts > m_lastDts)
+        duration = packet->dts - m_lastDts;
+    if (packet->dts != AV_NOPTS_VALUE)
+        m_lastDts = packet->dts;
+    if (duration < 0)
+        duration = 0;
+
+    m_queue.push({ packet, duration });
     ++m_nb_packets;
     m_packetSize += packet->size;
+    m_duration += duration;
+    _updateFull();
+    _notify();
     return true;
 }
 
-bool PacketQueue::pop(AVPacketPtr& packet)
+bool PacketQueue::pop(AVPacketPtr& packet, int& serial, int timeoutMs)
 {
-    if (m_queue.size())
-    {
-        packet = m_queue.front();
-        m_packetSize -= packet->size;
-        --m_nb_packets;
-        m_queue.pop();
-        return true;
-    }
-    return false;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    int waitSerial = m_serial;
+    waitCondition(m_cond, lock, timeoutMs, [&] {
+        return !m_queue.empty() || m_bEnd || waitSerial != m_serial || isInterrupted();
+    });
+    if (m_queue.empty() || m_bAbort)
+        return false;
+
+    //a flush empties the queue, so whatever is queued belongs to the current serial.
+    serial = m_serial;
+    packet = m_queue.front().packet;
+    m_packetSize -= packet->size;
+    m_duration -= m_queue.front().duration;
+    --m_nb_packets;
+    m_queue.pop();
+    _updateFull();
+    _notify();
+    return true;
 }
 
-void PacketQueue::clear()
+void PacketQueue::flush(int serial)
 {
-    m_queue.swap(std::queue<AVPacketPtr>());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::queue<QsQueuedPacket> empty;
+    m_queue.swap(empty);
     m_nb_packets = 0;
     m_packetSize = 0;
+    m_duration = 0;
+    m_lastDts = AV_NOPTS_VALUE;
+    m_bFull = false;
+    m_bEnd = false;
+    m_serial = serial;
+    _notify();
+}
+
+void PacketQueue::abort()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bAbort = true;
+    _notify();
+}
+
+void PacketQueue::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bAbort = false;
+}
+
+void PacketQueue::wakeup()
+{
+    //taking the lock orders the notification after a waiter evaluated its predicate.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    _notify();
+}
+
+void PacketQueue::setEnd(bool bEnd, int serial)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    //the end of the stream read before a seek says nothing about the new position.
+    if (serial != m_serial)
+        return;
+    m_bEnd = bEnd;
+    _notify();
+}
+
+bool PacketQueue::isEnd()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bEnd && m_queue.empty();
+}
+
+void PacketQueue::setMaxSize(uint32_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_marks.maxBytes = maxBytes;
+    _updateFull();
+    _notify();
+}
+
+void PacketQueue::setWatermarks(const QsBufferWatermarks& marks)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_marks = marks;
+    _updateFull();
+    _notify();
+}
+
+QsBufferWatermarks PacketQueue::watermarks() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_marks;
+}
+
+void PacketQueue::setTimeBase(int num, int den)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tbNum = num;
+    m_tbDen = den;
+    _updateFull();
+    _notify();
+}
+
+void PacketQueue::setOverfill(bool bOverfill)
+{
+    if (m_bOverfill.exchange(bOverfill) == bOverfill || !bOverfill)
+        return;
+    //taking the lock orders the notification after a waiting push() evaluated its predicate.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    _notify();
+}
+
+bool PacketQueue::isHungry() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_bEnd && bufferedTime() < m_marks.lowMs;
+}
+
+int PacketQueue::bufferedTime() const
+{
+    int num = m_tbNum;
+    int den = m_tbDen;
+    if (num <= 0 || den <= 0)
+        return 0;
+    return (int)(m_duration * num * 1000 / den);
+}
+
+bool PacketQueue::_hasSpace() const
+{
+    //an empty queue always accepts one packet, whatever its size.
+    if (m_queue.empty())
+        return true;
+    if (m_packetSize >= m_marks.maxBytes)
+        return false;
+    return !m_bFull || m_bOverfill;
+}
+
+void PacketQueue::_updateFull()
+{
+    //full at the high watermark, refilled only once it drained below the low one.
+    int bufferedMs = bufferedTime();
+    if (m_packetSize >= m_marks.maxBytes || (m_marks.highMs > 0 && bufferedMs >= m_marks.highMs))
+        m_bFull = true;
+    else if (m_marks.highMs <= 0 || bufferedMs < m_marks.lowMs)
+        m_bFull = false;
+}
+
+void PacketQueue::setWakeCallback(std::function<void()>&& cb)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wakeCb = std::move(cb);
+}
+
+//called with the lock held.
+void PacketQueue::_notify()
+{
+    m_cond.notify_all();
+    if (m_wakeCb)
+        m_wakeCb();
+}
+
+void PacketQueue::setInterruptCallback(std::function<bool()>&& cb)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_interruptCb = std::move(cb);
 }
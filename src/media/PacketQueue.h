@@ -3,19 +3,75 @@
 #include "media_global.h"
 #include "QsMediaInfo.h"
 #include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
 
+//Bounded blocking queue between the demuxer thread and a decode thread.
+//push() blocks once the queue reaches the high watermark (duration or bytes) until it drains
+//below the low one, pop() blocks while it is empty.
+//Both return false when the queue is aborted, flushed or the interrupt callback fires.
+//Every flush starts a new serial: push() only accepts packets of the current serial and
+//pop() reports it, so data read before a seek never reaches the decoder as new data.
 class PacketQueue
 {
 public:
-	PacketQueue();
-	bool push(const AVPacketPtr& packet);
-	bool pop(AVPacketPtr& packet);
+	PacketQueue(uint32_t maxBytes = 8 * 1024 * 1024);
+	bool push(const AVPacketPtr& packet, int serial, int timeoutMs = -1);
+	bool pop(AVPacketPtr& packet, int& serial, int timeoutMs = 0);
 
-    void clear();
-    int packetCount() { return m_nb_packets; }
-    int packetSize() { return m_packetSize; }
+	void flush(int serial);
+	int serial() const { return m_serial; }
+	void abort();
+	void start();
+	void wakeup();
+	void setEnd(bool bEnd, int serial);
+	bool isEnd();
+	void setMaxSize(uint32_t maxBytes);
+	void setWatermarks(const QsBufferWatermarks& marks);
+	QsBufferWatermarks watermarks() const;
+	//packet durations are in this time base, bufferedTime() stays 0 until it is set.
+	void setTimeBase(int num, int den);
+	//lets push() go past the high duration watermark, up to maxBytes, while another stream starves.
+	void setOverfill(bool bOverfill);
+	//below the low watermark and more data is still to come.
+	bool isHungry() const;
+	void setInterruptCallback(std::function<bool()>&& cb);
+	//called under the queue lock whenever a waiter would be woken, lets a task scheduler resume
+	//the producer or consumer instead of a blocked thread. It must not call back into the queue.
+	void setWakeCallback(std::function<void()>&& cb);
+
+    //read without the lock for statistics.
+    int packetCount() const { return m_nb_packets; }
+    int packetSize() const { return m_packetSize; }
+	int bufferedTime() const;
+private:
+	struct QsQueuedPacket
+	{
+		AVPacketPtr packet;
+		int64_t duration;   //in the time base, estimated from the dts step when the packet has none
+	};
+	bool isInterrupted() const { return m_bAbort || (m_interruptCb && m_interruptCb()); }
+	bool _hasSpace() const;
+	void _updateFull();
+	void _notify();
 private:
-	std::queue<AVPacketPtr> m_queue;
-	uint32_t    m_nb_packets = 0;
-	uint32_t    m_packetSize = 0;
+	std::queue<QsQueuedPacket> m_queue;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::function<bool()> m_interruptCb;
+	std::function<void()> m_wakeCb;
+	std::atomic<uint32_t> m_nb_packets{ 0 };
+	std::atomic<uint32_t> m_packetSize{ 0 };
+	std::atomic<int64_t> m_duration{ 0 };
+	int64_t     m_lastDts;
+	std::atomic<int> m_tbNum{ 0 };
+	std::atomic<int> m_tbDen{ 0 };
+	QsBufferWatermarks m_marks;
+	bool        m_bFull = false;
+	std::atomic<bool> m_bOverfill{ false };
+	std::atomic<int> m_serial{ 0 };
+	bool        m_bAbort = false;
+	std::atomic<bool> m_bEnd{ false };
 };
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "QcAudioMixer.h"
+#include "QcAudioTransformat.h"
+#include "QsAudioMix.h"
+#include "AVFrameRef.h"
+#include "QcMirroredRingBuffer.h"
+#include "QcSpscRing.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace
+{
+	//timestamps this close to where an input's last packet ended continue it without a gap.
+	const int kJitterMs = 10;
+	//packets an input can queue, a capture period is rarely under 3ms.
+	const int kMaxPackets = 1024;
+	const int64_t kNoIndex = INT64_MIN;
+}
+
+//a run of an input's frames in its sample ring, frame index is where it plays in the output.
+struct QsMixerPacket
+{
+	int64_t index = 0;
+	int frames = 0;
+};
+
+struct QsMixerInput
+{
+	QsMixerInput(size_t bytes)
+		: samples(bytes)
+		, packets(kMaxPackets)
+	{
+	}
+
+	std::atomic<bool> bActive{ true };
+	std::atomic<float> gain{ 1.0f };
+	std::atomic<bool> bMute{ false };
+
+	//producer side
+	QsAudioPara srcPara;
+	QcAudioTransformat transformat;
+	AVFrameRef converted;
+	int64_t nextIndex = kNoIndex;
+	std::atomic<int64_t> endIndex{ kNoIndex };
+
+	//interleaved floats in the output format, and the packets that cut them up.
+	QcMirroredRingBuffer samples;
+	QcSpscRing<QsMixerPacket> packets;
+
+	std::atomic<uint64_t> mixedFrames{ 0 };
+	std::atomic<uint64_t> silentFrames{ 0 };
+	std::atomic<uint64_t> lateFrames{ 0 };
+	std::atomic<uint64_t> overflowFrames{ 0 };
+};
+
+QcAudioMixer::QcAudioMixer()
+{
+
+}
+
+QcAudioMixer::~QcAudioMixer()
+{
+
+}
+
+bool QcAudioMixer::init(int sampleRate, int nChannels, int bufferMs)
+{
+	if (sampleRate <= 0 || nChannels <= 0 || nChannels > QmAudioPlanes || bufferMs <= 0)
+		return false;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& pInput : m_inputs)
+		pInput.reset();
+	m_para.sampleRate = sampleRate;
+	m_para.sampleFormat = eSampleFormatFloat;
+	m_para.nChannels = nChannels;
+	m_bufferFrames = (int)((int64_t)sampleRate * bufferMs / 1000);
+	m_jitterFrames = sampleRate * kJitterMs / 1000;
+	m_origin.store(kNoOrigin, std::memory_order_relaxed);
+	m_mixIndex = 0;
+	m_limiterGain = 1.0f;
+	return true;
+}
+
+const QsAudioPara& QcAudioMixer::outPara() const
+{
+	return m_para;
+}
+
+int QcAudioMixer::addInput()
+{
+	if (m_bufferFrames <= 0)
+		return -1;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < kMaxInputs; ++i)
+	{
+		if (m_inputs[i] && m_inputs[i]->bActive.load(std::memory_order_relaxed))
+			continue;
+		std::unique_ptr<QsMixerInput> pInput(new QsMixerInput((size_t)m_bufferFrames * m_para.nChannels * sizeof(float)));
+		if (!pInput->samples.isValid())
+			return -1;
+		m_inputs[i] = std::move(pInput);
+		return i;
+	}
+	return -1;
+}
+
+void QcAudioMixer::removeInput(int id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (id >= 0 && id < kMaxInputs && m_inputs[id])
+		m_inputs[id]->bActive.store(false, std::memory_order_release);
+}
+
+void QcAudioMixer::setGain(int id, float gain)
+{
+	if (id >= 0 && id < kMaxInputs && m_inputs[id])
+		m_inputs[id]->gain.store(gain, std::memory_order_relaxed);
+}
+
+void QcAudioMixer::setMute(int id, bool bMute)
+{
+	if (id >= 0 && id < kMaxInputs && m_inputs[id])
+		m_inputs[id]->bMute.store(bMute, std::memory_order_relaxed);
+}
+
+QsMixerInputStats QcAudioMixer::inputStats(int id) const
+{
+	QsMixerInputStats stats;
+	if (id >= 0 && id < kMaxInputs && m_inputs[id])
+	{
+		const QsMixerInput& input = *m_inputs[id];
+		stats.mixedFrames = input.mixedFrames.load(std::memory_order_relaxed);
+		stats.silentFrames = input.silentFrames.load(std::memory_order_relaxed);
+		stats.lateFrames = input.lateFrames.load(std::memory_order_relaxed);
+		stats.overflowFrames = input.overflowFrames.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+int64_t QcAudioMixer::toFrameIndex(int64_t timestamp) const
+{
+	int64_t delta = timestamp - m_origin.load(std::memory_order_acquire);
+	int64_t scaled = delta * m_para.sampleRate;
+	return (scaled + (scaled < 0 ? -500000 : 500000)) / 1000000;
+}
+
+bool QcAudioMixer::pushAudio(int id, const QsAudioData* data)
+{
+	if (id < 0 || id >= kMaxInputs || data == nullptr || data->frames == 0)
+		return false;
+	QsMixerInput* pInput = m_inputs[id].get();
+	if (pInput == nullptr || !pInput->bActive.load(std::memory_order_acquire))
+		return false;
+
+	QsAudioPara para;
+	para.sampleRate = data->sampleRate;
+	para.sampleFormat = data->sampleFormat;
+	para.nChannels = data->nChannels;
+	const float* samples = (const float*)data->data[0];
+	int frames = (int)data->frames;
+	if (para != m_para)
+	{
+		if (para != pInput->srcPara)
+		{
+			if (!pInput->transformat.init(para, m_para))
+				return false;
+			pInput->srcPara = para;
+		}
+		//a resampler may keep the whole packet back for now.
+		if (!pInput->transformat.transformat(data->data, frames, pInput->converted))
+			return true;
+		samples = (const float*)pInput->converted.data(0);
+		frames = pInput->converted.sampleCount();
+	}
+
+	//the first timestamp any input pushes becomes output frame 0.
+	int64_t origin = kNoOrigin;
+	m_origin.compare_exchange_strong(origin, (int64_t)data->timestamp, std::memory_order_acq_rel);
+	int64_t index = toFrameIndex((int64_t)data->timestamp);
+	if (pInput->nextIndex != kNoIndex && index - pInput->nextIndex <= m_jitterFrames && pInput->nextIndex - index <= m_jitterFrames)
+		index = pInput->nextIndex;
+	pInput->nextIndex = index + frames;
+
+	//the packet slot is checked first, so samples are only committed when their packet goes in too.
+	size_t bytes = (size_t)frames * m_para.nChannels * sizeof(float);
+	size_t usable = 0;
+	char* dst = pInput->samples.acquireWrite(usable);
+	if (usable < bytes || pInput->packets.size() >= pInput->packets.capacity())
+	{
+		pInput->overflowFrames.fetch_add(frames, std::memory_order_relaxed);
+		return false;
+	}
+	memcpy(dst, samples, bytes);
+	pInput->samples.commitWrite(bytes);
+	QsMixerPacket packet;
+	packet.index = index;
+	packet.frames = frames;
+	pInput->packets.push(packet);
+	pInput->endIndex.store(index + frames, std::memory_order_release);
+	return true;
+}
+
+int QcAudioMixer::readyFrames(int latencyMs)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int64_t lead = kNoIndex;
+	for (auto& pInput : m_inputs)
+	{
+		if (pInput && pInput->bActive.load(std::memory_order_acquire))
+			lead = std::max<int64_t>(lead, pInput->endIndex.load(std::memory_order_acquire));
+	}
+	if (lead == kNoIndex)
+		return 0;
+	int64_t ready = lead - (int64_t)m_para.sampleRate * latencyMs / 1000 - m_mixIndex;
+	return (int)std::min<int64_t>(std::max<int64_t>(ready, 0), INT32_MAX);
+}
+
+bool QcAudioMixer::mix(float* dst, int nFrames)
+{
+	if (nFrames <= 0 || m_origin.load(std::memory_order_acquire) == kNoOrigin)
+		return false;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	memset(dst, 0, (size_t)nFrames * m_para.nChannels * sizeof(float));
+	for (auto& pInput : m_inputs)
+	{
+		if (pInput && pInput->bActive.load(std::memory_order_acquire))
+			mixInput(*pInput, dst, nFrames);
+	}
+	if (m_bLimiter)
+		limit(dst, nFrames * m_para.nChannels);
+	m_mixIndex += nFrames;
+	return true;
+}
+
+int64_t QcAudioMixer::timestamp() const
+{
+	int64_t origin = m_origin.load(std::memory_order_acquire);
+	if (origin == kNoOrigin)
+		return 0;
+	return origin + m_mixIndex * 1000000 / m_para.sampleRate;
+}
+
+void QcAudioMixer::mixInput(QsMixerInput& input, float* dst, int nFrames)
+{
+	int nChannels = m_para.nChannels;
+	float gain = input.bMute.load(std::memory_order_relaxed) ? 0.0f : input.gain.load(std::memory_order_relaxed);
+	int64_t pos = m_mixIndex;
+	int64_t end = m_mixIndex + nFrames;
+	uint64_t mixed = 0;
+	uint64_t silent = 0;
+	uint64_t late = 0;
+	while (pos < end)
+	{
+		QsMixerPacket* pPacket = input.packets.front();
+		if (pPacket == nullptr)
+			break;
+		size_t available = 0;
+		const float* src = (const float*)input.samples.acquireRead(available);
+		int n = 0;
+		if (pPacket->index < pos)
+		{
+			//frames the mix has already passed, they went out as silence.
+			n = (int)std::min<int64_t>(pos - pPacket->index, pPacket->frames);
+			late += n;
+		}
+		else
+		{
+			if (pPacket->index >= end)
+				break;
+			silent += pPacket->index - pos;
+			pos = pPacket->index;
+			n = (int)std::min<int64_t>(pPacket->frames, end - pos);
+			if (gain != 0.0f)
+				audio::MixAdd(dst + (pos - m_mixIndex) * nChannels, src, n * nChannels, gain);
+			mixed += n;
+			pos += n;
+		}
+		input.samples.commitRead((size_t)n * nChannels * sizeof(float));
+		pPacket->index += n;
+		pPacket->frames -= n;
+		if (pPacket->frames == 0)
+			input.packets.pop();
+	}
+	silent += end - pos;
+	input.mixedFrames.fetch_add(mixed, std::memory_order_relaxed);
+	input.silentFrames.fetch_add(silent, std::memory_order_relaxed);
+	input.lateFrames.fetch_add(late, std::memory_order_relaxed);
+}
+
+void QcAudioMixer::setLimiter(bool bEnable, float threshold, int releaseMs)
+{
+	m_bLimiter = bEnable;
+	m_threshold = threshold > 0.0f && threshold < 1.0f ? threshold : 0.89f;
+	m_releaseMs = (float)(releaseMs > 0 ? releaseMs : 1);
+}
+
+void QcAudioMixer::limit(float* dst, int nSamples)
+{
+	//the gain needed to bring this block's peak to the threshold is reached within the block, going
+	//back up towards 1 it only moves by the release's share of the block.
+	float peak = audio::PeakLevel(dst, nSamples);
+	float wanted = peak > m_threshold ? m_threshold / peak : 1.0f;
+	float gain0 = m_limiterGain;
+	float gain1 = wanted;
+	if (wanted > gain0)
+	{
+		float blockMs = (float)nSamples / m_para.nChannels * 1000.0f / m_para.sampleRate;
+		gain1 = gain0 + (wanted - gain0) * (1.0f - expf(-blockMs / m_releaseMs));
+	}
+	audio::SoftLimit(dst, nSamples, gain0, gain1, m_threshold);
+	m_limiterGain = gain1;
+}
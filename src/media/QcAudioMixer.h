@@ -0,0 +1,81 @@
+#pragma once
+
+#include "media_global.h"
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "QsAudiodef.h"
+
+struct QsMixerInput;
+
+struct QsMixerInputStats
+{
+	uint64_t mixedFrames = 0;
+	uint64_t silentFrames = 0;      //mixed as silence, the input had nothing for them yet
+	uint64_t lateFrames = 0;        //arrived after the mix had passed their timestamp
+	uint64_t overflowFrames = 0;    //pushed while the input's buffer was full
+};
+
+//Mixes any number of timestamped streams (microphone, loopback, file playback) into one interleaved
+//float track at the output rate and channel count, followed by a soft limiter.
+//Each input has one producer thread calling pushAudio(), which converts to the output format and
+//queues the samples at the position QsAudioData::timestamp gives them, without locks. mix() runs on
+//one other thread: inputs with nothing buffered for the block add silence, samples that arrive
+//after their block has been mixed are dropped, so a stalled input never holds back the others.
+class MEDIA_API QcAudioMixer
+{
+public:
+	enum { kMaxInputs = 64 };
+
+	QcAudioMixer();
+	~QcAudioMixer();
+
+	//bufferMs of audio is the most an input can queue ahead of the mix.
+	bool init(int sampleRate, int nChannels, int bufferMs = 1000);
+	const QsAudioPara& outPara() const;
+
+	//-1 when kMaxInputs are in use. An input must not be pushed to once it is removed.
+	int addInput();
+	void removeInput(int id);
+	void setGain(int id, float gain);
+	void setMute(int id, bool bMute);
+	QsMixerInputStats inputStats(int id) const;
+
+	//data->timestamp is in microseconds, on a clock every input shares. Timestamps within a few ms
+	//of where the input's last packet ended are taken as contiguous, capture clocks jitter.
+	bool pushAudio(int id, const QsAudioData* data);
+
+	//frames the leading input is ahead of the mix, less latencyMs; mixing no more than that gives
+	//the other inputs latencyMs to catch up before they are filled with silence.
+	int readyFrames(int latencyMs);
+	//mixes nFrames interleaved frames into dst, false until some input has been pushed to.
+	bool mix(float* dst, int nFrames);
+	//timestamp of the next frame mix() produces, in the inputs' microseconds. Mix thread.
+	int64_t timestamp() const;
+
+	//peaks are ridden down to threshold (0..1) and released over releaseMs, what still overshoots
+	//is bent under full scale. Mix thread, or before mixing starts.
+	void setLimiter(bool bEnable, float threshold = 0.89f, int releaseMs = 200);
+protected:
+	int64_t toFrameIndex(int64_t timestamp) const;
+	void mixInput(QsMixerInput& input, float* dst, int nFrames);
+	void limit(float* dst, int nSamples);
+private:
+	QsAudioPara m_para;
+	int m_bufferFrames = 0;
+	int m_jitterFrames = 0;
+	std::unique_ptr<QsMixerInput> m_inputs[kMaxInputs];
+	//addInput/removeInput against mix().
+	std::mutex m_mutex;
+
+	static const int64_t kNoOrigin = INT64_MIN;
+	//timestamp of frame 0, the first timestamp any input pushed.
+	std::atomic<int64_t> m_origin{ kNoOrigin };
+	int64_t m_mixIndex = 0;
+
+	bool m_bLimiter = true;
+	float m_threshold = 0.89f;
+	float m_releaseMs = 200;
+	float m_limiterGain = 1.0f;
+};
@@ -1,11 +1,31 @@
 #include "QcAudioPlayer.h"
+#ifdef _WIN32
 #include "wasapi/WASAPIPlayer.h"
 
+typedef WASAPIPlayer QcAudioOutput;
+#else
+//no audio device backend off windows yet; open() fails and the player falls back to the external clock.
+class QcAudioOutput
+{
+public:
+    bool init(const wchar_t*, const QsAudioPara* = nullptr, QsAudioPara* = nullptr) { return false; }
+    bool start() { return false; }
+    void stop() {}
+    void playAudio(const uint8_t*, int) {}
+    int pendingTime() { return -1; }
+    void SetVolume(float fVolume) { m_fVolume = fVolume; }
+    float Volume() const { return m_fVolume; }
+
+private:
+    float m_fVolume = 1.0f;
+};
+#endif
+
 struct QcAudioPlayerPrivate
 {
     bool m_isOpen = false;
     QsAudioPara m_openParas;
-    std::unique_ptr<WASAPIPlayer> m_player;
+    std::unique_ptr<QcAudioOutput> m_player;
 };
 
 QcAudioPlayer::QcAudioPlayer()
@@ -22,7 +42,7 @@ QcAudioPlayer::~QcAudioPlayer()
 bool QcAudioPlayer::open(const wchar_t* deviceID, const QsAudioPara* para, QsAudioPara* pClosestMatch)
 {
 	close();
-    m_ptr->m_player.reset(new WASAPIPlayer());
+    m_ptr->m_player.reset(new QcAudioOutput());
     m_ptr->m_isOpen = m_ptr->m_player->init(deviceID, para, pClosestMatch);
 	if (m_ptr->m_isOpen)
 	{
@@ -71,6 +91,13 @@ void QcAudioPlayer::playAudio(const uint8_t* pcm, int nSamples)
 	}   
 }
 
+int QcAudioPlayer::pendingTime() const
+{
+    if (m_ptr->m_player && m_ptr->m_isOpen)
+        return m_ptr->m_player->pendingTime();
+    return -1;
+}
+
 void QcAudioPlayer::setVolume(float fVolume)
 {
     if (m_ptr->m_player)
@@ -22,6 +22,8 @@ public:
 	void close();
 	
 	void playAudio(const uint8_t* pcm, int nSamples);
+	//ms of played audio still waiting in the output, -1 when not open.
+	int pendingTime() const;
 	void setVolume(float fVolume);
     float volume() const;
 protected:
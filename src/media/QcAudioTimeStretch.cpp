@@ -0,0 +1,205 @@
+#include "QcAudioTimeStretch.h"
+#include "QcMirroredRingBuffer.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define QmStretchSSE 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define QmStretchNEON 1
+#endif
+
+//segment overlap and search range; 20ms covers a period of any voice or instrument above 50Hz.
+static const int kOverlapMs = 20;
+static const int kSearchMs = 10;
+//the search first visits every kCoarseStep-th offset, then refines around the best one.
+static const int kCoarseStep = 4;
+static const double kPi = 3.14159265358979323846;
+
+namespace
+{
+	//dot product of a and b plus the energy of b, the inner loop of the search.
+	void correlate(const float* a, const float* b, int n, float& dot, float& energy)
+	{
+		int i = 0;
+		float sumDot = 0;
+		float sumEnergy = 0;
+#if defined(QmStretchSSE)
+		__m128 vDot = _mm_setzero_ps();
+		__m128 vEnergy = _mm_setzero_ps();
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128 a0 = _mm_loadu_ps(a + i);
+			__m128 a1 = _mm_loadu_ps(a + i + 4);
+			__m128 b0 = _mm_loadu_ps(b + i);
+			__m128 b1 = _mm_loadu_ps(b + i + 4);
+			vDot = _mm_add_ps(vDot, _mm_add_ps(_mm_mul_ps(a0, b0), _mm_mul_ps(a1, b1)));
+			vEnergy = _mm_add_ps(vEnergy, _mm_add_ps(_mm_mul_ps(b0, b0), _mm_mul_ps(b1, b1)));
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, vDot);
+		sumDot = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_ps(lanes, vEnergy);
+		sumEnergy = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(QmStretchNEON)
+		float32x4_t vDot = vdupq_n_f32(0);
+		float32x4_t vEnergy = vdupq_n_f32(0);
+		for (; i + 4 <= n; i += 4)
+		{
+			float32x4_t va = vld1q_f32(a + i);
+			float32x4_t vb = vld1q_f32(b + i);
+			vDot = vmlaq_f32(vDot, va, vb);
+			vEnergy = vmlaq_f32(vEnergy, vb, vb);
+		}
+		float lanes[4];
+		vst1q_f32(lanes, vDot);
+		sumDot = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		vst1q_f32(lanes, vEnergy);
+		sumEnergy = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+		for (; i < n; ++i)
+		{
+			sumDot += a[i] * b[i];
+			sumEnergy += b[i] * b[i];
+		}
+		dot = sumDot;
+		energy = sumEnergy;
+	}
+}
+
+QcAudioTimeStretch::QcAudioTimeStretch()
+	: m_input(new QcMirroredRingBuffer())
+{
+}
+
+QcAudioTimeStretch::~QcAudioTimeStretch()
+{
+}
+
+void QcAudioTimeStretch::init(int sampleRate, int nChannels)
+{
+	m_nChannels = nChannels;
+	m_overlap = std::max<int>(1, sampleRate * kOverlapMs / 1000);
+	m_searchRange = sampleRate * kSearchMs / 1000;
+	m_fadeIn.resize(m_overlap);
+	for (int i = 0; i < m_overlap; ++i)
+		m_fadeIn[i] = 0.5f - 0.5f * (float)cos(kPi * (i + 0.5) / m_overlap);
+	reset();
+}
+
+void QcAudioTimeStretch::setRate(double rate)
+{
+	m_rate = rate > 0 ? rate : 1.0;
+}
+
+void QcAudioTimeStretch::reset()
+{
+	m_input->clear();
+	m_analysisPos = 0;
+	m_tailPos = 0;
+}
+
+int QcAudioTimeStretch::latency() const
+{
+	return m_nChannels > 0 ? _inputFrames() - m_tailPos : 0;
+}
+
+const float* QcAudioTimeStretch::_input() const
+{
+	size_t available = 0;
+	return (const float*)m_input->acquireRead(available);
+}
+
+int QcAudioTimeStretch::_inputFrames() const
+{
+	return (int)(m_input->size() / (sizeof(float) * m_nChannels));
+}
+
+int QcAudioTimeStretch::process(const float* in, int nFrames, std::vector<float>& out)
+{
+	if (m_nChannels <= 0)
+		return 0;
+	size_t bytes = (size_t)nFrames * m_nChannels * sizeof(float);
+	if (!m_input->ensureCapacity(m_input->size() + bytes))
+		return 0;
+	m_input->write((const char*)in, bytes);
+
+	int produced = 0;
+	int inputFrames = _inputFrames();
+	const float* input = _input();
+	for (;;)
+	{
+		int target = (int)m_analysisPos;
+		if (std::max<int>(m_tailPos, target + m_searchRange) + m_overlap > inputFrames)
+			break;
+
+		int best = _search(target);
+		const float* tail = input + (size_t)m_tailPos * m_nChannels;
+		const float* segment = input + (size_t)best * m_nChannels;
+		size_t outPos = out.size();
+		out.resize(outPos + (size_t)m_overlap * m_nChannels);
+		float* dst = &out[outPos];
+		for (int i = 0; i < m_overlap; ++i)
+		{
+			float fadeIn = m_fadeIn[i];
+			for (int c = 0; c < m_nChannels; ++c)
+			{
+				int index = i * m_nChannels + c;
+				dst[index] = tail[index] + (segment[index] - tail[index]) * fadeIn;
+			}
+		}
+		produced += m_overlap;
+		m_tailPos = best + m_overlap;
+		m_analysisPos += m_overlap * m_rate;
+	}
+
+	//the next search never looks further back than this.
+	int drop = std::min<int>(m_tailPos, std::max<int>(0, (int)m_analysisPos - m_searchRange));
+	if (drop > 0)
+	{
+		m_input->commitRead((size_t)drop * m_nChannels * sizeof(float));
+		m_tailPos -= drop;
+		m_analysisPos -= drop;
+	}
+	return produced;
+}
+
+int QcAudioTimeStretch::_search(int target) const
+{
+	int first = std::max<int>(0, target - m_searchRange);
+	int last = target + m_searchRange;
+	const float* input = _input();
+	const float* tail = input + (size_t)m_tailPos * m_nChannels;
+	int n = m_overlap * m_nChannels;
+	auto score = [&](int pos) {
+		float dot = 0;
+		float energy = 0;
+		correlate(tail, input + (size_t)pos * m_nChannels, n, dot, energy);
+		return dot / sqrtf(energy + 1e-9f);
+	};
+
+	int best = target;
+	float bestScore = -1e30f;
+	for (int pos = first; pos <= last; pos += kCoarseStep)
+	{
+		float s = score(pos);
+		if (s > bestScore)
+		{
+			bestScore = s;
+			best = pos;
+		}
+	}
+	int coarse = best;
+	for (int pos = std::max<int>(first, coarse - kCoarseStep + 1); pos <= std::min<int>(last, coarse + kCoarseStep - 1); ++pos)
+	{
+		float s = score(pos);
+		if (s > bestScore)
+		{
+			bestScore = s;
+			best = pos;
+		}
+	}
+	return best;
+}
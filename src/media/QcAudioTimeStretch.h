@@ -0,0 +1,42 @@
+#pragma once
+
+#include "media_global.h"
+#include <vector>
+#include <memory>
+
+class QcMirroredRingBuffer;
+
+//WSOLA time-stretch of interleaved float audio, the pitch stays where it is. Each step crossfades the
+//natural continuation of the last segment with the input segment around the ideal position that
+//correlates best with it, so rate 1 reproduces the input and other rates drop or repeat whole periods.
+class MEDIA_API QcAudioTimeStretch
+{
+public:
+	QcAudioTimeStretch();
+	~QcAudioTimeStretch();
+
+	void init(int sampleRate, int nChannels);
+	//input frames consumed per output frame, 2 plays twice as fast.
+	void setRate(double rate);
+	double rate() const { return m_rate; }
+	void reset();
+	//appends the stretched output to out, returns the frames appended.
+	int process(const float* in, int nFrames, std::vector<float>& out);
+	//input frames taken in but not yet reflected in the output.
+	int latency() const;
+private:
+	int _search(int target) const;
+	const float* _input() const;
+	int _inputFrames() const;
+private:
+	int m_nChannels = 0;
+	int m_overlap = 0;          //frames crossfaded per step, also the output per step
+	int m_searchRange = 0;      //frames searched around the ideal position each way
+	double m_rate = 1.0;
+	//interleaved floats, everything before the tail has been dropped. The mirror keeps the window
+	//contiguous, so dropping is a position update instead of moving what is left to the front.
+	std::unique_ptr<QcMirroredRingBuffer> m_input;
+	std::vector<float> m_fadeIn;
+	double m_analysisPos = 0;   //ideal start of the next segment in m_input
+	int m_tailPos = 0;          //natural continuation of the last segment in m_input
+};
@@ -1,8 +1,29 @@
 ﻿#include "QcAudioTransformat.h"
 #include "FFmpegUtils.h"
 #include "AVFrameRef.h"
+#include "QsAudioConvert.h"
 extern "C" {
 #include <libswresample/swresample.h>
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace
+{
+	//frames the converter writes into when the caller's frame is shared, so a consumer that holds on
+	//to a few output frames (a queue, the stretcher's output) does not make every call allocate.
+	const int kArenaFrames = 4;
+
+	//samples frame's buffers hold, 0 when it has another layout or its buffers are shared.
+	int frameCapacity(AVFrameRef& frame, AVSampleFormat format, int nChannel)
+	{
+		if (!frame || frame.format() != format || frame.channelCount() != nChannel || !av_frame_is_writable(frame))
+			return 0;
+		int bytesPerSample = av_get_bytes_per_sample(format);
+		if (!av_sample_fmt_is_planar(format))
+			bytesPerSample *= nChannel;
+		return bytesPerSample > 0 ? frame.linesize(0) / bytesPerSample : 0;
+	}
 }
 
 struct QcAudioTransformatPrivate
@@ -10,6 +31,9 @@ struct QcAudioTransformatPrivate
     QsAudioPara m_srcInfo;
     QsAudioPara m_dstInfo;
     SwrContext * m_pSwsCtx = nullptr;
+    //same rate conversions run through audio::ConvertDirect, swr is only set up to resample.
+    bool m_bDirect = false;
+    AVFrameRef m_arena[kArenaFrames];
 };
 
 QcAudioTransformat::QcAudioTransformat()
@@ -36,6 +60,13 @@ void QcAudioTransformat::CloseSwrContext()
 bool QcAudioTransformat::init(const QsAudioPara& sourceInfo, const QsAudioPara& destInfo)
 {
 	CloseSwrContext();
+	m_ptr->m_bDirect = audio::CanConvertDirect(sourceInfo, destInfo);
+	if (m_ptr->m_bDirect)
+	{
+		m_ptr->m_srcInfo = sourceInfo;
+		m_ptr->m_dstInfo = destInfo;
+		return true;
+	}
 	int64_t iSrcChannelLayout = av_get_default_channel_layout(sourceInfo.nChannels);
 	int64_t iDestChannelLayout = av_get_default_channel_layout(destInfo.nChannels);
 	AVSampleFormat iSrcSampleFormat = (AVSampleFormat)FFmpegUtils::ToFFmpegAudioFormat(sourceInfo.sampleFormat);
@@ -63,21 +94,78 @@ int QcAudioTransformat::getDelaySamples()
 	return 0;
 }
 
-bool QcAudioTransformat::transformat(const uint8_t* const srcData[], int srcSamples, AVFrameRef& outFrame)
+bool QcAudioTransformat::prepareOutFrame(AVFrameRef& outFrame, int nb_samples)
 {
-	if (m_ptr->m_pSwsCtx == nullptr)
+	int dstChannel = m_ptr->m_dstInfo.nChannels;
+	AVSampleFormat iDestSampleFormat = (AVSampleFormat)FFmpegUtils::ToFFmpegAudioFormat(m_ptr->m_dstInfo.sampleFormat);
+	//the caller's frame while nobody else holds it, nb_samples only tells what the last call wrote.
+	bool bArena = false;
+	for (AVFrameRef& frame : m_ptr->m_arena)
+	{
+		if (outFrame && (const AVFrame*)frame == (const AVFrame*)outFrame)
+			bArena = true;
+	}
+	if (outFrame.useCount() == (bArena ? 2 : 1) && frameCapacity(outFrame, iDestSampleFormat, dstChannel) >= nb_samples)
+		return true;
+
+	//outFrame's own reference is replaced below, it does not keep an arena frame busy.
+	AVFrameRef* pFree = nullptr;
+	for (AVFrameRef& frame : m_ptr->m_arena)
+	{
+		int users = frame.useCount();
+		if (outFrame && (const AVFrame*)frame == (const AVFrame*)outFrame)
+			--users;
+		if (users > 1)
+			continue;
+		if (frameCapacity(frame, iDestSampleFormat, dstChannel) >= nb_samples)
+		{
+			outFrame = frame;
+			return true;
+		}
+		if (pFree == nullptr)
+			pFree = &frame;
+	}
+	//some headroom, packets of a stream vary a little in length.
+	AVFrameRef frame = AVFrameRef::allocAudioFrame(nb_samples + nb_samples / 4, dstChannel, iDestSampleFormat);
+	if (frame.data(0) == nullptr)
 		return false;
-	int dstNum = swr_get_out_samples(m_ptr->m_pSwsCtx, srcSamples);
+	if (pFree)
+		*pFree = frame;
+	outFrame = frame;
+	return true;
+}
 
-    int dstChannel = m_ptr->m_dstInfo.nChannels;
-	AVSampleFormat iDestSampleFormat = (AVSampleFormat)FFmpegUtils::ToFFmpegAudioFormat(m_ptr->m_dstInfo.sampleFormat);
-	if (!(outFrame.format() == iDestSampleFormat
-		&& outFrame.channelCount() == dstChannel
-		&& outFrame.sampleCount() > dstNum) )
+bool QcAudioTransformat::transformat(const uint8_t* const srcData[], int srcSamples, AVFrameRef& outFrame)
+{
+	if (m_ptr->m_bDirect)
 	{
-		outFrame = AVFrameRef::allocAudioFrame(dstNum, dstChannel, iDestSampleFormat);
+		if (srcSamples <= 0 || !prepareOutFrame(outFrame, srcSamples))
+			return false;
+		const QsAudioPara& src = m_ptr->m_srcInfo;
+		const QsAudioPara& dst = m_ptr->m_dstInfo;
+		audio::ConvertDirect(srcData, src.sampleFormat, src.nChannels, outFrame->data, dst.sampleFormat, dst.nChannels, srcSamples);
+		outFrame->nb_samples = srcSamples;
+		return true;
 	}
+	if (m_ptr->m_pSwsCtx == nullptr)
+		return false;
+	int dstNum = swr_get_out_samples(m_ptr->m_pSwsCtx, srcSamples);
+	if (!prepareOutFrame(outFrame, dstNum))
+		return false;
 	int nCount = swr_convert(m_ptr->m_pSwsCtx, outFrame->data, dstNum, (const uint8_t**)srcData, srcSamples);
 	outFrame->nb_samples = nCount;
 	return nCount > 0;
 }
+
+bool QcAudioTransformat::flush(AVFrameRef& outFrame)
+{
+	//the direct path never holds samples back.
+	if (m_ptr->m_pSwsCtx == nullptr)
+		return false;
+	int dstNum = swr_get_out_samples(m_ptr->m_pSwsCtx, 0);
+	if (dstNum <= 0 || !prepareOutFrame(outFrame, dstNum))
+		return false;
+	int nCount = swr_convert(m_ptr->m_pSwsCtx, outFrame->data, dstNum, NULL, 0);
+	outFrame->nb_samples = nCount > 0 ? nCount : 0;
+	return nCount > 0;
+}
@@ -19,9 +19,14 @@ public:
     const QsAudioPara& srcPara() const;
     const QsAudioPara& dstPara() const;
 	int getDelaySamples();
+	//outFrame is reused while nobody else holds it, otherwise the samples land in one of the
+	//converter's own frames that the consumers have let go of.
 	bool transformat(const uint8_t* const data[], int nb_samples, AVFrameRef& outFrame);
+	//the getDelaySamples() a resampler still holds, at the end of a stream. False when there are none.
+	bool flush(AVFrameRef& outFrame);
 protected:
 	void CloseSwrContext();
+	bool prepareOutFrame(AVFrameRef& outFrame, int nb_samples);
 protected:
     QcAudioTransformatPrivate* m_ptr;
 };
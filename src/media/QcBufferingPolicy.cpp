@@ -0,0 +1,66 @@
+#include "QcBufferingPolicy.h"
+#include "PacketQueue.h"
+#include <algorithm>
+
+namespace
+{
+	struct QsModeLimits
+	{
+		int lowMs;
+		int highMs;
+		uint32_t minBytes;
+		uint32_t maxBytes;
+	};
+
+	//indexed by QeBufferingMode, video then audio.
+	const QsModeLimits kModeLimits[][2] =
+	{
+		{ { 1000, 3000, 4 * 1024 * 1024, 192 * 1024 * 1024 }, { 1000, 5000, 256 * 1024, 16 * 1024 * 1024 } },
+		{ { 150, 800, 1024 * 1024, 32 * 1024 * 1024 }, { 150, 800, 64 * 1024, 2 * 1024 * 1024 } },
+		{ { 500, 1500, 1024 * 1024, 12 * 1024 * 1024 }, { 500, 2000, 64 * 1024, 1024 * 1024 } },
+	};
+
+	//read-ahead cache size and how far it runs ahead of the demuxer, per mode.
+	const int kReadAhead[][2] =
+	{
+		{ 32 * 1024 * 1024, 16 * 1024 * 1024 },
+		{ 2 * 1024 * 1024, 1024 * 1024 },
+		{ 4 * 1024 * 1024, 2 * 1024 * 1024 },
+	};
+
+	//the byte cap leaves room for bitrate peaks above the average the container reports.
+	const int kBitRateHeadroom = 2;
+}
+
+void QcBufferingPolicy::setMode(int mode)
+{
+	if (mode >= eBufferLocalFile && mode <= eBufferLowMemory)
+		m_mode = mode;
+}
+
+QsBufferWatermarks QcBufferingPolicy::watermarks(bool bVideo, int64_t bitRate) const
+{
+	const QsModeLimits& limits = kModeLimits[m_mode][bVideo ? 0 : 1];
+	QsBufferWatermarks marks;
+	marks.lowMs = limits.lowMs;
+	marks.highMs = limits.highMs;
+	marks.maxBytes = limits.maxBytes;
+	if (bitRate > 0)
+	{
+		int64_t bytes = bitRate / 8 * limits.highMs / 1000 * kBitRateHeadroom;
+		marks.maxBytes = (uint32_t)std::min<int64_t>(std::max<int64_t>(bytes, limits.minBytes), limits.maxBytes);
+	}
+	return marks;
+}
+
+void QcBufferingPolicy::readAhead(int& bufferBytes, int& readAheadBytes) const
+{
+	bufferBytes = kReadAhead[m_mode][0];
+	readAheadBytes = kReadAhead[m_mode][1];
+}
+
+void QcBufferingPolicy::balance(PacketQueue& video, PacketQueue& audio)
+{
+	video.setOverfill(audio.isHungry());
+	audio.setOverfill(video.isHungry());
+}
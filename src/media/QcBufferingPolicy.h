@@ -0,0 +1,23 @@
+#pragma once
+
+#include "QsMediaInfo.h"
+#include <atomic>
+
+class PacketQueue;
+
+//Maps a QeBufferingMode and the stream bitrates to packet queue watermarks. Durations bound the
+//queues for ordinary streams, the byte caps only step in for very high bitrates.
+class QcBufferingPolicy
+{
+public:
+	void setMode(int mode);
+	int mode() const { return m_mode; }
+	//bitRate in bits per second, 0 when the container does not know it.
+	QsBufferWatermarks watermarks(bool bVideo, int64_t bitRate) const;
+	void readAhead(int& bufferBytes, int& readAheadBytes) const;
+	//lets either queue run past its high duration watermark while the other one is starving,
+	//so an interleaved burst of one stream cannot block the demuxer in front of the other.
+	static void balance(PacketQueue& video, PacketQueue& audio);
+private:
+	std::atomic<int> m_mode{ eBufferLocalFile };
+};
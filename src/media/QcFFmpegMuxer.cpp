@@ -1,7 +1,9 @@
 ﻿#include "QmMacro.h"
 #include "QcFFmpegMuxer.h"
+#include "FFmpegUtils.h"
 #include "x264.h"
 #include <dwbase/log.h>
+#include <chrono>
 
 enum
 {
@@ -9,8 +11,27 @@ enum
 	VIDEO_BUF_FLAG = 0x02,
 };
 
+//queued but unwritten packets; a producer that finds it full waits for the writer up to kQueueWaitMs.
+static const uint32_t kMaxQueuedBytes = 8 << 20;
+static const int kQueueWaitMs = 1000;
+//add*() timestamps.
+static const AVRational kMsTimeBase = { 1, 1000 };
+
+static int64_t nowUs()
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//owns a QcMediaBuffer handed to addBuffer() until the packet's last reference goes.
+static void freeMediaBuffer(void* opaque, uint8_t*)
+{
+	delete (QcMediaBuffer*)opaque;
+}
+
 QcFFmpegMuxer::QcFFmpegMuxer()
-	: m_fmt(0),
+	: m_maxQueuedBytes(kMaxQueuedBytes),
+	m_queueWaitMs(kQueueWaitMs),
 	m_oc(0),
 	m_audio_st(0),
 	m_video_st(0),
@@ -22,15 +43,15 @@ QcFFmpegMuxer::QcFFmpegMuxer()
 	m_audio_samples(44100),
 	m_audio_bitrate(128),
 	m_fileLength(0),
-	m_dwStartTime(0),
-	m_dwStartTimeAudio(0)
+	m_videoStart(AV_NOPTS_VALUE),
+	m_audioStart(AV_NOPTS_VALUE),
+	m_lastAudioPts(AV_NOPTS_VALUE)
 {
 
 }
 
 QcFFmpegMuxer::~QcFFmpegMuxer()
 {
-	StopWaitFor();
 	close();
 }
 
@@ -58,9 +79,15 @@ void QcFFmpegMuxer::setAudioFormat(unsigned char channels, unsigned short bits,
 	m_audio_bitrate = bitrate;
 }
 
+void QcFFmpegMuxer::setQueueLimit(uint32_t maxBytes, int waitMs)
+{
+	m_maxQueuedBytes = maxBytes;
+	m_queueWaitMs = waitMs;
+}
 
 bool QcFFmpegMuxer::open(const char *file)
 {
+	close();
 	avformat_alloc_output_context2(&m_oc, NULL, NULL, file);
 	if (!m_oc) {
 		avformat_alloc_output_context2(&m_oc, NULL, "mp4", file);
@@ -69,85 +96,71 @@ bool QcFFmpegMuxer::open(const char *file)
 		}
 	}
 
-	m_fmt = m_oc->oformat;
-	if (!m_fmt) {
-		return false;
-	}
-
-	if (m_fmt->video_codec == AV_CODEC_ID_NONE ||
-		m_fmt->audio_codec == AV_CODEC_ID_NONE)
-	{
-		return false;
-	}
-
-	m_fmt->audio_codec = AV_CODEC_ID_MP3;
-	m_fmt->video_codec = AV_CODEC_ID_H264;
-	if (!add_video_stream(m_fmt->video_codec) ||
-		!add_audio_stream(m_fmt->audio_codec))
+	if (m_oc->oformat->video_codec == AV_CODEC_ID_NONE ||
+		m_oc->oformat->audio_codec == AV_CODEC_ID_NONE ||
+		!add_video_stream(AV_CODEC_ID_H264) ||
+		!add_audio_stream(AV_CODEC_ID_MP3))
 	{
+		close();
 		return false;
 	}
 
-	if (!(m_fmt->flags & AVFMT_NOFILE)) {
+	if (!(m_oc->oformat->flags & AVFMT_NOFILE)) {
 		int ret = avio_open(&m_oc->pb, file, AVIO_FLAG_WRITE);
 		if (ret < 0) {
+			close();
 			return false;
 		}
 	}
 
-	m_dataHandle = CreateEventW(NULL, FALSE, FALSE, NULL);
-
-	m_video_st->codec->extradata_size = m_headBuffer.getDataSize();
-	m_video_st->codec->extradata = m_headBuffer.data();
-
-	avformat_write_header(m_oc, NULL);
+	if (avformat_write_header(m_oc, NULL) < 0) {
+		close();
+		return false;
+	}
 
 	m_fileLength = 0;
-	m_dwStartTime = 0;
-	m_lastpts = 0;
+	m_videoStart = AV_NOPTS_VALUE;
+	m_audioStart = AV_NOPTS_VALUE;
+	m_lastAudioPts = AV_NOPTS_VALUE;
 
+	m_bStop = false;
+	m_bRunning = true;
+	m_writer = std::thread(&QcFFmpegMuxer::run, this);
 	return true;
 }
 
 void QcFFmpegMuxer::close()
 {
+	if (m_writer.joinable())
+	{
+		{
+			QmStdMutexLocker(m_mutex);
+			m_bStop = true;
+		}
+		m_dataCond.notify_one();
+		m_spaceCond.notify_all();
+		m_writer.join();
+	}
+	{
+		QmStdMutexLocker(m_mutex);
+		m_bRunning = false;
+	}
+
 	if (m_oc) {
 		if (m_fileLength > 0) av_write_trailer(m_oc);
 
-		close_video();
-		close_audio();
-
-		for (unsigned int i = 0; i < m_oc->nb_streams; i++) {
-			av_freep(&m_oc->streams[i]->codec);
-			av_freep(&m_oc->streams[i]);
-		}
-
-		if (m_oc->pb && (!(m_fmt->flags & AVFMT_NOFILE))) {
-			avio_close(m_oc->pb);
+		if (!(m_oc->oformat->flags & AVFMT_NOFILE)) {
+			avio_closep(&m_oc->pb);
 		}
-		av_free(m_oc);
+		//frees the streams and their codecpar, extradata included.
+		avformat_free_context(m_oc);
 		m_oc = NULL;
-	}
-}
-
-void QcFFmpegMuxer::close_audio()
-{
-	if (m_audio_st) 
-	{
-		avcodec_close(m_audio_st->codec);
-		m_audio_st = NULL;
-	}
-}
-void QcFFmpegMuxer::close_video()
-{
-	if (m_video_st) 
-	{
-		avcodec_close(m_video_st->codec);
 		m_video_st = NULL;
+		m_audio_st = NULL;
 	}
 }
 
-bool QcFFmpegMuxer::add_video_stream(enum AVCodecID codec_id) 
+bool QcFFmpegMuxer::add_video_stream(enum AVCodecID codec_id)
 {
 	m_video_st = avformat_new_stream(m_oc, NULL);
 	if (!m_video_st) {
@@ -155,22 +168,27 @@ bool QcFFmpegMuxer::add_video_stream(enum AVCodecID codec_id)
 	}
 
 	m_video_st->id = m_oc->nb_streams - 1;
-	AVCodecContext *c = m_video_st->codec;
-	c->codec_id = codec_id;
-	c->codec_type = AVMEDIA_TYPE_VIDEO;
-	c->bit_rate = m_bitrate * 1000;
-	c->width = m_width;
-	c->height = m_height;
-
-	c->time_base.den = 1000;
-	c->time_base.num = 1;
-	m_video_st->time_base = c->time_base;
-	c->gop_size = static_cast<int>(m_fps); /* emit one intra frame every second */
-	c->pix_fmt = AV_PIX_FMT_YUV420P;
-
-	if (m_oc->oformat->flags & AVFMT_GLOBALHEADER)
-		c->flags |= CODEC_FLAG_GLOBAL_HEADER;
-
+	//a hint, the muxer may pick its own time base in avformat_write_header.
+	m_video_st->time_base = kMsTimeBase;
+	m_video_st->avg_frame_rate = av_make_q(m_fps, 1);
+	AVCodecParameters *par = m_video_st->codecpar;
+	par->codec_type = AVMEDIA_TYPE_VIDEO;
+	par->codec_id = codec_id;
+	par->bit_rate = m_bitrate * 1000;
+	par->width = m_width;
+	par->height = m_height;
+	par->format = AV_PIX_FMT_YUV420P;
+
+	//the encoder's sps/pps, codecpar owns a padded copy.
+	uint32_t size = m_headBuffer.getDataSize();
+	if (size > 0)
+	{
+		par->extradata = (uint8_t*)av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+		if (!par->extradata)
+			return false;
+		memcpy(par->extradata, m_headBuffer.data(), size);
+		par->extradata_size = size;
+	}
 	return true;
 }
 
@@ -182,102 +200,206 @@ bool QcFFmpegMuxer::add_audio_stream(enum AVCodecID codec_id)
 	}
 
 	m_audio_st->id = m_oc->nb_streams - 1;
-	AVCodecContext *c = m_audio_st->codec;
-	c->codec_id = codec_id;
-	c->codec_type = AVMEDIA_TYPE_AUDIO;
-	c->sample_fmt = AV_SAMPLE_FMT_S16;
-	c->bit_rate = m_audio_bitrate;
-	c->sample_rate = m_audio_samples;
-	c->channels = m_channels;
-	c->time_base.den = m_audio_samples;
-	c->time_base.num = 1;
-
-	if (m_oc->oformat->flags & AVFMT_GLOBALHEADER)
-		c->flags |= (CODEC_FLAG_GLOBAL_HEADER | AVFMT_VARIABLE_FPS);
+	m_audio_st->time_base = av_make_q(1, m_audio_samples);
+	AVCodecParameters *par = m_audio_st->codecpar;
+	par->codec_type = AVMEDIA_TYPE_AUDIO;
+	par->codec_id = codec_id;
+	par->format = AV_SAMPLE_FMT_S16;
+	par->bit_rate = m_audio_bitrate;
+	par->sample_rate = m_audio_samples;
+	par->channels = m_channels;
+	par->channel_layout = av_get_default_channel_layout(m_channels);
 	return true;
 }
 
-void QcFFmpegMuxer::addAudio(QcMediaBuffer& buffer)
+bool QcFFmpegMuxer::addAudio(QcMediaBuffer& buffer)
 {
-	buffer.m_type = AUDIO_BUF_FLAG;
-	QmCsLocker(m_cs);
-	m_bufferQueue.push_back_swap(buffer, true);
-	::SetEvent(m_dataHandle);
+	return addBuffer(buffer, AUDIO_BUF_FLAG);
 }
 
-void QcFFmpegMuxer::addVideo(QcMediaBuffer& buffer)
+bool QcFFmpegMuxer::addVideo(QcMediaBuffer& buffer)
 {
-	buffer.m_type = VIDEO_BUF_FLAG;
-	QmCsLocker(m_cs);
-	m_bufferQueue.push_back_swap(buffer, true);
-	::SetEvent(m_dataHandle);
+	return addBuffer(buffer, VIDEO_BUF_FLAG);
 }
 
-void QcFFmpegMuxer::OnRun()
+bool QcFFmpegMuxer::addAudio(const AVPacketPtr& packet)
 {
-	while (1)
+	return addPacket(packet, AUDIO_BUF_FLAG);
+}
+
+bool QcFFmpegMuxer::addVideo(const AVPacketPtr& packet)
+{
+	return addPacket(packet, VIDEO_BUF_FLAG);
+}
+
+bool QcFFmpegMuxer::addBuffer(QcMediaBuffer& buffer, int type)
+{
+	if (buffer.isEmpty())
+		return false;
+
+	AVPacketPtr packet = FFmpegUtils::allocAVPacket();
+	if (!packet)
+		return false;
+	uint32_t size = buffer.getDataSize();
+	uint32_t padded = size + AV_INPUT_BUFFER_PADDING_SIZE;
+	//the caller may reuse attached memory as soon as this returns, so that payload is copied.
+	bool bCopy = buffer.isExternalBuffer();
+	QcMediaBuffer* pOwner = new QcMediaBuffer;
+	if (!bCopy)
+		pOwner->swap(buffer);
+	//keeps the payload, only reallocates when the spare capacity is short of the padding.
+	pOwner->checkBufferSize(padded);
+	AVPacket* pkt = packet.get();
+	if (pOwner->bufferSize() >= padded)
 	{
-		DWORD ret = WaitFor(&m_dataHandle, 1);
-		if (ret == WAIT_OBJECT_0)
-		{
-			flush();
-		}
-		else
+		if (bCopy)
 		{
-			break;
+			pOwner->write(buffer.data(), size);
+			pOwner->m_tm = buffer.m_tm;
+			pOwner->m_flag = buffer.m_flag;
 		}
+		//packet data must be followed by AV_INPUT_BUFFER_PADDING_SIZE zeroed bytes.
+		memset(pOwner->data() + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+		pkt->buf = av_buffer_create(pOwner->data(), padded, freeMediaBuffer, pOwner, 0);
+	}
+	if (!pkt->buf)
+	{
+		if (!bCopy)
+			buffer.swap(*pOwner);
+		delete pOwner;
+		return false;
+	}
+	pOwner->m_type = type;
+	pkt->data = pOwner->data();
+	pkt->size = size;
+	pkt->pts = (int64_t)pOwner->m_tm;
+	if (type == AUDIO_BUF_FLAG || pOwner->m_flag == X264_TYPE_IDR)
+		pkt->flags |= AV_PKT_FLAG_KEY;
+	return enqueue(packet, type);
+}
+
+bool QcFFmpegMuxer::addPacket(const AVPacketPtr& packet, int type)
+{
+	//the writer takes the first pts of each stream as its start.
+	if (!packet || packet->size <= 0 || packet->pts == AV_NOPTS_VALUE)
+		return false;
+
+	//the writer changes the timestamps and hands the reference to libavformat, so it gets its own
+	//packet; av_packet_ref only copies a payload that is not ref counted.
+	AVPacketPtr own = FFmpegUtils::allocAVPacket();
+	if (!own || av_packet_ref(own.get(), packet.get()) < 0)
+		return false;
+	if (type == AUDIO_BUF_FLAG)
+		own->flags |= AV_PKT_FLAG_KEY;
+	return enqueue(own, type);
+}
+
+bool QcFFmpegMuxer::enqueue(const AVPacketPtr& packet, int type)
+{
+	uint32_t size = (uint32_t)packet->size;
+	QsMuxPacket item = { packet, type, nowUs() };
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	//a packet larger than the whole limit still goes into an empty queue.
+	bool bSpace = waitCondition(m_spaceCond, lock, m_queueWaitMs, [&] {
+		return m_bStop || m_queuedBytes == 0 || m_queuedBytes + size <= m_maxQueuedBytes;
+	});
+	if (!m_bRunning || m_bStop || !bSpace)
+	{
+		m_droppedPackets.fetch_add(1, std::memory_order_relaxed);
+		return false;
 	}
-	flush();
+	m_queue.push_back(std::move(item));
+	uint32_t queued = m_queuedBytes + size;
+	m_queuedBytes.store(queued, std::memory_order_relaxed);
+	m_queuedPackets.store(m_queuedPackets + 1, std::memory_order_relaxed);
+	if (queued > m_peakQueuedBytes)
+		m_peakQueuedBytes.store(queued, std::memory_order_relaxed);
+	//the writer only sleeps on an empty queue.
+	bool bWake = m_queue.size() == 1;
+	lock.unlock();
+	if (bWake)
+		m_dataCond.notify_one();
+	return true;
 }
 
-void QcFFmpegMuxer::flush()
+void QcFFmpegMuxer::run()
 {
+	uint32_t writtenBytes = 0;
+	uint32_t writtenPackets = 0;
 	while (1)
 	{
 		{
-			QmCsLocker(m_cs);
-			if (!m_bufferQueue.pop_swap(m_mediaBuffer))
+			std::unique_lock<std::mutex> lock(m_mutex);
+			//the batch written last time is released in the same lock that takes the next one.
+			if (writtenPackets > 0)
+			{
+				m_queuedBytes.store(m_queuedBytes - writtenBytes, std::memory_order_relaxed);
+				m_queuedPackets.store(m_queuedPackets - writtenPackets, std::memory_order_relaxed);
+				m_spaceCond.notify_all();
+			}
+			//stopping still drains what is queued.
+			m_dataCond.wait(lock, [this] { return !m_queue.empty() || m_bStop; });
+			if (m_queue.empty())
 				break;
-			QmAssertLogBefore(m_mediaBuffer.m_type == AUDIO_BUF_FLAG || m_mediaBuffer.m_type == VIDEO_BUF_FLAG);
+			m_batch.swap(m_queue);
 		}
-		if (m_mediaBuffer.m_type == AUDIO_BUF_FLAG)
-			writeAudio((uint32_t)m_mediaBuffer.m_tm, m_mediaBuffer.data(), m_mediaBuffer.getDataSize());
-		else if (m_mediaBuffer.m_type == VIDEO_BUF_FLAG)
-			writeVideo((uint32_t)m_mediaBuffer.m_tm, m_mediaBuffer.data(), m_mediaBuffer.getDataSize(), m_mediaBuffer.m_flag);
+		writtenPackets = (uint32_t)m_batch.size();
+		writtenBytes = writeBatch();
+		m_batches.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+uint32_t QcFFmpegMuxer::writeBatch()
+{
+	uint32_t bytes = 0;
+	for (QsMuxPacket& item : m_batch)
+	{
+		AVPacket* pkt = item.packet.get();
+		uint32_t size = (uint32_t)pkt->size;
+		int64_t start = nowUs();
+		bool bWritten = false;
+		if (item.type == AUDIO_BUF_FLAG)
+			bWritten = writeAudio(pkt);
+		else if (item.type == VIDEO_BUF_FLAG)
+			bWritten = writeVideo(pkt);
 		else
 		{
 			QmAssertLogBefore(false);
 		}
+		int64_t end = nowUs();
+		if (bWritten)
+		{
+			m_writeLatency.record((uint32_t)(end - start));
+			m_queueDelay.record((uint32_t)(end - item.queuedUs));
+			m_writtenPackets.fetch_add(1, std::memory_order_relaxed);
+			m_writtenBytes.fetch_add(size, std::memory_order_relaxed);
+		}
+		bytes += size;
 	}
+	//drops the references outside the lock, the vector keeps its capacity for the next swap.
+	m_batch.clear();
+	return bytes;
 }
 
-bool QcFFmpegMuxer::writeVideo(unsigned int pts, uint8_t *buf, int size, int flag)
+bool QcFFmpegMuxer::writeVideo(AVPacket* pkt)
 {
-	if (!buf || size < 0 || !m_oc || !m_video_st) {
+	if (!m_oc || !m_video_st) {
 		QmAssertLogBefore(false);
 		return false;
 	}
 
-	if (m_dwStartTime == 0) {
-		m_dwStartTime = pts;
-		m_frameCount = 0;
-	}
-
-	AVPacket pkt;
-	av_init_packet(&pkt);
-
-	pkt.stream_index = m_video_st->index;
-	pkt.data = buf;
-	pkt.size = size;
-	pkt.pts = pts - m_dwStartTime;
-	av_packet_rescale_ts(&pkt, m_video_st->codec->time_base, m_video_st->time_base);
-	pkt.dts = pkt.pts;
+	if (m_videoStart == AV_NOPTS_VALUE)
+		m_videoStart = pkt->pts;
 
-	//  Utils::DebugPrint("writeVideo m_dwStartTime:%d pkt.pts: %d\n", m_dwStartTime, pkt.pts);
-	if (flag == X264_TYPE_IDR)
-		pkt.flags |= AV_PKT_FLAG_KEY;
+	pkt->stream_index = m_video_st->index;
+	pkt->pts -= m_videoStart;
+	pkt->dts = pkt->dts == AV_NOPTS_VALUE ? pkt->pts : pkt->dts - m_videoStart;
+	av_packet_rescale_ts(pkt, kMsTimeBase, m_video_st->time_base);
 
-	int ret = av_interleaved_write_frame(m_oc, &pkt);
+	int size = pkt->size;
+	//takes the packet's reference and leaves it blank.
+	int ret = av_interleaved_write_frame(m_oc, pkt);
 	if (ret != 0) {
 		return false;
 	}
@@ -287,45 +409,30 @@ bool QcFFmpegMuxer::writeVideo(unsigned int pts, uint8_t *buf, int size, int fla
 	return true;
 }
 
-
-bool QcFFmpegMuxer::writeAudio(unsigned int pts, uint8_t *buf, int size)
+bool QcFFmpegMuxer::writeAudio(AVPacket* pkt)
 {
-	if (!buf || size < 0 || !m_oc || !m_audio_st) {
+	if (!m_oc || !m_audio_st) {
 		QmAssertLogBefore(false);
 		return false;
 	}
 
-	//   if( m_lastpts == 0 ) m_lastpts = pts;
-	//   if( m_dwStartTime == 0 || pts < m_dwStartTime ) return true;
-	if (m_lastpts > pts) return true;
-	if (m_dwStartTimeAudio == 0)
-		m_dwStartTimeAudio = pts;
-
-	AVPacket pkt;
-	av_init_packet(&pkt);
-	pkt.data = buf;
-	pkt.size = size;
-	pkt.flags |= AV_PKT_FLAG_KEY;
-	pkt.stream_index = m_audio_st->index;
-
-	AVRational bq;
-	bq.num = 1;
-	bq.den = 1000;
-	//  pkt.pts = (pts - m_dwStartTimeAudio)*m_audio_samples/1000; 
-	pkt.pts = av_rescale_q(pts - m_dwStartTimeAudio, bq, m_audio_st->codec->time_base);
-	pkt.dts = pkt.pts;
-
-	//pkt.pts = m_lastpts; //size / m_audio_st->codec->sample_rate / m_channels; //av_rescale_q(1, bq, m_audio_st->codec->time_base);
-	//m_lastpts += size / m_channels / av_get_bytes_per_sample( m_audio_st->codec->sample_fmt );
-	//   pkt.dts = pkt.pts; 
-
-	int ntime = pts - m_lastpts;
+	int64_t pts = pkt->pts;
+	if (m_lastAudioPts != AV_NOPTS_VALUE && m_lastAudioPts > pts) return true;
+	if (m_audioStart == AV_NOPTS_VALUE)
+		m_audioStart = pts;
+
+	int64_t ntime = m_lastAudioPts == AV_NOPTS_VALUE ? 0 : pts - m_lastAudioPts;
 	if (ntime <= 0) ntime = 20;
-	pkt.duration = ntime;
-	m_lastpts = pts;
-	//Utils::DebugPrint("writeAudio m_dwStartTime:%d pkt.pts: %d pkt.duration: %d\n", m_dwStartTime,  (int)pkt.pts, (int)pkt.duration);
+	m_lastAudioPts = pts;
+
+	pkt->stream_index = m_audio_st->index;
+	pkt->pts = pts - m_audioStart;
+	pkt->dts = pkt->pts;
+	pkt->duration = ntime;
+	av_packet_rescale_ts(pkt, kMsTimeBase, m_audio_st->time_base);
 
-	int ret = av_interleaved_write_frame(m_oc, &pkt);
+	int size = pkt->size;
+	int ret = av_interleaved_write_frame(m_oc, pkt);
 	if (ret != 0) {
 		return false;
 	}
@@ -335,3 +442,22 @@ bool QcFFmpegMuxer::writeAudio(unsigned int pts, uint8_t *buf, int size)
 	return true;
 }
 
+QsMuxerStats QcFFmpegMuxer::stats() const
+{
+	QsMuxerStats stats;
+	stats.queuedPackets = m_queuedPackets.load(std::memory_order_relaxed);
+	stats.queuedBytes = m_queuedBytes.load(std::memory_order_relaxed);
+	stats.peakQueuedBytes = m_peakQueuedBytes.load(std::memory_order_relaxed);
+	stats.writtenPackets = m_writtenPackets.load(std::memory_order_relaxed);
+	stats.writtenBytes = m_writtenBytes.load(std::memory_order_relaxed);
+	stats.droppedPackets = m_droppedPackets.load(std::memory_order_relaxed);
+	stats.batches = m_batches.load(std::memory_order_relaxed);
+	stats.write = m_writeLatency.snapshot();
+	stats.queueDelay = m_queueDelay.snapshot();
+	return stats;
+}
+
+bool QcFFmpegMuxer::isCongested() const
+{
+	return m_queuedBytes.load(std::memory_order_relaxed) > m_maxQueuedBytes / 2;
+}
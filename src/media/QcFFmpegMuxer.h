@@ -1,19 +1,38 @@
 ﻿#pragma once
 
-#include "Thread.h"
-#include "QcCycleQueue.h"
 #include "QcBuffer.h"
-#include "win_scope_handle.h"
+#include "QsMediaInfo.h"
+#include "QcPlayerMetrics.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <atomic>
 extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libswscale/swscale.h>
-#include <libavformat/avformat.h>
-#include <libswresample/swresample.h>
 }
 
-class QcFFmpegMuxer : public Thread
+struct QsMuxerStats
+{
+	uint32_t queuedPackets = 0;     //handed over and not written yet
+	uint32_t queuedBytes = 0;
+	uint32_t peakQueuedBytes = 0;
+	uint64_t writtenPackets = 0;
+	uint64_t writtenBytes = 0;
+	uint64_t droppedPackets = 0;    //refused, the queue stayed over its limit
+	uint64_t batches = 0;           //writer wakeups, writtenPackets / batches is the average batch
+	QsLatencyHistogram write;       //av_interleaved_write_frame per packet
+	QsLatencyHistogram queueDelay;  //from add*() until the packet is written
+};
+
+//Writes encoded audio and video into a file on a thread of its own.
+//add*() takes a reference to the payload, never a copy, and queues it under a short lock. The writer
+//takes everything queued in one go and writes the batch without the lock. Past the queue limit add*()
+//waits for the writer and then drops the packet; isCongested() turns true at half the limit, so a
+//capture producer can lower its bitrate or skip frames before that happens.
+class QcFFmpegMuxer
 {
 public:
 	QcFFmpegMuxer();
@@ -22,34 +41,72 @@ public:
 	void setVideoFormat(int width, int height, int fps, int bitrate);
 	void setAudioFormat(unsigned char channels, unsigned short bits, int samples, int bitrate);
 	void setVideoHeader(const uint8_t *pbuf, int len);
+	//maxBytes of queued packets before add*() waits up to waitMs for the writer, 0 drops at once. Before open().
+	void setQueueLimit(uint32_t maxBytes, int waitMs);
 
+	//starts the writer once the header is written.
 	bool open(const char *file);
+	//writes what is still queued, then the trailer.
 	void close();
 
-	void addAudio(QcMediaBuffer& buffer);
-	void addVideo(QcMediaBuffer& buffer);
+	//the buffer's memory moves into the muxer and buffer is left empty, memory attached with
+	//attachExternelBuffer is copied and left with the caller. m_tm is in ms, m_flag X264_TYPE_IDR
+	//marks a key frame.
+	bool addAudio(QcMediaBuffer& buffer);
+	bool addVideo(QcMediaBuffer& buffer);
+	//pts (and dts, if set) in ms, false without a pts. flags mark key frames. A ref counted payload
+	//is shared, not copied.
+	bool addAudio(const AVPacketPtr& packet);
+	bool addVideo(const AVPacketPtr& packet);
+
+	QsMuxerStats stats() const;
+	bool isCongested() const;
 protected:
-	virtual void OnRun();
-	void close_audio();
-	void close_video();
+	struct QsMuxPacket
+	{
+		AVPacketPtr packet;
+		int type;
+		int64_t queuedUs;
+	};
+	bool addBuffer(QcMediaBuffer& buffer, int type);
+	bool addPacket(const AVPacketPtr& packet, int type);
+	bool enqueue(const AVPacketPtr& packet, int type);
+
+	void run();
 	bool add_video_stream(enum AVCodecID codec_id);
 	bool add_audio_stream(enum AVCodecID codec_id);
 
-	void flush();
-	bool writeVideo(unsigned int pts, uint8_t *buf, int size, int flag);
-	bool writeAudio(unsigned int pts, uint8_t *buf, int size);
+	//returns the bytes written.
+	uint32_t writeBatch();
+	bool writeVideo(AVPacket* pkt);
+	bool writeAudio(AVPacket* pkt);
 protected:
-	QcMediaBuffer m_mediaBuffer;
-	QcCycleQueue<QcMediaBuffer> m_bufferQueue;
-	QcCriticalLock m_cs;
-    win_scope_handle m_dataHandle;
+	//producers append to m_queue, the writer swaps it with the empty m_batch, so neither reallocates once warm.
+	std::vector<QsMuxPacket> m_queue;
+	std::vector<QsMuxPacket> m_batch;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_dataCond;
+	std::condition_variable m_spaceCond;
+	std::thread m_writer;
+	bool m_bRunning = false;
+	bool m_bStop = false;
+	uint32_t m_maxQueuedBytes;
+	int m_queueWaitMs;
+	//changed under m_mutex, read without it; they include the batch being written.
+	std::atomic<uint32_t> m_queuedPackets{ 0 };
+	std::atomic<uint32_t> m_queuedBytes{ 0 };
+	std::atomic<uint32_t> m_peakQueuedBytes{ 0 };
+
+	std::atomic<uint64_t> m_writtenPackets{ 0 };
+	std::atomic<uint64_t> m_writtenBytes{ 0 };
+	std::atomic<uint64_t> m_droppedPackets{ 0 };
+	std::atomic<uint64_t> m_batches{ 0 };
+	QcLatencyHistogram m_writeLatency;
+	QcLatencyHistogram m_queueDelay;
 
-	AVOutputFormat  *m_fmt;
 	AVFormatContext *m_oc;
-	//AVDictionary    *m_opt;
 	AVStream *m_audio_st;
 	AVStream *m_video_st;
-	int64_t m_frameCount;
 	int             m_width;
 	int             m_height;
 	int             m_fps;
@@ -59,8 +116,9 @@ protected:
 	unsigned int    m_audio_samples;
 	unsigned int    m_audio_bitrate;
 	long long       m_fileLength;
-	unsigned int    m_dwStartTime;
-	unsigned int    m_dwStartTimeAudio;
-	unsigned int    m_lastpts;
+	//first pts of each stream in ms, AV_NOPTS_VALUE until it arrives.
+	int64_t         m_videoStart;
+	int64_t         m_audioStart;
+	int64_t         m_lastAudioPts;
 	QcBuffer        m_headBuffer;
 };
@@ -0,0 +1,56 @@
+#include "QcMediaClock.h"
+#include "FFmpegUtils.h"
+
+void QcMediaClock::set(int ptsMs)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ptsMs = ptsMs;
+	m_updateTime = FFmpegUtils::currentMilliSecsSinceEpoch();
+	m_bValid = true;
+}
+
+void QcMediaClock::reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bValid = false;
+}
+
+void QcMediaClock::setPaused(bool bPaused)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_bPaused == bPaused)
+		return;
+
+	//freeze the extrapolated time on pause, continue from it on resume.
+	int now = FFmpegUtils::currentMilliSecsSinceEpoch();
+	m_ptsMs = _get(now);
+	m_updateTime = now;
+	m_bPaused = bPaused;
+}
+
+void QcMediaClock::setSpeed(double speed)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	//re-anchor, so only the time after the change runs at the new speed.
+	int now = FFmpegUtils::currentMilliSecsSinceEpoch();
+	m_ptsMs = _get(now);
+	m_updateTime = now;
+	m_speed = speed;
+}
+
+bool QcMediaClock::isValid() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bValid;
+}
+
+int QcMediaClock::get() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return _get(FFmpegUtils::currentMilliSecsSinceEpoch());
+}
+
+int QcMediaClock::_get(int now) const
+{
+	return m_bPaused ? m_ptsMs : m_ptsMs + (int)((now - m_updateTime) * m_speed);
+}
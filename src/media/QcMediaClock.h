@@ -0,0 +1,27 @@
+#pragma once
+
+#include <mutex>
+
+//A presentation clock: the last pts it was set to, extrapolated with the steady clock at its speed.
+//It is invalid until the first set() after a reset(), callers then fall back to another clock.
+class QcMediaClock
+{
+public:
+	void set(int ptsMs);
+	void reset();
+	void setPaused(bool bPaused);
+	//media ms per wall ms, 1 by default.
+	void setSpeed(double speed);
+
+	bool isValid() const;
+	int get() const;
+private:
+	int _get(int now) const;
+private:
+	mutable std::mutex m_mutex;
+	int m_ptsMs = 0;
+	int m_updateTime = 0;
+	bool m_bValid = false;
+	bool m_bPaused = false;
+	double m_speed = 1.0;
+};
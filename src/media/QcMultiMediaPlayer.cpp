@@ -23,6 +23,11 @@ bool QcMultiMediaPlayer::open(const char* pFile)
     return m_ptr->open(pFile);
 }
 
+bool QcMultiMediaPlayer::open(const char* pFile, const QsDecoderOptions& options)
+{
+    return m_ptr->open(pFile, options);
+}
+
 bool QcMultiMediaPlayer::close()
 {
     return m_ptr->close();
@@ -68,6 +73,71 @@ int QcMultiMediaPlayer::getTotalTime() const
     return m_ptr->getTotalTime();
 }
 
+int QcMultiMediaPlayer::getLastSeekLatency() const
+{
+    return m_ptr->getLastSeekLatency();
+}
+
+void QcMultiMediaPlayer::setClockMode(int mode)
+{
+    m_ptr->setClockMode(mode);
+}
+
+int QcMultiMediaPlayer::clockMode() const
+{
+    return m_ptr->clockMode();
+}
+
+QsClockStats QcMultiMediaPlayer::getClockStats() const
+{
+    return m_ptr->getClockStats();
+}
+
+QsPlayerStats QcMultiMediaPlayer::getStats() const
+{
+    return m_ptr->getStats();
+}
+
+void QcMultiMediaPlayer::setStatsDumpInterval(int ms)
+{
+    m_ptr->setStatsDumpInterval(ms);
+}
+
+void QcMultiMediaPlayer::setBufferingMode(int mode)
+{
+    m_ptr->setBufferingMode(mode);
+}
+
+int QcMultiMediaPlayer::bufferingMode() const
+{
+    return m_ptr->bufferingMode();
+}
+
+int QcMultiMediaPlayer::bufferedTime(bool bVideo) const
+{
+    return m_ptr->bufferedTime(bVideo);
+}
+
+void QcMultiMediaPlayer::setRate(double rate)
+{
+    m_ptr->setRate(rate);
+}
+
+double QcMultiMediaPlayer::rate() const
+{
+    return m_ptr->rate();
+}
+
+void QcMultiMediaPlayer::setExecutor(QcTaskExecutor* pExecutor)
+{
+    m_ptr->setExecutor(pExecutor);
+}
+
+QcTaskExecutor* QcMultiMediaPlayer::executor() const
+{
+    return m_ptr->executor();
+}
+
 void QcMultiMediaPlayer::play()
 {
     return m_ptr->play();
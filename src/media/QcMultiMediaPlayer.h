@@ -3,8 +3,12 @@
 #include "media_global.h"
 
 class QcMultiMediaPlayerPrivate;
+class QcTaskExecutor;
 class AVFrameRef;
 struct QsMediaInfo;
+struct QsClockStats;
+struct QsPlayerStats;
+struct QsDecoderOptions;
 struct AVBufferRef;
 
 class IMultiMediaNotify
@@ -13,6 +17,9 @@ public:
 	virtual bool OnVideoFrame(const AVFrameRef& frame) = 0;
     virtual bool OnAudioFrame(const AVFrameRef& frame) = 0;
 	virtual void ToEndSignal() = 0;
+	//ms of audio handed to OnAudioFrame that the output has not played yet, -1 when unknown.
+	//it drives the audio clock, without it the audio master clock falls back to the external clock.
+	virtual int audioPendingTime() { return -1; }
 };
 
 class MEDIA_API QcMultiMediaPlayer
@@ -23,6 +30,8 @@ public:
 
 	void setHwDevice(AVBufferRef* device_ctx);
 	bool open(const char* pFile);
+	//options apply to the video decoder, open(pFile) uses the QsDecoderOptions defaults.
+	bool open(const char* pFile, const QsDecoderOptions& options);
 	void play();
 	void pause();
 	void seek(int msTime);
@@ -36,6 +45,33 @@ public:
     bool hasAudio() const;
     int getCurTime() const;
 	int getTotalTime() const;
+	//ms from the last seek() call to its first presented frame, -1 while it is still pending.
+	int getLastSeekLatency() const;
+
+	//QeClockMode, eAudioMasterClock by default.
+	void setClockMode(int mode);
+	int clockMode() const;
+	QsClockStats getClockStats() const;
+	//snapshot of the pipeline counters, cheap enough to poll every frame.
+	QsPlayerStats getStats() const;
+	//writes getStats() as one line to stderr and the debugger every ms, 0 turns it off.
+	void setStatsDumpInterval(int ms);
+
+	//QeBufferingMode, eBufferLocalFile by default. The read-ahead cache follows it on the next open().
+	void setBufferingMode(int mode);
+	int bufferingMode() const;
+	//ms of demuxed packets waiting for the decoder.
+	int bufferedTime(bool bVideo) const;
+
+	//playback speed, clamped to [0.5, 4] and kept across open(). Audio is time-stretched at its pitch,
+	//above 1 the video decoder skips non-reference frames while it cannot keep up.
+	void setRate(double rate);
+	double rate() const;
+
+	//runs the demux and decode stages as tasks on pExecutor, e.g. QcTaskExecutor::shared(), instead of
+	//three threads per player. nullptr (the default) keeps the threads. Takes effect on the next open().
+	void setExecutor(QcTaskExecutor* pExecutor);
+	QcTaskExecutor* executor() const;
 protected: 
     QcMultiMediaPlayerPrivate* m_ptr;
 };
@@ -9,9 +9,39 @@ extern "C"{
 #include "FFmpegVideoDecoder.h"
 #include "FFmpegAudioDecoder.h"
 #include "FFmpegUtils.h"
-#include "utils/libtime.h"
 #include <string>
+#include <cstdlib>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#ifdef _WIN32
 #include <windows.h>
+#endif
+
+//a frame is handed out when it is due within this many ms.
+static const int kPresentAheadTime = 5;
+//decoded frames kept ahead of presentation per stream.
+static const int kMaxQueuedFrames = 3;
+//with the audio clock as master, audio is handed out whenever less than this is waiting in the output.
+static const int kAudioSinkBufferTime = 60;
+//the external clock is re-anchored to the master clock once they drift further apart than this.
+static const int kMaxClockDrift = 40;
+//a video frame shown this many ms behind its clock counts as late.
+static const int kLateFrameTime = 40;
+//setRate() range.
+static const double kMinRate = 0.5;
+static const double kMaxRate = 4.0;
+//above rate 1 non-reference frames are skipped once decoding takes this share of the frame interval,
+//and decoded again below the second one.
+static const double kSkipFrameLoad = 0.9;
+static const double kDecodeAllLoad = 0.6;
+//stages the queue wake callbacks resume in executor mode.
+enum
+{
+	kDemuxStage = 1,
+	kVideoStage = 2,
+	kAudioStage = 4,
+};
 
 
 static const char *get_error_text(const int error)
@@ -22,10 +52,26 @@ static const char *get_error_text(const int error)
 }
 
 QcMultiMediaPlayerPrivate::QcMultiMediaPlayerPrivate(IMultiMediaNotify* pNotify)
-    : m_pNotify(pNotify)
-
+    : m_videoQueue(kMaxQueuedFrames, FrameQueue::kLockFreeRing)
+	, m_audioQueue(kMaxQueuedFrames, FrameQueue::kLockFreeRing)
+	, m_pNotify(pNotify)
 {
-
+	//queue waits give up as soon as the player leaves ePlaying, so _synState never waits behind a blocked thread.
+	auto interrupted = [this] { return m_playState != ePlaying; };
+	m_videoPacketQueue.setInterruptCallback(interrupted);
+	m_audioPacketQueue.setInterruptCallback(interrupted);
+	//a decode thread waiting for frame space also has to notice a seek, its queued frames are stale then.
+	m_videoQueue.setInterruptCallback([this] {
+		return m_playState != ePlaying || m_videoPacketQueue.serial() != m_videoDecodeSerial;
+	});
+	m_audioQueue.setInterruptCallback([this] {
+		return m_playState != ePlaying || m_audioPacketQueue.serial() != m_audioDecodeSerial;
+	});
+	//a packet queue resumes both of its ends, a frame queue the decoder feeding it.
+	m_videoPacketQueue.setWakeCallback([this] { _wakeStages(kDemuxStage | kVideoStage); });
+	m_audioPacketQueue.setWakeCallback([this] { _wakeStages(kDemuxStage | kAudioStage); });
+	m_videoQueue.setWakeCallback([this] { _wakeStages(kVideoStage); });
+	m_audioQueue.setWakeCallback([this] { _wakeStages(kAudioStage); });
 }
 
 QcMultiMediaPlayerPrivate::~QcMultiMediaPlayerPrivate()
@@ -41,11 +87,19 @@ void QcMultiMediaPlayerPrivate::setHwDevice(AVBufferRef* device_ctx)
 		m_hw_device_ctx = av_buffer_ref(device_ctx);
 }
 
-bool QcMultiMediaPlayerPrivate::open(const char* pFile)
+bool QcMultiMediaPlayerPrivate::open(const char* pFile, const QsDecoderOptions& options)
 {
     close();
+	m_timeStretch.reset();
+	m_iVideoDecodeCostUs = 0;
+	m_iSkipFrame = eDiscardNone;
 
 	m_pDemuxer = std::make_unique<FFmpegDemuxer>();
+	//the demuxer reads the file through a cache kept ahead of it.
+	int bufferBytes = 0;
+	int readAheadBytes = 0;
+	m_bufferingPolicy.readAhead(bufferBytes, readAheadBytes);
+	m_pDemuxer->setReadAhead(bufferBytes, readAheadBytes);
 	bool bOk = m_pDemuxer->open(pFile);
 	if (bOk)
 	{
@@ -54,14 +108,18 @@ bool QcMultiMediaPlayerPrivate::open(const char* pFile)
 		{
 			m_pVideoDecoder = std::make_unique<FFmpegVideoDecoder>();
 			m_pVideoDecoder->setHwDevice(m_hw_device_ctx);
-			m_pVideoDecoder->open(pVideoStream->codecpar);
+			m_pVideoDecoder->setOptions(options);
+			if (!m_pVideoDecoder->open(pVideoStream->codecpar))
+				m_pVideoDecoder = nullptr;
 		}
 		AVStream* pAudioStream = m_pDemuxer->audioStream();
 		if (pAudioStream)
 		{
 			m_pAudioDecoder = std::make_unique<FFmpegAudioDecoder>();
-			m_pAudioDecoder->open(pAudioStream->codecpar);
+			if (!m_pAudioDecoder->open(pAudioStream->codecpar))
+				m_pAudioDecoder = nullptr;
 		}
+		_applyBuffering();
 	}
 	_start();
     return true;
@@ -72,6 +130,7 @@ bool QcMultiMediaPlayerPrivate::close()
 	if (!m_pDemuxer)
 		return false;
 
+	_abortQueues();
 	_synState(eExitThread);
 	if (m_videoThread.joinable())
 		m_videoThread.join();
@@ -79,10 +138,19 @@ bool QcMultiMediaPlayerPrivate::close()
 		m_audioThread.join();
 	if (m_demuxerThread.joinable())
 		m_demuxerThread.join();
+	{
+		std::lock_guard<std::mutex> lock(m_taskMutex);
+		for (QcTaskPtr* pTask : { &m_demuxTask, &m_videoTask, &m_audioTask })
+		{
+			if (*pTask)
+				(*pTask)->waitDone();
+			pTask->reset();
+		}
+		m_bTaskMode = false;
+	}
 
-	m_pVideoDecoder->close();
-
-	m_pAudioDecoder->close();
+	m_pVideoDecoder = nullptr;
+	m_pAudioDecoder = nullptr;
 	m_pDemuxer = nullptr;
 
     m_playState = eReady;
@@ -95,13 +163,18 @@ bool QcMultiMediaPlayerPrivate::close()
     m_videoQueue.clear();
     m_audioQueue.clear();
 
-    m_videoPacketQueue.clear();
-    m_audioPacketQueue.clear();
+    m_videoPacketQueue.flush(m_seekSerial);
+    m_audioPacketQueue.flush(m_seekSerial);
+	m_pendingPacket = nullptr;
 	m_bFileEnd = false;
 	m_videoDecodeEnd = false;
 	m_audioDecodeEnd = false;
 
-    m_iBeginSystemTime = 0;
+	_resetClocks(0);
+	m_iMaxDriftMs = 0;
+	m_nClockCorrections = 0;
+	m_iSeekLatency = 0;
+	m_metrics.reset();
     return true;
 }
 
@@ -117,20 +190,21 @@ bool QcMultiMediaPlayerPrivate::readFrame(bool bVideo, AVFrameRef& frame)
 	if (!m_pDemuxer)
 		return false;
 
-	if (bVideo)
+	FrameQueue& queue = bVideo ? m_videoQueue : m_audioQueue;
+	const PacketQueue& packetQueue = bVideo ? m_videoPacketQueue : m_audioPacketQueue;
+	while (queue.pop(frame))
 	{
-		QmStdMutexLocker(m_videoQueue.mutex());
-		bool bRet = m_videoQueue.pop(frame);
-		if (bRet)
+		//frames decoded before the last seek are skipped.
+		if (frame.serial() != packetQueue.serial())
+			continue;
+
+		if (bVideo)
 			m_iVideoCurTime = frame.ptsMsTime();
-		return bRet;
+		else
+			m_iAudioCurTime = frame.ptsMsTime();
+		return true;
 	}
-		
-	QmStdMutexLocker(m_audioQueue.mutex());
-	bool bRet = m_audioQueue.pop(frame);
-	if (bRet)
-		m_iAudioCurTime = frame.ptsMsTime();
-	return bRet;
+	return false;
 }
 
 const QsMediaInfo* QcMultiMediaPlayerPrivate::getMediaInfo() const
@@ -155,7 +229,10 @@ void QcMultiMediaPlayerPrivate::play()
 
 	if (m_playState != ePlaying)
 	{
-        m_iBeginSystemTime = (int)FFmpegUtils::currentMilliSecsSinceEpoch() - getCurTime();
+		m_externalClock.set(getCurTime());
+		m_externalClock.setPaused(false);
+		m_audioClock.setPaused(false);
+		m_videoClock.setPaused(false);
 		_synState(ePlaying);
 	}	
 }
@@ -168,6 +245,9 @@ void QcMultiMediaPlayerPrivate::pause()
 	if (m_playState != ePause)
 	{
 		_synState(ePause);
+		m_audioClock.setPaused(true);
+		m_videoClock.setPaused(true);
+		m_externalClock.setPaused(true);
 	}
 }
 
@@ -176,68 +256,150 @@ void QcMultiMediaPlayerPrivate::seek(int msTime)
 	if (m_pDemuxer == nullptr)
 		return;
 
-	//TODO: Ƶ Demuxer ߳
-	int lastState = m_playState;
-	if (m_playState == ePlaying)
-		_synState(ePause);
-
-	m_pDemuxer->seek(msTime);
-	m_videoPacketQueue.clear();
-	m_audioPacketQueue.clear();
-
-	m_pVideoDecoder->flush();
-	m_pAudioDecoder->flush();
-	m_videoQueue.clear();
-	m_audioQueue.clear();
-	m_bFileEnd = false;
-	m_videoDecodeEnd = false;
-	m_audioDecodeEnd = false;
+	//only the latest target is kept, the demuxer thread performs the seek and the new serial
+	//makes every thread drop what was read or decoded before it.
+	std::lock_guard<std::mutex> lock(m_stateMutex);
+	int serial = ++m_seekSerial;
+	m_iSeekTarget = msTime;
+	m_iSeekRequestTime = (int)FFmpegUtils::currentMilliSecsSinceEpoch();
+	m_iSeekLatency = -1;
+	m_metrics.onSeek();
+	m_videoPacketQueue.flush(serial);
+	m_audioPacketQueue.flush(serial);
 
 	m_iVideoCurTime = msTime;
 	m_iAudioCurTime = msTime;
-	m_iBeginSystemTime = (int)FFmpegUtils::currentMilliSecsSinceEpoch() - msTime;
-	if (lastState == ePlaying)
-		_synState(ePlaying);
+	_wakeupQueues();
+	m_stateCond.notify_all();
+}
+
+void QcMultiMediaPlayerPrivate::_performSeek()
+{
+	int serial = 0;
+	int msTime = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+		serial = m_seekSerial;
+		if (serial == m_demuxSerial)
+			return;
+		msTime = m_iSeekTarget;
+	}
+
+	//requests arriving meanwhile only move the target, they are picked up on the next pass.
+	m_pDemuxer->seek(msTime);
+	m_pendingPacket = nullptr;
+	m_bFileEnd = false;
+	m_demuxSerial = serial;
+	_resetClocks(msTime);
 }
 
+void QcMultiMediaPlayerPrivate::_restartDecoder(bool bVideo, int serial)
+{
+	if (bVideo)
+	{
+		m_pVideoDecoder->flush();
+		m_videoDecodeSerial = serial;
+		m_videoDecodeEnd = false;
+	}
+	else
+	{
+		m_pAudioDecoder->flush();
+		m_audioDecodeSerial = serial;
+		m_audioDecodeEnd = false;
+		m_timeStretch.reset();
+	}
+}
 
 void QcMultiMediaPlayerPrivate::_synState(int eState)
 {
+	std::unique_lock<std::mutex> lock(m_stateMutex);
 	m_playState = eState;
-	while ((hasVideo() && m_playState != m_videoThreadState)
-		|| (hasAudio() && m_playState != m_audioThreadState)
-		|| (m_demuxerThread.joinable() && m_playState != m_demuxerThreadState))
-		SwitchToThread();
+	_wakeupQueues();
+	m_stateCond.notify_all();
+	m_stateCond.wait(lock, [this] { return _isStateSynced(); });
 }
 
-void QcMultiMediaPlayerPrivate::_start()
+bool QcMultiMediaPlayerPrivate::_isStateSynced() const
 {
-	m_playState = eReady;
+	return (!(m_videoThread.joinable() || m_videoTask) || m_playState == m_videoThreadState)
+		&& (!(m_audioThread.joinable() || m_audioTask) || m_playState == m_audioThreadState)
+		&& (!(m_demuxerThread.joinable() || m_demuxTask) || m_playState == m_demuxerThreadState);
+}
 
-	m_demuxerThread = std::thread([this] { demuxeThread(); });
-	m_videoThread = std::thread([this] {videoDecodeThread(); });
-	m_audioThread = std::thread([this] {audioDecodeThread(); });
+int QcMultiMediaPlayerPrivate::_ackState(int& threadState)
+{
+	std::lock_guard<std::mutex> lock(m_stateMutex);
+	if (threadState != m_playState)
+	{
+		threadState = m_playState;
+		m_stateCond.notify_all();
+	}
+	return threadState;
 }
 
-bool QcMultiMediaPlayerPrivate::isPacketQueueFull()
+void QcMultiMediaPlayerPrivate::_waitStateChanged(int threadState, const std::function<bool()>& wakeup)
 {
-	std::lock_guard<std::mutex> lck(m_demuxerMutex);
-	return m_videoPacketQueue.packetSize() + m_audioPacketQueue.packetSize() > 15 * 1024 * 1024;
+	std::unique_lock<std::mutex> lock(m_stateMutex);
+	m_stateCond.wait(lock, [&] { return m_playState != threadState || (wakeup && wakeup()); });
 }
 
-int QcMultiMediaPlayerPrivate::readPacket(bool bVideo, AVPacketPtr& ptr)
+void QcMultiMediaPlayerPrivate::_wakeupQueues()
 {
-	bool bRet = false;
-	std::lock_guard<std::mutex> lck(m_demuxerMutex);
-	if (bVideo)
-	{
-		bRet = m_videoPacketQueue.pop(ptr);
-	}
-	else
+	m_videoPacketQueue.wakeup();
+	m_audioPacketQueue.wakeup();
+	m_videoQueue.wakeup();
+	m_audioQueue.wakeup();
+}
+
+void QcMultiMediaPlayerPrivate::_abortQueues()
+{
+	m_videoPacketQueue.abort();
+	m_audioPacketQueue.abort();
+	m_videoQueue.abort();
+	m_audioQueue.abort();
+}
+
+void QcMultiMediaPlayerPrivate::_start()
+{
+	m_playState = eReady;
+	m_videoPacketQueue.start();
+	m_audioPacketQueue.start();
+	m_videoQueue.start();
+	m_audioQueue.start();
+	m_demuxSerial = m_seekSerial;
+	m_videoDecodeSerial = m_videoPacketQueue.serial();
+	m_audioDecodeSerial = m_audioPacketQueue.serial();
+
+	if (m_pExecutor)
 	{
-		bRet = m_audioPacketQueue.pop(ptr);
+		//audio runs before video before demuxing, each step is one packet so players take turns.
+		std::lock_guard<std::mutex> lock(m_taskMutex);
+		m_bTaskMode = true;
+		m_demuxTask = m_pExecutor->submit([this] { return _demuxStep(false); }, eTaskLow);
+		if (m_pVideoDecoder)
+			m_videoTask = m_pExecutor->submit([this] { return _videoDecodeStep(false); }, eTaskNormal);
+		if (m_pAudioDecoder)
+			m_audioTask = m_pExecutor->submit([this] { return _audioDecodeStep(false); }, eTaskHigh);
+		return;
 	}
-	return bRet;
+	m_demuxerThread = std::thread([this] { demuxeThread(); });
+	if (m_pVideoDecoder)
+		m_videoThread = std::thread([this] {videoDecodeThread(); });
+	if (m_pAudioDecoder)
+		m_audioThread = std::thread([this] {audioDecodeThread(); });
+}
+
+void QcMultiMediaPlayerPrivate::_wakeStages(int stages)
+{
+	if (!m_bTaskMode)
+		return;
+	std::lock_guard<std::mutex> lock(m_taskMutex);
+	if ((stages & kDemuxStage) && m_demuxTask)
+		m_demuxTask->notify();
+	if ((stages & kVideoStage) && m_videoTask)
+		m_videoTask->notify();
+	if ((stages & kAudioStage) && m_audioTask)
+		m_audioTask->notify();
 }
 
 int QcMultiMediaPlayerPrivate::toMediaTime(int64_t pts, AVStream* pStream)
@@ -254,267 +416,526 @@ int QcMultiMediaPlayerPrivate::toMediaTime(int64_t pts, AVStream* pStream)
 	return iTime;
 }
 
-int QcMultiMediaPlayerPrivate::diffToCurrentTime(const AVFrameRef& frame)
+//the clock a stream is paced against: the video master is itself paced by the external clock.
+int QcMultiMediaPlayerPrivate::diffToCurrentTime(const AVFrameRef& frame, bool bVideo)
 {
-	int iDiff = (int)frame.ptsMsTime() - (FFmpegUtils::currentMilliSecsSinceEpoch() - m_iBeginSystemTime);
-	return iDiff;
+	int clock = (bVideo && m_clockMode == eVideoMasterClock) ? m_externalClock.get() : masterClock();
+	return frame.ptsMsTime() - clock;
 }
 
-void QcMultiMediaPlayerPrivate::demuxeThread()
+int QcMultiMediaPlayerPrivate::masterClock() const
+{
+	if (m_clockMode == eAudioMasterClock && hasAudio() && m_audioClock.isValid())
+		return m_audioClock.get();
+	if (m_clockMode == eVideoMasterClock && hasVideo() && m_videoClock.isValid())
+		return m_videoClock.get();
+	return m_externalClock.get();
+}
+
+void QcMultiMediaPlayerPrivate::_resetClocks(int msTime)
+{
+	m_externalClock.set(msTime);
+	m_audioClock.reset();
+	m_videoClock.reset();
+	m_iDriftMs = 0;
+}
+
+void QcMultiMediaPlayerPrivate::_updateDrift(const QcMediaClock& clock, bool bCorrect)
 {
-	for (;;)
+	int master = clock.get();
+	int drift = master - m_externalClock.get();
+	m_iDriftMs = drift;
+	if (std::abs(drift) > m_iMaxDriftMs)
+		m_iMaxDriftMs = std::abs(drift);
+	if (bCorrect && std::abs(drift) > kMaxClockDrift)
 	{
-		m_demuxerThreadState = m_playState;
-		if (m_demuxerThreadState == eExitThread)
-			break;
+		m_externalClock.set(master);
+		++m_nClockCorrections;
+	}
+}
+
+QsClockStats QcMultiMediaPlayerPrivate::getClockStats() const
+{
+	QsClockStats stats;
+	stats.clockMode = m_clockMode;
+	stats.masterTime = masterClock();
+	stats.driftMs = m_iDriftMs;
+	stats.maxDriftMs = m_iMaxDriftMs;
+	stats.corrections = m_nClockCorrections;
+	stats.droppedVideoFrames = m_metrics.droppedVideoFrames();
+	return stats;
+}
+
+QsPlayerStats QcMultiMediaPlayerPrivate::getStats() const
+{
+	QsPlayerStats stats;
+	m_metrics.snapshot(stats);
+	stats.videoPackets = m_videoPacketQueue.packetCount();
+	stats.videoPacketBytes = m_videoPacketQueue.packetSize();
+	stats.audioPackets = m_audioPacketQueue.packetCount();
+	stats.audioPacketBytes = m_audioPacketQueue.packetSize();
+	stats.videoBufferedMs = m_videoPacketQueue.bufferedTime();
+	stats.audioBufferedMs = m_audioPacketQueue.bufferedTime();
+	stats.videoFrames = m_videoQueue.size();
+	stats.audioFrames = m_audioQueue.size();
+	if (m_videoClock.isValid() && m_audioClock.isValid())
+		stats.avOffsetMs = m_videoClock.get() - m_audioClock.get();
+	stats.lastSeekLatency = m_iSeekLatency;
+	return stats;
+}
+
+void QcMultiMediaPlayerPrivate::setBufferingMode(int mode)
+{
+	m_bufferingPolicy.setMode(mode);
+	if (m_pDemuxer)
+		_applyBuffering();
+}
+
+int QcMultiMediaPlayerPrivate::bufferedTime(bool bVideo) const
+{
+	return bVideo ? m_videoPacketQueue.bufferedTime() : m_audioPacketQueue.bufferedTime();
+}
+
+void QcMultiMediaPlayerPrivate::_applyBuffering()
+{
+	AVStream* pVideoStream = m_pDemuxer->videoStream();
+	if (pVideoStream)
+	{
+		m_videoPacketQueue.setTimeBase(pVideoStream->time_base.num, pVideoStream->time_base.den);
+		m_videoPacketQueue.setWatermarks(m_bufferingPolicy.watermarks(true, pVideoStream->codecpar->bit_rate));
+	}
+	AVStream* pAudioStream = m_pDemuxer->audioStream();
+	if (pAudioStream)
+	{
+		m_audioPacketQueue.setTimeBase(pAudioStream->time_base.num, pAudioStream->time_base.den);
+		m_audioPacketQueue.setWatermarks(m_bufferingPolicy.watermarks(false, pAudioStream->codecpar->bit_rate));
+	}
+}
+
+//called after every push and pop, a queue may only overfill while the other stream is decoded too.
+void QcMultiMediaPlayerPrivate::_balanceBuffering()
+{
+	if (hasVideo() && hasAudio())
+		QcBufferingPolicy::balance(m_videoPacketQueue, m_audioPacketQueue);
+}
+
+void QcMultiMediaPlayerPrivate::setRate(double rate)
+{
+	rate = std::min<double>(std::max<double>(rate, kMinRate), kMaxRate);
+	m_fRate = (float)rate;
+	m_externalClock.setSpeed(rate);
+	m_audioClock.setSpeed(rate);
+	m_videoClock.setSpeed(rate);
+}
+
+//replaces frame by its stretched version, false while the stretcher has nothing to hand out yet.
+bool QcMultiMediaPlayerPrivate::_stretchAudio(AVFrameRef& frame)
+{
+	float rate = m_fRate;
+	if (rate == 1.0f)
+	{
+		//what the stretcher still holds is dropped, a few ms at the switch back.
+		if (m_bStretching)
+			m_timeStretch.reset();
+		m_bStretching = false;
+		return true;
+	}
+
+	QsAudioPara para;
+	para.sampleRate = frame->sample_rate;
+	para.sampleFormat = FFmpegUtils::FromFFmpegAudioFormat(frame.format());
+	para.nChannels = frame.channelCount();
+	if (para != m_stretchPara)
+	{
+		QsAudioPara floatPara = para;
+		floatPara.sampleFormat = eSampleFormatFloat;
+		if (para.sampleFormat != eSampleFormatFloat
+			&& (!m_stretchToFloat.init(para, floatPara) || !m_stretchFromFloat.init(floatPara, para)))
+			return true;
+		m_stretchPara = para;
+		m_timeStretch.init(para.sampleRate, para.nChannels);
+	}
+	m_timeStretch.setRate(rate);
+	m_bStretching = true;
+
+	const float* samples = (const float*)frame.data(0);
+	int nSamples = frame.sampleCount();
+	if (para.sampleFormat != eSampleFormatFloat)
+	{
+		if (!m_stretchToFloat.transformat(frame.data(), nSamples, m_stretchInFrame))
+			return false;
+		samples = (const float*)m_stretchInFrame.data(0);
+		nSamples = m_stretchInFrame.sampleCount();
+	}
+	m_stretchBuffer.clear();
+	int nOut = m_timeStretch.process(samples, nSamples, m_stretchBuffer);
+	if (nOut <= 0)
+		return false;
+
+	AVFrameRef outFrame;
+	if (para.sampleFormat == eSampleFormatFloat)
+	{
+		outFrame = AVFrameRef::allocAudioFrame(nOut, para.nChannels, frame.format());
+		memcpy(outFrame.data(0), m_stretchBuffer.data(), m_stretchBuffer.size() * sizeof(float));
+	}
+	else
+	{
+		const uint8_t* src[] = { (const uint8_t*)m_stretchBuffer.data() };
+		if (!m_stretchFromFloat.transformat(src, nOut, outFrame))
+			return false;
+	}
+	outFrame->sample_rate = para.sampleRate;
+	outFrame->channel_layout = frame.channelLayout();
+	outFrame->pts = frame->pts;
+	outFrame.setPtsMsTime(frame.ptsMsTime());
+	outFrame.setSerial(frame.serial());
+	frame = outFrame;
+	return true;
+}
+
+void QcMultiMediaPlayerPrivate::_adaptSkipFrame(uint32_t decodeUs)
+{
+	//the cost is only learned while every frame is decoded, skipped packets would make it look cheap.
+	if (m_iSkipFrame == eDiscardNone)
+		m_iVideoDecodeCostUs += ((int)decodeUs - m_iVideoDecodeCostUs) / 8;
+
+	double frameRate = m_pDemuxer->getMediaInfo().frameRate;
+	double rate = m_fRate;
+	if (frameRate <= 0)
+		return;
+	double load = m_iVideoDecodeCostUs * frameRate * rate / 1000000;
+	int skip = eDiscardNone;
+	if (rate > 1.0 && (load > kSkipFrameLoad || (m_iSkipFrame != eDiscardNone && load > kDecodeAllLoad)))
+		skip = eDiscardNonRef;
+	if (skip != m_iSkipFrame)
+	{
+		m_iSkipFrame = skip;
+		m_pVideoDecoder->setSkipFrame(skip);
+	}
+}
+
+void QcMultiMediaPlayerPrivate::setStatsDumpInterval(int ms)
+{
+	m_iStatsDumpInterval = ms > 0 ? ms : 0;
+	m_iNextStatsDump = (int)FFmpegUtils::currentMilliSecsSinceEpoch() + m_iStatsDumpInterval;
+}
+
+//called from both decode threads, whichever passes the due time first writes the line.
+void QcMultiMediaPlayerPrivate::_dumpStats()
+{
+	int interval = m_iStatsDumpInterval;
+	if (interval <= 0)
+		return;
+	int now = (int)FFmpegUtils::currentMilliSecsSinceEpoch();
+	int due = m_iNextStatsDump;
+	if (now - due < 0 || !m_iNextStatsDump.compare_exchange_strong(due, now + interval))
+		return;
+
+	QsPlayerStats stats = getStats();
+	char line[512];
+	snprintf(line, sizeof(line),
+		"player demux=%u pkt/s %u KB/s queue v=%u/%uKB/%dms a=%u/%uKB/%dms frames v=%u a=%u "
+		"decode v=%uus(p99 %uus) a=%uus(p99 %uus) dropped=%u late=%u av=%dms seek=%dms\n",
+		stats.demuxPacketRate, stats.demuxByteRate / 1024,
+		stats.videoPackets, stats.videoPacketBytes / 1024, stats.videoBufferedMs,
+		stats.audioPackets, stats.audioPacketBytes / 1024, stats.audioBufferedMs,
+		stats.videoFrames, stats.audioFrames,
+		stats.videoDecode.avgUs, stats.videoDecode.p99Us, stats.audioDecode.avgUs, stats.audioDecode.p99Us,
+		stats.droppedVideoFrames, stats.lateVideoFrames, stats.avOffsetMs, stats.lastSeekLatency);
+#ifdef _WIN32
+	OutputDebugStringA(line);
+#endif
+	fputs(line, stderr);
+}
 
-		if (m_bFileEnd)
+//Hand every due frame to the notify, returns the ms until the next frame is due or -1 when there is nothing to wait for.
+int QcMultiMediaPlayerPrivate::presentFrames(bool bVideo)
+{
+	if (m_pNotify == nullptr)
+		return -1;
+
+	FrameQueue& queue = bVideo ? m_videoQueue : m_audioQueue;
+	int serial = bVideo ? m_videoPacketQueue.serial() : m_audioPacketQueue.serial();
+	AVFrameRef playFrame;
+	bool bPlay = false;
+	int iPlayDiff = 0;
+	int iWaitTime = -1;
+	while (const AVFrameRef* pFrame = queue.peek())
+	{
+		if (pFrame->serial() != serial)
 		{
-			::Sleep(10);
+			queue.pop();
 			continue;
 		}
-		switch (m_demuxerThreadState)
-		{
-		case eReady:
-		case ePause:
+
+		//the audio master is paced by the output pulling samples, everything else by its pts.
+		int iPending = bVideo ? -1 : m_pNotify->audioPendingTime();
+		int iDiff = 0;
+		if (iPending >= 0 && m_clockMode == eAudioMasterClock)
+			iDiff = iPending - kAudioSinkBufferTime;
+		else
+			iDiff = diffToCurrentTime(*pFrame, bVideo);
+		if (iDiff >= kPresentAheadTime)
 		{
-			::Sleep(10);
+			iWaitTime = iDiff - kPresentAheadTime + 1;
 			break;
 		}
-		case ePlaying:
+		if (bVideo)
 		{
-			if (isPacketQueueFull())
-			{
-				::Sleep(10);
-				continue;
-			}
-			AVPacketPtr pkt = FFmpegUtils::allocAVPacket();
-			int iRet = m_pDemuxer->readPacket(pkt);
-			if (iRet == 0)
-			{
-				std::lock_guard<std::mutex> lck(m_demuxerMutex);
-				if (m_pDemuxer->videoStream() && pkt->stream_index == m_pDemuxer->videoStream()->index)
-				{
-					m_videoPacketQueue.push(pkt);
-				}
-				if (m_pDemuxer->audioStream() && pkt->stream_index == m_pDemuxer->audioStream()->index)
-				{
-					m_audioPacketQueue.push(pkt);
-				}
-			}
-			else
+			//late video frames are dropped, only the newest due one is shown.
+			if (bPlay)
+				m_metrics.onVideoDropped();
+			m_iVideoCurTime = pFrame->ptsMsTime();
+			playFrame = *pFrame;
+			bPlay = true;
+			iPlayDiff = iDiff;
+			queue.pop();
+		}
+		else
+		{
+			//close() aborts the queue under a peeked frame.
+			AVFrameRef frame;
+			if (!queue.pop(frame))
+				break;
+			m_iAudioCurTime = frame.ptsMsTime();
+			int sampleRate = frame->sample_rate;
+			int endTime = sampleRate > 0 ? frame.ptsMsTime() + (int)((int64_t)frame.sampleCount() * 1000 / sampleRate) : 0;
+			if (_stretchAudio(frame))
+				m_pNotify->OnAudioFrame(frame);
+			onFramePresented(serial);
+
+			//the output reports what it has not played yet, the audio clock is the end of this frame minus that.
+			//what is pending plays at the rate, the stretcher still holds back some of the frame's input.
+			iPending = m_pNotify->audioPendingTime();
+			if (iPending >= 0 && sampleRate > 0)
 			{
-				m_bFileEnd = m_pDemuxer->isFileEnd();
+				if (m_bStretching)
+					endTime -= (int)((int64_t)m_timeStretch.latency() * 1000 / sampleRate);
+				m_audioClock.set(endTime - (int)(iPending * m_fRate));
+				if (m_clockMode != eVideoMasterClock)
+					_updateDrift(m_audioClock, m_clockMode == eAudioMasterClock);
 			}
-			break;
-		}
 		}
 	}
+	if (bPlay)
+	{
+		m_pNotify->OnVideoFrame(playFrame);
+		onFramePresented(serial);
+		m_metrics.onVideoPresented(iPlayDiff < -kLateFrameTime);
+		m_videoClock.set(playFrame.ptsMsTime());
+		if (m_clockMode == eVideoMasterClock)
+			_updateDrift(m_videoClock, true);
+	}
+	_dumpStats();
+	return iWaitTime;
+}
+
+void QcMultiMediaPlayerPrivate::demuxeThread()
+{
+	while (_demuxStep(true) != QcTask::kDone)
+	{
+	}
 }
 
 void QcMultiMediaPlayerPrivate::videoDecodeThread()
 {
-	for (;;)
+	while (_videoDecodeStep(true) != QcTask::kDone)
 	{
-		m_videoThreadState = m_playState;
-		if (m_videoThreadState == eExitThread)
-			break;
+	}
+}
 
-		if (m_videoDecodeEnd)
-		{
-			::Sleep(10);
-			continue;
-		}
+void QcMultiMediaPlayerPrivate::audioDecodeThread()
+{
+	while (_audioDecodeStep(true) != QcTask::kDone)
+	{
+	}
+}
 
-		switch (m_videoThreadState)
-		{
-		case eReady:
-		case ePause:
-		{
-			::Sleep(10);
-			break;
-		}
+//One pass of a stage. A thread runs it with bBlocking and waits inside, as a QcTask it never waits:
+//it returns kIdle or the ms until it has something to do, and the queue wake callbacks resume it.
+int QcMultiMediaPlayerPrivate::_demuxStep(bool bBlocking)
+{
+	int eState = _ackState(m_demuxerThreadState);
+	if (eState == eExitThread)
+		return QcTask::kDone;
 
-		case ePlaying:
-		{
-			int iVideoQueueSize = 0;
-			{
-				AVFrameRef playFrame;
-				bool bPlay = false;
-				{
-					QmStdMutexLocker(m_videoQueue.mutex());
-					iVideoQueueSize = m_videoQueue.size();
-					if (iVideoQueueSize > 0 && m_pNotify)
-					{
-						//֡
-						while (m_videoQueue.front(playFrame) && diffToCurrentTime(playFrame) < 5)
-						{
-							--iVideoQueueSize;
-							m_iVideoCurTime = playFrame.ptsMsTime();
-							m_videoQueue.pop(playFrame);
-							bPlay = true;
-						}
-					}
-				}
-				if (bPlay && m_pNotify)
-				{
-					m_pNotify->OnVideoFrame(playFrame);
-				}
-			}
+	_performSeek();
+	if (eState != ePlaying || m_bFileEnd)
+	{
+		if (!bBlocking)
+			return QcTask::kIdle;
+		_waitStateChanged(eState, [this] { return m_seekSerial != m_demuxSerial; });
+		return 0;
+	}
 
-			if (iVideoQueueSize < 3)
-			{
-				AVPacketPtr pkt;
-				if (readPacket(true, pkt) || m_pDemuxer->isFileEnd())
-				{
-					static uint32_t totalTime;
-					static uint32_t gCount = 0;
-					static libtime::FpsTimer fps;
-					libtime::ScopedTime scoped([&](uint32_t time) {
-						totalTime += time;
-						++gCount;
-						if (fps.tick())
-						{
-							wchar_t buffer[256];
-							wsprintfW(buffer, L"videoTime=%d fps=%d\n", totalTime/gCount, (int)fps.fps());
-							OutputDebugStringW(buffer);
-							totalTime = 0;
-							gCount = 0;
-						}
-					});
-
-					int iRet = m_pVideoDecoder->decode(pkt.get());
-					for (; iRet == FFmpegVideoDecoder::kOk;)
-					{
-						AVFrameRef frame;
-						iRet = m_pVideoDecoder->recv(frame);
-						if (iRet == FFmpegVideoDecoder::kOk)
-						{
-							int mediaTime = toMediaTime(frame->pts, m_pDemuxer->videoStream());
-							frame.setPtsMsTime(mediaTime);
-
-							QmStdMutexLocker(m_videoQueue.mutex());
-							m_videoQueue.push(frame);
-							continue;
-						}
-						else if (iRet == FFmpegVideoDecoder::kEOF)
-						{
-							m_videoDecodeEnd = true;
-							onNotifyFileEnd();
-						}
-						break;
-					}
-				}
-			}
-			else
+	if (!m_pendingPacket)
+	{
+		AVPacketPtr pkt = FFmpegUtils::allocAVPacket();
+		int iRet = m_pDemuxer->readPacket(pkt);
+		if (iRet != 0)
+		{
+			m_bFileEnd = m_pDemuxer->isFileEnd();
+			if (m_bFileEnd)
 			{
-				::Sleep(10);
+				m_videoPacketQueue.setEnd(true, m_demuxSerial);
+				m_audioPacketQueue.setEnd(true, m_demuxSerial);
 			}
-			break;
-		}
+			return 0;
 		}
+		m_pendingPacket = pkt;
+		m_metrics.onPacketDemuxed(pkt->size);
+	}
+
+	PacketQueue* pQueue = nullptr;
+	if (m_pVideoDecoder && m_pDemuxer->videoStream() && m_pendingPacket->stream_index == m_pDemuxer->videoStream()->index)
+	{
+		pQueue = &m_videoPacketQueue;
+	}
+	else if (m_pAudioDecoder && m_pDemuxer->audioStream() && m_pendingPacket->stream_index == m_pDemuxer->audioStream()->index)
+	{
+		pQueue = &m_audioPacketQueue;
 	}
+	//push blocks while the queue is full; when a state change interrupts it the packet is kept and retried.
+	int next = 0;
+	if (pQueue == nullptr || pQueue->push(m_pendingPacket, m_demuxSerial, bBlocking ? -1 : 0))
+		m_pendingPacket = nullptr;
+	else if (!bBlocking)
+		next = QcTask::kIdle;
+	_balanceBuffering();
+	return next;
 }
 
-void QcMultiMediaPlayerPrivate::audioDecodeThread()
+int QcMultiMediaPlayerPrivate::_videoDecodeStep(bool bBlocking)
 {
-	for (;;)
+	int eState = _ackState(m_videoThreadState);
+	if (eState == eExitThread)
+		return QcTask::kDone;
+
+	int serial = m_videoPacketQueue.serial();
+	if (serial != m_videoDecodeSerial)
+		_restartDecoder(true, serial);
+
+	if (eState != ePlaying || m_videoDecodeEnd)
 	{
-		m_audioThreadState = m_playState;
-		if (m_audioThreadState == eExitThread)
-			break;
+		if (!bBlocking)
+			return QcTask::kIdle;
+		_waitStateChanged(eState, [this] { return m_videoPacketQueue.serial() != m_videoDecodeSerial; });
+		return 0;
+	}
+
+	int iWaitTime = presentFrames(true);
+	if (!m_videoQueue.waitForSpace(bBlocking ? iWaitTime : 0))
+		return bBlocking ? 0 : iWaitTime;
 
-		if (m_audioDecodeEnd)
+	AVFrameRef frame;
+	int iRet = m_pVideoDecoder->recv(frame);
+	if (iRet == FFmpegVideoDecoder::kOk)
+	{
+		int mediaTime = toMediaTime(frame->pts, m_pDemuxer->videoStream());
+		frame.setPtsMsTime(mediaTime);
+		frame.setSerial(m_videoDecodeSerial);
+		m_videoQueue.push(frame);
+		m_metrics.onFrameDecoded(true);
+	}
+	else if (iRet == FFmpegVideoDecoder::kEOF)
+	{
+		m_videoDecodeEnd = true;
+		if (m_videoDecodeSerial == m_videoPacketQueue.serial())
+			onNotifyFileEnd();
+	}
+	else
+	{
+		AVPacketPtr pkt;
+		bool bPacket = m_videoPacketQueue.pop(pkt, serial, bBlocking ? iWaitTime : 0);
+		if (bPacket)
+			_balanceBuffering();
+		//the first packet after a seek restarts the decoder before it is decoded.
+		if (bPacket && serial != m_videoDecodeSerial)
+			_restartDecoder(true, serial);
+		if (bPacket || m_videoPacketQueue.isEnd())
 		{
-			::Sleep(10);
-			continue;
+			auto begin = std::chrono::steady_clock::now();
+			m_pVideoDecoder->decode(pkt.get());
+			uint32_t decodeUs = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - begin).count();
+			m_metrics.onDecodeTime(true, decodeUs);
+			_adaptSkipFrame(decodeUs);
 		}
-		switch (m_audioThreadState)
-		{
-		case eReady:
-		case ePause:
+		else if (!bBlocking)
 		{
-			::Sleep(10);
-			break;
+			//nothing to decode until a packet arrives or the next frame is due.
+			return iWaitTime;
 		}
+	}
+	return 0;
+}
 
-		case ePlaying:
-		{
-			int iQueueSize = 0;
-			{
-				AVFrameRef playFrame;
-				bool bPlay = false;
-				{
-					QmStdMutexLocker(m_audioQueue.mutex());
-					iQueueSize = m_audioQueue.size();
-					if (iQueueSize > 0 && m_pNotify)
-					{
-						if (m_audioQueue.front(playFrame) && diffToCurrentTime(playFrame) < 5)
-						{
-							--iQueueSize;
-							m_iAudioCurTime = playFrame.ptsMsTime();
-							m_audioQueue.pop(playFrame);
-							bPlay = true;
-						}
-					}
-				}
-				if (bPlay && m_pNotify)
-				{
-					m_pNotify->OnAudioFrame(playFrame);
-				}
-			}
+int QcMultiMediaPlayerPrivate::_audioDecodeStep(bool bBlocking)
+{
+	int eState = _ackState(m_audioThreadState);
+	if (eState == eExitThread)
+		return QcTask::kDone;
 
+	int serial = m_audioPacketQueue.serial();
+	if (serial != m_audioDecodeSerial)
+		_restartDecoder(false, serial);
 
-			if (iQueueSize < 3)
-			{
-				AVPacketPtr pkt;
-				if (readPacket(false, pkt) || m_pDemuxer->isFileEnd())
-				{
-					static uint32_t totalTime;
-					static uint32_t gCount = 0;
-					static libtime::FpsTimer fps;
-					libtime::ScopedTime scoped([&](uint32_t time) {
-						totalTime += time;
-						++gCount;
-						if (fps.tick())
-						{
-							wchar_t buffer[256];
-							wsprintfW(buffer, L"audioTime=%d fps=%d\n", totalTime / gCount, (int)fps.fps());
-							OutputDebugStringW(buffer);
-						}
-					});
-
-					int iRet = m_pAudioDecoder->decode(pkt.get());
-					for (; iRet == FFmpegVideoDecoder::kOk;)
-					{
-						AVFrameRef frame;
-						iRet = m_pAudioDecoder->recv(frame);
-						if (iRet == FFmpegVideoDecoder::kOk)
-						{
-							int mediaTime = toMediaTime(frame->pts, m_pDemuxer->audioStream());
-							frame.setPtsMsTime(mediaTime);
-
-							QmStdMutexLocker(m_audioQueue.mutex());
-							m_audioQueue.push(frame);
-							continue;
-						}
-						else if (iRet == FFmpegVideoDecoder::kEOF)
-						{
-							m_audioDecodeEnd = true;
-							onNotifyFileEnd();
-						}
-						break;
-					}
-				}
-			}
-			else
-			{
-				::Sleep(10);
-			}
-			break;
+	if (eState != ePlaying || m_audioDecodeEnd)
+	{
+		if (!bBlocking)
+			return QcTask::kIdle;
+		_waitStateChanged(eState, [this] { return m_audioPacketQueue.serial() != m_audioDecodeSerial; });
+		return 0;
+	}
+
+	int iWaitTime = presentFrames(false);
+	if (!m_audioQueue.waitForSpace(bBlocking ? iWaitTime : 0))
+		return bBlocking ? 0 : iWaitTime;
+
+	AVFrameRef frame;
+	int iRet = m_pAudioDecoder->recv(frame);
+	if (iRet == FFmpegAudioDecoder::kOk)
+	{
+		int mediaTime = toMediaTime(frame->pts, m_pDemuxer->audioStream());
+		frame.setPtsMsTime(mediaTime);
+		frame.setSerial(m_audioDecodeSerial);
+		m_audioQueue.push(frame);
+		m_metrics.onFrameDecoded(false);
+	}
+	else if (iRet == FFmpegAudioDecoder::kEOF)
+	{
+		m_audioDecodeEnd = true;
+		if (m_audioDecodeSerial == m_audioPacketQueue.serial())
+			onNotifyFileEnd();
+	}
+	else
+	{
+		AVPacketPtr pkt;
+		bool bPacket = m_audioPacketQueue.pop(pkt, serial, bBlocking ? iWaitTime : 0);
+		if (bPacket)
+			_balanceBuffering();
+		//the first packet after a seek restarts the decoder before it is decoded.
+		if (bPacket && serial != m_audioDecodeSerial)
+			_restartDecoder(false, serial);
+		if (bPacket || m_audioPacketQueue.isEnd())
+		{
+			auto begin = std::chrono::steady_clock::now();
+			m_pAudioDecoder->decode(pkt.get());
+			m_metrics.onDecodeTime(false, (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - begin).count());
 		}
+		else if (!bBlocking)
+		{
+			return iWaitTime;
 		}
 	}
+	return 0;
+}
+
+void QcMultiMediaPlayerPrivate::onFramePresented(int serial)
+{
+	if (m_iSeekLatency < 0 && serial == m_seekSerial)
+		m_iSeekLatency = (int)FFmpegUtils::currentMilliSecsSinceEpoch() - m_iSeekRequestTime;
 }
 
 void QcMultiMediaPlayerPrivate::onNotifyFileEnd()
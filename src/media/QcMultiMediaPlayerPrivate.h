@@ -4,9 +4,20 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include "QsMediaInfo.h"
 #include "FrameQueue.h"
 #include "PacketQueue.h"
+#include "QcMediaClock.h"
+#include "QcPlayerMetrics.h"
+#include "QcBufferingPolicy.h"
+#include "QcAudioTimeStretch.h"
+#include "QcAudioTransformat.h"
+#include "QcTaskExecutor.h"
+#include "AVFrameRef.h"
+#include <vector>
 #include "QcMultiMediaPlayer.h"
 
 struct AVCodecContext;
@@ -26,7 +37,7 @@ public:
     ~QcMultiMediaPlayerPrivate();
 
 	void setHwDevice(AVBufferRef* device_ctx);
-	bool open(const char* pFile);
+	bool open(const char* pFile, const QsDecoderOptions& options = QsDecoderOptions());
 	void play();
 	void pause();
 	void seek(int msTime);
@@ -40,17 +51,49 @@ public:
     bool hasAudio() const  {return m_pAudioDecoder != nullptr; }
 	int getCurTime() const;
 	int getTotalTime() const;
+	int getLastSeekLatency() const { return m_iSeekLatency; }
+	void setClockMode(int mode) { m_clockMode = mode; }
+	int clockMode() const { return m_clockMode; }
+	QsClockStats getClockStats() const;
+	QsPlayerStats getStats() const;
+	void setStatsDumpInterval(int ms);
+	void setBufferingMode(int mode);
+	int bufferingMode() const { return m_bufferingPolicy.mode(); }
+	int bufferedTime(bool bVideo) const;
+	void setRate(double rate);
+	double rate() const { return m_fRate; }
+	void setExecutor(QcTaskExecutor* pExecutor) { m_pExecutor = pExecutor; }
+	QcTaskExecutor* executor() const { return m_pExecutor; }
 protected:
     void _start();
 	void _synState(int eState);
-	bool isPacketQueueFull();
-	int readPacket(bool bVideo, AVPacketPtr& ptr);
+	bool _isStateSynced() const;
+	int _ackState(int& threadState);
+	void _waitStateChanged(int threadState, const std::function<bool()>& wakeup = nullptr);
+	void _performSeek();
+	void _restartDecoder(bool bVideo, int serial);
+	void _wakeupQueues();
+	void _abortQueues();
+	int presentFrames(bool bVideo);
 	int toMediaTime(int64_t pts, AVStream*);
-	int diffToCurrentTime(const AVFrameRef& frame);
+	int diffToCurrentTime(const AVFrameRef& frame, bool bVideo);
+	int masterClock() const;
+	void _resetClocks(int msTime);
+	void _updateDrift(const QcMediaClock& clock, bool bCorrect);
+	void _dumpStats();
+	void _applyBuffering();
+	void _balanceBuffering();
+	bool _stretchAudio(AVFrameRef& frame);
+	void _adaptSkipFrame(uint32_t decodeUs);
 
 	void demuxeThread();
 	void videoDecodeThread();
 	void audioDecodeThread();
+	int _demuxStep(bool bBlocking);
+	int _videoDecodeStep(bool bBlocking);
+	int _audioDecodeStep(bool bBlocking);
+	void _wakeStages(int stages);
+	void onFramePresented(int serial);
 	void onNotifyFileEnd();
 protected: 
 	std::unique_ptr<FFmpegDemuxer> m_pDemuxer;
@@ -58,29 +101,71 @@ protected:
 	std::unique_ptr<FFmpegAudioDecoder> m_pAudioDecoder;
 	AVBufferRef * m_hw_device_ctx = nullptr;
     
-    int m_playState = eReady;
+    std::atomic<int> m_playState{ eReady };
 	int m_videoThreadState = eReady;
 	int m_audioThreadState = eReady;
 	int m_demuxerThreadState = eReady;
     std::thread m_videoThread;
     std::thread m_audioThread;
 	std::thread m_demuxerThread;
+	//with an executor the stages run as tasks instead of the three threads.
+	QcTaskExecutor* m_pExecutor = nullptr;
+	std::atomic<bool> m_bTaskMode{ false };
+	std::mutex m_taskMutex;
+	QcTaskPtr m_demuxTask;
+	QcTaskPtr m_videoTask;
+	QcTaskPtr m_audioTask;
+	std::mutex m_stateMutex;
+	std::condition_variable m_stateCond;
 
 	int m_iVideoCurTime = 0;
 	int m_iAudioCurTime = 0;
 	FrameQueue m_videoQueue;
 	FrameQueue m_audioQueue;
 
-	std::mutex m_demuxerMutex;
 	PacketQueue m_videoPacketQueue;
 	PacketQueue m_audioPacketQueue;
+	QcBufferingPolicy m_bufferingPolicy;
+	AVPacketPtr m_pendingPacket;
 	bool m_bFileEnd = false;
 	bool m_videoDecodeEnd = false;
 	bool m_audioDecodeEnd = false;
+
+	//seek() only records the latest target, the demuxer thread performs it.
+	std::atomic<int> m_seekSerial{ 0 };
+	int m_iSeekTarget = 0;
+	std::atomic<int> m_iSeekRequestTime{ 0 };
+	std::atomic<int> m_iSeekLatency{ 0 };
+	int m_demuxSerial = 0;
+	std::atomic<int> m_videoDecodeSerial{ 0 };
+	std::atomic<int> m_audioDecodeSerial{ 0 };
 	
     IMultiMediaNotify* m_pNotify = nullptr;
 
-	int m_iBeginSystemTime = 0;
+	std::atomic<int> m_clockMode{ eAudioMasterClock };
+	QcMediaClock m_audioClock;
+	QcMediaClock m_videoClock;
+	QcMediaClock m_externalClock;
+	std::atomic<float> m_fRate{ 1.0f };
+	std::atomic<int> m_iDriftMs{ 0 };
+	std::atomic<int> m_iMaxDriftMs{ 0 };
+	std::atomic<uint32_t> m_nClockCorrections{ 0 };
+
+	//audio thread only: frames are stretched in the decoded format, through float when that is another one.
+	QcAudioTimeStretch m_timeStretch;
+	QcAudioTransformat m_stretchToFloat;
+	QcAudioTransformat m_stretchFromFloat;
+	QsAudioPara m_stretchPara;
+	AVFrameRef m_stretchInFrame;
+	std::vector<float> m_stretchBuffer;
+	bool m_bStretching = false;
+	//video thread only: decode cost per packet while nothing is skipped, and what is skipped now.
+	int m_iVideoDecodeCostUs = 0;
+	int m_iSkipFrame = eDiscardNone;
+
+	QcPlayerMetrics m_metrics;
+	std::atomic<int> m_iStatsDumpInterval{ 0 };
+	std::atomic<int> m_iNextStatsDump{ 0 };
 };
 
 #endif
@@ -0,0 +1,160 @@
+#include "QcPlayerMetrics.h"
+
+static int bucketOf(uint32_t us)
+{
+	int bucket = 0;
+	while (us > 1 && bucket < QsLatencyHistogram::kBuckets - 1)
+	{
+		us >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+//upper bound of the bucket the given fraction of the samples falls into.
+static uint32_t percentile(const QsLatencyHistogram& histogram, double fraction)
+{
+	uint32_t target = (uint32_t)(histogram.count * fraction);
+	uint32_t seen = 0;
+	for (int i = 0; i < QsLatencyHistogram::kBuckets; ++i)
+	{
+		seen += histogram.buckets[i];
+		if (seen > target)
+		{
+			uint32_t bound = i == QsLatencyHistogram::kBuckets - 1 ? histogram.maxUs : (2u << i);
+			return bound < histogram.maxUs ? bound : histogram.maxUs;
+		}
+	}
+	return histogram.maxUs;
+}
+
+QcLatencyHistogram::QcLatencyHistogram()
+{
+	reset();
+}
+
+void QcLatencyHistogram::record(uint32_t us)
+{
+	m_buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sumUs.fetch_add(us, std::memory_order_relaxed);
+	uint32_t maxUs = m_maxUs.load(std::memory_order_relaxed);
+	while (us > maxUs && !m_maxUs.compare_exchange_weak(maxUs, us, std::memory_order_relaxed))
+	{
+	}
+}
+
+void QcLatencyHistogram::reset()
+{
+	for (auto& bucket : m_buckets)
+		bucket.store(0, std::memory_order_relaxed);
+	m_count = 0;
+	m_maxUs = 0;
+	m_sumUs = 0;
+}
+
+QsLatencyHistogram QcLatencyHistogram::snapshot() const
+{
+	QsLatencyHistogram histogram;
+	//the buckets are summed rather than m_count read, so the percentiles stay consistent with them.
+	for (int i = 0; i < QsLatencyHistogram::kBuckets; ++i)
+	{
+		histogram.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		histogram.count += histogram.buckets[i];
+	}
+	uint32_t count = m_count.load(std::memory_order_relaxed);
+	histogram.avgUs = count ? (uint32_t)(m_sumUs.load(std::memory_order_relaxed) / count) : 0;
+	histogram.maxUs = m_maxUs.load(std::memory_order_relaxed);
+	histogram.p50Us = percentile(histogram, 0.5);
+	histogram.p99Us = percentile(histogram, 0.99);
+	return histogram;
+}
+
+void QcRateMeter::add(uint32_t n)
+{
+	auto now = std::chrono::steady_clock::now();
+	if (m_windowCount == 0 && m_windowStart == std::chrono::steady_clock::time_point())
+		m_windowStart = now;
+	m_windowCount += n;
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_windowStart).count();
+	if (elapsed >= 1000)
+	{
+		m_rate = (uint32_t)(m_windowCount * 1000 / elapsed);
+		m_windowStart = now;
+		m_windowCount = 0;
+	}
+}
+
+void QcRateMeter::reset()
+{
+	m_windowStart = std::chrono::steady_clock::time_point();
+	m_windowCount = 0;
+	m_rate = 0;
+}
+
+void QcPlayerMetrics::reset()
+{
+	m_demuxedPackets = 0;
+	m_demuxedBytes = 0;
+	m_demuxPacketRate.reset();
+	m_demuxByteRate.reset();
+	m_decodedVideoFrames = 0;
+	m_decodedAudioFrames = 0;
+	m_videoDecode.reset();
+	m_audioDecode.reset();
+	m_presentedVideoFrames = 0;
+	m_droppedVideoFrames = 0;
+	m_lateVideoFrames = 0;
+	m_seeks = 0;
+}
+
+void QcPlayerMetrics::onPacketDemuxed(int bytes)
+{
+	m_demuxedPackets.fetch_add(1, std::memory_order_relaxed);
+	m_demuxedBytes.fetch_add(bytes, std::memory_order_relaxed);
+	m_demuxPacketRate.add(1);
+	m_demuxByteRate.add(bytes);
+}
+
+void QcPlayerMetrics::onFrameDecoded(bool bVideo)
+{
+	(bVideo ? m_decodedVideoFrames : m_decodedAudioFrames).fetch_add(1, std::memory_order_relaxed);
+}
+
+void QcPlayerMetrics::onDecodeTime(bool bVideo, uint32_t us)
+{
+	(bVideo ? m_videoDecode : m_audioDecode).record(us);
+}
+
+void QcPlayerMetrics::onVideoPresented(bool bLate)
+{
+	m_presentedVideoFrames.fetch_add(1, std::memory_order_relaxed);
+	if (bLate)
+		m_lateVideoFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QcPlayerMetrics::onVideoDropped()
+{
+	m_droppedVideoFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QcPlayerMetrics::onSeek()
+{
+	m_seeks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QcPlayerMetrics::snapshot(QsPlayerStats& stats) const
+{
+	stats.demuxedPackets = m_demuxedPackets.load(std::memory_order_relaxed);
+	stats.demuxedBytes = m_demuxedBytes.load(std::memory_order_relaxed);
+	stats.demuxPacketRate = m_demuxPacketRate.rate();
+	stats.demuxByteRate = m_demuxByteRate.rate();
+	stats.decodedVideoFrames = m_decodedVideoFrames.load(std::memory_order_relaxed);
+	stats.decodedAudioFrames = m_decodedAudioFrames.load(std::memory_order_relaxed);
+	stats.videoDecode = m_videoDecode.snapshot();
+	stats.audioDecode = m_audioDecode.snapshot();
+	stats.presentedVideoFrames = m_presentedVideoFrames.load(std::memory_order_relaxed);
+	stats.droppedVideoFrames = m_droppedVideoFrames.load(std::memory_order_relaxed);
+	stats.lateVideoFrames = m_lateVideoFrames.load(std::memory_order_relaxed);
+	stats.seeks = m_seeks.load(std::memory_order_relaxed);
+}
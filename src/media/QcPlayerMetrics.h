@@ -0,0 +1,63 @@
+#pragma once
+
+#include "QsMediaInfo.h"
+#include <atomic>
+#include <chrono>
+
+//Latency histogram updated with relaxed atomics only, so any thread may record into it.
+class QcLatencyHistogram
+{
+public:
+	QcLatencyHistogram();
+	void record(uint32_t us);
+	void reset();
+	QsLatencyHistogram snapshot() const;
+private:
+	std::atomic<uint32_t> m_buckets[QsLatencyHistogram::kBuckets];
+	std::atomic<uint32_t> m_count{ 0 };
+	std::atomic<uint32_t> m_maxUs{ 0 };
+	std::atomic<uint64_t> m_sumUs{ 0 };
+};
+
+//Counts per second: the window is only moved by the thread calling add(), readers see the last full second.
+class QcRateMeter
+{
+public:
+	void add(uint32_t n);
+	void reset();
+	uint32_t rate() const { return m_rate; }
+private:
+	std::chrono::steady_clock::time_point m_windowStart;
+	uint64_t m_windowCount = 0;
+	std::atomic<uint32_t> m_rate{ 0 };
+};
+
+//Counters of the player pipeline. Each one has a single writer thread, getStats() may read them any time.
+class QcPlayerMetrics
+{
+public:
+	void reset();
+	void onPacketDemuxed(int bytes);
+	void onFrameDecoded(bool bVideo);
+	void onDecodeTime(bool bVideo, uint32_t us);
+	void onVideoPresented(bool bLate);
+	void onVideoDropped();
+	void onSeek();
+
+	//fills the counters, queue depths and clocks are left to the player.
+	void snapshot(QsPlayerStats& stats) const;
+	uint32_t droppedVideoFrames() const { return m_droppedVideoFrames; }
+private:
+	std::atomic<uint64_t> m_demuxedPackets{ 0 };
+	std::atomic<uint64_t> m_demuxedBytes{ 0 };
+	QcRateMeter m_demuxPacketRate;
+	QcRateMeter m_demuxByteRate;
+	std::atomic<uint64_t> m_decodedVideoFrames{ 0 };
+	std::atomic<uint64_t> m_decodedAudioFrames{ 0 };
+	QcLatencyHistogram m_videoDecode;
+	QcLatencyHistogram m_audioDecode;
+	std::atomic<uint64_t> m_presentedVideoFrames{ 0 };
+	std::atomic<uint32_t> m_droppedVideoFrames{ 0 };
+	std::atomic<uint32_t> m_lateVideoFrames{ 0 };
+	std::atomic<uint32_t> m_seeks{ 0 };
+};
@@ -0,0 +1,237 @@
+#include "QcTaskExecutor.h"
+#include <algorithm>
+#include <limits>
+
+using std::chrono::steady_clock;
+
+namespace
+{
+	//lets _schedule() keep a task on the worker that is running the step which notified it.
+	thread_local QcTaskExecutor* t_pExecutor = nullptr;
+	thread_local int t_workerIndex = -1;
+
+	const int64_t kNoTimer = std::numeric_limits<int64_t>::max();
+}
+
+QcTask::QcTask(QcTaskExecutor* pExecutor, std::function<int()>&& step, int priority)
+	: m_pExecutor(pExecutor)
+	, m_step(std::move(step))
+	, m_priority(std::min(std::max(priority, (int)eTaskHigh), (int)eTaskLow))
+{
+}
+
+void QcTask::notify()
+{
+	int state = m_state;
+	for (;;)
+	{
+		if (state == eIdle)
+		{
+			if (m_state.compare_exchange_weak(state, eQueued))
+			{
+				m_pExecutor->_schedule(shared_from_this());
+				return;
+			}
+		}
+		else if (state == eRunning)
+		{
+			if (m_state.compare_exchange_weak(state, eRunningNotified))
+				return;
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+void QcTask::waitDone()
+{
+	std::unique_lock<std::mutex> lock(m_doneMutex);
+	m_doneCond.wait(lock, [this] { return m_state == eDone; });
+}
+
+QcTaskExecutor::QcTaskExecutor(int nThreads)
+	: m_nextTimerDue(kNoTimer)
+{
+	if (nThreads <= 0)
+		nThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 0; i < nThreads; ++i)
+		m_workers.push_back(std::make_unique<QsWorker>());
+	for (int i = 0; i < nThreads; ++i)
+		m_workers[i]->thread = std::thread([this, i] { _workerLoop(i); });
+}
+
+QcTaskExecutor::~QcTaskExecutor()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bStop = true;
+		m_sleepCond.notify_all();
+	}
+	for (auto& worker : m_workers)
+		worker->thread.join();
+}
+
+QcTaskExecutor& QcTaskExecutor::shared()
+{
+	//leaked on purpose, players may still be closing while static destructors run.
+	static QcTaskExecutor* s_pExecutor = new QcTaskExecutor();
+	return *s_pExecutor;
+}
+
+QcTaskPtr QcTaskExecutor::submit(std::function<int()>&& step, int priority)
+{
+	QcTaskPtr task = std::make_shared<QcTask>(this, std::move(step), priority);
+	task->notify();
+	return task;
+}
+
+QsExecutorStats QcTaskExecutor::stats() const
+{
+	QsExecutorStats stats;
+	stats.threads = threadCount();
+	stats.runs = m_nRuns;
+	stats.steals = m_nSteals;
+	stats.timers = m_nTimers;
+	stats.sleeps = m_nSleeps;
+	return stats;
+}
+
+void QcTaskExecutor::_schedule(const QcTaskPtr& task)
+{
+	int index = t_pExecutor == this ? t_workerIndex : (int)(m_nextWorker++ % m_workers.size());
+	{
+		QsWorker& worker = *m_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.queues[task->m_priority].push_back(task);
+	}
+	//pairs with the sleeper registering itself before it checks m_queued, one of the two sees the other.
+	++m_queued;
+	if (m_sleepers > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_sleepCond.notify_one();
+	}
+}
+
+void QcTaskExecutor::_addTimer(const QcTaskPtr& task, int ms)
+{
+	std::lock_guard<std::mutex> lock(m_sleepMutex);
+	auto due = steady_clock::now() + std::chrono::milliseconds(ms);
+	m_timers.push({ due, task });
+	m_nextTimerDue = m_timers.top().due.time_since_epoch().count();
+	//a parked worker may be waiting for a later deadline.
+	if (m_sleepers > 0)
+		m_sleepCond.notify_one();
+}
+
+//collects the tasks whose timers expired, they are notified after the lock is released.
+void QcTaskExecutor::_fireTimers(bool bLocked, std::vector<QcTaskPtr>& due)
+{
+	if (steady_clock::now().time_since_epoch().count() < m_nextTimerDue)
+		return;
+	std::unique_lock<std::mutex> lock(m_sleepMutex, std::defer_lock);
+	if (!bLocked)
+		lock.lock();
+	auto now = steady_clock::now();
+	while (!m_timers.empty() && m_timers.top().due <= now)
+	{
+		if (QcTaskPtr task = m_timers.top().task.lock())
+			due.push_back(task);
+		m_timers.pop();
+	}
+	m_nextTimerDue = m_timers.empty() ? kNoTimer : m_timers.top().due.time_since_epoch().count();
+}
+
+QcTaskPtr QcTaskExecutor::_take(int index)
+{
+	int nWorkers = (int)m_workers.size();
+	for (int priority = eTaskHigh; priority < kTaskPriorityCount; ++priority)
+	{
+		for (int i = 0; i < nWorkers; ++i)
+		{
+			QsWorker& worker = *m_workers[(index + i) % nWorkers];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			auto& queue = worker.queues[priority];
+			if (queue.empty())
+				continue;
+			QcTaskPtr task = std::move(queue.front());
+			queue.pop_front();
+			--m_queued;
+			if (i > 0)
+				++m_nSteals;
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+void QcTaskExecutor::_run(const QcTaskPtr& task)
+{
+	task->m_state = QcTask::eRunning;
+	int next = task->m_step();
+	++m_nRuns;
+	if (next == QcTask::kDone)
+	{
+		std::lock_guard<std::mutex> lock(task->m_doneMutex);
+		task->m_state = QcTask::eDone;
+		task->m_doneCond.notify_all();
+		return;
+	}
+
+	//a notify() that came in while the step ran asks for another run.
+	int state = QcTask::eRunning;
+	if (next == 0 || !task->m_state.compare_exchange_strong(state, QcTask::eIdle))
+	{
+		task->m_state = QcTask::eQueued;
+		_schedule(task);
+		return;
+	}
+	if (next > 0)
+		_addTimer(task, next);
+}
+
+void QcTaskExecutor::_workerLoop(int index)
+{
+	t_pExecutor = this;
+	t_workerIndex = index;
+	std::vector<QcTaskPtr> due;
+	for (;;)
+	{
+		//busy workers look at the timers between steps, otherwise a loaded pool would never fire them.
+		_fireTimers(false, due);
+		if (due.empty())
+		{
+			QcTaskPtr task = m_queued > 0 ? _take(index) : nullptr;
+			if (task)
+			{
+				_run(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			++m_sleepers;
+			for (;;)
+			{
+				if (m_bStop || m_queued > 0)
+					break;
+				_fireTimers(true, due);
+				if (!due.empty())
+					break;
+				++m_nSleeps;
+				if (m_timers.empty())
+					m_sleepCond.wait(lock);
+				else
+					m_sleepCond.wait_until(lock, m_timers.top().due);
+			}
+			--m_sleepers;
+			if (m_bStop)
+				break;
+		}
+		m_nTimers += due.size();
+		for (const QcTaskPtr& task : due)
+			task->notify();
+		due.clear();
+	}
+}
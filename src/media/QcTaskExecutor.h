@@ -0,0 +1,122 @@
+#pragma once
+
+#include "media_global.h"
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <queue>
+
+class QcTaskExecutor;
+
+enum QeTaskPriority
+{
+	eTaskHigh = 0,      //audio
+	eTaskNormal,        //video
+	eTaskLow,           //demux
+	kTaskPriorityCount,
+};
+
+//A resumable task. step() does a bounded piece of work and returns when it wants to run again:
+//0 right away behind everything already queued, kIdle on the next notify(), > 0 after that many ms
+//or on notify() if that comes first, kDone never again.
+class MEDIA_API QcTask : public std::enable_shared_from_this<QcTask>
+{
+public:
+	enum
+	{
+		kDone = -2,
+		kIdle = -1,
+	};
+	QcTask(QcTaskExecutor* pExecutor, std::function<int()>&& step, int priority);
+	//runs step() again soon; notifications while a step is queued or running fold into one more run.
+	void notify();
+	//blocks until step() returned kDone.
+	void waitDone();
+	int priority() const { return m_priority; }
+private:
+	friend class QcTaskExecutor;
+	enum
+	{
+		eIdle = 0,
+		eQueued,
+		eRunning,
+		eRunningNotified,
+		eDone,
+	};
+	QcTaskExecutor* m_pExecutor;
+	std::function<int()> m_step;
+	int m_priority;
+	std::atomic<int> m_state{ eIdle };
+	std::mutex m_doneMutex;
+	std::condition_variable m_doneCond;
+};
+typedef std::shared_ptr<QcTask> QcTaskPtr;
+
+struct QsExecutorStats
+{
+	int threads = 0;
+	uint64_t runs = 0;      //steps executed
+	uint64_t steals = 0;    //steps taken from another worker's queue
+	uint64_t timers = 0;    //steps started by an expired timer
+	uint64_t sleeps = 0;    //times a worker found nothing to do and parked
+};
+
+//Fixed pool of workers, each with a FIFO queue per priority. A worker runs the highest priority step it
+//can find, from its own queues first and then stolen from the others, so audio never waits behind
+//demuxing and the backlog of a busy worker spreads over the idle ones. A task that wants to continue
+//goes to the back of its queue, which keeps many players taking turns.
+class MEDIA_API QcTaskExecutor
+{
+public:
+	//0 starts one worker per core.
+	explicit QcTaskExecutor(int nThreads = 0);
+	~QcTaskExecutor();
+	//process wide pool, created on first use and never destroyed.
+	static QcTaskExecutor& shared();
+
+	//the first step is scheduled right away.
+	QcTaskPtr submit(std::function<int()>&& step, int priority);
+	int threadCount() const { return (int)m_workers.size(); }
+	QsExecutorStats stats() const;
+private:
+	friend class QcTask;
+	struct QsWorker
+	{
+		std::mutex mutex;
+		std::deque<QcTaskPtr> queues[kTaskPriorityCount];
+		std::thread thread;
+	};
+	struct QsTimer
+	{
+		std::chrono::steady_clock::time_point due;
+		std::weak_ptr<QcTask> task;
+		bool operator<(const QsTimer& other) const { return due > other.due; }
+	};
+	void _schedule(const QcTaskPtr& task);
+	void _addTimer(const QcTaskPtr& task, int ms);
+	void _fireTimers(bool bLocked, std::vector<QcTaskPtr>& due);
+	QcTaskPtr _take(int index);
+	void _run(const QcTaskPtr& task);
+	void _workerLoop(int index);
+private:
+	std::vector<std::unique_ptr<QsWorker>> m_workers;
+	std::atomic<int> m_queued{ 0 };
+	std::atomic<int> m_sleepers{ 0 };
+	std::atomic<uint32_t> m_nextWorker{ 0 };
+	std::mutex m_sleepMutex;    //also guards m_timers and m_bStop
+	std::condition_variable m_sleepCond;
+	std::priority_queue<QsTimer> m_timers;
+	std::atomic<int64_t> m_nextTimerDue;    //steady_clock ticks of m_timers.top(), max when empty
+	bool m_bStop = false;
+
+	std::atomic<uint64_t> m_nRuns{ 0 };
+	std::atomic<uint64_t> m_nSteals{ 0 };
+	std::atomic<uint64_t> m_nTimers{ 0 };
+	std::atomic<uint64_t> m_nSleeps{ 0 };
+};
@@ -0,0 +1,255 @@
+#include "QcThumbnailExtractor.h"
+#include "QcTaskExecutor.h"
+#include "FFmpegUtils.h"
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include "QsVideodef.h"
+
+namespace
+{
+	//a point is given up when no decodable keyframe follows its seek within this many packets.
+	const int kMaxPacketsPerThumbnail = 2000;
+	const int kMaxLowres = 3;
+
+	struct QsThumbnailJob
+	{
+		QsThumbnailJob(const std::string& file, QcThumbnailPool::Callback&& cb, const QsThumbnailOptions& options)
+			: file(file), cb(std::move(cb)), extractor(options)
+		{
+		}
+		std::string file;
+		QcThumbnailPool::Callback cb;
+		QcThumbnailExtractor extractor;
+		std::vector<QsThumbnail> thumbnails;
+		bool bOpened = false;
+	};
+}
+
+QcThumbnailExtractor::QcThumbnailExtractor(const QsThumbnailOptions& options)
+	: m_options(options)
+{
+
+}
+
+bool QcThumbnailExtractor::open(const char* file)
+{
+	close();
+	if (!m_demuxer.open(file) || m_demuxer.videoStream() == nullptr)
+	{
+		m_demuxer.close();
+		return false;
+	}
+	const AVCodecParameters* par = m_demuxer.videoStream()->codecpar;
+	QsDecoderOptions options;
+	//files run side by side, a frame thread would only hold every keyframe back.
+	options.threadCount = 1;
+	options.skipFrame = eDiscardNonKey;
+	options.lowres = m_options.bLowres ? _lowres(par->width, par->height) : 0;
+	m_decoder.setOptions(options);
+	if (!m_decoder.open(par))
+	{
+		m_demuxer.close();
+		return false;
+	}
+	m_totalTime = m_demuxer.getMediaInfo().iFileTotalTime;
+	//without a duration there is nothing to spread over, the first keyframe is all we can offer.
+	m_count = m_totalTime > 0 ? std::max(m_options.count, 0) : std::min(m_options.count, 1);
+	return true;
+}
+
+void QcThumbnailExtractor::close()
+{
+	m_decoder.close();
+	m_demuxer.close();
+	m_count = 0;
+	m_index = 0;
+	m_totalTime = 0;
+	m_bHasLast = false;
+}
+
+bool QcThumbnailExtractor::next(QsThumbnail& thumbnail)
+{
+	while (m_index < m_count)
+	{
+		//the middle of each of count equal slices, which skips a black first frame and the credits.
+		int msTime = (int)((int64_t)m_totalTime * (2 * m_index + 1) / (2 * m_count));
+		++m_index;
+		//a failed seek still leaves the next keyframe after the current position.
+		if (m_totalTime > 0)
+			m_demuxer.seek(msTime);
+
+		AVFrameRef frame;
+		int64_t pts = 0;
+		if (!_decodeKeyframe(frame, pts))
+			continue;
+		m_lastPts = pts;
+		m_bHasLast = true;
+
+		int dstW = 0;
+		int dstH = 0;
+		_targetSize(frame, dstW, dstH);
+		thumbnail.msTime = QmBaseTimeToMSTime(pts, m_demuxer.videoStream()->time_base);
+		int format = FFmpegUtils::fourccToFFmpegFormat(m_options.format ? m_options.format : FOURCC_BGRA);
+		thumbnail.frame = AVFrameRef::allocFrame(dstW, dstH, format);
+		thumbnail.frame.setPtsMsTime(thumbnail.msTime);
+		if (!m_transformat.transformat(frame.width(), frame.height(), frame.format(), frame.data(), frame.linesize(),
+			dstW, dstH, format, thumbnail.frame.data(), thumbnail.frame.linesize()))
+			continue;
+		return true;
+	}
+	return false;
+}
+
+bool QcThumbnailExtractor::extract(const char* file, std::vector<QsThumbnail>& thumbnails)
+{
+	thumbnails.clear();
+	if (!open(file))
+		return false;
+	thumbnails.reserve(m_count);
+	QsThumbnail thumbnail;
+	while (next(thumbnail))
+		thumbnails.push_back(std::move(thumbnail));
+	close();
+	return true;
+}
+
+int QcThumbnailExtractor::_lowres(int srcW, int srcH) const
+{
+	int dstW = m_options.width;
+	int dstH = m_options.height;
+	if (srcW <= 0 || srcH <= 0 || (dstW <= 0 && dstH <= 0))
+		return 0;
+	if (dstW <= 0)
+		dstW = (int)((int64_t)srcW * dstH / srcH);
+	if (dstH <= 0)
+		dstH = (int)((int64_t)srcH * dstW / srcW);
+	//the decoder clamps it to what the codec supports, h264 and hevc have no lowres at all.
+	int lowres = 0;
+	while (lowres < kMaxLowres && (srcW >> (lowres + 1)) >= dstW && (srcH >> (lowres + 1)) >= dstH)
+		++lowres;
+	return lowres;
+}
+
+void QcThumbnailExtractor::_targetSize(const AVFrameRef& frame, int& dstW, int& dstH) const
+{
+	dstW = m_options.width;
+	dstH = m_options.height;
+	double aspect = frame.height() > 0 ? (double)frame.width() / frame.height() : 1.0;
+	AVRational sar = ((const AVFrame*)frame)->sample_aspect_ratio;
+	if (sar.num > 0 && sar.den > 0)
+		aspect = aspect * sar.num / sar.den;
+	if (dstW <= 0 && dstH <= 0)
+	{
+		dstW = frame.width();
+		dstH = frame.height();
+	}
+	else if (dstW <= 0)
+	{
+		dstW = (int)(dstH * aspect + 0.5);
+	}
+	else if (dstH <= 0)
+	{
+		dstH = (int)(dstW / aspect + 0.5);
+	}
+	//chroma subsampled targets need even sizes.
+	dstW = std::max(2, dstW & ~1);
+	dstH = std::max(2, dstH & ~1);
+}
+
+bool QcThumbnailExtractor::_decodeKeyframe(AVFrameRef& frame, int64_t& pts)
+{
+	const AVStream* pStream = m_demuxer.videoStream();
+	AVPacketPtr pkt = FFmpegUtils::allocAVPacket();
+	for (int i = 0; i < kMaxPacketsPerThumbnail && m_demuxer.readPacket(pkt) >= 0; ++i)
+	{
+		int64_t pktPts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+		//a seek that lands on the keyframe of the previous point moves on to the one after it.
+		bool bKey = pkt->stream_index == pStream->index && (pkt->flags & AV_PKT_FLAG_KEY)
+			&& !(m_bHasLast && pktPts <= m_lastPts);
+		if (bKey)
+		{
+			//draining hands the keyframe out at once, even from codecs that hold frames back for reordering.
+			m_decoder.flush();
+			m_decoder.decode(pkt.get());
+			m_decoder.decode((const AVPacket*)nullptr);
+			bKey = m_decoder.recv(frame) == FFmpegVideoDecoder::kOk;
+		}
+		av_packet_unref(pkt.get());
+		if (bKey)
+		{
+			pts = pktPts;
+			return true;
+		}
+	}
+	return false;
+}
+
+QcThumbnailPool::QcThumbnailPool(const QsThumbnailOptions& options, QcTaskExecutor* pExecutor)
+	: m_options(options)
+	, m_pExecutor(pExecutor ? pExecutor : &QcTaskExecutor::shared())
+{
+
+}
+
+QcThumbnailPool::~QcThumbnailPool()
+{
+	waitAll();
+}
+
+void QcThumbnailPool::add(const std::string& file, Callback&& cb)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_nPending;
+	}
+	auto pJob = std::make_shared<QsThumbnailJob>(file, std::move(cb), m_options);
+	m_pExecutor->submit([this, pJob]() -> int {
+		if (!pJob->bOpened)
+		{
+			pJob->bOpened = true;
+			if (pJob->extractor.open(pJob->file.c_str()))
+			{
+				pJob->thumbnails.reserve(pJob->extractor.count());
+				return 0;
+			}
+		}
+		else
+		{
+			QsThumbnail thumbnail;
+			if (pJob->extractor.next(thumbnail))
+			{
+				pJob->thumbnails.push_back(std::move(thumbnail));
+				return 0;
+			}
+			pJob->extractor.close();
+		}
+		if (pJob->cb)
+			pJob->cb(pJob->file, pJob->thumbnails);
+		_finish();
+		return QcTask::kDone;
+	}, eTaskLow);
+}
+
+int QcThumbnailPool::pending() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_nPending;
+}
+
+void QcThumbnailPool::waitAll()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cond.wait(lock, [this] { return m_nPending == 0; });
+}
+
+void QcThumbnailPool::_finish()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	--m_nPending;
+	m_cond.notify_all();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "media_global.h"
+#include "AVFrameRef.h"
+#include "FFmpegDemuxer.h"
+#include "FFmpegVideoDecoder.h"
+#include "FFmpegVideoTransformat.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class QcTaskExecutor;
+
+struct QsThumbnailOptions
+{
+	int count = 10;             //spread evenly over the duration
+	int width = 160;            //0 follows height and the display aspect ratio
+	int height = 0;             //0 follows width
+	int format = 0;             //QeFourCC of the thumbnails, 0 is FOURCC_BGRA
+	bool bLowres = true;        //decode at the smallest 1/2^n size that still covers the target
+};
+
+struct QsThumbnail
+{
+	int msTime = 0;             //pts of the keyframe it was taken from
+	AVFrameRef frame;
+};
+
+//Decodes one keyframe near each of count evenly spaced points and scales it straight to the target size.
+//Only keyframe packets reach the single threaded decoder, which also discards everything else, so a
+//thumbnail costs one seek and one intra frame. Not thread safe, run one extractor per worker.
+class MEDIA_API QcThumbnailExtractor
+{
+public:
+	QcThumbnailExtractor(const QsThumbnailOptions& options = QsThumbnailOptions());
+
+	bool open(const char* file);
+	void close();
+	//thumbnails next() will try to produce for the open file.
+	int count() const { return m_count; }
+	//false once count() thumbnails were tried, a point whose keyframe cannot be decoded is skipped.
+	bool next(QsThumbnail& thumbnail);
+	//open(), every next(), close().
+	bool extract(const char* file, std::vector<QsThumbnail>& thumbnails);
+protected:
+	int _lowres(int srcW, int srcH) const;
+	void _targetSize(const AVFrameRef& frame, int& dstW, int& dstH) const;
+	bool _decodeKeyframe(AVFrameRef& frame, int64_t& pts);
+protected:
+	QsThumbnailOptions m_options;
+	FFmpegDemuxer m_demuxer;
+	FFmpegVideoDecoder m_decoder;
+	FFmpegVideoTransformat m_transformat;
+	int m_count = 0;
+	int m_index = 0;
+	int m_totalTime = 0;
+	int64_t m_lastPts = 0;
+	bool m_bHasLast = false;
+};
+
+//Runs a QcThumbnailExtractor per file as a low priority task on a QcTaskExecutor, one thumbnail per
+//step, so many files progress at once and players sharing the executor stay ahead of them.
+class MEDIA_API QcThumbnailPool
+{
+public:
+	//thumbnails is empty when the file could not be opened.
+	typedef std::function<void(const std::string& file, std::vector<QsThumbnail>& thumbnails)> Callback;
+
+	//nullptr runs on QcTaskExecutor::shared().
+	QcThumbnailPool(const QsThumbnailOptions& options = QsThumbnailOptions(), QcTaskExecutor* pExecutor = nullptr);
+	//waits for the files still in flight.
+	~QcThumbnailPool();
+
+	//cb runs on a worker thread once the whole file is done.
+	void add(const std::string& file, Callback&& cb);
+	int pending() const;
+	void waitAll();
+private:
+	void _finish();
+private:
+	QsThumbnailOptions m_options;
+	QcTaskExecutor* m_pExecutor;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	int m_nPending = 0;
+};
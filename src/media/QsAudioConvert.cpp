@@ -0,0 +1,553 @@
+#include "QsAudioConvert.h"
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace
+{
+	//frames per pass of the staged conversions, the scratch planes stay in l1.
+	const int kChunk = 256;
+	//sqrt(1/2) the way swr rounds it for its int16 matrix.
+	const int16_t kUpmixS16 = 23170;
+	const float kUpmixFloat = 0.70710678f;
+	//swr only normalizes its downmix matrix to 0.5 per channel for an integer output, a float one
+	//keeps sqrt(1/2).
+	const float kDownmixFloat = 0.70710678f;
+	const float kDownmixFloatToS16 = 0.5f;
+
+	inline int16_t floatToS16(float v)
+	{
+		v *= 32768.0f;
+		//clipped before lrintf, which is undefined past the int range.
+		v = v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v);
+		return (int16_t)lrintf(v);
+	}
+
+	//the reference, every simd kernel below gives the same samples.
+	void s16ToFloatC(const int16_t* src, float* dst, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = src[i] * (1.0f / 32768.0f);
+	}
+
+	void floatToS16C(const float* src, int16_t* dst, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = floatToS16(src[i]);
+	}
+
+	void interleave16C(const int16_t* l, const int16_t* r, int16_t* dst, int n)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			dst[2 * i] = l[i];
+			dst[2 * i + 1] = r[i];
+		}
+	}
+
+	void interleave32C(const float* l, const float* r, float* dst, int n)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			dst[2 * i] = l[i];
+			dst[2 * i + 1] = r[i];
+		}
+	}
+
+	void deinterleave16C(const int16_t* src, int16_t* l, int16_t* r, int n)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			l[i] = src[2 * i];
+			r[i] = src[2 * i + 1];
+		}
+	}
+
+	void deinterleave32C(const float* src, float* l, float* r, int n)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			l[i] = src[2 * i];
+			r[i] = src[2 * i + 1];
+		}
+	}
+
+	void downmixS16C(const int16_t* l, const int16_t* r, int16_t* dst, int n)
+	{
+		//swr's 16384 * l + 16384 * r + 16384 >> 15.
+		for (int i = 0; i < n; ++i)
+			dst[i] = (int16_t)((l[i] + r[i] + 1) >> 1);
+	}
+
+	void downmixFloatC(const float* l, const float* r, float* dst, int n, float gain)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = gain * l[i] + gain * r[i];
+	}
+
+	void upmixS16C(const int16_t* src, int16_t* dst, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = (int16_t)((src[i] * kUpmixS16 + 16384) >> 15);
+	}
+
+	void upmixFloatC(const float* src, float* dst, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = kUpmixFloat * src[i];
+	}
+
+	//the decoder -> player hop: aac, mp3 and opus decode to floatp, outputs mostly take packed s16.
+	void floatPToS16StereoC(const float* l, const float* r, int16_t* dst, int n)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			dst[2 * i] = floatToS16(l[i]);
+			dst[2 * i + 1] = floatToS16(r[i]);
+		}
+	}
+
+	struct QsAudioKernels
+	{
+		void (*s16ToFloat)(const int16_t* src, float* dst, int n);
+		void (*floatToS16)(const float* src, int16_t* dst, int n);
+		void (*interleave16)(const int16_t* l, const int16_t* r, int16_t* dst, int n);
+		void (*interleave32)(const float* l, const float* r, float* dst, int n);
+		void (*deinterleave16)(const int16_t* src, int16_t* l, int16_t* r, int n);
+		void (*deinterleave32)(const float* src, float* l, float* r, int n);
+		void (*downmixS16)(const int16_t* l, const int16_t* r, int16_t* dst, int n);
+		void (*downmixFloat)(const float* l, const float* r, float* dst, int n, float gain);
+		void (*upmixS16)(const int16_t* src, int16_t* dst, int n);
+		void (*upmixFloat)(const float* src, float* dst, int n);
+		void (*floatPToS16Stereo)(const float* l, const float* r, int16_t* dst, int n);
+	};
+
+	const QsAudioKernels kScalar = {
+		s16ToFloatC, floatToS16C, interleave16C, interleave32C, deinterleave16C, deinterleave32C,
+		downmixS16C, downmixFloatC, upmixS16C, upmixFloatC, floatPToS16StereoC,
+	};
+
+#if QmSimdX86
+	//eight floats to eight s16: scale, clip, round to nearest even (lrintf under the default mxcsr).
+	QmTargetSSE41 inline __m128i floatToS16x8(const float* src)
+	{
+		const __m128 scale = _mm_set1_ps(32768.0f);
+		const __m128 hi = _mm_set1_ps(32767.0f);
+		const __m128 lo = _mm_set1_ps(-32768.0f);
+		__m128 a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(src), scale), hi), lo);
+		__m128 b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(src + 4), scale), hi), lo);
+		return _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+	}
+
+	QmTargetSSE41 void s16ToFloatSSE41(const int16_t* src, float* dst, int n)
+	{
+		const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+			__m128i a = _mm_cvtepi16_epi32(s);
+			__m128i b = _mm_cvtepi16_epi32(_mm_srli_si128(s, 8));
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+		}
+		s16ToFloatC(src + i, dst + i, n - i);
+	}
+
+	QmTargetSSE41 void floatToS16SSE41(const float* src, int16_t* dst, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+			_mm_storeu_si128((__m128i*)(dst + i), floatToS16x8(src + i));
+		floatToS16C(src + i, dst + i, n - i);
+	}
+
+	QmTargetSSE41 void interleave16SSE41(const int16_t* l, const int16_t* r, int16_t* dst, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(l + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(r + i));
+			_mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_unpacklo_epi16(a, b));
+			_mm_storeu_si128((__m128i*)(dst + 2 * i + 8), _mm_unpackhi_epi16(a, b));
+		}
+		interleave16C(l + i, r + i, dst + 2 * i, n - i);
+	}
+
+	QmTargetSSE41 void interleave32SSE41(const float* l, const float* r, float* dst, int n)
+	{
+		int i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 a = _mm_loadu_ps(l + i);
+			__m128 b = _mm_loadu_ps(r + i);
+			_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(a, b));
+			_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(a, b));
+		}
+		interleave32C(l + i, r + i, dst + 2 * i, n - i);
+	}
+
+	QmTargetSSE41 void deinterleave16SSE41(const int16_t* src, int16_t* l, int16_t* r, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			//each 32 bit lane is one l, r pair: l is the sign extended low half, r the high half.
+			__m128i a = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(src + 2 * i + 8));
+			__m128i la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+			__m128i lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+			_mm_storeu_si128((__m128i*)(l + i), _mm_packs_epi32(la, lb));
+			_mm_storeu_si128((__m128i*)(r + i), _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+		}
+		deinterleave16C(src + 2 * i, l + i, r + i, n - i);
+	}
+
+	QmTargetSSE41 void deinterleave32SSE41(const float* src, float* l, float* r, int n)
+	{
+		int i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 a = _mm_loadu_ps(src + 2 * i);
+			__m128 b = _mm_loadu_ps(src + 2 * i + 4);
+			_mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+		deinterleave32C(src + 2 * i, l + i, r + i, n - i);
+	}
+
+	QmTargetSSE41 void downmixS16SSE41(const int16_t* l, const int16_t* r, int16_t* dst, int n)
+	{
+		//pavgw is the unsigned (a + b + 1) >> 1, biasing by 0x8000 makes it the signed one.
+		const __m128i bias = _mm_set1_epi16((short)0x8000);
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(l + i)), bias);
+			__m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(r + i)), bias);
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_avg_epu16(a, b), bias));
+		}
+		downmixS16C(l + i, r + i, dst + i, n - i);
+	}
+
+	QmTargetSSE41 void downmixFloatSSE41(const float* l, const float* r, float* dst, int n, float gain)
+	{
+		const __m128 g = _mm_set1_ps(gain);
+		int i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 a = _mm_mul_ps(_mm_loadu_ps(l + i), g);
+			__m128 b = _mm_mul_ps(_mm_loadu_ps(r + i), g);
+			_mm_storeu_ps(dst + i, _mm_add_ps(a, b));
+		}
+		downmixFloatC(l + i, r + i, dst + i, n - i, gain);
+	}
+
+	QmTargetSSE41 void upmixS16SSE41(const int16_t* src, int16_t* dst, int n)
+	{
+		//pmulhrsw is exactly (a * b + 16384) >> 15.
+		const __m128i gain = _mm_set1_epi16(kUpmixS16);
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_mulhrs_epi16(_mm_loadu_si128((const __m128i*)(src + i)), gain));
+		upmixS16C(src + i, dst + i, n - i);
+	}
+
+	QmTargetSSE41 void upmixFloatSSE41(const float* src, float* dst, int n)
+	{
+		const __m128 gain = _mm_set1_ps(kUpmixFloat);
+		int i = 0;
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), gain));
+		upmixFloatC(src + i, dst + i, n - i);
+	}
+
+	QmTargetSSE41 void floatPToS16StereoSSE41(const float* l, const float* r, int16_t* dst, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128i a = floatToS16x8(l + i);
+			__m128i b = floatToS16x8(r + i);
+			_mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_unpacklo_epi16(a, b));
+			_mm_storeu_si128((__m128i*)(dst + 2 * i + 8), _mm_unpackhi_epi16(a, b));
+		}
+		floatPToS16StereoC(l + i, r + i, dst + 2 * i, n - i);
+	}
+
+	const QsAudioKernels kSSE41 = {
+		s16ToFloatSSE41, floatToS16SSE41, interleave16SSE41, interleave32SSE41, deinterleave16SSE41,
+		deinterleave32SSE41, downmixS16SSE41, downmixFloatSSE41, upmixS16SSE41, upmixFloatSSE41,
+		floatPToS16StereoSSE41,
+	};
+
+	//sixteen floats to sixteen s16, packs works per 128 bit lane so the quadwords are put back in order.
+	QmTargetAVX2 inline __m256i floatToS16x16(const float* src)
+	{
+		const __m256 scale = _mm256_set1_ps(32768.0f);
+		const __m256 hi = _mm256_set1_ps(32767.0f);
+		const __m256 lo = _mm256_set1_ps(-32768.0f);
+		__m256 a = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(src), scale), hi), lo);
+		__m256 b = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(src + 8), scale), hi), lo);
+		__m256i s = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+		return _mm256_permute4x64_epi64(s, _MM_SHUFFLE(3, 1, 2, 0));
+	}
+
+	QmTargetAVX2 void s16ToFloatAVX2(const int16_t* src, float* dst, int n)
+	{
+		const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+		int i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			__m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+			__m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + i + 8)));
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), scale));
+			_mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), scale));
+		}
+		s16ToFloatC(src + i, dst + i, n - i);
+	}
+
+	QmTargetAVX2 void floatToS16AVX2(const float* src, int16_t* dst, int n)
+	{
+		int i = 0;
+		for (; i + 16 <= n; i += 16)
+			_mm256_storeu_si256((__m256i*)(dst + i), floatToS16x16(src + i));
+		floatToS16C(src + i, dst + i, n - i);
+	}
+
+	QmTargetAVX2 void downmixFloatAVX2(const float* l, const float* r, float* dst, int n, float gain)
+	{
+		const __m256 g = _mm256_set1_ps(gain);
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 a = _mm256_mul_ps(_mm256_loadu_ps(l + i), g);
+			__m256 b = _mm256_mul_ps(_mm256_loadu_ps(r + i), g);
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(a, b));
+		}
+		downmixFloatC(l + i, r + i, dst + i, n - i, gain);
+	}
+
+	QmTargetAVX2 void floatPToS16StereoAVX2(const float* l, const float* r, int16_t* dst, int n)
+	{
+		int i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			//unpack interleaves within lanes: lo holds pairs 0-3 and 8-11, hi 4-7 and 12-15.
+			__m256i a = floatToS16x16(l + i);
+			__m256i b = floatToS16x16(r + i);
+			__m256i lo = _mm256_unpacklo_epi16(a, b);
+			__m256i hi = _mm256_unpackhi_epi16(a, b);
+			_mm256_storeu_si256((__m256i*)(dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256((__m256i*)(dst + 2 * i + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+		floatPToS16StereoC(l + i, r + i, dst + 2 * i, n - i);
+	}
+
+	//the shuffles are load/store bound, the 128 bit versions keep up with avx2.
+	const QsAudioKernels kAVX2 = {
+		s16ToFloatAVX2, floatToS16AVX2, interleave16SSE41, interleave32SSE41, deinterleave16SSE41,
+		deinterleave32SSE41, downmixS16SSE41, downmixFloatAVX2, upmixS16SSE41, upmixFloatSSE41,
+		floatPToS16StereoAVX2,
+	};
+#endif
+
+	const QsAudioKernels& audioKernels(QeSimdLevel level)
+	{
+		level = ClampSimdLevel(level);
+#if QmSimdX86
+		if (level >= eSimdAVX2)
+			return kAVX2;
+		if (level >= eSimdSSE41)
+			return kSSE41;
+#endif
+		return kScalar;
+	}
+
+	bool isFloatFormat(QeSampleFormat format)
+	{
+		return format == eSampleFormatFloat || format == eSampleFormatFloatP;
+	}
+
+	bool isPlanarFormat(QeSampleFormat format)
+	{
+		return format == eSampleFormatS16P || format == eSampleFormatFloatP;
+	}
+
+	bool isDirectFormat(QeSampleFormat format)
+	{
+		return format == eSampleFormatS16 || format == eSampleFormatS16P
+			|| format == eSampleFormatFloat || format == eSampleFormatFloatP;
+	}
+
+	//one sample format to the other over n samples, same format is a copy.
+	void convertSamples(const QsAudioKernels& k, const uint8_t* src, bool bSrcFloat, uint8_t* dst, bool bDstFloat, int n)
+	{
+		if (bSrcFloat == bDstFloat)
+			memcpy(dst, src, (size_t)n * (bSrcFloat ? 4 : 2));
+		else if (bSrcFloat)
+			k.floatToS16((const float*)src, (int16_t*)dst, n);
+		else
+			k.s16ToFloat((const int16_t*)src, (float*)dst, n);
+	}
+}
+
+namespace audio {
+	bool CanConvertDirect(const QsAudioPara& src, const QsAudioPara& dst)
+	{
+		if (src.sampleRate != dst.sampleRate || !isDirectFormat(src.sampleFormat) || !isDirectFormat(dst.sampleFormat))
+			return false;
+		if (src.nChannels == dst.nChannels)
+			return src.nChannels > 0 && src.nChannels <= QmAudioPlanes;
+		return (src.nChannels == 1 && dst.nChannels == 2) || (src.nChannels == 2 && dst.nChannels == 1);
+	}
+
+	bool ConvertDirect(const uint8_t* const srcData[], QeSampleFormat srcFormat, int srcChannels,
+		uint8_t* const dstData[], QeSampleFormat dstFormat, int dstChannels, int nSamples, QeSimdLevel level)
+	{
+		QsAudioPara src;
+		src.sampleFormat = srcFormat;
+		src.nChannels = srcChannels;
+		QsAudioPara dst;
+		dst.sampleFormat = dstFormat;
+		dst.nChannels = dstChannels;
+		if (!CanConvertDirect(src, dst) || nSamples < 0)
+			return false;
+
+		const QsAudioKernels& k = audioKernels(level);
+		bool bSrcFloat = isFloatFormat(srcFormat);
+		bool bDstFloat = isFloatFormat(dstFormat);
+		bool bSrcPlanar = isPlanarFormat(srcFormat) && srcChannels > 1;
+		bool bDstPlanar = isPlanarFormat(dstFormat) && dstChannels > 1;
+		int srcBytes = bSrcFloat ? 4 : 2;
+		int dstBytes = bDstFloat ? 4 : 2;
+
+		//same layout: one pass over each plane, straight into the output.
+		if (srcChannels == dstChannels && bSrcPlanar == bDstPlanar)
+		{
+			int nPlanes = bSrcPlanar ? srcChannels : 1;
+			int n = bSrcPlanar ? nSamples : nSamples * srcChannels;
+			for (int c = 0; c < nPlanes; ++c)
+				convertSamples(k, srcData[c], bSrcFloat, dstData[c], bDstFloat, n);
+			return true;
+		}
+		if (srcChannels == 2 && dstChannels == 2 && bSrcFloat && bSrcPlanar && !bDstFloat && !bDstPlanar)
+		{
+			k.floatPToS16Stereo((const float*)srcData[0], (const float*)srcData[1], (int16_t*)dstData[0], nSamples);
+			return true;
+		}
+
+		//everything else is staged through two sets of scratch planes, kChunk frames at a time:
+		//split the input into planes, widen s16 to float, mix, narrow to s16, then join the planes.
+		//mixing happens in float whenever either side is float, as swr does.
+		alignas(32) float scratch[2][QmAudioPlanes][kChunk];
+		for (int i = 0; i < nSamples; i += kChunk)
+		{
+			int n = nSamples - i < kChunk ? nSamples - i : kChunk;
+			const uint8_t* planes[QmAudioPlanes];
+			int nPlanes = srcChannels;
+			bool bFloat = bSrcFloat;
+			int next = 0;
+
+			if (bSrcPlanar || srcChannels == 1)
+			{
+				for (int c = 0; c < srcChannels; ++c)
+					planes[c] = srcData[c] + (size_t)i * srcBytes;
+			}
+			else
+			{
+				const uint8_t* p = srcData[0] + (size_t)i * srcBytes * srcChannels;
+				if (srcChannels == 2 && bSrcFloat)
+					k.deinterleave32((const float*)p, scratch[next][0], scratch[next][1], n);
+				else if (srcChannels == 2)
+					k.deinterleave16((const int16_t*)p, (int16_t*)scratch[next][0], (int16_t*)scratch[next][1], n);
+				else
+				{
+					for (int c = 0; c < srcChannels; ++c)
+					{
+						uint8_t* plane = (uint8_t*)scratch[next][c];
+						for (int j = 0; j < n; ++j)
+							memcpy(plane + j * srcBytes, p + ((size_t)j * srcChannels + c) * srcBytes, srcBytes);
+					}
+				}
+				for (int c = 0; c < srcChannels; ++c)
+					planes[c] = (const uint8_t*)scratch[next][c];
+				next ^= 1;
+			}
+
+			if (!bFloat && bDstFloat)
+			{
+				for (int c = 0; c < nPlanes; ++c)
+				{
+					k.s16ToFloat((const int16_t*)planes[c], scratch[next][c], n);
+					planes[c] = (const uint8_t*)scratch[next][c];
+				}
+				bFloat = true;
+				next ^= 1;
+			}
+
+			if (srcChannels == 2 && dstChannels == 1)
+			{
+				if (bFloat)
+					k.downmixFloat((const float*)planes[0], (const float*)planes[1], scratch[next][0], n,
+						bDstFloat ? kDownmixFloat : kDownmixFloatToS16);
+				else
+					k.downmixS16((const int16_t*)planes[0], (const int16_t*)planes[1], (int16_t*)scratch[next][0], n);
+				planes[0] = (const uint8_t*)scratch[next][0];
+				nPlanes = 1;
+				next ^= 1;
+			}
+			else if (srcChannels == 1 && dstChannels == 2)
+			{
+				if (bFloat)
+					k.upmixFloat((const float*)planes[0], scratch[next][0], n);
+				else
+					k.upmixS16((const int16_t*)planes[0], (int16_t*)scratch[next][0], n);
+				planes[0] = planes[1] = (const uint8_t*)scratch[next][0];
+				nPlanes = 2;
+				next ^= 1;
+			}
+
+			if (bFloat && !bDstFloat)
+			{
+				//an upmixed pair shares one plane, converting it once is enough.
+				bool bShared = nPlanes == 2 && planes[0] == planes[1];
+				for (int c = 0; c < nPlanes; ++c)
+				{
+					if (c == 1 && bShared)
+					{
+						planes[1] = planes[0];
+						break;
+					}
+					k.floatToS16((const float*)planes[c], (int16_t*)scratch[next][c], n);
+					planes[c] = (const uint8_t*)scratch[next][c];
+				}
+				bFloat = false;
+			}
+
+			if (bDstPlanar || dstChannels == 1)
+			{
+				for (int c = 0; c < dstChannels; ++c)
+					memcpy(dstData[c] + (size_t)i * dstBytes, planes[c], (size_t)n * dstBytes);
+			}
+			else
+			{
+				uint8_t* p = dstData[0] + (size_t)i * dstBytes * dstChannels;
+				if (dstChannels == 2 && bDstFloat)
+					k.interleave32((const float*)planes[0], (const float*)planes[1], (float*)p, n);
+				else if (dstChannels == 2)
+					k.interleave16((const int16_t*)planes[0], (const int16_t*)planes[1], (int16_t*)p, n);
+				else
+				{
+					for (int c = 0; c < dstChannels; ++c)
+					{
+						for (int j = 0; j < n; ++j)
+							memcpy(p + ((size_t)j * dstChannels + c) * dstBytes, planes[c] + (size_t)j * dstBytes, dstBytes);
+					}
+				}
+			}
+		}
+		return true;
+	}
+}
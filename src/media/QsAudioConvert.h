@@ -0,0 +1,22 @@
+#pragma once
+
+#include "media_global.h"
+#include <stdint.h>
+#include "QsAudiodef.h"
+#include "QsSimd.h"
+
+//Same rate sample conversions QcAudioTransformat does without libswresample: s16 <-> float,
+//packed <-> planar and stereo <-> mono. The results match swr's default settings: float -> s16
+//rounds to nearest and clips, stereo -> mono is sqrt(1/2) * (l + r) into float and 0.5 * (l + r)
+//into s16, mono -> stereo is sqrt(1/2) * c, and s16 -> s16 mixing is done in 15 bit fixed point
+//the way swr does it.
+namespace audio {
+	//s16, s16p, float and floatp at the same rate, with equal channel counts or stereo <-> mono.
+	MEDIA_API bool CanConvertDirect(const QsAudioPara& src, const QsAudioPara& dst);
+
+	//data holds one pointer per channel for planar formats, one for packed ones. Every level gives
+	//the same samples as eSimdNone, level is capped at DetectSimdLevel().
+	MEDIA_API bool ConvertDirect(const uint8_t* const srcData[], QeSampleFormat srcFormat, int srcChannels,
+		uint8_t* const dstData[], QeSampleFormat dstFormat, int dstChannels, int nSamples,
+		QeSimdLevel level = eSimdAuto);
+}
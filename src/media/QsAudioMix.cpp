@@ -0,0 +1,210 @@
+#include "QsAudioMix.h"
+#include <stdint.h>
+
+namespace
+{
+	//above the knee y = knee + (1 - knee) * u / (1 + u), u = (|x| - knee) / (1 - knee): the slope is 1 at
+	//the knee, so the bend does not click, and it only reaches full scale at infinity.
+	struct QsKnee
+	{
+		float knee;
+		float range;        //1 - knee
+		float invRange;     //1 / (1 - knee)
+	};
+
+	QsKnee makeKnee(float knee)
+	{
+		knee = knee < 0.0f ? 0.0f : (knee > 0.999f ? 0.999f : knee);
+		QsKnee k;
+		k.knee = knee;
+		k.range = 1.0f - knee;
+		k.invRange = 1.0f / k.range;
+		return k;
+	}
+
+	//the reference, every simd step below mirrors one of these operations.
+	inline float softLimit(float x, float gain, const QsKnee& k)
+	{
+		x *= gain;
+		float a = x < 0.0f ? -x : x;
+		if (!(a > k.knee))
+			return x;
+		float u = (a - k.knee) * k.invRange;
+		float y = k.knee + k.range * (u / (1.0f + u));
+		return x < 0.0f ? -y : y;
+	}
+
+	//from sample i on, so the simd loops can finish their tails here.
+	void mixAddC(float* dst, const float* src, int i, int n, float gain)
+	{
+		for (; i < n; ++i)
+			dst[i] += gain * src[i];
+	}
+
+	float peakLevelC(const float* data, int i, int n, float peak)
+	{
+		for (; i < n; ++i)
+		{
+			float a = data[i] < 0.0f ? -data[i] : data[i];
+			peak = a > peak ? a : peak;
+		}
+		return peak;
+	}
+
+	void softLimitC(float* data, int i, int n, float gain0, float step, const QsKnee& k)
+	{
+		for (; i < n; ++i)
+			data[i] = softLimit(data[i], gain0 + step * (float)i, k);
+	}
+
+#if QmSimdX86
+	QmTargetSSE41 void mixAddSSE41(float* dst, const float* src, int n, float gain)
+	{
+		const __m128 g = _mm_set1_ps(gain);
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128 a = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(g, _mm_loadu_ps(src + i)));
+			__m128 b = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(g, _mm_loadu_ps(src + i + 4)));
+			_mm_storeu_ps(dst + i, a);
+			_mm_storeu_ps(dst + i + 4, b);
+		}
+		mixAddC(dst, src, i, n, gain);
+	}
+
+	QmTargetSSE41 float peakLevelSSE41(const float* data, int n)
+	{
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		//maxps returns its second operand for a nan, so a nan sample is skipped like in peakLevelC.
+		__m128 peak = _mm_setzero_ps();
+		int i = 0;
+		for (; i + 4 <= n; i += 4)
+			peak = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(data + i), absMask), peak);
+		peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+		peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+		return peakLevelC(data, i, n, _mm_cvtss_f32(peak));
+	}
+
+	QmTargetSSE41 inline __m128 softLimit4(__m128 x, __m128 gain, const QsKnee& k)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+		const __m128 one = _mm_set1_ps(1.0f);
+		x = _mm_mul_ps(x, gain);
+		__m128 sign = _mm_and_ps(x, signMask);
+		__m128 a = _mm_andnot_ps(signMask, x);
+		__m128 u = _mm_mul_ps(_mm_sub_ps(a, _mm_set1_ps(k.knee)), _mm_set1_ps(k.invRange));
+		__m128 y = _mm_add_ps(_mm_set1_ps(k.knee), _mm_mul_ps(_mm_set1_ps(k.range), _mm_div_ps(u, _mm_add_ps(one, u))));
+		return _mm_blendv_ps(x, _mm_or_ps(y, sign), _mm_cmpgt_ps(a, _mm_set1_ps(k.knee)));
+	}
+
+	QmTargetSSE41 void softLimitSSE41(float* data, int n, float gain0, float step, const QsKnee& k)
+	{
+		__m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		const __m128 four = _mm_set1_ps(4.0f);
+		const __m128 g0 = _mm_set1_ps(gain0);
+		const __m128 s = _mm_set1_ps(step);
+		int i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 gain = _mm_add_ps(g0, _mm_mul_ps(s, index));
+			_mm_storeu_ps(data + i, softLimit4(_mm_loadu_ps(data + i), gain, k));
+			index = _mm_add_ps(index, four);
+		}
+		softLimitC(data, i, n, gain0, step, k);
+	}
+
+	QmTargetAVX2 void mixAddAVX2(float* dst, const float* src, int n, float gain)
+	{
+		const __m256 g = _mm256_set1_ps(gain);
+		int i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			__m256 a = _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(g, _mm256_loadu_ps(src + i)));
+			__m256 b = _mm256_add_ps(_mm256_loadu_ps(dst + i + 8), _mm256_mul_ps(g, _mm256_loadu_ps(src + i + 8)));
+			_mm256_storeu_ps(dst + i, a);
+			_mm256_storeu_ps(dst + i + 8, b);
+		}
+		mixAddC(dst, src, i, n, gain);
+	}
+
+	QmTargetAVX2 float peakLevelAVX2(const float* data, int n)
+	{
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+		__m256 peak = _mm256_setzero_ps();
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+			peak = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(data + i), absMask), peak);
+		__m128 p = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+		p = _mm_max_ps(p, _mm_movehl_ps(p, p));
+		p = _mm_max_ss(p, _mm_shuffle_ps(p, p, 1));
+		return peakLevelC(data, i, n, _mm_cvtss_f32(p));
+	}
+
+	QmTargetAVX2 void softLimitAVX2(float* data, int n, float gain0, float step, const QsKnee& k)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 knee = _mm256_set1_ps(k.knee);
+		const __m256 range = _mm256_set1_ps(k.range);
+		const __m256 invRange = _mm256_set1_ps(k.invRange);
+		const __m256 eight = _mm256_set1_ps(8.0f);
+		const __m256 g0 = _mm256_set1_ps(gain0);
+		const __m256 s = _mm256_set1_ps(step);
+		__m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 x = _mm256_mul_ps(_mm256_loadu_ps(data + i), _mm256_add_ps(g0, _mm256_mul_ps(s, index)));
+			__m256 sign = _mm256_and_ps(x, signMask);
+			__m256 a = _mm256_andnot_ps(signMask, x);
+			__m256 u = _mm256_mul_ps(_mm256_sub_ps(a, knee), invRange);
+			__m256 y = _mm256_add_ps(knee, _mm256_mul_ps(range, _mm256_div_ps(u, _mm256_add_ps(one, u))));
+			_mm256_storeu_ps(data + i, _mm256_blendv_ps(x, _mm256_or_ps(y, sign), _mm256_cmp_ps(a, knee, _CMP_GT_OQ)));
+			index = _mm256_add_ps(index, eight);
+		}
+		softLimitC(data, i, n, gain0, step, k);
+	}
+#endif
+}
+
+namespace audio {
+	void MixAdd(float* dst, const float* src, int n, float gain, QeSimdLevel level)
+	{
+		level = ClampSimdLevel(level);
+#if QmSimdX86
+		if (level >= eSimdAVX2)
+			return mixAddAVX2(dst, src, n, gain);
+		if (level >= eSimdSSE41)
+			return mixAddSSE41(dst, src, n, gain);
+#endif
+		mixAddC(dst, src, 0, n, gain);
+	}
+
+	float PeakLevel(const float* data, int n, QeSimdLevel level)
+	{
+		level = ClampSimdLevel(level);
+#if QmSimdX86
+		if (level >= eSimdAVX2)
+			return peakLevelAVX2(data, n);
+		if (level >= eSimdSSE41)
+			return peakLevelSSE41(data, n);
+#endif
+		return peakLevelC(data, 0, n, 0.0f);
+	}
+
+	void SoftLimit(float* data, int n, float gain0, float gain1, float knee, QeSimdLevel level)
+	{
+		if (n <= 0)
+			return;
+		QsKnee k = makeKnee(knee);
+		float step = (gain1 - gain0) / (float)n;
+		level = ClampSimdLevel(level);
+#if QmSimdX86
+		if (level >= eSimdAVX2)
+			return softLimitAVX2(data, n, gain0, step, k);
+		if (level >= eSimdSSE41)
+			return softLimitSSE41(data, n, gain0, step, k);
+#endif
+		softLimitC(data, 0, n, gain0, step, k);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "media_global.h"
+#include "QsSimd.h"
+
+//Float kernels behind QcAudioMixer. Every level gives the same samples as eSimdNone (no fused
+//multiply-adds), level is capped at DetectSimdLevel().
+namespace audio {
+	//dst[i] += gain * src[i].
+	MEDIA_API void MixAdd(float* dst, const float* src, int n, float gain, QeSimdLevel level = eSimdAuto);
+
+	//largest |data[i]|, 0 for n == 0.
+	MEDIA_API float PeakLevel(const float* data, int n, QeSimdLevel level = eSimdAuto);
+
+	//scales data by a gain ramping linearly from gain0 towards gain1 over n samples, then bends
+	//everything above knee (0..1) smoothly towards, but never onto, full scale.
+	MEDIA_API void SoftLimit(float* data, int n, float gain0, float gain1, float knee, QeSimdLevel level = eSimdAuto);
+}
@@ -2,6 +2,10 @@
 
 #include "QmMacro.h"
 #include <memory>
+#include <stdint.h>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
 
 struct AVPacket;
 typedef std::shared_ptr<AVPacket> AVPacketPtr;
@@ -30,4 +34,140 @@ enum QsThreadState
 	eExitThread,
 };
 
-#define QmStdMutexLocker(mutex1) std::lock_guard<std::mutex> QmUniqueVarName(mutex1)
\ No newline at end of file
+//which clock the other streams are slaved to.
+enum QeClockMode
+{
+	eAudioMasterClock = 0,
+	eVideoMasterClock,
+	eExternalClock,
+};
+
+struct QsClockStats
+{
+	int clockMode = eAudioMasterClock;
+	int masterTime = 0;      //ms, the clock presentation follows right now
+	int driftMs = 0;         //master clock minus the steady_clock based external clock
+	int maxDriftMs = 0;      //largest |driftMs| seen since open/seek
+	uint32_t corrections = 0;        //external clock re-anchored to the master
+	uint32_t droppedVideoFrames = 0; //late video frames never shown
+};
+
+struct QsIOStats
+{
+	uint64_t bytesRead = 0;      //handed to the demuxer
+	uint64_t bytesFetched = 0;   //read from the source by the read-ahead thread
+	uint32_t hits = 0;           //reads served from the cache without waiting
+	uint32_t misses = 0;         //reads that had to wait for the source
+	uint32_t invalidations = 0;  //seeks outside the cached window
+	uint64_t stallUs = 0;        //time the demuxer spent waiting for data
+	float hitRate = 0;
+};
+
+struct QsPoolStats
+{
+	uint64_t hits = 0;      //allocations served from the pool
+	uint64_t misses = 0;    //allocations that went to the heap
+	uint64_t recycled = 0;  //objects returned to the pool
+	uint64_t freed = 0;     //objects released because the pool was full or disabled
+	uint32_t pooled = 0;    //objects waiting in the pool right now
+};
+
+enum QeDecodeThreadType
+{
+	eAutoThread = 0,    //frame and slice threading, whichever the codec supports
+	eFrameThread,       //more throughput, adds one frame of latency per thread
+	eSliceThread,       //no extra latency, scales only with the slices per picture
+};
+
+//maps onto AVDiscard, what the decoder may skip.
+enum QeDecodeDiscard
+{
+	eDiscardNone = 0,
+	eDiscardNonRef,
+	eDiscardBidir,
+	eDiscardNonIntra,
+	eDiscardNonKey,
+	eDiscardAll,
+};
+
+struct QsDecoderOptions
+{
+	int threadCount = 1;                //0 picks one thread per core, 1 leaves threading off
+	int threadType = eAutoThread;       //QeDecodeThreadType, only used with more than one thread
+	bool lowDelay = false;              //AV_CODEC_FLAG_LOW_DELAY, also restricts threading to slices
+	int skipLoopFilter = eDiscardNone;  //QeDecodeDiscard
+	int skipFrame = eDiscardNone;       //QeDecodeDiscard
+	int lowres = 0;                     //decode at 1/2^lowres size, clamped to what the codec supports
+};
+
+//how much demuxed data the player keeps ahead of the decoders.
+enum QeBufferingMode
+{
+	eBufferLocalFile = 0,   //seconds ahead, reads are cheap
+	eBufferLive,            //a short window, latency matters more than riding out stalls
+	eBufferLowMemory,       //tight byte caps for memory constrained nodes
+};
+
+//a packet queue stops accepting packets at highMs or maxBytes and is refilled once it drains below lowMs.
+struct QsBufferWatermarks
+{
+	int lowMs = 0;
+	int highMs = 0;         //0 limits the queue by bytes only
+	uint32_t maxBytes = 0;
+};
+
+//bucket i counts samples in [2^i, 2^(i+1)) us, the last one everything above.
+struct QsLatencyHistogram
+{
+	enum { kBuckets = 24 };
+	uint32_t count = 0;
+	uint32_t avgUs = 0;
+	uint32_t maxUs = 0;
+	uint32_t p50Us = 0;     //upper bound of the bucket holding the median
+	uint32_t p99Us = 0;
+	uint32_t buckets[kBuckets] = {};
+};
+
+struct QsPlayerStats
+{
+	uint64_t demuxedPackets = 0;
+	uint64_t demuxedBytes = 0;
+	uint32_t demuxPacketRate = 0;    //packets per second over the last full second
+	uint32_t demuxByteRate = 0;      //bytes per second over the last full second
+
+	uint32_t videoPackets = 0;       //waiting in the packet queues
+	uint32_t videoPacketBytes = 0;
+	uint32_t audioPackets = 0;
+	uint32_t audioPacketBytes = 0;
+	int videoBufferedMs = 0;         //duration of the queued packets
+	int audioBufferedMs = 0;
+	uint32_t videoFrames = 0;        //decoded, waiting in the frame queues
+	uint32_t audioFrames = 0;
+
+	uint64_t decodedVideoFrames = 0;
+	uint64_t decodedAudioFrames = 0;
+	QsLatencyHistogram videoDecode;  //time spent in decode() per packet
+	QsLatencyHistogram audioDecode;
+
+	uint64_t presentedVideoFrames = 0;
+	uint32_t droppedVideoFrames = 0; //late video frames never shown
+	uint32_t lateVideoFrames = 0;    //shown, but already behind their clock
+	int avOffsetMs = 0;              //video clock minus audio clock, 0 unless both run
+
+	uint32_t seeks = 0;
+	int lastSeekLatency = 0;         //ms, -1 while a seek is pending
+};
+
+#define QmStdMutexLocker(mutex1) std::lock_guard<std::mutex> QmUniqueVarName(mutex1)
+
+//timeoutMs < 0 waits forever, 0 only checks the predicate.
+template<class Predicate>
+inline bool waitCondition(std::condition_variable& cond, std::unique_lock<std::mutex>& lock, int timeoutMs, Predicate pred)
+{
+	if (timeoutMs < 0)
+	{
+		cond.wait(lock, pred);
+		return true;
+	}
+	return cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), pred);
+}
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include "QsVideoConvert.h"
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <utility>
+#include "QsVideodef.h"
+
+namespace
+{
+	//Q6 fixed point, y1 = (y * 0x0101 * yg) >> 16 is y scaled to 6 fraction bits, every sum after that
+	//saturates to int16 and the result is clamped after >> 6. ub/ug/vg/vr are the chroma gains * 64.
+	struct QsYuvConstants
+	{
+		uint16_t yg;
+		int16_t yb;         //-16 * y gain for limited range, plus the rounding half
+		int16_t ub;
+		int16_t ug;
+		int16_t vg;
+		int16_t vr;
+	};
+
+	QsYuvConstants makeConstants(double kr, double kb, bool bFull)
+	{
+		double kg = 1.0 - kr - kb;
+		double yGain = bFull ? 1.0 : 255.0 / 219.0;
+		double cGain = bFull ? 1.0 : 255.0 / 224.0;
+		QsYuvConstants c;
+		c.yg = (uint16_t)lround(yGain * 64 * 65536 / 257);
+		c.yb = (int16_t)(lround((bFull ? 0 : -16) * yGain * 64) + 32);
+		c.ub = (int16_t)lround(cGain * 2 * (1 - kb) * 64);
+		c.ug = (int16_t)lround(cGain * 2 * (1 - kb) * kb / kg * 64);
+		c.vg = (int16_t)lround(cGain * 2 * (1 - kr) * kr / kg * 64);
+		c.vr = (int16_t)lround(cGain * 2 * (1 - kr) * 64);
+		return c;
+	}
+
+	const QsYuvConstants& yuvConstants(video::QeColorMatrix matrix, video::QeColorRange range)
+	{
+		static const QsYuvConstants kConstants[2][2] = {
+			{ makeConstants(0.299, 0.114, false), makeConstants(0.299, 0.114, true) },
+			{ makeConstants(0.2126, 0.0722, false), makeConstants(0.2126, 0.0722, true) },
+		};
+		return kConstants[matrix == video::eMatrixBT709][range == video::eRangeFull];
+	}
+
+	inline int sat16(int v)
+	{
+		return v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+	}
+
+	inline uint8_t clamp8(int v)
+	{
+		return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+	}
+
+	//the reference, every simd step below mirrors one of these operations.
+	inline void yuvPixel(int y, int u, int v, uint8_t* dst, const QsYuvConstants& c, bool bRGBA)
+	{
+		int y1 = sat16((int)(((uint32_t)y * 0x0101u * c.yg) >> 16) + c.yb);
+		u -= 128;
+		v -= 128;
+		uint8_t b = clamp8(sat16(y1 + (int16_t)(u * c.ub)) >> 6);
+		uint8_t g = clamp8(sat16(y1 - (int16_t)(u * c.ug + v * c.vg)) >> 6);
+		uint8_t r = clamp8(sat16(y1 + (int16_t)(v * c.vr)) >> 6);
+		dst[0] = bRGBA ? r : b;
+		dst[1] = g;
+		dst[2] = bRGBA ? b : r;
+		dst[3] = 0xff;
+	}
+
+	//from pixel x on, so the simd rows can finish their tails here.
+	void i420RowC(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int x, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		for (; x < width; ++x)
+			yuvPixel(y[x], u[x >> 1], v[x >> 1], dst + x * 4, c, bRGBA);
+	}
+
+	void nv12RowC(const uint8_t* y, const uint8_t* uv, bool bVU, uint8_t* dst, int x, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		for (; x < width; ++x)
+		{
+			const uint8_t* pair = uv + (x >> 1) * 2;
+			yuvPixel(y[x], pair[bVU ? 1 : 0], pair[bVU ? 0 : 1], dst + x * 4, c, bRGBA);
+		}
+	}
+
+#if QmSimdX86
+	struct QsYuvVec128
+	{
+		__m128i yg, yb, ub, ug, vg, vr, c128, max8, alpha;
+	};
+
+	QmTargetSSE41 inline void loadConstants(QsYuvVec128& k, const QsYuvConstants& c)
+	{
+		k.yg = _mm_set1_epi16((short)c.yg);
+		k.yb = _mm_set1_epi16(c.yb);
+		k.ub = _mm_set1_epi16(c.ub);
+		k.ug = _mm_set1_epi16(c.ug);
+		k.vg = _mm_set1_epi16(c.vg);
+		k.vr = _mm_set1_epi16(c.vr);
+		k.c128 = _mm_set1_epi16(128);
+		k.max8 = _mm_set1_epi16(255);
+		k.alpha = _mm_set1_epi16((short)0xff00);
+	}
+
+	//8 pixels, y/u/v are 16 bit lanes holding 0..255.
+	QmTargetSSE41 inline void yuvPixels8(__m128i y, __m128i u, __m128i v, uint8_t* dst, const QsYuvVec128& k, bool bRGBA)
+	{
+		__m128i zero = _mm_setzero_si128();
+		y = _mm_mulhi_epu16(_mm_or_si128(_mm_slli_epi16(y, 8), y), k.yg);
+		y = _mm_adds_epi16(y, k.yb);
+		u = _mm_sub_epi16(u, k.c128);
+		v = _mm_sub_epi16(v, k.c128);
+		__m128i b = _mm_srai_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(u, k.ub)), 6);
+		__m128i g = _mm_srai_epi16(_mm_subs_epi16(y, _mm_add_epi16(_mm_mullo_epi16(u, k.ug), _mm_mullo_epi16(v, k.vg))), 6);
+		__m128i r = _mm_srai_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(v, k.vr)), 6);
+		if (bRGBA)
+			std::swap(b, r);
+		b = _mm_min_epi16(_mm_max_epi16(b, zero), k.max8);
+		g = _mm_min_epi16(_mm_max_epi16(g, zero), k.max8);
+		r = _mm_min_epi16(_mm_max_epi16(r, zero), k.max8);
+		__m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+		__m128i ra = _mm_or_si128(r, k.alpha);
+		_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(bg, ra));
+		_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(bg, ra));
+	}
+
+	//4 chroma bytes -> 8 lanes, each sample twice.
+	QmTargetSSE41 inline __m128i loadChroma4(const uint8_t* p)
+	{
+		int32_t bytes;
+		memcpy(&bytes, p, 4);
+		__m128i c = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+		return _mm_or_si128(c, _mm_slli_epi32(c, 16));
+	}
+
+	QmTargetSSE41 void i420RowSSE41(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		QsYuvVec128 k;
+		loadConstants(k, c);
+		int x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i y8 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(y + x)));
+			yuvPixels8(y8, loadChroma4(u + (x >> 1)), loadChroma4(v + (x >> 1)), dst + x * 4, k, bRGBA);
+		}
+		i420RowC(y, u, v, dst, x, width, c, bRGBA);
+	}
+
+	QmTargetSSE41 void nv12RowSSE41(const uint8_t* y, const uint8_t* uv, bool bVU, uint8_t* dst, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		QsYuvVec128 k;
+		loadConstants(k, c);
+		__m128i lo = _mm_set1_epi32(0x0000ffff);
+		__m128i hi = _mm_set1_epi32((int)0xffff0000);
+		int x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			//u in the low and v in the high half of each 32 bit lane.
+			__m128i pairs = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(uv + x)));
+			__m128i u = _mm_or_si128(_mm_and_si128(pairs, lo), _mm_slli_epi32(pairs, 16));
+			__m128i v = _mm_or_si128(_mm_and_si128(pairs, hi), _mm_srli_epi32(pairs, 16));
+			if (bVU)
+				std::swap(u, v);
+			__m128i y8 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(y + x)));
+			yuvPixels8(y8, u, v, dst + x * 4, k, bRGBA);
+		}
+		nv12RowC(y, uv, bVU, dst, x, width, c, bRGBA);
+	}
+
+	struct QsYuvVec256
+	{
+		__m256i yg, yb, ub, ug, vg, vr, c128, max8, alpha;
+	};
+
+	QmTargetAVX2 inline void loadConstants(QsYuvVec256& k, const QsYuvConstants& c)
+	{
+		k.yg = _mm256_set1_epi16((short)c.yg);
+		k.yb = _mm256_set1_epi16(c.yb);
+		k.ub = _mm256_set1_epi16(c.ub);
+		k.ug = _mm256_set1_epi16(c.ug);
+		k.vg = _mm256_set1_epi16(c.vg);
+		k.vr = _mm256_set1_epi16(c.vr);
+		k.c128 = _mm256_set1_epi16(128);
+		k.max8 = _mm256_set1_epi16(255);
+		k.alpha = _mm256_set1_epi16((short)0xff00);
+	}
+
+	//16 pixels, the same steps as yuvPixels8 on twice the lanes.
+	QmTargetAVX2 inline void yuvPixels16(__m256i y, __m256i u, __m256i v, uint8_t* dst, const QsYuvVec256& k, bool bRGBA)
+	{
+		__m256i zero = _mm256_setzero_si256();
+		y = _mm256_mulhi_epu16(_mm256_or_si256(_mm256_slli_epi16(y, 8), y), k.yg);
+		y = _mm256_adds_epi16(y, k.yb);
+		u = _mm256_sub_epi16(u, k.c128);
+		v = _mm256_sub_epi16(v, k.c128);
+		__m256i b = _mm256_srai_epi16(_mm256_adds_epi16(y, _mm256_mullo_epi16(u, k.ub)), 6);
+		__m256i g = _mm256_srai_epi16(_mm256_subs_epi16(y, _mm256_add_epi16(_mm256_mullo_epi16(u, k.ug), _mm256_mullo_epi16(v, k.vg))), 6);
+		__m256i r = _mm256_srai_epi16(_mm256_adds_epi16(y, _mm256_mullo_epi16(v, k.vr)), 6);
+		if (bRGBA)
+			std::swap(b, r);
+		b = _mm256_min_epi16(_mm256_max_epi16(b, zero), k.max8);
+		g = _mm256_min_epi16(_mm256_max_epi16(g, zero), k.max8);
+		r = _mm256_min_epi16(_mm256_max_epi16(r, zero), k.max8);
+		__m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+		__m256i ra = _mm256_or_si256(r, k.alpha);
+		//unpack works inside 128 bit lanes: pixels 0-3 8-11 and 4-7 12-15.
+		__m256i p0 = _mm256_unpacklo_epi16(bg, ra);
+		__m256i p1 = _mm256_unpackhi_epi16(bg, ra);
+		_mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(p0, p1, 0x31));
+	}
+
+	QmTargetAVX2 inline __m256i loadChroma8(const uint8_t* p)
+	{
+		__m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+		return _mm256_or_si256(c, _mm256_slli_epi32(c, 16));
+	}
+
+	QmTargetAVX2 void i420RowAVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		QsYuvVec256 k;
+		loadConstants(k, c);
+		int x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			__m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + x)));
+			yuvPixels16(y16, loadChroma8(u + (x >> 1)), loadChroma8(v + (x >> 1)), dst + x * 4, k, bRGBA);
+		}
+		i420RowC(y, u, v, dst, x, width, c, bRGBA);
+	}
+
+	QmTargetAVX2 void nv12RowAVX2(const uint8_t* y, const uint8_t* uv, bool bVU, uint8_t* dst, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		QsYuvVec256 k;
+		loadConstants(k, c);
+		__m256i lo = _mm256_set1_epi32(0x0000ffff);
+		__m256i hi = _mm256_set1_epi32((int)0xffff0000);
+		int x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			__m256i pairs = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(uv + x)));
+			__m256i u = _mm256_or_si256(_mm256_and_si256(pairs, lo), _mm256_slli_epi32(pairs, 16));
+			__m256i v = _mm256_or_si256(_mm256_and_si256(pairs, hi), _mm256_srli_epi32(pairs, 16));
+			if (bVU)
+				std::swap(u, v);
+			__m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + x)));
+			yuvPixels16(y16, u, v, dst + x * 4, k, bRGBA);
+		}
+		nv12RowC(y, uv, bVU, dst, x, width, c, bRGBA);
+	}
+#endif
+
+	void i420RowScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		i420RowC(y, u, v, dst, 0, width, c, bRGBA);
+	}
+
+	void nv12RowScalar(const uint8_t* y, const uint8_t* uv, bool bVU, uint8_t* dst, int width,
+		const QsYuvConstants& c, bool bRGBA)
+	{
+		nv12RowC(y, uv, bVU, dst, 0, width, c, bRGBA);
+	}
+}
+
+namespace video {
+	bool CanConvertToRGB32(int srcFormat, int dstFormat)
+	{
+		if (dstFormat != FOURCC_BGRA && dstFormat != FOURCC_RGBA)
+			return false;
+		switch (srcFormat)
+		{
+		case FOURCC_I420:
+		case FOURCC_YU12:
+		case FOURCC_YV12:
+		case FOURCC_NV12:
+		case FOURCC_NV21:
+			return true;
+		}
+		return false;
+	}
+
+	bool ConvertToRGB32(const uint8_t* const srcData[], const int srcLinesize[], int srcFormat,
+		uint8_t* dst, int dstStride, int dstFormat, int width, int height,
+		QeColorMatrix matrix, QeColorRange range, QeSimdLevel level)
+	{
+		if (!CanConvertToRGB32(srcFormat, dstFormat) || width <= 0 || height <= 0)
+			return false;
+
+		level = ClampSimdLevel(level);
+		const QsYuvConstants& c = yuvConstants(matrix, range);
+		bool bRGBA = dstFormat == FOURCC_RGBA;
+
+		if (srcFormat == FOURCC_NV12 || srcFormat == FOURCC_NV21)
+		{
+			auto row = nv12RowScalar;
+#if QmSimdX86
+			if (level >= eSimdAVX2)
+				row = nv12RowAVX2;
+			else if (level >= eSimdSSE41)
+				row = nv12RowSSE41;
+#endif
+			bool bVU = srcFormat == FOURCC_NV21;
+			for (int i = 0; i < height; ++i)
+			{
+				row(srcData[0] + (ptrdiff_t)i * srcLinesize[0], srcData[1] + (ptrdiff_t)(i >> 1) * srcLinesize[1], bVU,
+					dst + (ptrdiff_t)i * dstStride, width, c, bRGBA);
+			}
+			return true;
+		}
+
+		auto row = i420RowScalar;
+#if QmSimdX86
+		if (level >= eSimdAVX2)
+			row = i420RowAVX2;
+		else if (level >= eSimdSSE41)
+			row = i420RowSSE41;
+#endif
+		//yv12 stores v before u.
+		int iU = srcFormat == FOURCC_YV12 ? 2 : 1;
+		int iV = 3 - iU;
+		for (int i = 0; i < height; ++i)
+		{
+			row(srcData[0] + (ptrdiff_t)i * srcLinesize[0], srcData[iU] + (ptrdiff_t)(i >> 1) * srcLinesize[iU],
+				srcData[iV] + (ptrdiff_t)(i >> 1) * srcLinesize[iV], dst + (ptrdiff_t)i * dstStride, width, c, bRGBA);
+		}
+		return true;
+	}
+}
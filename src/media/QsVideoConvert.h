@@ -0,0 +1,30 @@
+#pragma once
+
+#include "media_global.h"
+#include <stdint.h>
+#include "QsSimd.h"
+
+//Same size yuv 4:2:0 -> rgb32 conversion for the software render paths, next to the layout
+//helpers in QsVideodef.h. Formats are QeFourCC values.
+namespace video {
+	enum QeColorMatrix
+	{
+		eMatrixBT601,
+		eMatrixBT709,
+	};
+
+	enum QeColorRange
+	{
+		eRangeLimited,      //y 16..235, uv 16..240
+		eRangeFull,         //jpeg
+	};
+
+	MEDIA_API bool CanConvertToRGB32(int srcFormat, int dstFormat);
+
+	//I420/YU12/YV12, NV12 or NV21 to BGRA or RGBA, chroma is replicated rather than interpolated.
+	//The math is 16 bit fixed point shared by every level, so the simd paths are bit exact with
+	//eSimdNone. level is capped at DetectSimdLevel(). Returns false for unsupported format pairs.
+	MEDIA_API bool ConvertToRGB32(const uint8_t* const srcData[], const int srcLinesize[], int srcFormat,
+		uint8_t* dst, int dstStride, int dstFormat, int width, int height,
+		QeColorMatrix matrix = eMatrixBT601, QeColorRange range = eRangeLimited, QeSimdLevel level = eSimdAuto);
+}
@@ -1,6 +1,9 @@
 #pragma once
 
-#ifdef MEDIA_DLL
+#ifndef _WIN32
+#define MEDIA_API __attribute__((visibility("default")))
+#define EXPIMP_TEMPLATE
+#elif defined(MEDIA_DLL)
 #define MEDIA_API __declspec(dllexport)
 #define EXPIMP_TEMPLATE
 #else
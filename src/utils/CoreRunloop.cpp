@@ -23,6 +23,7 @@ void CoreRunloop::quit()
     m_exitEvent.setEvent();
 }
 
+#ifdef _WIN32
 void CoreRunloop::run()
 {
 	bool bLoop = true;
@@ -51,6 +52,20 @@ void CoreRunloop::run()
 	}
 	runOnce();
 }
+#else
+//no message queue to pump here, the loop only sleeps on its two events.
+void CoreRunloop::run()
+{
+	const QcEvent* events[] = { &m_exitEvent, &m_wakeupEvent };
+	for (;;)
+	{
+		runOnce();
+		if (QcEvent::waitAny(events, 2) == 0)
+			break;
+	}
+	runOnce();
+}
+#endif
 
 void CoreRunloop::runOnce()
 {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdio>
 #include "libtime.h"
 
 class LogTimeElapsed
@@ -14,7 +15,11 @@ public:
 	~LogTimeElapsed()
 	{
 		std::wstring sLog = m_name + L"=" + std::to_wstring(m_time.elapsedMS()) + L"\n";
+#ifdef _WIN32
 		OutputDebugStringW(sLog.c_str());
+#else
+		fputws(sLog.c_str(), stderr);
+#endif
 	}
 protected:
 	std::wstring m_name;
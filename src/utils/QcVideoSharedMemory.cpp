@@ -1,94 +1,455 @@
 ﻿#include "QcVideoSharedMemory.h"
 #include "QcSharedMemory.h"
+#include "QsVideoCopy.h"
+#include "QcFutex.h"
+#include <atomic>
+#include <chrono>
 #include <algorithm>
-#include "videodef.h"
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
-const int kBlockShift = 18;
-const int kBlockSize = 1 << kBlockShift;
-const int kBlockMask = kBlockSize - 1;
+const uint32_t kRingMagic = MAKE_FOURCC('Q', 'V', 'S', 'M');
+const uint32_t kRingVersion = 2;
+const uint32_t kWriting = 0x80000000u;
+const uint32_t kPageSize = 4096;
+const uint32_t kSlotHeadSize = 256;
+const int kMaxSlots = 64;
 
-static int calcBlocks(int size)
-{
-    return (size + kBlockMask) >> kBlockShift;
+static uint32_t alignUp(uint32_t size, uint32_t align)
+{
+	return (size + align - 1) & ~(align - 1);
 }
 
-QcVideoSharedMemory::QcVideoSharedMemory(const wchar_t* name)
+static int currentProcessId()
+{
+#ifdef _WIN32
+	return (int)GetCurrentProcessId();
+#else
+	return (int)getpid();
+#endif
+}
+
+//lives at the start of the segment; every field after magic is only valid once magic is set.
+struct QcVideoSharedMemory::QsRingHead
+{
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	int writerPid;			//process that last created the ring
+	int nSlots;
+	uint32_t slotSize;		//frame bytes a slot can hold
+	uint32_t slotStride;	//slot header plus data, page aligned
+	//frames published so far, also the word readers park on.
+	alignas(64) std::atomic<int> writeIndex;
+	std::atomic<uint32_t> readerMask;
+	struct alignas(64) QsReader
+	{
+		std::atomic<int> readIndex;		//next frame this reader wants
+		std::atomic<int64_t> dropped;
+	} readers[kMaxReaders];
+};
+
+//state is the number of readers holding the slot, plus kWriting while the writer fills it.
+struct alignas(64) QcVideoSharedMemory::QsSlotHead
 {
-     m_pHead = new QcSharedMemory(name);
+	std::atomic<uint32_t> state;
+	std::atomic<int> frameIndex;	//-1 while empty or being written
+	int width;
+	int height;
+	int format;
+	uint32_t dataSize;
+	uint32_t linesize[QMaxSlice];
+	uint32_t offset[QMaxSlice];
+	int64_t pts;
+	int64_t timestamp;
+};
 
-     std::wstring eventName1 = m_pHead->key() + L"_headChangedEvent";
-     std::wstring eventName2 = m_pHead->key() + L"_frameEvent";
-     m_headChangeEvent = CreateEventW(NULL, FALSE, FALSE, eventName2.c_str());
-     m_frameEvent = CreateEventW(NULL, FALSE, FALSE, eventName1.c_str());
+//a lock based atomic would keep its lock in this process, not in the segment.
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "shared atomics must be lock free");
+
+QcVideoSharedMemory::QcVideoSharedMemory(const wchar_t* name)
+{
+	m_pHead = new QcSharedMemory(name);
 }
 
 QcVideoSharedMemory::~QcVideoSharedMemory()
 {
-    delete m_pHead;
-    m_pHead = nullptr;
+	detach();
+	delete m_pHead;
+	m_pHead = nullptr;
+}
+
+bool QcVideoSharedMemory::create(int nFrameBuffer, int maxWidth, int maxHeight, int format)
+{
+	if (m_pRing || nFrameBuffer < 2 || nFrameBuffer > kMaxSlots)
+		return false;
+
+	uint32_t slotSize = alignUp(video::CalBufNeedSize(maxWidth, maxHeight, format), 64);
+	if (slotSize == 0)
+		return false;
+	uint32_t slotStride = alignUp(kSlotHeadSize + slotSize, kPageSize);
+	uint32_t headSize = alignUp(sizeof(QsRingHead), kPageSize);
+	uint64_t iSize = headSize + (uint64_t)slotStride * nFrameBuffer;
+	if (iSize > INT32_MAX)
+		return false;
+
+	bool bOk = false;
+	m_pHead->lock();
+	//a ring another writer created is taken over in place and has to be large enough for this layout.
+	bool bMapped = m_pHead->create((int)iSize, QcSharedMemory::ReadWrite);
+#ifndef _WIN32
+	//a posix segment outlives a writer that crashed; it is replaced, its readers have to attach again.
+	if (bMapped && !m_pHead->isCreator() && isStale())
+		bMapped = m_pHead->replace((int)iSize, QcSharedMemory::ReadWrite);
+#endif
+	if (bMapped && (uint64_t)m_pHead->size() >= iSize)
+	{
+		m_pRing = (QsRingHead*)m_pHead->data();
+		m_pRing->magic.store(0);
+		m_pRing->version = kRingVersion;
+		m_pRing->writerPid = currentProcessId();
+		m_pRing->nSlots = nFrameBuffer;
+		m_pRing->slotSize = slotSize;
+		m_pRing->slotStride = slotStride;
+		m_pRing->writeIndex.store(0);
+		m_pRing->readerMask.store(0);
+		for (auto& reader : m_pRing->readers)
+		{
+			reader.readIndex.store(0);
+			reader.dropped.store(0);
+		}
+		for (int i = 0; i < nFrameBuffer; ++i)
+		{
+			QsSlotHead* pSlot = slotHead(i);
+			pSlot->state.store(0);
+			pSlot->frameIndex.store(-1);
+		}
+		m_pRing->magic.store(kRingMagic);
+		m_bWriter = true;
+		bOk = true;
+	}
+	else
+	{
+		m_pRing = nullptr;
+		m_pHead->detach();
+	}
+	m_pHead->unlock();
+	return bOk;
 }
 
-bool QcVideoSharedMemory::create(int nFrameBuffer)
+#ifndef _WIN32
+bool QcVideoSharedMemory::isStale() const
 {
-    int iSize = std::max((int)sizeof(QsHeadInfo) + sizeof(QsFrameInfo) * nFrameBuffer, 1024);
-    m_pHead->lock();
-    if (m_pHead->create(iSize, QcSharedMemory::ReadWrite))
-    {
-        m_pHeadInfo = (QsHeadInfo*)m_pHead->data();
-        if (m_pHead->isCreator())
-        {
-			m_pHeadInfo->nFrameBuffer = nFrameBuffer;
-			m_pHeadInfo->writeIndex = 0;
-			m_pHeadInfo->readIndex = 0;
-        }
-    }
-    m_pHead->unlock();
+	//the head is only trusted as far as the version, a ring cut short or of another layout is stale too.
+	const QsRingHead* pRing = (const QsRingHead*)m_pHead->data();
+	if ((uint32_t)m_pHead->size() < sizeof(QsRingHead) || pRing->version != kRingVersion)
+		return true;
+	return kill(pRing->writerPid, 0) != 0 && errno == ESRCH;
 }
+#endif
 
-bool QcVideoSharedMemory::attach(bool bReadOnly /*= false*/)
+bool QcVideoSharedMemory::attach()
 {
-    return m_pHead->attach(bReadOnly ? QcSharedMemory::ReadOnly : QcSharedMemory::ReadWrite);
+	if (m_pRing)
+		return false;
+
+	m_pHead->lock();
+	bool bOk = m_pHead->attach(QcSharedMemory::ReadWrite);
+	QsRingHead* pRing = bOk ? (QsRingHead*)m_pHead->data() : nullptr;
+	bOk = pRing && (uint32_t)m_pHead->size() >= sizeof(QsRingHead)
+		&& pRing->magic.load() == kRingMagic && pRing->version == kRingVersion;
+	if (bOk)
+	{
+		uint32_t mask = pRing->readerMask.load();
+		int id = -1;
+		while (id < 0 && mask != (1u << kMaxReaders) - 1)
+		{
+			int bit = 0;
+			while (mask & (1u << bit))
+				++bit;
+			if (pRing->readerMask.compare_exchange_weak(mask, mask | (1u << bit)))
+				id = bit;
+		}
+		bOk = id >= 0;
+		if (bOk)
+		{
+			m_pRing = pRing;
+			m_readerId = id;
+			pRing->readers[id].dropped.store(0);
+			pRing->readers[id].readIndex.store(pRing->writeIndex.load());
+#ifdef _WIN32
+			std::wstring eventName = m_pHead->key() + L"_frameEvent" + std::to_wstring(id);
+			m_frameEvents[id].init(false, false, eventName.c_str());
+#endif
+		}
+	}
+	if (!bOk)
+		m_pHead->detach();
+	m_pHead->unlock();
+	return bOk;
 }
 
 bool QcVideoSharedMemory::detach()
 {
-    return m_pHead->detach();
+	if (m_pRing)
+	{
+		if (m_bWriter)
+		{
+			if (m_writeSlot >= 0)
+				slotHead(m_writeSlot)->state.fetch_sub(kWriting);
+			//wakes parked readers so they notice the writer went away.
+			m_pRing->magic.store(0);
+			wakeReaders();
+		}
+		else
+		{
+			unLockReadBuffer();
+			m_pRing->readerMask.fetch_and(~(1u << m_readerId));
+		}
+	}
+	m_pRing = nullptr;
+	m_bWriter = false;
+	m_readerId = -1;
+	m_writeSlot = -1;
+	m_readSlot = -1;
+	return m_pHead->detach();
 }
 
-void* QcVideoSharedMemory::lockWriteBuffer(int w, int h, int format, bool bOverWrite /*= false*/)
+bool QcVideoSharedMemory::lockWriteBuffer(int w, int h, int format, QsSharedFrame& frame)
 {
-    uint32_t blockSize = (video::CalBufNeedSize(w, h, format) + kBlockMask) & kBlockSize;
-    if (m_pBlockInfo && m_pBlockInfo->blockSize != blockSize)
-    {
-        delete m_pData;
-        m_pBlockInfo = nullptr;
-    }
-    if (m_pBlockInfo == nullptr)
-    {
-        ++m_pHeadInfo->mapID;
+	if (!m_bWriter || m_writeSlot >= 0)
+		return false;
+	uint32_t dataSize = video::CalBufNeedSize(w, h, format);
+	if (dataSize == 0 || dataSize > m_pRing->slotSize)
+		return false;
+
+	//oldest slot first, empty slots are -1 and come before every frame.
+	int order[kMaxSlots];
+	int nSlots = m_pRing->nSlots;
+	for (int i = 0; i < nSlots; ++i)
+		order[i] = i;
+	std::sort(order, order + nSlots, [this](int a, int b) {
+		return slotHead(a)->frameIndex.load(std::memory_order_relaxed) < slotHead(b)->frameIndex.load(std::memory_order_relaxed);
+	});
+	for (int i = 0; i < nSlots; ++i)
+	{
+		QsSlotHead* pSlot = slotHead(order[i]);
+		uint32_t expected = 0;
+		if (pSlot->state.compare_exchange_strong(expected, kWriting))
+		{
+			m_writeSlot = order[i];
+			break;
+		}
+	}
+	if (m_writeSlot < 0)
+		return false;
 
-        std::wstring newName = m_pHead->key() + L"_map" + std::to_wstring(m_pHeadInfo->mapID);
-        m_pData = new QcSharedMemory(newName);
-        m_pData->create(m_pHeadInfo->frameBufferCount * blockSize + sizeof(QsBlockInfo));
-        m_pBlockInfo = (QsBlockInfo*)m_pData->data();
-        m_pBlockInfo->blockSize = blockSize;
-        m_pBlockInfo->readIndex = 0;
-        m_pBlockInfo->writeIndex = 0;
-    }
+	QsSlotHead* pSlot = slotHead(m_writeSlot);
+	pSlot->frameIndex.store(-1);
+	pSlot->width = w;
+	pSlot->height = h;
+	pSlot->format = format;
+	pSlot->dataSize = dataSize;
 
+	frame = QsSharedFrame();
+	uint8_t* pData = slotData(m_writeSlot);
+	video::FillVideoFrameInfo(pData, w, h, format, frame.data, frame.linesize);
+	for (int p = 0; p < QMaxSlice; ++p)
+	{
+		pSlot->linesize[p] = frame.linesize[p];
+		pSlot->offset[p] = frame.data[p] ? (uint32_t)(frame.data[p] - pData) : 0;
+	}
+	frame.width = w;
+	frame.height = h;
+	frame.format = format;
+	return true;
 }
 
-bool QcVideoSharedMemory::ensureFrameBuffer(int w, int h, int format)
+void QcVideoSharedMemory::unLockWriteBuffer(int64_t pts)
 {
-	frameInfo(m_pHead->ReadWrite);
+	if (m_writeSlot < 0)
+		return;
+
+	QsSlotHead* pSlot = slotHead(m_writeSlot);
+	int index = m_pRing->writeIndex.load(std::memory_order_relaxed);
+	pSlot->pts = pts;
+	pSlot->timestamp = now();
+	pSlot->frameIndex.store(index);
+	pSlot->state.fetch_sub(kWriting);
+	m_pRing->writeIndex.store(index + 1);
+	m_writeSlot = -1;
+	wakeReaders();
 }
 
-void QcVideoSharedMemory::unLockWriteBuffer()
+bool QcVideoSharedMemory::writeFrame(const uint8_t* const data[QMaxSlice], const uint32_t linesize[QMaxSlice], int w, int h, int format, int64_t pts)
 {
+	QsSharedFrame frame;
+	if (!lockWriteBuffer(w, h, format, frame))
+		return false;
+	//readers pull the frame into their own caches, so the writer's copy bypasses its cache.
+	video::CopyVideoFrameFast(frame.data, frame.linesize, data, linesize, format, w, h, video::eCopyWriteOnly);
+	unLockWriteBuffer(pts);
+	return true;
+}
+
+bool QcVideoSharedMemory::lockReadBuffer(QsSharedFrame& frame, int waitTime)
+{
+	if (!m_pRing || m_bWriter || m_readSlot >= 0)
+		return false;
+
+	auto& reader = m_pRing->readers[m_readerId];
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(waitTime, 0));
+	for (;;)
+	{
+		if (m_pRing->magic.load() != kRingMagic)
+			return false;
+
+		int lastWriteIndex = m_pRing->writeIndex.load();
+		int cursor = reader.readIndex.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			//smallest published frame not read yet.
+			int slot = -1;
+			int frameIndex = INT32_MAX;
+			for (int i = 0; i < m_pRing->nSlots; ++i)
+			{
+				int index = slotHead(i)->frameIndex.load();
+				if (index >= cursor && index < frameIndex)
+				{
+					frameIndex = index;
+					slot = i;
+				}
+			}
+			if (slot < 0)
+				break;
+
+			//pinning races the writer: back off if it got the slot first or reused it meanwhile.
+			QsSlotHead* pSlot = slotHead(slot);
+			uint32_t state = pSlot->state.fetch_add(1);
+			if ((state & kWriting) || pSlot->frameIndex.load() != frameIndex)
+			{
+				pSlot->state.fetch_sub(1);
+				continue;
+			}
+
+			if (frameIndex > cursor)
+				reader.dropped.fetch_add(frameIndex - cursor, std::memory_order_relaxed);
+			reader.readIndex.store(frameIndex + 1, std::memory_order_relaxed);
+			m_readSlot = slot;
+
+			uint8_t* pData = slotData(slot);
+			frame = QsSharedFrame();
+			frame.width = pSlot->width;
+			frame.height = pSlot->height;
+			frame.format = pSlot->format;
+			frame.pts = pSlot->pts;
+			frame.timestamp = pSlot->timestamp;
+			frame.frameIndex = frameIndex;
+			for (int p = 0; p < QMaxSlice; ++p)
+			{
+				frame.linesize[p] = pSlot->linesize[p];
+				frame.data[p] = pSlot->linesize[p] ? pData + pSlot->offset[p] : nullptr;
+			}
+			return true;
+		}
 
+		int remain = waitTime;
+		if (waitTime > 0)
+		{
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			remain = (int)std::max<int64_t>(left.count(), 0);
+		}
+		if (waitTime == 0 || (waitTime > 0 && remain == 0))
+			return false;
+		waitFrame(lastWriteIndex, remain);
+	}
+}
+
+void QcVideoSharedMemory::unLockReadBuffer()
+{
+	if (m_readSlot < 0)
+		return;
+	slotHead(m_readSlot)->state.fetch_sub(1);
+	m_readSlot = -1;
+}
+
+int64_t QcVideoSharedMemory::droppedFrames() const
+{
+	if (!m_pRing)
+		return 0;
+	if (!m_bWriter)
+		return m_pRing->readers[m_readerId].dropped.load(std::memory_order_relaxed);
+
+	int64_t dropped = 0;
+	uint32_t mask = m_pRing->readerMask.load();
+	for (int i = 0; i < kMaxReaders; ++i)
+	{
+		if (mask & (1u << i))
+			dropped += m_pRing->readers[i].dropped.load(std::memory_order_relaxed);
+	}
+	return dropped;
+}
+
+int QcVideoSharedMemory::writtenFrames() const
+{
+	return m_pRing ? m_pRing->writeIndex.load(std::memory_order_relaxed) : 0;
+}
+
+int QcVideoSharedMemory::readerCount() const
+{
+	int count = 0;
+	uint32_t mask = m_pRing ? m_pRing->readerMask.load() : 0;
+	for (; mask; mask &= mask - 1)
+		++count;
+	return count;
+}
+
+int64_t QcVideoSharedMemory::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QcVideoSharedMemory::QsSlotHead* QcVideoSharedMemory::slotHead(int index) const
+{
+	uint8_t* pBase = (uint8_t*)m_pRing + alignUp(sizeof(QsRingHead), kPageSize);
+	return (QsSlotHead*)(pBase + (size_t)m_pRing->slotStride * index);
+}
+
+uint8_t* QcVideoSharedMemory::slotData(int index) const
+{
+	static_assert(sizeof(QsSlotHead) <= kSlotHeadSize, "slot header outgrew its space");
+	return (uint8_t*)slotHead(index) + kSlotHeadSize;
+}
+
+void QcVideoSharedMemory::wakeReaders()
+{
+#ifdef _WIN32
+	//one auto reset event per reader seat, opened by name the first time that seat is used.
+	uint32_t mask = m_pRing->readerMask.load();
+	for (int i = 0; i < kMaxReaders; ++i)
+	{
+		if (!(mask & (1u << i)))
+			continue;
+		if (!m_frameEvents[i])
+		{
+			std::wstring eventName = m_pHead->key() + L"_frameEvent" + std::to_wstring(i);
+			m_frameEvents[i].init(false, false, eventName.c_str());
+		}
+		m_frameEvents[i].setEvent();
+	}
+#else
+	QcFutex::wakeAllShared(m_pRing->writeIndex);
+#endif
 }
 
-QsFrameInfo* QcVideoSharedMemory::frameInfo(int index)
+bool QcVideoSharedMemory::waitFrame(int lastWriteIndex, int timeoutMs)
 {
-	return m_pHeadInfo->frameInfo[index % m_pHeadInfo->nFrameBuffer];
+#ifdef _WIN32
+	(void)lastWriteIndex;
+	return m_frameEvents[m_readerId].wait(timeoutMs);
+#else
+	return QcFutex::waitShared(m_pRing->writeIndex, lastWriteIndex, timeoutMs);
+#endif
 }
@@ -1,54 +1,79 @@
-﻿#pragma once
-
-#include <windows.h>
+﻿#pragma once
+
 #include <stdint.h>
-#include <string>
-
-class QcSharedMemory;
-class QcVideoSharedMemory
+#include <string>
+#include "QsVideodef.h"
+#include "QcEvent.h"
+
+class QcSharedMemory;
+
+//A frame published to, or locked from, the ring. data points straight into shared memory.
+struct QsSharedFrame
 {
-    struct QsHeadInfo
-    {
-        int readIndex;
-        int writeIndex;
-		int nFrameBuffer;
-		uint8_t reverse[64];
-		QsFrameInfo frameInfo[0];
-    };
-	struct QsFrameInfo
-	{
-		int mapID;
-		int bufferSize;
-		int width;
-		int heigth;
-		int format;
-		unsigned long long m_timeStamp;
-		uint8_t reverse[64];
-		uint8_t data[0];
-	};
-	struct QsFrameData
-	{
-		QcSharedMemory* m_pData;
-	};
-public:
-    QcVideoSharedMemory(const wchar_t* name);
-    ~QcVideoSharedMemory();
-
-    bool create(int nFrameBuffer);
-    bool attach(bool bReadOnly);
-    bool detach();
-
-    void* lockWriteBuffer(int w, int h, int format, bool bOverWrite = false);
-    void unLockWriteBuffer();
-
-    void* lockReadBuffer(int waitTime = 0);
-    void unLockReadBuffer();
+	int width = 0;
+	int height = 0;
+	int format = 0;
+	int64_t pts = 0;
+	int64_t timestamp = 0;	//QcVideoSharedMemory::now() when the writer published it
+	int frameIndex = -1;
+	uint8_t* data[QMaxSlice] = {};
+	uint32_t linesize[QMaxSlice] = {};
+};
+
+//Decoded frames handed to other processes through one shared memory segment.
+//The writer owns a ring of fixed size slots, each with its own header (size, format, strides, pts),
+//and readers get pointers into the slot, so a frame is copied once, into shared memory.
+//When every slot is full the writer overwrites the oldest one no reader holds; a slow reader skips
+//ahead to the oldest newer frame and counts the ones it missed in droppedFrames().
+//A reader that crashes while it holds a frame keeps that slot pinned until the ring is recreated.
+class QcVideoSharedMemory
+{
+	struct QsRingHead;
+	struct QsSlotHead;
+public:
+	enum { kMaxReaders = 16 };
+
+	QcVideoSharedMemory(const wchar_t* name);
+	~QcVideoSharedMemory();
+
+	//writer: maps nFrameBuffer slots, each large enough for a maxWidth x maxHeight frame of format.
+	bool create(int nFrameBuffer, int maxWidth, int maxHeight, int format);
+	//reader: opens the ring of a running writer and takes one of kMaxReaders reader seats.
+	bool attach();
+	bool detach();
+	bool isWriter() const { return m_bWriter; }
+
+	//false when the frame does not fit a slot or every slot is held by readers (the frame is dropped).
+	bool lockWriteBuffer(int w, int h, int format, QsSharedFrame& frame);
+	void unLockWriteBuffer(int64_t pts);
+	bool writeFrame(const uint8_t* const data[QMaxSlice], const uint32_t linesize[QMaxSlice], int w, int h, int format, int64_t pts);
+
+	//next frame after the last one this reader locked, waitTime ms (< 0 forever). Valid until unLockReadBuffer.
+	bool lockReadBuffer(QsSharedFrame& frame, int waitTime = 0);
+	void unLockReadBuffer();
+
+	int64_t droppedFrames() const;
+	int writtenFrames() const;
+	int readerCount() const;
+	//steady clock in microseconds, comparable between processes on the same machine.
+	static int64_t now();
 protected:
-    bool ensureFrameBuffer(int w, int h, int format);
-	QsFrameInfo* frameInfo(int index);
+	QsSlotHead* slotHead(int index) const;
+	uint8_t* slotData(int index) const;
+	void wakeReaders();
+	bool waitFrame(int lastWriteIndex, int timeoutMs);
+#ifndef _WIN32
+	//the mapped ring was left by a writer process that no longer exists.
+	bool isStale() const;
+#endif
 private:
-    QsHeadInfo* m_pHeadInfo = nullptr;
-    QcSharedMemory* m_pHead = nullptr;
-    HANDLE m_headChangeEvent = 0;
-    HANDLE m_frameEvent = 0;
-};
+	QcSharedMemory* m_pHead = nullptr;
+	QsRingHead* m_pRing = nullptr;
+	bool m_bWriter = false;
+	int m_readerId = -1;
+	int m_writeSlot = -1;
+	int m_readSlot = -1;
+#ifdef _WIN32
+	QcEvent m_frameEvents[kMaxReaders];
+#endif
+};
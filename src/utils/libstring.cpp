@@ -1,5 +1,19 @@
 ﻿#include "libstring.h"
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <codecvt>
+#include <locale>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#ifndef CP_ACP
+#define CP_ACP 0
+#endif
+#ifndef CP_UTF8
+#define CP_UTF8 65001
+#endif
+#endif
 #include <string>
 #include <regex>
 #include <map>
@@ -14,10 +28,26 @@ namespace libstring
         {
             size = (int)strlen(str);
         }
+#ifndef _WIN32
+        //only utf-8 and the current locale are supported off windows.
+        std::string src(str, size);
+        if (codePage == CP_UTF8)
+        {
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
+            return conv.from_bytes(src);
+        }
+        size_t charsNeed = mbstowcs(nullptr, src.c_str(), 0);
+        if (charsNeed == (size_t)-1)
+            return wstr;
+        wstr.resize(charsNeed);
+        mbstowcs(&wstr[0], src.c_str(), charsNeed);
+        return wstr;
+#else
         int bytesNeed = MultiByteToWideChar(codePage, 0, str, size, 0, 0);
         wstr.resize(bytesNeed);
         MultiByteToWideChar(codePage, 0, str, size, const_cast<wchar_t *>(wstr.c_str()), bytesNeed);
         return wstr;
+#endif
     }
 
     std::string toMultiByte(uint32_t codePage, const wchar_t *wstr, int size /*= -1*/)
@@ -27,10 +57,25 @@ namespace libstring
         {
             size = (int)wcslen(wstr);
         }
+#ifndef _WIN32
+        std::wstring src(wstr, size);
+        if (codePage == CP_UTF8)
+        {
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
+            return conv.to_bytes(src);
+        }
+        size_t bytesNeed = wcstombs(nullptr, src.c_str(), 0);
+        if (bytesNeed == (size_t)-1)
+            return str;
+        str.resize(bytesNeed);
+        wcstombs(&str[0], src.c_str(), bytesNeed);
+        return str;
+#else
         int bytesNeed = WideCharToMultiByte(codePage, NULL, wstr, size, NULL, 0, NULL, FALSE);
         str.resize(bytesNeed);
         WideCharToMultiByte(codePage, NULL, wstr, size, const_cast<char *>(str.c_str()), bytesNeed, NULL, FALSE);
         return str;
+#endif
     }
 
     std::wstring fromUtf8(const char *str, int size /*= -1*/)
@@ -263,22 +263,18 @@ void WASAPICapture::captureThread()
     QmComInit();
 
     /* Output devices don't signal, so just make it check every 10 ms */
-    DWORD        dur = m_bInputDevice ? 3000 : 100;
-    HANDLE wait_array[] = { m_stopEvent, m_captureReadyEvent };
+    int          dur = m_bInputDevice ? 3000 : 100;
+    const QcEvent* wait_array[] = { &m_stopEvent, &m_captureReadyEvent };
     for (;;)
     {
-        DWORD wait_result = WaitForMultipleObjects(sizeof(wait_array) / sizeof(HANDLE), wait_array, FALSE, dur);
-        if (wait_result == WAIT_OBJECT_0 + 0)
+        int wait_result = QcEvent::waitAny(wait_array, 2, dur);
+        if (wait_result == 0)
         {
             break;
         }
-        else if (wait_result == WAIT_OBJECT_0 + 1 || wait_result == WAIT_TIMEOUT)
-        {
-            captureData();
-        }
         else
         {
-            //error.
+            captureData();
         }
     }
 }
@@ -315,7 +311,8 @@ void WASAPICapture::captureData()
             data.data[0] = (const uint8_t *)buffer;
             data.frames = (uint32_t)frames;
 
-            data.timestamp = GetTickCount();
+            //the device's qpc position of the first frame in 100ns units, steadier than reading the clock here.
+            data.timestamp = ts / 10;
 
             m_audioCb(&data);
         }
@@ -183,7 +183,12 @@ HRESULT WASAPIPlayer::_InitClient(const WAVEFORMATEX* pcmFormat, QsAudioPara* pC
         m_render = render;
         m_volControl = volControl;
 
-        m_pRingBuffer.reset(new QcRingBuffer(m_bufferFrameCount * pUseFormat->nBlockAlign * 4));
+        //the player keeps the sink filled ahead of the device, leave it room for that on top of the device buffer.
+        uint32_t ringBytes = std::max<uint32_t>(m_bufferFrameCount * pUseFormat->nBlockAlign * 4, pUseFormat->nAvgBytesPerSec / 4);
+        //the decode thread writes and the render thread reads without a lock between them.
+        m_pRingBuffer.reset(new QcRingBuffer(ringBytes, QcRingBuffer::eSpsc));
+        m_blockAlign = pUseFormat->nBlockAlign;
+        m_sampleRate = pUseFormat->nSamplesPerSec;
         packet_size_frames_ = pUseFormat->nSamplesPerSec / 100;
         packet_size_bytes_ = pUseFormat->nBlockAlign * packet_size_frames_;
 
@@ -244,11 +249,30 @@ void WASAPIPlayer::stop()
 
 void WASAPIPlayer::playAudio(const uint8_t* pcm, int nLen)
 {
-    std::unique_lock<std::mutex> lock(m_bufferMutex);
-    int usableSize = m_pRingBuffer->usableSize();
-    if (nLen > usableSize)
-        m_pRingBuffer->read(nullptr, nLen - usableSize);
-    m_pRingBuffer->write((const char*)pcm, nLen);
+    //only the render thread may move the read side, so a full ring drops the newest whole frames
+    //instead of the oldest; the caller paces itself on pendingTime() and overflowBytes() counts them.
+    if (!m_pRingBuffer)
+        return;
+    m_pRingBuffer->writeSpsc((const char*)pcm, nLen, m_blockAlign);
+}
+
+int WASAPIPlayer::pendingTime()
+{
+    if (m_sampleRate == 0 || !m_pRingBuffer)
+        return -1;
+
+    size_t ringFrames = m_pRingBuffer->size() / m_blockAlign;
+    return (int)((ringFrames + m_paddingFrames) * 1000 / m_sampleRate);
+}
+
+uint64_t WASAPIPlayer::overflowBytes() const
+{
+    return m_pRingBuffer ? m_pRingBuffer->overflowBytes() : 0;
+}
+
+uint64_t WASAPIPlayer::underflowCount() const
+{
+    return m_pRingBuffer ? m_pRingBuffer->underflowCount() : 0;
 }
 
 void WASAPIPlayer::SetVolume(float fVolume)
@@ -270,15 +294,15 @@ float WASAPIPlayer::Volume() const
 
 void WASAPIPlayer::playThread()
 {
-    HANDLE wait_array[] = { m_stopEvent, m_readyPlayEvent };
+    const QcEvent* wait_array[] = { &m_stopEvent, &m_readyPlayEvent };
     for (;;)
     {
-        DWORD wait_result = WaitForMultipleObjects(sizeof(wait_array)/sizeof(HANDLE), wait_array, FALSE,INFINITE);
-        if (wait_result == WAIT_OBJECT_0 + 0)
+        int wait_result = QcEvent::waitAny(wait_array, 2);
+        if (wait_result == 0)
         {
             break;
         }
-        else if (wait_result == WAIT_OBJECT_0 + 1)
+        else if (wait_result == 1)
         {
             fillPcmData();
         }
@@ -309,19 +333,17 @@ void WASAPIPlayer::fillPcmData()
             return;
         }
 
+        //copies straight from the ring into the endpoint buffer, a short ring plays a packet of silence.
         DWORD flags = AUDCLNT_BUFFERFLAGS_SILENT;
+        QcRingBuffer::QsReadSpan span = m_pRingBuffer->acquireRead(packet_size_bytes_);
+        if (span.size() == packet_size_bytes_)
         {
-            std::unique_lock<std::mutex> lock(m_bufferMutex);
-            if (m_pRingBuffer->size() > packet_size_bytes_)
-            {
-                m_pRingBuffer->read((char*)audio_data, packet_size_bytes_);
-                flags = 0;
-            }
-			else
-			{
-				flags = flags;
-			}
+            memcpy(audio_data, span.data1, span.size1);
+            memcpy(audio_data + span.size1, span.data2, span.size2);
+            m_pRingBuffer->commitRead(span.size());
+            flags = 0;
         }
         m_render->ReleaseBuffer(packet_size_frames_, flags);
     }
+    m_paddingFrames = num_queued_frames + (uint32_t)(num_packets * packet_size_frames_);
 }
@@ -4,6 +4,7 @@
 #include "QcEvent.h"
 #include <thread>
 #include <mutex>
+#include <atomic>
 
 struct IMMDeviceEnumerator;
 struct IMMDevice;
@@ -24,6 +25,11 @@ public:
     void stop();
 
     void playAudio(const uint8_t* pcm, int nLen);
+    //ms of audio accepted by playAudio that the device has not played yet, -1 before init.
+    int pendingTime();
+    //bytes playAudio dropped on a full ring, packets played as silence on an empty one.
+    uint64_t overflowBytes() const;
+    uint64_t underflowCount() const;
     void SetVolume(float fVolume);
     float Volume() const;
 protected:
@@ -48,11 +54,14 @@ protected:
     uint32_t m_bufferFrameCount = 0;
     uint32_t packet_size_frames_ = 0;
     uint32_t packet_size_bytes_ = 0;
+    uint32_t m_blockAlign = 0;
+    uint32_t m_sampleRate = 0;
+    //frames handed to the device that it has not played yet, refreshed on every fill.
+    std::atomic<uint32_t> m_paddingFrames{ 0 };
 
     QcEvent m_stopEvent;
     QcEvent m_readyPlayEvent;
     std::thread m_playingThread;
 
-    std::mutex m_bufferMutex;
     std::unique_ptr<QcRingBuffer> m_pRingBuffer;
 };